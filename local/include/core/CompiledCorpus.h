@@ -0,0 +1,182 @@
+/** @file
+ * Declaration of CompiledCorpus, a binary file of parsed replay files.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "yaml-cpp/yaml.h"
+
+#include "swoc/Errata.h"
+#include "swoc/swoc_file.h"
+
+/** A read-only, memory-mapped file of the parsed node trees of a set of
+ * replay files.
+ *
+ * A corpus is compiled once from the replay files by CompiledCorpus::Builder
+ * and can then be loaded in place of them: the trees are read straight from
+ * the mapping, so loading needs no file system scan, no YAML or JSON
+ * scanning, and no merge key processing.
+ *
+ * The corpus is a pre-tokenized cache, not a serialization of the loaded
+ * transactions. The replay file handlers build the transactions from the
+ * trees as they do from parsed files, so localization and the construction
+ * of fields and rules still happen at every load.
+ *
+ * The file is a header followed by fixed size file and node records and a
+ * string table. All references are offsets into the file, so the mapping can
+ * be used wherever it is mapped. Each container's children are stored
+ * contiguously after it: a sequence's elements, or a map's keys and values
+ * alternately. Integers are stored in host byte order: a corpus is meant to
+ * be used on the machine type that compiled it.
+ */
+class CompiledCorpus
+{
+public:
+  /// The value find_file returns for a path that is not in the corpus.
+  static constexpr uint32_t NO_FILE = std::numeric_limits<uint32_t>::max();
+
+  /// The current version of the file format. Other versions are rejected.
+  static constexpr uint32_t VERSION = 1;
+
+  /** Collects the node trees of a set of replay files and writes the corpus
+   * file.
+   */
+  class Builder
+  {
+  public:
+    /** Add a replay file to the corpus.
+     *
+     * @param[in] path The path of the replay file, relative to the replay
+     * directory.
+     *
+     * @param[in] root The root of the replay file's parsed and merged tree.
+     */
+    void add_file(std::string_view path, YAML::Node const &root);
+
+    /** Write the corpus to a file.
+     *
+     * @param[in] path The file to write. It is replaced if it exists.
+     *
+     * @return Any errors writing the file.
+     */
+    swoc::Errata write(swoc::file::path const &path);
+
+  private:
+    struct Node
+    {
+      uint32_t type = 0;
+      uint32_t count = 0;
+      uint64_t offset = 0;
+      uint64_t length = 0;
+    };
+
+    /// Record @a node, already allocated at @a index, and its descendants.
+    void add_node(size_t index, YAML::Node const &node);
+
+    /// Add @a s to the string table, returning its offset.
+    uint64_t add_string(std::string_view s);
+
+    std::vector<std::pair<std::string, uint64_t>> _files;
+    std::vector<Node> _nodes;
+    std::string _strings;
+    /// The offsets of the strings already in the table, so each is stored once.
+    std::unordered_map<std::string, uint64_t> _string_offsets;
+  };
+
+  CompiledCorpus(CompiledCorpus const &) = delete;
+  CompiledCorpus &operator=(CompiledCorpus const &) = delete;
+  /// Unmaps the file.
+  ~CompiledCorpus();
+
+  /** Whether a file is a compiled corpus.
+   *
+   * @param[in] path The file to check.
+   *
+   * @return True if path starts with the corpus file identifier.
+   */
+  static bool is_compiled_corpus(swoc::file::path const &path);
+
+  /** Map a corpus file into memory.
+   *
+   * @param[in] path The corpus file written by a Builder.
+   *
+   * @return The mapped corpus, or nullptr and errors if the file cannot be
+   * mapped or is not a valid corpus of this version.
+   */
+  static swoc::Rv<std::unique_ptr<CompiledCorpus>> open(swoc::file::path const &path);
+
+  /** Look up a replay file by its path.
+   *
+   * @param[in] path The path with which the file was added to the Builder.
+   *
+   * @return The file's identifier, or NO_FILE if it is not in the corpus.
+   */
+  uint32_t find_file(std::string_view path) const;
+
+  /** The path of a replay file, relative to the replay directory.
+   *
+   * @param[in] file_id An identifier less than get_file_count().
+   */
+  std::string_view get_file_path(uint32_t file_id) const;
+
+  /** Build the node tree of a replay file.
+   *
+   * @param[in] file_id An identifier less than get_file_count().
+   *
+   * @param[in] tag_sources Whether the corpus stays mapped for the rest of
+   * the process, in which case each scalar is tagged with its text in the
+   * mapping (see ScalarSource).
+   *
+   * @return The root of the file's tree. The nodes carry no marks.
+   */
+  YAML::Node get_root(uint32_t file_id, bool tag_sources = false) const;
+
+  size_t get_file_count() const;
+
+  /// The size of the corpus file.
+  size_t get_size() const;
+
+private:
+  struct Header;
+  struct FileRecord;
+  struct NodeRecord;
+
+  CompiledCorpus(void const *data, size_t size);
+
+  /** Check that every reference in the file is in bounds and that children
+   * follow their parents, so trees can be built without further checks.
+   */
+  bool is_valid() const;
+
+  Header const &get_header() const;
+  FileRecord const *get_file_records() const;
+  NodeRecord const *get_node_records() const;
+  std::string_view get_string(uint64_t offset, uint64_t length) const;
+
+  /// Create the node for @a record, without its children.
+  YAML::Node make_node(NodeRecord const &record, bool tag_sources) const;
+
+  /// Add the children of the container @a record to @a node.
+  void add_children(YAML::Node &node, NodeRecord const &record, bool tag_sources) const;
+
+private:
+  /// The start of the mapping.
+  char const *_data = nullptr;
+  /// The size of the mapping.
+  size_t _size = 0;
+  /// The offset of the string table in the mapping.
+  size_t _strings_offset = 0;
+  /// The identifiers of the files by path.
+  std::unordered_map<std::string_view, uint32_t> _file_ids;
+};
@@ -0,0 +1,79 @@
+/** @file
+ * Declaration of CompressedFile, the reader of compressed replay files.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "swoc/Errata.h"
+#include "swoc/swoc_file.h"
+
+/** Reads gzip and zstd compressed replay files.
+ *
+ * A replay file is compressed if its name has a ".gz" or ".zst" extension
+ * after its ".json" or ".yaml" one, such as "sessions.json.zst". The file is
+ * read a block at a time and each block is decompressed as it is read, so
+ * the compressed file is never held in memory whole and its pages are
+ * released from the page cache once they are decompressed.
+ */
+class CompressedFile
+{
+public:
+  /// The compression formats of replay files.
+  enum class Format {
+    NONE,
+    GZIP,
+    ZSTD,
+  };
+
+  /// The size of the blocks in which a compressed file is read.
+  static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+  /** The compression format of a file, by its extension.
+   *
+   * @param[in] path The file path.
+   *
+   * @return GZIP for a ".gz" extension, ZSTD for a ".zst" extension, and NONE
+   * otherwise. Extensions are matched regardless of case.
+   */
+  static Format get_format(swoc::file::path const &path);
+
+  /** Whether a file is compressed.
+   *
+   * @param[in] path The file path.
+   *
+   * @return True if get_format for path is not NONE.
+   */
+  static bool is_compressed(swoc::file::path const &path);
+
+  /** The path of a file without its compression extension.
+   *
+   * This names the decompressed content, so that its format can be told
+   * from its extension as for an uncompressed file.
+   *
+   * @param[in] path The file path.
+   *
+   * @return path without a ".gz" or ".zst" extension, or path itself if it
+   * is not compressed.
+   */
+  static swoc::file::path get_content_path(swoc::file::path const &path);
+
+  /** Read and decompress a compressed file.
+   *
+   * Files of concatenated gzip members or zstd frames are decompressed
+   * whole.
+   *
+   * @param[in] path The file, in the format get_format reports for it.
+   *
+   * @param[out] compressed_size The number of compressed bytes read.
+   *
+   * @return The decompressed content, or errors if the file cannot be read
+   * or is not valid compressed data.
+   */
+  static swoc::Rv<std::string> load(swoc::file::path const &path, size_t &compressed_size);
+};
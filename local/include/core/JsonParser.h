@@ -0,0 +1,94 @@
+/** @file
+ * Declaration of JsonParser, a native parser for JSON replay files.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "yaml-cpp/yaml.h"
+
+#include "swoc/Errata.h"
+#include "swoc/TextView.h"
+#include "swoc/swoc_file.h"
+
+/** Parses JSON text directly into a YAML node tree.
+ *
+ * JSON is a subset of YAML, so YAML::Load can parse JSON replay files, but
+ * its general purpose scanner dominates the load time of large generated
+ * corpora. This parser handles only JSON and builds the same tree YAML::Load
+ * would, so the replay file handlers need not distinguish between the
+ * formats: strings and numbers become scalars holding their text, true and
+ * false become the scalars "true" and "false", and null becomes a null node.
+ *
+ * The nodes carry no marks, so diagnostics about a natively parsed file
+ * cannot name the line of the offending node.
+ */
+class JsonParser
+{
+public:
+  /// The maximum nesting depth of objects and arrays, as with yaml-cpp.
+  static constexpr int MAX_DEPTH = 1000;
+
+  /** Parse a JSON document.
+   *
+   * @param[in] text The JSON text.
+   *
+   * @param[out] has_merge_key Set to whether any object has the YAML merge
+   * key ("<<"), in which case the caller should apply yaml_merge to the tree
+   * as it would to a tree from YAML::Load.
+   *
+   * @param[in] tag_sources Whether text stays mapped for the rest of the
+   * process, in which case each string or number value that is written in
+   * text without escapes is tagged with its text there (see ScalarSource).
+   *
+   * @return The root node of the document, or errors locating the first
+   * syntax error in text.
+   */
+  static swoc::Rv<YAML::Node>
+  parse(swoc::TextView text, bool &has_merge_key, bool tag_sources = false);
+
+  /// The documents split_array splits a JSON document into.
+  struct ArraySplit
+  {
+    /// The document with the split array emptied.
+    std::string remainder;
+    /// Documents with the same array member holding consecutive runs of the
+    /// array's elements, in order.
+    std::vector<std::string> chunks;
+  };
+
+  /** Split the elements of an array member of a JSON object into documents
+   * that can be parsed concurrently.
+   *
+   * The text is only scanned for the boundaries of the object's members and
+   * the array's elements, not validated: a chunk of an invalid document may
+   * fail to parse, in which case the caller should parse the whole document.
+   *
+   * @param[in] text The JSON text of an object.
+   *
+   * @param[in] key The name of the array member of the object to split. It
+   * must not need escaping.
+   *
+   * @param[in] max_chunks The maximum number of chunks to split the array
+   * into. The elements are divided into runs of about the same size.
+   *
+   * @return The split document, or no chunks if text is not an object with
+   * a single key member that is an array of at least two elements, or if
+   * max_chunks is less than two.
+   */
+  static ArraySplit split_array(swoc::TextView text, std::string_view key, size_t max_chunks);
+
+  /** Whether a replay file should be parsed by parse rather than YAML::Load.
+   *
+   * @param[in] path The replay file path.
+   *
+   * @return True if path has a ".json" extension.
+   */
+  static bool is_json_file(swoc::file::path const &path);
+};
@@ -0,0 +1,213 @@
+/** @file
+ * Declaration of KeyIndex, a flat hash index keyed by transaction keys.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "swoc/MemArena.h"
+
+/** An open addressing hash index from string keys to values.
+ *
+ * The index is populated while the replay files are loaded and is only read
+ * afterwards. Keys are interned into a single arena and each slot stores the
+ * key's precomputed hash, so probing compares hashes before key bytes and
+ * growing the table never rehashes a key. Lookups take a string_view and do
+ * not allocate.
+ *
+ * Entries are stored in a deque so references to them remain valid as the
+ * index grows. Any number of threads may call find concurrently once
+ * population is complete, but emplace must not be called concurrently with
+ * any other member.
+ */
+template <typename Value> class KeyIndex
+{
+public:
+  using value_type = std::pair<std::string_view const, Value>;
+  using iterator = typename std::deque<value_type>::iterator;
+  using const_iterator = typename std::deque<value_type>::const_iterator;
+
+  /** Add a value for key if key is not already indexed.
+   *
+   * @param[in] key The key for the value. It is copied into the index.
+   * @param[in] args The arguments with which to construct the value.
+   *
+   * @return The indexed value for key and whether it was newly added.
+   */
+  template <typename... Args>
+  std::pair<Value *, bool> emplace(std::string_view key, Args &&...args);
+
+  /** Look up the value for a key.
+   *
+   * @param[in] key The key to look up.
+   *
+   * @return The value for key, or nullptr if key is not indexed.
+   */
+  Value *find(std::string_view key);
+  Value const *find(std::string_view key) const;
+
+  /** Allocate the slots for n keys up front. */
+  void reserve(size_t n);
+
+  size_t
+  size() const
+  {
+    return _entries.size();
+  }
+
+  bool
+  empty() const
+  {
+    return _entries.empty();
+  }
+
+  iterator
+  begin()
+  {
+    return _entries.begin();
+  }
+
+  iterator
+  end()
+  {
+    return _entries.end();
+  }
+
+  const_iterator
+  begin() const
+  {
+    return _entries.begin();
+  }
+
+  const_iterator
+  end() const
+  {
+    return _entries.end();
+  }
+
+private:
+  struct Slot
+  {
+    /// The hash of the entry's key.
+    size_t hash = 0;
+    /// The interned key, kept in the slot so probes stay in the slot array.
+    std::string_view key;
+    /// The entry for this slot, or nullptr if the slot is empty.
+    value_type *entry = nullptr;
+  };
+
+  /// The slot array is grown so that it is never more than half full.
+  static constexpr size_t MAX_LOAD_FACTOR_INVERSE = 2;
+  static constexpr size_t MIN_SLOT_COUNT = 16;
+
+  /** Return the index of key's slot, or of the empty slot to use for it. */
+  size_t probe(std::string_view key, size_t hash) const;
+
+  /** Reinsert the existing entries into a slot array of the given size. */
+  void resize(size_t slot_count);
+
+private:
+  std::vector<Slot> _slots;
+  /// _slots.size() - 1. The slot count is always a power of two.
+  size_t _mask = 0;
+  std::deque<value_type> _entries;
+  /// The storage for the interned keys.
+  swoc::MemArena _arena;
+};
+
+template <typename Value>
+template <typename... Args>
+std::pair<Value *, bool>
+KeyIndex<Value>::emplace(std::string_view key, Args &&...args)
+{
+  if ((_entries.size() + 1) * MAX_LOAD_FACTOR_INVERSE > _slots.size()) {
+    resize(std::max(MIN_SLOT_COUNT, _slots.size() * 2));
+  }
+  auto const hash = std::hash<std::string_view>{}(key);
+  auto &slot = _slots[probe(key, hash)];
+  if (slot.entry != nullptr) {
+    return {&slot.entry->second, false};
+  }
+  auto span{_arena.alloc(key.size()).template rebind<char>()};
+  std::copy(key.begin(), key.end(), span.begin());
+  std::string_view const interned_key{span.data(), key.size()};
+  auto &entry = _entries.emplace_back(
+      std::piecewise_construct,
+      std::forward_as_tuple(interned_key),
+      std::forward_as_tuple(std::forward<Args>(args)...));
+  slot.hash = hash;
+  slot.key = interned_key;
+  slot.entry = &entry;
+  return {&entry.second, true};
+}
+
+template <typename Value>
+Value *
+KeyIndex<Value>::find(std::string_view key)
+{
+  return const_cast<Value *>(static_cast<KeyIndex const *>(this)->find(key));
+}
+
+template <typename Value>
+Value const *
+KeyIndex<Value>::find(std::string_view key) const
+{
+  if (_slots.empty()) {
+    return nullptr;
+  }
+  auto const &slot = _slots[probe(key, std::hash<std::string_view>{}(key))];
+  return slot.entry == nullptr ? nullptr : &slot.entry->second;
+}
+
+template <typename Value>
+void
+KeyIndex<Value>::reserve(size_t n)
+{
+  size_t slot_count = MIN_SLOT_COUNT;
+  while (slot_count < n * MAX_LOAD_FACTOR_INVERSE) {
+    slot_count *= 2;
+  }
+  if (slot_count > _slots.size()) {
+    resize(slot_count);
+  }
+}
+
+template <typename Value>
+size_t
+KeyIndex<Value>::probe(std::string_view key, size_t hash) const
+{
+  // Linear probing: the load factor guarantees an empty slot is reached.
+  for (size_t i = hash & _mask;; i = (i + 1) & _mask) {
+    auto const &slot = _slots[i];
+    if (slot.entry == nullptr || (slot.hash == hash && slot.key == key)) {
+      return i;
+    }
+  }
+}
+
+template <typename Value>
+void
+KeyIndex<Value>::resize(size_t slot_count)
+{
+  std::vector<Slot> old_slots(slot_count);
+  _slots.swap(old_slots);
+  _mask = slot_count - 1;
+  for (auto const &old_slot : old_slots) {
+    if (old_slot.entry == nullptr) {
+      continue;
+    }
+    // The stored hash spares rehashing the key.
+    _slots[probe(old_slot.key, old_slot.hash)] = old_slot;
+  }
+}
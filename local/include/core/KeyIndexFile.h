@@ -0,0 +1,173 @@
+/** @file
+ * Declaration of KeyIndexFile, an on-disk index from transaction keys to the
+ * replay files that contain them.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "swoc/Errata.h"
+#include "swoc/swoc_file.h"
+
+/** A read-only, memory-mapped index of the transaction keys of a set of
+ * replay files.
+ *
+ * The index maps each key to the replay file that specifies its transaction
+ * and records the per-SNI TLS handshake directives of those files, so a
+ * server can start serving without parsing any replay file and decode each
+ * file only once one of its keys is requested. Index files are written by
+ * KeyIndexFile::Builder.
+ *
+ * The file is a header followed by fixed size file, key, and SNI records and
+ * a string table. Key records are sorted by key, so a lookup is a binary
+ * search that only touches the pages it probes. Integers are stored in host
+ * byte order: an index is meant to be used on the machine type that built it.
+ */
+class KeyIndexFile
+{
+public:
+  /// The value find returns for a key that is not in the index.
+  static constexpr uint32_t NO_FILE = std::numeric_limits<uint32_t>::max();
+
+  /// The current version of the file format. Other versions are rejected.
+  static constexpr uint32_t VERSION = 1;
+
+  /// The TLS handshake directives recorded for an SNI.
+  struct SniBehavior
+  {
+    std::string_view sni;
+    /// The verify mode to pass to SSL_set_verify.
+    int verify_mode = 0;
+    /// The ALPN protocols in the wire format of SSL_select_next_proto.
+    std::string_view alpn_wire_string;
+  };
+
+  /** Collects the keys of a set of replay files and writes the index file. */
+  class Builder
+  {
+  public:
+    /** Record the key format with which the keys were derived.
+     *
+     * @param[in] key_format The --format value used to derive the keys.
+     */
+    void set_key_format(std::string_view key_format);
+
+    /** Add a replay file to the index.
+     *
+     * @param[in] path The path of the replay file, relative to the replay
+     * directory.
+     *
+     * @return The identifier with which to add the file's keys.
+     */
+    uint32_t add_file(std::string_view path);
+
+    /** Add a transaction key.
+     *
+     * If a key is added more than once, the first file added for it is kept.
+     *
+     * @param[in] key The transaction key.
+     * @param[in] file_id The identifier returned by add_file for the replay
+     * file containing the transaction.
+     */
+    void add_key(std::string_view key, uint32_t file_id);
+
+    /** Add the TLS handshake directives for an SNI.
+     *
+     * @param[in] behavior The directives to record for behavior.sni.
+     */
+    void add_sni(SniBehavior const &behavior);
+
+    /** Write the index to a file.
+     *
+     * @param[in] path The file to write. It is replaced if it exists.
+     *
+     * @return Any errors writing the file.
+     */
+    swoc::Errata write(swoc::file::path const &path);
+
+  private:
+    std::string _key_format;
+    std::vector<std::string> _files;
+    std::vector<std::pair<std::string, uint32_t>> _keys;
+    std::vector<std::pair<std::string, std::pair<int, std::string>>> _snis;
+  };
+
+  KeyIndexFile(KeyIndexFile const &) = delete;
+  KeyIndexFile &operator=(KeyIndexFile const &) = delete;
+  /// Unmaps the file.
+  ~KeyIndexFile();
+
+  /** Map an index file into memory.
+   *
+   * @param[in] path The index file written by a Builder.
+   *
+   * @return The mapped index, or nullptr and errors if the file cannot be
+   * mapped or is not a valid index of this version.
+   */
+  static swoc::Rv<std::unique_ptr<KeyIndexFile>> open(swoc::file::path const &path);
+
+  /** Look up the replay file that contains a key's transaction.
+   *
+   * @param[in] key The transaction key to look up.
+   *
+   * @return The identifier of the replay file for key, or NO_FILE if key is
+   * not indexed.
+   */
+  uint32_t find(std::string_view key) const;
+
+  /** The path of a replay file, relative to the replay directory.
+   *
+   * @param[in] file_id An identifier returned by find.
+   */
+  std::string_view get_file_path(uint32_t file_id) const;
+
+  /** The TLS handshake directives recorded for the i'th SNI.
+   *
+   * @param[in] i An index less than get_sni_count().
+   */
+  SniBehavior get_sni_behavior(size_t i) const;
+
+  /// The --format value with which the keys were derived.
+  std::string_view get_key_format() const;
+
+  size_t get_key_count() const;
+  size_t get_file_count() const;
+  size_t get_sni_count() const;
+
+private:
+  struct Header;
+  struct StringRef;
+  struct FileRecord;
+  struct KeyRecord;
+  struct SniRecord;
+
+  KeyIndexFile(void const *data, size_t size);
+
+  /** Return the string a record refers to, or an empty view if the reference
+   * is outside of the string table.
+   */
+  std::string_view get_string(StringRef const &ref) const;
+
+  Header const &get_header() const;
+  FileRecord const *get_file_records() const;
+  KeyRecord const *get_key_records() const;
+  SniRecord const *get_sni_records() const;
+
+private:
+  /// The start of the mapping.
+  char const *_data = nullptr;
+  /// The size of the mapping.
+  size_t _size = 0;
+  /// The offset of the string table in the mapping.
+  size_t _strings_offset = 0;
+};
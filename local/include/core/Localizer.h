@@ -9,8 +9,16 @@
 
 #include "case_insensitive_utils.h"
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <unordered_set>
+#include <vector>
 
+#include "swoc/Errata.h"
 #include "swoc/MemArena.h"
 #include "swoc/TextView.h"
 #include "swoc/bwf_base.h"
@@ -23,6 +31,13 @@
  * duplicate across all transactions. The storage of this space in a single
  * location is called, in this context, localizing it. This class's functions
  * encapsulate this logic.
+ *
+ * Replay files are parsed by several threads at once. Each thread copies
+ * strings into an arena of its own, so plain localization takes no lock. The
+ * case-insensitive names deduplicated by localize_lower are interned in a
+ * table split into shards by hash, each with its own lock and arena, so
+ * threads only contend when they intern names of the same shard at the same
+ * time.
  */
 class Localizer
 {
@@ -32,9 +47,14 @@ public:
    * All localization should be completed during the YAML parsing stage. If
    * localization happens elsewhere, then there is a logic flaw. This sets
    * state saying that localization is completed such that if localization is
-   * requested elsewhere, assertions will be triggered.
+   * requested elsewhere, assertions will be triggered. Localizing within a
+   * ScopedArena remains allowed.
+   *
+   * @return An informational note of how often localize_lower found an
+   * interned name, how many bytes the arenas hold, and how many bytes of
+   * retained sources are referred to in place.
    */
-  static void freeze_localization();
+  static swoc::Errata freeze_localization();
 
   static swoc::TextView localize(char const *text);
   static swoc::TextView localize_lower(char const *text);
@@ -50,16 +70,125 @@ public:
 
   static swoc::TextView localize(swoc::TextView text, Encoding enc);
 
+  /// The most sources retain keeps, so that mappings stay well within the
+  /// kernel's limit on the number of a process's mappings.
+  static constexpr size_t MAX_RETAINED_SOURCES = 4096;
+
+  /** Whether strings may refer to a source kept by retain rather than be
+   * localized.
+   *
+   * They may not while the calling thread has a ScopedArena, whose strings
+   * are meant to be freed with it, nor once MAX_RETAINED_SOURCES are kept.
+   */
+  static bool can_retain();
+
+  /** Keep a source of strings, such as a memory-mapped replay file, for the
+   * rest of the process, so that localize_retained can refer to its text.
+   *
+   * The strings referring to a mapped file change if the file is rewritten
+   * in place, so such files should only be replaced by renaming.
+   *
+   * @param[in] source The owner of the source's memory.
+   * @param[in] size The size of the source, for the freeze_localization note.
+   */
+  static void retain(std::shared_ptr<void const> source, size_t size);
+
+  /** Localize text by referring to it in place rather than copying it.
+   *
+   * @param[in] text Text in a source passed to retain.
+   *
+   * @return @a text itself.
+   */
+  static swoc::TextView localize_retained(swoc::TextView text);
+
+  /** Localize the calling thread's strings into a caller provided arena for
+   * the lifetime of this object.
+   *
+   * Strings localized into the thread's own arena live for the rest of the
+   * process. A streaming replay, which parses sessions as it sends them,
+   * instead scopes each replay file's strings to an arena that is freed with
+   * the file's last session. The Verifier Server likewise loads each corpus
+   * into arenas the corpus owns, so a reload frees the strings of the corpus
+   * it replaces. Names interned by localize_lower are shared across files, so
+   * they are always localized into the arena of their shard.
+   *
+   * Since a scope's strings are freed with its arena, a thread may localize
+   * within one after freeze_localization, as each --repeat pass of a
+   * streaming replay and each reload of the Verifier Server does.
+   */
+  class ScopedArena
+  {
+  public:
+    explicit ScopedArena(swoc::MemArena &arena);
+    ~ScopedArena();
+
+    ScopedArena(ScopedArena const &) = delete;
+    ScopedArena &operator=(ScopedArena const &) = delete;
+
+  private:
+    /// The arena of an enclosing scope, restored on destruction.
+    swoc::MemArena *_previous = nullptr;
+  };
+
 private:
   /** A convenience boolean for the corresponding parameter to localize_helper.
    */
   static constexpr bool SHOULD_LOWER = true;
 
-  static swoc::TextView localize_helper(swoc::TextView text, bool should_lower);
+  static swoc::TextView
+  localize_helper(swoc::MemArena &arena, swoc::TextView text, bool should_lower);
+
+  /// Return the calling thread's arena, creating it on first use.
+  static swoc::MemArena &get_thread_arena();
+
+  /// Return the arena of the calling thread's ScopedArena, if any, otherwise
+  /// its own arena.
+  static swoc::MemArena &get_localization_arena();
 
 private:
   using NameSet = std::unordered_set<swoc::TextView, Hash, Hash>;
-  static NameSet _names;
-  static swoc::MemArena _arena;
-  static bool _frozen;
+
+  /// The log2 of the number of shards of the interned name table.
+  static constexpr size_t NAME_SHARD_BITS = 6;
+  static constexpr size_t NUM_NAME_SHARDS = size_t{1} << NAME_SHARD_BITS;
+
+  /** A shard of the interned name table.
+   *
+   * Shards are aligned to a cache line so that threads locking neighboring
+   * shards do not contend on the same line.
+   */
+  struct alignas(64) NameShard
+  {
+    std::mutex mutex;
+    NameSet names;
+    /** The interned names, which live for the rest of the process.
+     *
+     * Names are only added with the shard locked, so they need no arena of
+     * the thread that interns them, which may be short lived.
+     */
+    swoc::MemArena arena{1024};
+    /// The number of localize_lower calls for names of this shard.
+    uint64_t lookups = 0;
+    /// The number of those calls which found the name already interned.
+    uint64_t hits = 0;
+  };
+  static std::array<NameShard, NUM_NAME_SHARDS> _name_shards;
+
+  /** The arenas of all threads that have localized strings.
+   *
+   * Localized strings live for the rest of the process, so an arena outlives
+   * the thread that filled it. A deque keeps the arenas in place as it grows.
+   */
+  static std::deque<swoc::MemArena> _arenas;
+  /// Guards _arenas. It is only taken when a thread first localizes.
+  static std::mutex _arenas_mutex;
+
+  /// The sources kept by retain.
+  static std::vector<std::shared_ptr<void const>> _retained_sources;
+  /// The total size of the sources kept by retain.
+  static size_t _retained_bytes;
+  /// Guards _retained_sources and _retained_bytes.
+  static std::mutex _retained_sources_mutex;
+
+  static std::atomic<bool> _frozen;
 };
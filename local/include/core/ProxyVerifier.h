@@ -8,7 +8,9 @@
 #pragma once
 
 #include <condition_variable>
+#include <cstdio>
 #include <deque>
+#include <functional>
 #include <list>
 #include <string>
 #include <string_view>
@@ -19,6 +21,7 @@
 #include "swoc/Errata.h"
 #include "swoc/TextView.h"
 #include "swoc/bwf_base.h"
+#include "swoc/swoc_file.h"
 #include "swoc/swoc_ip.h"
 
 extern bool Verbose;
@@ -75,6 +78,64 @@ swoc::Errata parse_ips(std::string addresses, std::deque<swoc::IPEndpoint> &targ
 swoc::Errata resolve_ips(std::string hostnames, std::deque<swoc::IPEndpoint> &targets);
 swoc::Rv<swoc::IPEndpoint> Resolve_FQDN(swoc::TextView host);
 
+/** Write a file by renaming a newly written temporary file into place.
+ *
+ * The temporary file is uniquely named in the directory of path, so processes
+ * and threads writing the same path at once each write their own, and a
+ * reader of path never sees a partially written file.
+ *
+ * @param[in] path The file to write.
+ * @param[in] description What the file is, for error messages, such as
+ * "key index".
+ * @param[in] write Writes the content to the temporary file, returning
+ * whether it succeeded.
+ *
+ * @return Any errors writing the file.
+ */
+swoc::Errata write_file_atomically(
+    swoc::file::path const &path,
+    std::string_view description,
+    std::function<bool(FILE *)> const &write);
+
+/** A partition of the transaction key space.
+ *
+ * A corpus too large for one verifier-server can be split across count
+ * servers, each of which loads only the transactions whose keys hash to its
+ * index. The client can then send each transaction to the server owning its
+ * key.
+ */
+struct KeyPartition
+{
+  /// The index of this partition, less than count.
+  size_t index = 0;
+  /// The number of partitions. One means the key space is not partitioned.
+  size_t count = 1;
+
+  /** Whether this partition owns key. */
+  bool
+  owns(std::string_view key) const
+  {
+    return count <= 1 || get_partition(key, count) == index;
+  }
+
+  /** Return the index of the partition owning key.
+   *
+   * @param[in] key The transaction key.
+   * @param[in] count The number of partitions. This must be non-zero.
+   *
+   * @return The index of the owning partition, less than count.
+   */
+  static size_t get_partition(std::string_view key, size_t count);
+
+  /** Parse a partition specification of the form "<index>/<count>".
+   *
+   * @param[in] spec The specification, such as "0/4".
+   *
+   * @return The parsed partition and logging and status information.
+   */
+  static swoc::Rv<KeyPartition> parse(swoc::TextView spec);
+};
+
 class ThreadInfo
 {
 public:
@@ -0,0 +1,188 @@
+/** @file
+ * Declaration of ReplayGenerator, the generator of synthetic replay files.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "swoc/Errata.h"
+#include "swoc/TextView.h"
+#include "swoc/swoc_file.h"
+
+/** Generates synthetic replay files for benchmarks and load tests.
+ *
+ * The files are generated from a seed, so the same options and seed always
+ * generate the same files, whatever the number of threads generating them.
+ * The sessions of the files are first planned in order from the seed, then
+ * the files are generated concurrently, each from a seed derived from the
+ * seed and the file's index.
+ *
+ * The replay files are written as JSON, a session at a time, so a file is
+ * never held in memory whole. Alternatively the files are compiled into a
+ * single corpus file (see CompiledCorpus).
+ */
+class ReplayGenerator
+{
+public:
+  /// An inclusive range from which a count or size is drawn uniformly.
+  struct Range
+  {
+    size_t min = 0;
+    size_t max = 0;
+
+    /** Parse a range.
+     *
+     * @param[in] text A single number, such as "10", or a range of them, such
+     * as "1-1000".
+     *
+     * @return The range, or errors if text is not a range.
+     */
+    static swoc::Rv<Range> parse(swoc::TextView text);
+  };
+
+  /// The protocol stacks of the generated sessions.
+  enum class Protocol {
+    HTTP,  ///< HTTP/1.1 over TCP.
+    HTTPS, ///< HTTP/1.1 over TLS.
+    HTTP2, ///< HTTP/2 over TLS.
+  };
+  /// The number of Protocol values.
+  static constexpr size_t N_PROTOCOLS = 3;
+
+  /// The formats in which the replay files are written.
+  enum class Format {
+    JSON,   ///< A directory of JSON replay files.
+    CORPUS, ///< A compiled corpus file.
+  };
+
+  /// What to generate and how.
+  struct Options
+  {
+    /// The seed from which everything generated is drawn.
+    uint64_t seed = 1;
+    /// The total number of transactions.
+    size_t transactions = 0;
+    /// The number of sessions in each file.
+    Range file_sessions{10, 10};
+    /// The number of transactions in each session.
+    Range session_transactions{10, 10};
+    /// The number of headers added to each message beyond those its protocol
+    /// requires.
+    Range header_count{0, 0};
+    /// The size of the values of the added headers.
+    Range header_size{16, 16};
+    /// The body size of the POST requests.
+    Range request_body_size{1, 1000};
+    /// The body size of the responses.
+    Range response_body_size{1, 1000};
+    /// The relative weights of the protocols, indexed by Protocol.
+    std::array<unsigned, N_PROTOCOLS> protocol_weights{1, 1, 1};
+    /// The URLs requested. If empty, URLs are synthesized.
+    std::vector<std::string> urls;
+    /// Prefixed to the names of the replay files.
+    std::string prefix;
+    Format format = Format::JSON;
+    /// The number of threads generating files, or zero for one per core.
+    int n_threads = 0;
+  };
+
+  /// The sessions of a replay file, as planned from the seed.
+  struct FilePlan
+  {
+    /// The index of the file among all the files generated.
+    size_t index = 0;
+    /// The number of sessions generated before this file's.
+    size_t first_session = 0;
+    /// The number of transactions in each of the file's sessions.
+    std::vector<size_t> session_transactions;
+  };
+
+  /** Parse a protocol mix.
+   *
+   * @param[in] text A comma separated list of protocols, "http", "https",
+   * and "h2", each optionally followed by a colon and its weight, such as
+   * "http:3,h2:1". A protocol without a weight has a weight of one, and one
+   * not listed is not generated.
+   *
+   * @param[out] weights The protocol weights, indexed by Protocol.
+   *
+   * @return Any errors parsing text.
+   */
+  static swoc::Errata
+  parse_protocol_mix(swoc::TextView text, std::array<unsigned, N_PROTOCOLS> &weights);
+
+  /** Load a URL list.
+   *
+   * @param[in] path A file of URLs, one per line, such as
+   * remap_config_to_url_list.py writes. Blank lines and lines starting with
+   * '#' are skipped.
+   *
+   * @return The URLs, or errors if the file cannot be read or lists none.
+   */
+  static swoc::Rv<std::vector<std::string>> load_urls(swoc::file::path const &path);
+
+  /** Plan the sessions of the replay files.
+   *
+   * Sessions are added to files until the files hold the requested number
+   * of transactions. The last session is shortened as needed.
+   *
+   * @param[in] options The generation options.
+   *
+   * @return The plans of the files, in order.
+   */
+  static std::vector<FilePlan> plan(Options const &options);
+
+  /** Generate a replay file.
+   *
+   * @param[in] options The generation options.
+   * @param[in] file The plan of the file.
+   *
+   * @param[in] write Called with the JSON text of the file a piece at a
+   * time, in order, with a piece ending after each session.
+   */
+  static void generate_file(
+      Options const &options,
+      FilePlan const &file,
+      std::function<void(std::string_view)> const &write);
+
+  /** Generate a replay file.
+   *
+   * @param[in] options The generation options.
+   * @param[in] file The plan of the file.
+   *
+   * @return The JSON text of the file.
+   */
+  static std::string generate_file(Options const &options, FilePlan const &file);
+
+  /** The name of a replay file.
+   *
+   * The names are numbered from zero and padded to the same width, so that
+   * they sort in the order they were generated.
+   *
+   * @param[in] options The generation options.
+   * @param[in] index The index of the file.
+   * @param[in] n_files The number of files generated.
+   */
+  static std::string get_file_name(Options const &options, size_t index, size_t n_files);
+
+  /** Generate the replay files.
+   *
+   * @param[in] options The generation options.
+   *
+   * @param[in] output The directory to write the JSON replay files to,
+   * created if it does not exist, or the corpus file to write.
+   *
+   * @return A summary of the generated files, or errors writing them.
+   */
+  static swoc::Errata generate(Options const &options, swoc::file::path const &output);
+};
@@ -0,0 +1,82 @@
+/** @file
+ * Declaration of ScalarSource, the mapped text a scalar node was parsed from.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "yaml-cpp/yaml.h"
+
+/** Records the memory-mapped text a scalar node was parsed from.
+ *
+ * A scalar node's source is the text of its value in a memory-mapped replay
+ * file or compiled corpus which stays mapped for the rest of the process
+ * (see Localizer::retain). The replay file handlers refer to the source
+ * rather than localize a copy of the scalar, so the values of a mapped file
+ * are held in memory once, by the mapping, rather than again in the
+ * localization arenas.
+ *
+ * yaml-cpp nodes cannot carry anything but their own copy of a scalar, so
+ * the source is recorded in the node's tag. The tag holds the address and
+ * size of the source after a prefix that no YAML tag can start with, and
+ * fits in the tag string's inline buffer so that tagging allocates nothing.
+ */
+class ScalarSource
+{
+public:
+  /** Record the source of a scalar node.
+   *
+   * @param[in] node A scalar node whose value is @a source.
+   *
+   * @param[in] source The value's text in a mapping that stays mapped for
+   * the rest of the process. Sources too large to record are not recorded.
+   */
+  static void
+  set(YAML::Node &node, std::string_view source)
+  {
+    if (source.size() > UINT32_MAX) {
+      return;
+    }
+    char tag[TAG_SIZE];
+    char const *const data = source.data();
+    uint32_t const size = static_cast<uint32_t>(source.size());
+    memcpy(tag, TAG_PREFIX.data(), TAG_PREFIX.size());
+    memcpy(tag + TAG_PREFIX.size(), &data, sizeof(data));
+    memcpy(tag + TAG_PREFIX.size() + sizeof(data), &size, sizeof(size));
+    node.SetTag(std::string{tag, sizeof(tag)});
+  }
+
+  /** The source of a scalar node.
+   *
+   * @param[in] node A scalar node.
+   *
+   * @return The text of the node's value in its mapping, or an empty view if
+   * the node has no source.
+   */
+  static std::string_view
+  get(YAML::Node const &node)
+  {
+    auto const &tag = node.Tag();
+    if (tag.size() != TAG_SIZE || 0 != memcmp(tag.data(), TAG_PREFIX.data(), TAG_PREFIX.size())) {
+      return {};
+    }
+    char const *data = nullptr;
+    uint32_t size = 0;
+    memcpy(&data, tag.data() + TAG_PREFIX.size(), sizeof(data));
+    memcpy(&size, tag.data() + TAG_PREFIX.size() + sizeof(data), sizeof(size));
+    return {data, size};
+  }
+
+private:
+  /// Starts the tag of a node with a source. YAML tags cannot contain a NUL.
+  static constexpr std::string_view TAG_PREFIX{"\0pv", 3};
+  /// The size of a source tag: the prefix, the address, and the size.
+  static constexpr size_t TAG_SIZE = TAG_PREFIX.size() + sizeof(char const *) + sizeof(uint32_t);
+};
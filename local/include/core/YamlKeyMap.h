@@ -0,0 +1,220 @@
+/** @file
+ * Declaration of YamlKeyMap, the values of a replay file map's known keys.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "yaml-cpp/yaml.h"
+
+/// The keys of the replay file maps that the replay file handlers look up.
+enum class YamlKey : uint8_t {
+  // Session keys.
+  CONNECTION_TIME,
+  DELAY,
+  PROTOCOL,
+  TRANSACTIONS,
+  // Transaction keys.
+  ALL,
+  CLIENT_REQUEST,
+  PROXY_REQUEST,
+  SERVER_RESPONSE,
+  PROXY_RESPONSE,
+  // Message keys.
+  VERSION,
+  HTTP2,
+  STATUS,
+  REASON,
+  METHOD,
+  URL,
+  SCHEME,
+  HEADERS,
+  CONTENT,
+  // Content keys.
+  SIZE,
+  DATA,
+  VERIFY,
+  ENCODING,
+  TRANSFER,
+  /// Not a known key. This is also the number of known keys.
+  UNKNOWN,
+};
+
+namespace yaml_key_hash
+{
+/// The number of known keys.
+constexpr size_t N_KEYS = static_cast<size_t>(YamlKey::UNKNOWN);
+
+/// The key strings, indexed by YamlKey. These are the values of the
+/// corresponding YAML_*_KEY strings in YamlParser.h.
+constexpr std::array<std::string_view, N_KEYS> NAMES{
+    "connection-time",
+    "delay",
+    "protocol",
+    "transactions",
+    "all",
+    "client-request",
+    "proxy-request",
+    "server-response",
+    "proxy-response",
+    "version",
+    "http2",
+    "status",
+    "reason",
+    "method",
+    "url",
+    "scheme",
+    "headers",
+    "content",
+    "size",
+    "data",
+    "verify",
+    "encoding",
+    "transfer",
+};
+
+/// The number of bits of a hash, and so of the table's index.
+constexpr unsigned TABLE_BITS = 6;
+constexpr size_t TABLE_SIZE = size_t{1} << TABLE_BITS;
+static_assert(N_KEYS <= TABLE_SIZE, "The known keys must fit in the hash table.");
+
+/** Hash a key for the table.
+ *
+ * Only the length and the first, middle, and last characters are hashed,
+ * which the known keys differ in, so a key is hashed in constant time. The
+ * table entry is compared to the whole key.
+ *
+ * @param[in] name A key, which must not be empty.
+ * @param[in] seed The seed for which the hash is perfect for the known keys.
+ */
+constexpr uint32_t
+hash(std::string_view name, uint32_t seed)
+{
+  constexpr uint32_t FNV_PRIME = 16777619;
+  uint32_t h = seed ^ static_cast<uint32_t>(name.size());
+  h = (h ^ static_cast<uint8_t>(name.front())) * FNV_PRIME;
+  h = (h ^ static_cast<uint8_t>(name[name.size() / 2])) * FNV_PRIME;
+  h = (h ^ static_cast<uint8_t>(name.back())) * FNV_PRIME;
+  return h >> (32 - TABLE_BITS);
+}
+
+/// The first seed for which no two known keys hash alike, or zero if none.
+constexpr uint32_t
+find_seed()
+{
+  for (uint32_t seed = 1; seed < 100'000; ++seed) {
+    uint64_t used = 0;
+    bool is_perfect = true;
+    for (auto const name : NAMES) {
+      uint64_t const slot = uint64_t{1} << hash(name, seed);
+      is_perfect = is_perfect && (used & slot) == 0;
+      used |= slot;
+    }
+    if (is_perfect) {
+      return seed;
+    }
+  }
+  return 0;
+}
+
+constexpr uint32_t SEED = find_seed();
+static_assert(SEED != 0, "No seed hashes the known keys perfectly: add bits to the table.");
+
+/// The known keys by their hash, with UNKNOWN in the unused entries.
+constexpr std::array<YamlKey, TABLE_SIZE>
+build_table()
+{
+  std::array<YamlKey, TABLE_SIZE> table{};
+  for (auto &entry : table) {
+    entry = YamlKey::UNKNOWN;
+  }
+  for (size_t i = 0; i < N_KEYS; ++i) {
+    table[hash(NAMES[i], SEED)] = static_cast<YamlKey>(i);
+  }
+  return table;
+}
+
+constexpr std::array<YamlKey, TABLE_SIZE> TABLE = build_table();
+} // namespace yaml_key_hash
+
+/** The values of the known keys of a map node, found in one pass over it.
+ *
+ * yaml-cpp looks a key up by comparing it to each of the map's keys in turn,
+ * copying each of their scalars to do so, so looking up each of a message's
+ * keys scans its map again and again. Instead the map is iterated once and
+ * each key is identified by a perfect hash of the known keys, computed at
+ * compile time.
+ *
+ * As with a lookup, the value of a key that appears more than once is that
+ * of its first appearance.
+ */
+class YamlKeyMap
+{
+public:
+  /** Find the values of the known keys of a map.
+   *
+   * @param[in] node A map node. A node that is not a map has no keys.
+   */
+  explicit YamlKeyMap(YAML::Node const &node)
+  {
+    if (!node.IsMap()) {
+      return;
+    }
+    for (auto const &entry : node) {
+      if (!entry.first.IsScalar()) {
+        continue;
+      }
+      auto const index = static_cast<size_t>(get_key(entry.first.Scalar()));
+      uint32_t const bit = uint32_t{1} << index;
+      if (index < yaml_key_hash::N_KEYS && (_found & bit) == 0) {
+        _values[index].reset(entry.second);
+        _found |= bit;
+      }
+    }
+  }
+
+  /** The value of a key.
+   *
+   * @param[in] key A known key.
+   *
+   * @return The key's value, or nullptr if the map does not have the key.
+   */
+  YAML::Node const *
+  find(YamlKey key) const
+  {
+    auto const index = static_cast<size_t>(key);
+    return (_found & (uint32_t{1} << index)) != 0 ? &_values[index] : nullptr;
+  }
+
+  /** Identify a key.
+   *
+   * @param[in] name A map key.
+   *
+   * @return The known key name is, or UNKNOWN.
+   */
+  static constexpr YamlKey
+  get_key(std::string_view name)
+  {
+    if (name.empty()) {
+      return YamlKey::UNKNOWN;
+    }
+    auto const key = yaml_key_hash::TABLE[yaml_key_hash::hash(name, yaml_key_hash::SEED)];
+    return key != YamlKey::UNKNOWN && yaml_key_hash::NAMES[static_cast<size_t>(key)] == name
+               ? key
+               : YamlKey::UNKNOWN;
+  }
+
+private:
+  static_assert(yaml_key_hash::N_KEYS <= 32, "The found keys must fit in _found.");
+
+  std::array<YAML::Node, yaml_key_hash::N_KEYS> _values;
+  /// The bits, indexed by YamlKey, of the keys the map has.
+  uint32_t _found = 0;
+};
@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
+#include "core/YamlKeyMap.h"
 #include "yaml-cpp/yaml.h"
 
 #include "swoc/BufferWriter.h"
@@ -22,6 +26,7 @@
 #include "swoc/bwf_base.h"
 #include "swoc/swoc_file.h"
 
+class CompiledCorpus;
 class HttpFields;
 class HttpHeader;
 class RuleCheck;
@@ -96,6 +101,10 @@ namespace swoc
 inline BufferWriter &
 bwformat(BufferWriter &w, bwf::Spec const & /* spec */, YAML::Mark const &mark)
 {
+  // Nodes parsed by JsonParser have no marks.
+  if (mark.is_null()) {
+    return w.write("an unknown line");
+  }
   return w.print("line {}", mark.line);
 }
 } // namespace swoc
@@ -122,7 +131,8 @@ swoc::Rv<std::chrono::microseconds> get_delay_time(YAML::Node const &node);
 
 struct VerificationConfig
 {
-  std::shared_ptr<HttpFields> txn_rules;
+  /// The global field rules, shared by the messages they apply to.
+  std::shared_ptr<HttpFields const> txn_rules;
 };
 
 /** Protocol class for loading a replay file.
@@ -149,8 +159,14 @@ public:
   {
     return {};
   }
+  /** Open the session node.
+   *
+   * @param node Session node.
+   * @param keys The values of the session node's keys.
+   * @return Errors, if any.
+   */
   virtual swoc::Errata
-  ssn_open(YAML::Node const & /* node */)
+  ssn_open(YAML::Node const & /* node */, YamlKeyMap const & /* keys */)
   {
     return {};
   }
@@ -163,13 +179,14 @@ public:
   /** Open the transaction node.
    *
    * @param node Transaction node.
+   * @param keys The values of the transaction node's keys.
    * @return Errors, if any.
    *
    * This is required to do any base validation of the transaction such as
    * verifying required keys.
    */
   virtual swoc::Errata
-  txn_open(YAML::Node const & /* node */)
+  txn_open(YAML::Node const & /* node */, YamlKeyMap const & /* keys */)
   {
     return {};
   }
@@ -179,6 +196,24 @@ public:
   {
     return {};
   }
+
+  /** Whether to skip a transaction without loading it.
+   *
+   * This is called before txn_open. A skipped transaction's messages are not
+   * parsed and none of the other transaction callbacks are called for it, so
+   * handlers which only load some of the transactions, such as those with
+   * certain keys, can decide this cheaply via
+   * YamlParser::derive_transaction_key.
+   *
+   * @param node Transaction node.
+   * @return True if the transaction should be skipped.
+   */
+  virtual bool
+  skip_transaction(YAML::Node const & /* node */)
+  {
+    return false;
+  }
+
   virtual swoc::Errata
   client_request(YAML::Node const & /* node */)
   {
@@ -200,7 +235,7 @@ public:
     return {};
   }
   virtual swoc::Errata
-  apply_to_all_messages(HttpFields const & /* all_headers */)
+  apply_to_all_messages(std::shared_ptr<HttpFields const> const & /* all_headers */)
   {
     return {};
   }
@@ -262,22 +297,127 @@ public:
    */
   static swoc::Errata load_replay_file(swoc::file::path const &path, ReplayFileHandler &handler);
 
+  /** Parse a replay file into its node tree without interpreting it.
+   *
+   * If the file is in the compiled corpus being loaded by load_replay_files,
+   * its tree is taken from the corpus rather than parsed.
+   *
+   * @param[in] path The path to the replay file.
+   *
+   * @return The root of the file's tree with any merge keys applied.
+   */
+  static swoc::Rv<YAML::Node> parse_replay_file(swoc::file::path const &path);
+
+  /** Cache the parsed trees of replay files in a directory.
+   *
+   * parse_replay_file then looks each file up in the directory by a hash of
+   * its content before parsing it, and adds the trees it parses. A file
+   * which has not changed since a previous run is therefore not parsed
+   * again. The entries are single file corpora (see CompiledCorpus) and
+   * can be removed at any time. This must not be called while files are
+   * loaded.
+   *
+   * @param[in] dir The cache directory, which must exist, or an empty path
+   * to parse every file.
+   *
+   * @return An error if dir is not a directory.
+   */
+  static swoc::Errata set_parse_cache_dir(swoc::file::path const &dir);
+
   using loader_t = std::function<swoc::Errata(swoc::file::path const &)>;
 
+  /// A convenience value for the split_files parameter of load_replay_files.
+  static constexpr bool SPLIT_FILES = true;
+
   /** Parse the specified YAML file(s).
    *
    * @param[in] path The path to the file or directory containing YAML
-   *   files to parse. Note this may actually be a path to a single file.
+   *   files to parse. Note this may actually be a path to a single file. A
+   *   directory is searched recursively for ".json" and ".yaml" files, and
+   *   the loader is called with their paths under path.
    *
    * @param[in] loader The function to use for each file in path.
    *
    * @param[in] n_threads The number of threads to use to parse the files in
-   *   path.
+   *   path. If this is 0, get_default_thread_count() threads are used. No
+   *   more threads are started than there are files.
+   *
+   * @param[in] split_files Whether a large single JSON replay file may be
+   *   split into chunks of its sessions which are parsed concurrently. The
+   *   loader is then called once per chunk, each on its own thread, and
+   *   load_replay_file loads only that thread's chunk, in file order by
+   *   thread index. The file's meta node is parsed once for all chunks. Only
+   *   loaders which pass the file to load_replay_file should allow this.
+   *
+   * Files are parsed concurrently, largest first so that no thread is left
+   * parsing a large file after the others are done, so loaders should
+   * populate containers of their own thread (see get_loader_thread_index)
+   * and the caller should merge them once this returns. With a single
+   * thread the files are loaded in path order instead.
+   *
+   * If path is a corpus written by compile_replay_files, the loader is
+   * called with the path of each replay file compiled into it and
+   * load_replay_file takes their trees from the corpus.
    *
    * @return Any errata from parsing the file.
    */
+  static swoc::Errata load_replay_files(
+      swoc::file::path const &path,
+      loader_t loader,
+      int n_threads = 0,
+      bool split_files = !SPLIT_FILES);
+
+  /** Parse the given list of replay files.
+   *
+   * This is load_replay_files for a caller which already knows which files
+   * it needs, such as from a KeyIndexFile, so that no directory is scanned.
+   *
+   * @param[in] files The replay files to parse.
+   *
+   * @param[in] loader The function to use for each file.
+   *
+   * @param[in] n_threads As for load_replay_files.
+   *
+   * @return Any errata from parsing the files.
+   */
+  static swoc::Errata load_replay_files(
+      std::vector<swoc::file::path> const &files,
+      loader_t loader,
+      int n_threads = 0);
+
+  /** Compile the specified replay file(s) into a corpus file.
+   *
+   * The corpus holds the parsed trees of the replay files and can be passed
+   * to load_replay_files in place of them.
+   *
+   * @param[in] path The file or directory containing the replay files.
+   *
+   * @param[in] corpus_path The corpus file to write.
+   *
+   * @return Any errata from parsing the replay files or writing the corpus.
+   */
   static swoc::Errata
-  load_replay_files(swoc::file::path const &path, loader_t loader, int n_threads = 10);
+  compile_replay_files(swoc::file::path const &path, swoc::file::path const &corpus_path);
+
+  /** The path of a replay file passed to a load_replay_files loader,
+   * relative to the directory passed to load_replay_files.
+   *
+   * @param[in] file The path passed to the loader.
+   * @param[in] dir The path passed to load_replay_files.
+   *
+   * @return The relative path, or file itself if it is not under dir.
+   */
+  static std::string get_relative_path(swoc::file::path const &file, swoc::file::path const &dir);
+
+  /// The number of threads load_replay_files uses by default: one per core.
+  static int get_default_thread_count();
+
+  /** The index of the load_replay_files thread calling a loader.
+   *
+   * @return A value less than the n_threads passed to load_replay_files, or 0
+   * if called from outside of a loader thread.
+   */
+  static int get_loader_thread_index();
 
   /** Populate an HTTP message from a YAML node.
    *
@@ -297,6 +437,30 @@ public:
    */
   static swoc::Errata parse_global_rules(YAML::Node const &node, HttpFields &fields);
 
+  /** Derive a transaction's key without populating its messages.
+   *
+   * Only the url and the field values of the request node are read, and
+   * nothing is localized, so this is cheap enough to decide whether to load
+   * a transaction at all. The key is the one the request populated by
+   * populate_http_message would have once the transaction's "all" fields are
+   * merged into it.
+   *
+   * @param[in] txn_node The transaction node.
+   *
+   * @param[in] request_key The request node to derive the key from, such as
+   * YAML_CLIENT_REQ_KEY.
+   *
+   * @param[in] include_all_messages Whether to use the "all" fields if the
+   * request node's own do not yield a key.
+   *
+   * @return The key, or HttpHeader::TRANSACTION_KEY_NOT_SET if the nodes do
+   * not yield one.
+   */
+  static std::string derive_transaction_key(
+      YAML::Node const &txn_node,
+      std::string const &request_key,
+      bool include_all_messages = true);
+
 private:
   /** Indicate that parsing has started.
    */
@@ -309,6 +473,98 @@ private:
    */
   static swoc::Errata parsing_is_done();
 
+  /** The parse cache entry for a replay file's content.
+   *
+   * @param[in] content The content of the replay file.
+   *
+   * @return The path of the entry, named by the SHA-256 digest of the
+   * content, or an empty path if the digest could not be computed.
+   */
+  static swoc::file::path get_parse_cache_path(swoc::TextView content);
+
+  /** Read a replay file's content, decompressing it if the file is
+   * compressed (see CompressedFile).
+   *
+   * @param[in] path The replay file.
+   *
+   * @param[out] file_size The size of the file as stored.
+   *
+   * @return The content of the file, or errors if it cannot be read.
+   */
+  static swoc::Rv<std::string> load_content(swoc::file::path const &path, size_t &file_size);
+
+  /** Count a parsed replay file toward the throughput of compressed or
+   * uncompressed files, as the file is.
+   *
+   * @param[in] path The replay file.
+   * @param[in] file_size The size of the file as stored.
+   * @param[in] content_size The size of the file's content.
+   * @param[in] parse_time The time taken to read and parse the file.
+   */
+  static void count_parsed_file(
+      swoc::file::path const &path,
+      size_t file_size,
+      size_t content_size,
+      std::chrono::nanoseconds parse_time);
+
+  /// A replay file found by find_replay_files.
+  struct ReplayFileEntry
+  {
+    swoc::file::path path;
+    size_t size = 0;
+  };
+
+  /** Add the replay files under dir, recursively, to entries.
+   *
+   * @return Any errors reading the directories.
+   */
+  static swoc::Errata
+  find_replay_files(swoc::file::path const &dir, std::vector<ReplayFileEntry> &entries);
+
+  /** Call a loader for each of a list of replay files, with up to n_threads
+   * threads.
+   */
+  static swoc::Errata load_files(
+      std::vector<swoc::file::path> const &files,
+      loader_t const &loader,
+      int n_threads);
+
+  /// Load the replay files of a compiled corpus.
+  static swoc::Errata
+  load_compiled_corpus(swoc::file::path const &path, loader_t const &loader, int n_threads);
+
+  /** Load a JSON replay file with up to n_threads threads, each calling the
+   * loader for a chunk of the file's sessions. See load_replay_files.
+   *
+   * The file is loaded by a single call to the loader instead if it is small
+   * or cannot be split.
+   */
+  static swoc::Errata
+  load_split_file(swoc::file::path const &path, loader_t const &loader, int n_threads);
+
+  /** Parse the global field rules of a replay file's meta node.
+   *
+   * @param[in] path The replay file, for diagnostics.
+   * @param[in] root The root of the replay file's tree.
+   *
+   * @return The global field rules, empty if the file has none.
+   */
+  static swoc::Rv<std::shared_ptr<HttpFields>>
+  parse_meta(swoc::file::path const &path, YAML::Node const &root);
+
+  /** Load the sessions of a replay file's tree into a handler.
+   *
+   * @param[in] path The replay file, for diagnostics.
+   * @param[in] root The root of the replay file's tree.
+   * @param[in] handler The handler to load the sessions into.
+   *
+   * @return Any errata from loading the sessions.
+   */
+  static swoc::Errata load_sessions(
+      swoc::file::path const &path,
+      YAML::Node const &root,
+      ReplayFileHandler &handler);
+
   /** Process HTTP/2 pseudo headers from the message node.
    *
    * @param[in] node The YAML node from which to parse HTTP pseudo headers.
@@ -358,4 +614,43 @@ private:
   using ClockType = std::chrono::system_clock;
   using TimePoint = std::chrono::time_point<ClockType, std::chrono::nanoseconds>;
   static TimePoint _parsing_start_time;
+  /// The number of replay files parsed since parsing_is_started.
+  static std::atomic<size_t> _num_parsed_files;
+  /// The number of transactions parsed since parsing_is_started.
+  static std::atomic<size_t> _num_parsed_transactions;
+  /// The number of replay files taken from the parse cache since
+  /// parsing_is_started.
+  static std::atomic<size_t> _num_cached_files;
+  /// The directory of the parse cache, if any. See set_parse_cache_dir.
+  static swoc::file::path _parse_cache_dir;
+  /// The number of transactions handlers skipped since parsing_is_started.
+  static std::atomic<size_t> _num_skipped_transactions;
+  /// The size in bytes of the replay files parsed since parsing_is_started.
+  static std::atomic<size_t> _num_parsed_bytes;
+
+  /// The replay files of one kind read and parsed since parsing_is_started.
+  struct ParseStats
+  {
+    std::atomic<size_t> files{0};
+    /// The size of the files as stored.
+    std::atomic<size_t> file_bytes{0};
+    /// The size of the files' content, after any decompression.
+    std::atomic<size_t> content_bytes{0};
+    /// The time the threads spent reading and parsing the files.
+    std::atomic<uint64_t> parse_ns{0};
+
+    void reset();
+  };
+  /// The compressed replay files parsed, reported apart from the
+  /// uncompressed ones because decompression bounds their throughput.
+  static ParseStats _compressed_stats;
+  /// The uncompressed replay files parsed.
+  static ParseStats _uncompressed_stats;
+  /// The number of threads used to parse the files.
+  static int _num_parsing_threads;
+  /// The compiled corpus being loaded by load_replay_files, if any.
+  static std::shared_ptr<CompiledCorpus const> _compiled_corpus;
+  /// Whether _compiled_corpus is kept by Localizer::retain, so that the
+  /// trees taken from it are tagged with their sources.
+  static bool _is_compiled_corpus_retained;
 };
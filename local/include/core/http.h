@@ -9,9 +9,12 @@
 
 #include "case_insensitive_utils.h"
 
+#include <atomic>
 #include <chrono>
 #include <list>
 #include <map>
+#include <memory>
+#include <typeindex>
 #include <unordered_map>
 #include <nghttp2/nghttp2.h>
 #include <nghttp3/nghttp3.h>
@@ -68,6 +71,8 @@ static constexpr swoc::TextView HTTP_EOH{"\r\n\r\n"};
 class HttpHeader;
 class RuleCheck;
 struct Txn;
+struct H2PackedHeaders;
+struct H3PackedHeaders;
 
 constexpr auto Transaction_Delay_Cutoff = std::chrono::seconds{10};
 constexpr auto Poll_Timeout = std::chrono::seconds{5};
@@ -126,7 +131,9 @@ class HttpFields
   // field verification requires that we verify the correct order of the field
   // values.
   using Rules = std::multimap<swoc::TextView, std::shared_ptr<RuleCheck>, CaseInsensitiveCompare>;
-  using Fields = std::multimap<swoc::TextView, std::string, CaseInsensitiveCompare>;
+  // The values refer to the same storage as the names: the localized replay
+  // file strings or the received message.
+  using Fields = std::multimap<swoc::TextView, swoc::TextView, CaseInsensitiveCompare>;
 
   struct Field
   {
@@ -136,7 +143,12 @@ class HttpFields
   using FieldsSequence = std::vector<Field>;
 
 public:
-  HttpFields();
+  /// A URL verification rule and the part of the URL it checks.
+  struct UrlRule
+  {
+    UrlPart part;
+    std::shared_ptr<RuleCheck> rule_check;
+  };
 
   Rules _rules;   ///< Maps field names to functors.
   Fields _fields; ///< Maps field names to values.
@@ -147,18 +159,23 @@ public:
    */
   FieldsSequence _fields_sequence;
 
-  /** The capacity to reserve up front for _fields_sequnce.
+  /** The capacity to reserve up front for the _fields_sequence of a received
+   * message.
    *
    * An analysis of 1.2 million messages from production traffic showed that
    * 94% of HTTP request and response messages had 30 or less fields.
    * _fields_sequence is a list of std::string_view tuples, so they are
    * relatively small. Thus reserving this space ahead of time is a cheap cost
    * to pay for the potential performance benefit of avoiding reallocations.
+   * Messages loaded from replay files are not reserved for: they are kept for
+   * the whole run, so their fields are sized exactly instead.
    */
   static constexpr auto num_fields_to_reserve = 30;
 
-  std::vector<std::shared_ptr<RuleCheck>>
-      _url_rules[static_cast<size_t>(UrlPart::UrlPartCount)]; ///< Maps URL part names to functors.
+  /// The URL verification rules, in the order they were specified.
+  std::vector<UrlRule> _url_rules;
+  /// Rule sets shared with other messages. See add_shared_rules.
+  std::vector<std::shared_ptr<self_type const>> _shared_rules;
   swoc::TextView
       _url_parts[static_cast<size_t>(UrlPart::UrlPartCount)]; ///< Maps URL part names to values.
 
@@ -169,14 +186,47 @@ public:
    */
   void add_field(swoc::TextView name, swoc::TextView value);
 
-  /** Add the field and rules from other into self.
+  /** Add the fields, but not the rules, from other into self.
    *
    * @note duplicate field names between this and other will result in
    * duplicate fields being added.
    *
-   * @param[in] other The HttpFields from which to add fields and rules.
+   * @param[in] other The HttpFields from which to add fields.
+   */
+  void merge_fields(self_type const &other);
+
+  /** Check the rules of a shared rule set along with the rules of self.
+   *
+   * The set is referred to rather than copied, so rule sets that apply to
+   * many messages, such as a replay file's global field rules, are stored
+   * once. At verification, the shared rules for a field name are checked
+   * before the rules of self for that name.
+   *
+   * @param[in] rules The immutable rule set. A set without rules is ignored.
+   */
+  void add_shared_rules(std::shared_ptr<self_type const> rules);
+
+  /** The memory saved by referring to shared rule sets.
+   *
+   * @return The estimated memory the rules of the shared rule sets would
+   * have used had they been copied into each message.
+   */
+  static uint64_t get_shared_rules_bytes_saved();
+
+  /** Release the spare capacity of the fields and rules.
+   *
+   * This is for messages which are loaded once and kept, after which no
+   * fields are added.
+   */
+  void shrink_to_fit();
+
+  /** Estimate the memory used by these fields and rules.
+   *
+   * @return The size of this object, its containers' allocations, and the
+   * nodes of its maps. The strings the fields refer to and the RuleCheck
+   * objects are not included.
    */
-  void merge(self_type const &other);
+  size_t get_memory_footprint() const;
 
   /** Convert _fields into nghttp2_nv and add them to the provided vector.
    *
@@ -199,6 +249,13 @@ public:
   void add_fields_to_ngnva(nghttp3_nv *l) const;
 
   friend class HttpHeader;
+
+private:
+  /// Estimate the memory used by the rules, excluding this object itself.
+  size_t get_rules_footprint() const;
+
+  /// The total of the shared rule sets' footprints. See add_shared_rules.
+  static std::atomic<uint64_t> _shared_rules_bytes_saved;
 };
 
 /// An enumeration of the various protocol types.
@@ -247,8 +304,28 @@ public:
   swoc::Errata update_content_length(TextView method);
   swoc::Errata update_transfer_encoding();
 
+  /** Determine the body length of this message when sent in reply to method.
+   *
+   * This does not modify the message. See update_content_length.
+   *
+   * @param[in] method The method of the request this message responds to.
+   *
+   * @return The number of body bytes to send and whether that length is
+   * framed by a Content-Length (or, for HEAD, needs no framing).
+   */
+  std::pair<size_t, bool> get_content_length_for(TextView method) const;
+
   swoc::Errata serialize(swoc::BufferWriter &w) const;
 
+  /** Serialize this message with the given HTTP version in its first line.
+   *
+   * @param[in] w The buffer into which to write the message.
+   * @param[in] http_version The version to use in place of _http_version.
+   *
+   * @return logging and status information via an Errata.
+   */
+  swoc::Errata serialize(swoc::BufferWriter &w, TextView http_version) const;
+
   /** A marker indicating that this transaction's key is not yet set nor derived.
    */
   static constexpr char const *const TRANSACTION_KEY_NOT_SET = "*N/A*";
@@ -279,7 +356,7 @@ public:
    * @return A key if the header fields describe a key or if the user
    * previously set a key via set_key, or TRANSACTION_KEY_NOT_SET otherwise.
    */
-  std::string get_key() const;
+  std::string const &get_key() const;
 
   /** Verify that the fields in 'this' correspond to the provided rules.
    *
@@ -288,14 +365,14 @@ public:
    */
   bool verify_headers(swoc::TextView key, HttpFields const &rules_) const;
 
-  /** Add the fields and rules from other into self's _fields_rules.
+  /** Add the fields from other into self's _fields_rules.
    *
    * @note duplicate field names between this and other will result in
    * duplicate fields being added.
    *
-   * @param[in] other The HttpFields from which to add fields and rules.
+   * @param[in] other The HttpFields from which to add fields.
    */
-  void merge(HttpFields const &other);
+  void merge_fields(HttpFields const &other);
 
   /// Get the HTTP protocol type of this message.
   HTTP_PROTOCOL_TYPE get_http_protocol() const;
@@ -303,6 +380,13 @@ public:
   /// Set the HTTP protocol type for this message.
   void set_http_protocol(HTTP_PROTOCOL_TYPE protocol);
 
+  /** Estimate the heap memory owned by this message.
+   *
+   * @return The memory used by the fields and rules and by the cached
+   * serialization, excluding the size of this object itself.
+   */
+  size_t get_heap_footprint() const;
+
   /// Set that this is an HTTP/1.x message.
   void set_is_http1();
 
@@ -414,15 +498,83 @@ public:
   /// The parsed headers contain "Connection: close" header.
   bool _contains_connection_close = false;
 
-  /// Format string to generate a key from a transaction.
+  /** Serialize this message once as HTTP/1.1 and cache the bytes.
+   *
+   * Responses are static per key, so the server serializes each one at load
+   * time. Session::write then sends the cached bytes for HTTP/1 messages
+   * instead of serializing the header for every request.
+   *
+   * @return logging and status information via an Errata.
+   */
+  swoc::Errata cache_http1_serialization();
+
+  /// The cached HTTP/1.1 header bytes, or empty if not cached.
+  std::string _http1_serialization;
+
+  /// The cached nghttp2 header array. See H2Session::cache_packed_headers.
+  std::shared_ptr<H2PackedHeaders const> _h2_packed_headers;
+
+  /// The cached nghttp3 header array. See H3Session::cache_packed_headers.
+  std::shared_ptr<H3PackedHeaders const> _h3_packed_headers;
+
+  /** Account for a header representation cached at load time.
+   *
+   * @param[in] build_time How long it took to build the representation. This
+   * approximates the time saved each time the representation is sent.
+   */
+  static void record_cached_serialization(std::chrono::nanoseconds build_time);
+
+  /** Account for a header sent from its cached representation. */
+  static void record_cached_serialization_sent();
+
+  /** Report how often cached header representations were sent.
+   *
+   * @return An errata with an informational note estimating the header
+   * serialization time saved by the cache.
+   */
+  static swoc::Errata report_serialization_cache_statistics();
+
+  /// Format string to generate a key from a transaction. Set it with
+  /// set_key_format.
   static std::string _key_format;
 
+  /** Set the format with which keys are derived (see --format).
+   *
+   * The format is compiled once into the parts of the key, so derive_key
+   * need not parse it for every message. This must not be called while
+   * other threads derive keys.
+   *
+   * @param[in] format The key format, such as "{field.uuid}".
+   */
+  static void set_key_format(swoc::TextView format);
+
+  /** Allocate and fill _content with at least n bytes of generated body.
+   *
+   * The buffer only grows, and it may grow while other threads send bodies
+   * from it, such as during a streaming replay. A larger buffer is therefore
+   * published atomically and the previous buffer is not freed, since a send
+   * may still be reading it.
+   */
   static void set_max_content_length(size_t n);
 
+  /** Return a generated body buffer of at least n bytes.
+   *
+   * This is the buffer _content points to, grown if needed. Unlike
+   * set_max_content_length, a buffer replaced by growth is freed once its
+   * last holder releases it, so callers must hold the buffer for as long as
+   * they send from it. The Verifier Server's corpora do so, which lets a
+   * reload free the buffer of the corpus it replaces.
+   *
+   * @param[in] n The minimum size of the buffer.
+   *
+   * @return The buffer.
+   */
+  static std::shared_ptr<char const> get_content(size_t n);
+
   static void global_init();
 
   /// Precomputed content buffer.
-  static swoc::MemSpan<char> _content;
+  static std::atomic<char const *> _content;
 
   bool _verify_strictly;
 
@@ -450,6 +602,34 @@ protected:
   };
 
 private:
+  /** The key format compiled into the parts of the key.
+   *
+   * Formats with specifiers other than plain field and url names are not
+   * compiled and are formatted with Binding instead.
+   */
+  struct KeyPlan
+  {
+    enum class PartType { LITERAL, FIELD, URL };
+
+    struct Part
+    {
+      PartType type = PartType::LITERAL;
+      /// The literal text, or the name of the field.
+      std::string text;
+    };
+
+    /// The format this plan was compiled from.
+    std::string format;
+    std::vector<Part> parts;
+    /// Whether the format could be compiled into parts.
+    bool is_compiled = false;
+  };
+
+  static KeyPlan compile_key_format(swoc::TextView format);
+
+  /// The plan for _key_format.
+  static KeyPlan _key_plan;
+
   /** The key associated with this HTTP transaction. */
   std::string _key;
 
@@ -458,6 +638,44 @@ private:
 
   /// Whether this is an HTTP request.
   bool _is_request = false;
+
+  /// The number of header representations cached at load time.
+  static std::atomic<uint64_t> _num_cached_serializations;
+  /// The total time spent building the cached header representations.
+  static std::atomic<uint64_t> _cached_serialization_build_ns;
+  /// The number of headers sent from a cached representation.
+  static std::atomic<uint64_t> _num_cached_serializations_sent;
+};
+
+/** The per-request state with which a shared message is sent.
+ *
+ * The server's transactions are loaded once and are then shared by every
+ * connection. Whatever depends upon the particular request being answered
+ * (the protocol and stream it arrived on, and whether it was a HEAD request)
+ * is described here rather than being written into the shared HttpHeader.
+ */
+struct MessageOverlay
+{
+  /// Describe hdr as it is, without adjustment.
+  explicit MessageOverlay(HttpHeader const &hdr);
+
+  /** Describe response as sent in reply to request.
+   *
+   * The response is sent via the request's protocol and stream. Responses to
+   * HEAD requests may have a non-zero Content-Length but never have a body.
+   */
+  MessageOverlay(HttpHeader const &response, HttpHeader const &request);
+
+  /// The protocol over which the message is sent.
+  HTTP_PROTOCOL_TYPE protocol = HTTP_PROTOCOL_TYPE::HTTP_1;
+  /// The HTTP version for the first line of an HTTP/1 message.
+  swoc::TextView http_version;
+  /// The stream on which the message is sent, for protocols with streams.
+  int32_t stream_id = -1;
+  /// The number of body bytes to send.
+  size_t content_size = 0;
+  /// Whether the body length is framed by a Content-Length.
+  bool content_length_p = false;
 };
 
 struct Txn
@@ -470,11 +688,47 @@ struct Txn
   std::chrono::microseconds _user_specified_delay_duration{0};
   HttpHeader _req; ///< Request to send.
   HttpHeader _rsp; ///< Rules for response to expect.
+
+  /** Release the spare capacity of a fully loaded transaction.
+   *
+   * The transaction's memory footprint before and after is accounted for
+   * report_memory_statistics.
+   */
+  void compact();
+
+  /** Estimate the memory used by this transaction.
+   *
+   * @return The size of this object plus the heap memory of its messages.
+   */
+  size_t get_memory_footprint() const;
+
+  /** Report the memory used by the compacted transactions.
+   *
+   * @return An errata with an informational note with the average memory
+   * used per transaction as loaded and after compaction.
+   */
+  static swoc::Errata report_memory_statistics();
+
+private:
+  /// The number of transactions compacted.
+  static std::atomic<uint64_t> _num_compacted;
+  /// The memory footprint of those transactions as loaded.
+  static std::atomic<uint64_t> _loaded_bytes;
+  /// The memory footprint of those transactions after compaction.
+  static std::atomic<uint64_t> _compacted_bytes;
 };
 
 struct Ssn
 {
-  std::list<Txn> _transactions;
+  /** The arena holding the strings localized for this session, if they are
+   * freed with it rather than kept for the rest of the process. It is
+   * declared first so that it outlives the transactions referring into it.
+   * See Localizer::ScopedArena.
+   */
+  std::shared_ptr<swoc::MemArena> _localized_arena;
+
+  /// The transactions, contiguous so that replaying them walks memory in order.
+  std::vector<Txn> _transactions;
   swoc::file::path _path;
   unsigned _line_no = 0;
 
@@ -494,6 +748,9 @@ struct Ssn
   bool is_tls = false;
   bool is_h2 = false;
   bool is_h3 = false;
+  /// The key partition, and thus target, of all of this session's
+  /// transactions, or -1 if targets are chosen round robin.
+  int _key_partition = -1;
 
   swoc::Errata post_process_transactions();
 };
@@ -598,16 +855,25 @@ public:
    *
    * @return The number of bytes written and an errata with any messaging.
    */
-  virtual swoc::Rv<ssize_t> write(HttpHeader const &hdr);
+  swoc::Rv<ssize_t> write(HttpHeader const &hdr);
 
-  /** Write the number of body bytes as specified by hdr.
+  /** Write the header to the socket as described by overlay.
    *
-   * @param[in] hdr The header to inspect to determine how many body bytes to
-   * write.
+   * @param[in] hdr The headers to write to the socket. This is not modified.
+   * @param[in] overlay The protocol, stream and body length to send hdr with.
    *
    * @return The number of bytes written and an errata with any messaging.
    */
-  virtual swoc::Rv<ssize_t> write_body(HttpHeader const &hdr);
+  virtual swoc::Rv<ssize_t> write(HttpHeader const &hdr, MessageOverlay const &overlay);
+
+  /** Write the number of body bytes as specified by hdr and overlay.
+   *
+   * @param[in] hdr The header whose body to write.
+   * @param[in] overlay The overlay specifying how many body bytes to write.
+   *
+   * @return The number of bytes written and an errata with any messaging.
+   */
+  virtual swoc::Rv<ssize_t> write_body(HttpHeader const &hdr, MessageOverlay const &overlay);
 
   /** Whether the connection is currently closed. */
   bool is_closed() const;
@@ -615,10 +881,29 @@ public:
   /** Close the connection. */
   virtual void close();
 
+  /** Close the connection and return the session to its newly constructed
+   * state so that it can be used for another connection.
+   *
+   * Unlike destruction, allocations such as buffers and TLS objects are
+   * retained for the next connection. @see SessionPool
+   */
+  virtual void reset();
+
+  /** Whether the session supports reuse via reset.
+   *
+   * @return true if a SessionPool may hand this session out again after it
+   * is released, false if it must be destroyed.
+   */
+  virtual bool
+  is_reusable() const
+  {
+    return true;
+  }
+
   static swoc::Errata init(int num_transactions);
 
   virtual swoc::Errata run_transactions(
-      std::list<Txn> const &txn,
+      std::vector<Txn> const &txn,
       swoc::TextView interface,
       swoc::IPEndpoint const *real_target,
       double rate_multiplier);
@@ -662,6 +947,64 @@ Session::is_closed() const
   return _fd < 0;
 }
 
+/** A free list of Session objects so that a new connection can reuse the
+ * allocations of a previous, closed connection.
+ *
+ * Each worker thread owns its own pool. A pool is not thread safe: the owner
+ * is expected to serialize access to it.
+ */
+class SessionPool
+{
+public:
+  /** Retrieve a session of the given type, reusing a released one if available.
+   *
+   * @return A closed session ready for set_fd or do_connect.
+   */
+  template <typename SessionType> std::unique_ptr<SessionType> acquire();
+
+  /** Return a session to the pool for later reuse.
+   *
+   * The session is reset (closing its connection if still open). Sessions
+   * which are not reusable are destroyed.
+   *
+   * @param[in] session The session to release.
+   */
+  void release(std::unique_ptr<Session> session);
+
+  /** Report the session allocation counters across all pools.
+   *
+   * @return An errata with an informational note with the number of
+   * connections and Session objects allocated for them.
+   */
+  static swoc::Errata report_allocation_statistics();
+
+private:
+  /// The maximum number of idle sessions to retain per session type.
+  static constexpr size_t MAX_IDLE_SESSIONS_PER_TYPE = 4;
+
+  std::unordered_map<std::type_index, std::vector<std::unique_ptr<Session>>> _free_lists;
+
+  /// The number of sessions handed out by all pools.
+  static std::atomic<uint64_t> _num_acquired;
+  /// The number of those sessions which had to be newly allocated.
+  static std::atomic<uint64_t> _num_allocated;
+};
+
+template <typename SessionType>
+std::unique_ptr<SessionType>
+SessionPool::acquire()
+{
+  ++_num_acquired;
+  auto &free_list = _free_lists[std::type_index(typeid(SessionType))];
+  if (free_list.empty()) {
+    ++_num_allocated;
+    return std::make_unique<SessionType>();
+  }
+  std::unique_ptr<SessionType> session{static_cast<SessionType *>(free_list.back().release())};
+  free_list.pop_back();
+  return session;
+}
+
 class ChunkCodex
 {
 public:
@@ -17,6 +17,7 @@
 #include <nghttp2/nghttp2.h>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "swoc/BufferWriter.h"
 #include "swoc/Errata.h"
@@ -27,6 +28,22 @@
 class HttpHeader;
 struct Txn;
 
+/** An nghttp2 header array packed once for a static HttpHeader.
+ *
+ * The same array is submitted for every stream that sends the header. The
+ * stream id is passed to nghttp2 separately, so nothing in the array varies
+ * per request.
+ */
+struct H2PackedHeaders
+{
+  /// Keeps the field names and values referenced by nva alive.
+  std::shared_ptr<HttpFields> fields;
+  /// The storage referenced by the :status entry.
+  std::string status;
+  /// The packed header array.
+  std::vector<nghttp2_nv> nva;
+};
+
 class H2StreamState
 {
 public:
@@ -95,8 +112,9 @@ public:
   H2Session(swoc::TextView const &client_sni, int client_verify_mode = SSL_VERIFY_NONE);
   ~H2Session();
   swoc::Rv<ssize_t> read(swoc::MemSpan<char> span) override;
+  using Session::write;
   swoc::Rv<ssize_t> write(swoc::TextView data) override;
-  swoc::Rv<ssize_t> write(HttpHeader const &hdr) override;
+  swoc::Rv<ssize_t> write(HttpHeader const &hdr, MessageOverlay const &overlay) override;
 
   /** For HTTP/2, we read on the socket until an entire stream is done.
    *
@@ -114,6 +132,8 @@ public:
 
   swoc::Errata accept() override;
   swoc::Errata connect() override;
+  /** @see Session::reset */
+  void reset() override;
 
   /** Perform HTTP/2 global initialization.
    *
@@ -126,6 +146,17 @@ public:
   /** Delete global instances. */
   static void terminate();
 
+  /** Pack the nghttp2 header array for a static header once.
+   *
+   * write(HttpHeader const &, MessageOverlay const &) submits the cached
+   * array rather than packing the header for each stream.
+   *
+   * @param[in,out] hdr The header to pack and in which to cache the array.
+   *
+   * @return logging and status information via an Errata.
+   */
+  static swoc::Errata cache_packed_headers(HttpHeader &hdr);
+
   /** Perform the HTTP/2 (nghttp2) configuration for a client connection. */
   swoc::Errata client_session_init();
   /** Perform the HTTP/2 (nghttp2) configuration for a server connection. */
@@ -133,7 +164,7 @@ public:
 
   swoc::Errata send_connection_settings();
   swoc::Errata run_transactions(
-      std::list<Txn> const &txn,
+      std::vector<Txn> const &txn,
       swoc::TextView interface,
       swoc::IPEndpoint const *real_target,
       double rate_multiplier) override;
@@ -187,8 +218,8 @@ private:
    *
    * @return Any errata information from the packing operation.
    */
-  swoc::Errata pack_headers(HttpHeader const &hdr, nghttp2_nv *&nv_hdr, int &hdr_count);
-  nghttp2_nv tv_to_nv(char const *name, swoc::TextView v);
+  static swoc::Errata pack_headers(HttpHeader const &hdr, nghttp2_nv *&nv_hdr, int &hdr_count);
+  static nghttp2_nv tv_to_nv(char const *name, swoc::TextView v);
   void set_expected_response_for_last_request(HttpHeader const &response);
 
 private:
@@ -196,8 +227,6 @@ private:
   bool _is_server = false;
 
   nghttp2_session *_session = nullptr;
-  nghttp2_session_callbacks *_callbacks = nullptr;
-  nghttp2_option *_options = nullptr;
   bool _h2_is_negotiated = false;
 
   std::deque<int32_t> _ended_streams;
@@ -219,6 +248,19 @@ private:
    */
   static SSL_CTX *h2_client_context;
 
+  /** The nghttp2 callbacks for both client and server sessions.
+   *
+   * nghttp2 copies the callbacks into each session it creates, so these are
+   * built once in init and shared by all connections.
+   */
+  static nghttp2_session_callbacks *_session_callbacks;
+
+  /** Create the shared nghttp2 callbacks.
+   *
+   * @return logging and status information via an Errata.
+   */
+  static swoc::Errata callbacks_init();
+
   /// The system status code. This is set to non-zero if problems are detected.
   static int *process_exit_code;
 };
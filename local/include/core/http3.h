@@ -31,6 +31,22 @@
 class HttpHeader;
 struct Txn;
 
+/** An nghttp3 header array packed once for a static HttpHeader.
+ *
+ * The same array is submitted for every stream that sends the header. The
+ * stream id is passed to nghttp3 separately, so nothing in the array varies
+ * per request.
+ */
+struct H3PackedHeaders
+{
+  /// Keeps the field names and values referenced by nva alive.
+  std::shared_ptr<HttpFields> fields;
+  /// The storage referenced by the :status entry.
+  std::string status;
+  /// The packed header array.
+  std::vector<nghttp3_nv> nva;
+};
+
 namespace swoc
 {
 inline namespace SWOC_VERSION_NS
@@ -268,11 +284,23 @@ public:
   H3Session(swoc::TextView const &client_sni, int client_verify_mode = SSL_VERIFY_NONE);
   ~H3Session();
   swoc::Rv<ssize_t> read(swoc::MemSpan<char> span) override;
+  using Session::write;
   swoc::Rv<ssize_t> write(swoc::TextView data) override;
-  swoc::Rv<ssize_t> write(HttpHeader const &hdr) override;
+  swoc::Rv<ssize_t> write(HttpHeader const &hdr, MessageOverlay const &overlay) override;
 
   /** Populate an nghttp3_nv header vector structure from an HttpHeader. */
-  swoc::Errata pack_headers(HttpHeader const &hdr, nghttp3_nv *&nv_hdr, int &hdr_count);
+  static swoc::Errata pack_headers(HttpHeader const &hdr, nghttp3_nv *&nv_hdr, int &hdr_count);
+
+  /** Pack the nghttp3 header array for a static header once.
+   *
+   * write(HttpHeader const &, MessageOverlay const &) submits the cached
+   * array rather than packing the header for each stream.
+   *
+   * @param[in,out] hdr The header to pack and in which to cache the array.
+   *
+   * @return logging and status information via an Errata.
+   */
+  static swoc::Errata cache_packed_headers(HttpHeader &hdr);
 
   /** For HTTP/3, we read on the socket until an entire stream is done.
    *
@@ -291,9 +319,33 @@ public:
   /** Perform the server-side QUIC handshake for a connection. */
   swoc::Errata accept() override;
 
+  /** QUIC connection state is not reset for reuse: always allocate anew. */
+  bool
+  is_reusable() const override
+  {
+    return false;
+  }
+
   /** Perform the client-side QUIC handshake for a connection. */
   swoc::Errata connect() override;
 
+  /** Offer the given session for resumption in the next QUIC handshake.
+   *
+   * @param[in] session The session to resume, or nullptr for a full
+   * handshake.
+   */
+  void set_session_to_resume(SSL_SESSION *session);
+
+  /** Retrieve a resumable session from the completed handshake.
+   *
+   * @return A new reference to a resumable session which the caller must
+   * free, or nullptr if the server has not provided one.
+   */
+  SSL_SESSION *get1_resumable_session() const;
+
+  /** Whether the QUIC handshake resumed a previous session. */
+  bool is_session_reused() const;
+
   /** Establish a QUIC connection from the given interface to the given IP
    * address. */
   swoc::Errata do_connect(swoc::TextView interface, swoc::IPEndpoint const *target) override;
@@ -331,7 +383,7 @@ public:
 
   /** Run all the transactions against the specified target. */
   swoc::Errata run_transactions(
-      std::list<Txn> const &transactions,
+      std::vector<Txn> const &transactions,
       swoc::TextView interface,
       swoc::IPEndpoint const *target,
       double rate_multiplier) override;
@@ -377,10 +429,13 @@ protected:
    */
   int _client_verify_mode = SSL_VERIFY_NONE;
 
+  /// The session offered for resumption in the client handshake, if any.
+  SSL_SESSION *_session_to_resume = nullptr;
+
   SSL *_ssl = nullptr;
 
 private:
-  nghttp3_nv tv_to_nv(char const *name, swoc::TextView v);
+  static nghttp3_nv tv_to_nv(char const *name, swoc::TextView v);
 
   /** Create and configure the UDP socket for this connection. */
   swoc::Errata configure_udp_socket(swoc::TextView interface, swoc::IPEndpoint const *target);
@@ -11,6 +11,8 @@
 
 #include <openssl/err.h>
 #include <openssl/ssl.h>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <string_view>
@@ -34,6 +36,10 @@ int client_hello_callback(SSL *ssl, int * /* al */, void * /* arg */);
 /** The callback for SSL_CTX_set_alpn_select_cb.
  *
  * This sets the protocols that the server will negotiate via ALPN.
+ *
+ * If @a arg is not null, it is the TLSHandshakeBehavior of a per-SNI context
+ * (see TLSSession::build_sni_context_cache) and its ALPN string is used
+ * directly instead of looking it up by the SNI.
  */
 int alpn_select_next_proto_cb(
     SSL *ssl,
@@ -41,7 +47,7 @@ int alpn_select_next_proto_cb(
     unsigned char *outlen,
     unsigned char const *in,
     unsigned int inlen,
-    void * /* arg */);
+    void *arg);
 
 #ifndef OPENSSL_NO_NEXTPROTONEG
 /** The callback for SSL_CTX_set_next_proto_select_cb.
@@ -147,6 +153,65 @@ private:
   std::string _alpn_wire_string;
 };
 
+/** The TLS handshake behaviors of one load of the replay files, keyed by SNI.
+ *
+ * This is used by the Verifier Server. A table is populated while the replay
+ * files are loaded, its per-SNI contexts are built via
+ * TLSSession::build_sni_context_cache, and it is then made current via
+ * TLSSession::set_sni_handshake_table. It is not modified afterward: a reload
+ * builds a new table. Each TLSSession keeps the table that was current when
+ * its handshake started, so replacing the table does not free the contexts
+ * or behaviors of a handshake in progress.
+ */
+class SniHandshakeTable
+{
+public:
+  SniHandshakeTable() = default;
+  SniHandshakeTable(SniHandshakeTable const &) = delete;
+  SniHandshakeTable &operator=(SniHandshakeTable const &) = delete;
+  /// Frees the per-SNI contexts.
+  ~SniHandshakeTable();
+
+  /** Register the TLS handshake behavior of the server for the SNI.
+   *
+   * @param[in] sni The SNI which is the key for the handshake behavior.
+   *
+   * @param[in] handshake_behavior Dictates how proxy verifier should behave
+   * during a TLS handshake with the given SNI.
+   */
+  void register_tls_handshake_behavior(
+      std::string_view sni,
+      TLSHandshakeBehavior &&handshake_behavior);
+
+  /// The number of SNIs with a registered handshake behavior.
+  size_t size() const;
+
+  /** Move the behaviors of another table into this one.
+   *
+   * As with register_tls_handshake_behavior, an SNI already registered keeps
+   * its behavior. This must be called before build_sni_context_cache.
+   *
+   * @param[in] other The table to merge. Its behaviors are moved from.
+   */
+  void merge(SniHandshakeTable &&other);
+
+  /// The registered handshake behaviors, keyed by SNI.
+  std::unordered_map<std::string, TLSHandshakeBehavior> const &get_handshake_behaviors() const;
+
+private:
+  friend class TLSSession;
+
+  /** The handshake behavior of the verifier server against the proxy in the TLS
+   * handshake as specified per the SNI received from the proxy.
+   */
+  std::unordered_map<std::string, TLSHandshakeBehavior> _handshake_behavior_per_sni;
+
+  /** The per-SNI server contexts, built from _handshake_behavior_per_sni via
+   * TLSSession::build_sni_context_cache.
+   */
+  std::unordered_map<std::string_view, SSL_CTX *> _server_context_per_sni;
+};
+
 class TLSSession : public Session
 {
 public:
@@ -160,14 +225,9 @@ public:
   swoc::Rv<ssize_t> read(swoc::MemSpan<char> span) override;
   /** @see Session::write */
   swoc::Rv<ssize_t> write(swoc::TextView data) override;
-  /** @see Session::write */
-  swoc::Rv<ssize_t>
-  write(HttpHeader const &hdr) override
-  {
-    // The base Session::write will serialize the header then polymorphically
-    // call the TLSSession::write(TextView) version.
-    return Session::write(hdr);
-  }
+  // The base Session::write overloads for headers serialize the header then
+  // polymorphically call the TLSSession::write(TextView) version.
+  using Session::write;
 
   /** Poll until there is data on the socket after an SSL operation fails.
    *
@@ -186,8 +246,14 @@ public:
       std::chrono::milliseconds timeout,
       int ssl_error);
 
-  /** @see Session::close */
+  /** @see Session::close
+   *
+   * The SSL object is retained so that it can be reused via SSL_clear if
+   * this session is reset and used for another connection.
+   */
   void close() override;
+  /** @see Session::reset */
+  void reset() override;
   /** @see Session::accept */
   swoc::Errata accept() override;
   /** @see Session::connect */
@@ -200,6 +266,60 @@ public:
     return _ssl;
   }
 
+  /** Set the SNI and verify mode the client uses in its handshake with the
+   * proxy.
+   *
+   * This is used to configure a pooled session with the values otherwise
+   * passed to the constructor.
+   *
+   * @param[in] client_sni The SNI to send in the client hello.
+   * @param[in] client_verify_mode The verify mode for the proxy's certificate.
+   */
+  void set_client_tls_options(swoc::TextView client_sni, int client_verify_mode);
+
+  /** Offer the given session for resumption in subsequent client handshakes.
+   *
+   * A reference to the session is held until it is replaced or this
+   * TLSSession is destroyed.
+   *
+   * @param[in] session The session to resume, or nullptr for a full
+   * handshake.
+   */
+  void set_session_to_resume(SSL_SESSION *session);
+
+  /** Retrieve a session from the completed handshake that can be resumed.
+   *
+   * TLS 1.3 servers send their session tickets after the handshake, so if the
+   * session is not yet resumable this waits up to timeout for a ticket.
+   *
+   * @param[in] timeout How long to wait for a TLS 1.3 session ticket.
+   *
+   * @return A new reference to a resumable session which the caller must
+   * free, or nullptr if the server did not provide one.
+   */
+  swoc::Rv<SSL_SESSION *> get1_resumable_session(std::chrono::milliseconds timeout);
+
+  /** Whether the last client handshake resumed a previous session. */
+  bool
+  is_session_reused() const
+  {
+    return _ssl != nullptr && SSL_session_reused(_ssl) == 1;
+  }
+
+  /** Whether the kernel encrypts the records sent on this session (kTLS). */
+  bool
+  is_ktls_send_offloaded() const
+  {
+    return _ktls_send;
+  }
+
+  /** Whether the kernel decrypts the records received on this session (kTLS). */
+  bool
+  is_ktls_recv_offloaded() const
+  {
+    return _ktls_recv;
+  }
+
   // static members
   /** Perform global TLS initialization.
    *
@@ -209,45 +329,147 @@ public:
   static swoc::Errata init(swoc::TextView tls_secrets_log_file);
   static void terminate();
 
-  /** Register the TLS handshake verification mode of the server per the SNI.
-   *
-   * This function is only relevant to the server.
-   *
-   * This specifies what verification mode should be done against the client in
-   * the TLS handshake if the client uses the given SNI in the client hello.
+  /** Make table the SNI handshake table for handshakes accepted from now on.
    *
-   * @param[in] sni The SNI which is the key for the handshake behavior.
+   * This function is only relevant to the server. Handshakes already in
+   * progress keep using the table that was current when they were accepted.
    *
-   * @param[in] handshake_behavior Dictates how proxy verifier should behave
-   * during a TLS handshake with the given SNI.
+   * @param[in] table The table to use, with its contexts built via
+   * build_sni_context_cache.
    */
-  static void register_tls_handshake_behavior(
-      std::string_view sni,
-      TLSHandshakeBehavior &&handshake_behavior);
+  static void set_sni_handshake_table(std::shared_ptr<SniHandshakeTable const> table);
 
   /** A lookup function for the registered verification mode given the SNI.
    *
    * This function is only relevant to the server.
    *
+   * @param[in] ssl The SSL object of the handshake, from which the session's
+   * SNI handshake table is retrieved.
+   *
    * @param[in] sni The SNI key from which the mode value is queried.
    *
    * @return The verification mode for the given SNI previously registered via
-   * register_sni_for_client_verification. If no such SNI has been registered,
-   * then SSL_VERIFY_NONE will be returned as a default.
+   * SniHandshakeTable::register_tls_handshake_behavior. If no such SNI has
+   * been registered, then SSL_VERIFY_NONE will be returned as a default.
    */
-  static int get_verify_mode_for_sni(std::string_view sni);
+  static int get_verify_mode_for_sni(SSL *ssl, std::string_view sni);
 
   /** A lookup function for the registered alpn protocol string given the SNI.
    *
    * This function is only relevant to the server.
    *
+   * @param[in] ssl The SSL object of the handshake, from which the session's
+   * SNI handshake table is retrieved.
+   *
    * @param[in] sni The SNI key from which the alpn string is queried.
    *
    * @return The wire format alpn protocol string for the given SNI previously
-   * registered via register_sni_for_client_verification. If no such SNI has
-   * been registered, then an empty string will be returned as a default.
+   * registered via SniHandshakeTable::register_tls_handshake_behavior. If no
+   * such SNI has been registered, then an empty string will be returned as a
+   * default.
+   */
+  static std::string_view get_alpn_protocol_string_for_sni(SSL *ssl, std::string_view sni);
+
+  /** Configure TLS session resumption for the server.
+   *
+   * This must be called before init. Session IDs and session tickets are
+   * always accepted by the server. If a ticket key file is provided, its
+   * first 80 bytes are used as the session ticket keys so that tickets
+   * issued by one verifier-server process are accepted by another (or by the
+   * same server after a restart). Otherwise OpenSSL generates random keys at
+   * startup.
+   *
+   * @param[in] ticket_key_file The path to the ticket key file, or an empty
+   * string to use OpenSSL's randomly generated keys.
+   *
+   * @return logging and status information via an Errata.
    */
-  static std::string_view get_alpn_protocol_string_for_sni(std::string_view sni);
+  static swoc::Errata configure_session_tickets(std::string_view ticket_key_file);
+
+  /** Build an SSL_CTX per registered SNI of table.
+   *
+   * This function is only relevant to the server and should be called after
+   * all the handshake behaviors have been registered in the table via
+   * SniHandshakeTable::register_tls_handshake_behavior (i.e., after the
+   * replay files are loaded). Each context has the server certificates, CA
+   * store, verify mode and ALPN selection already applied so that the client
+   * hello callback only has to swap in the context for the received SNI
+   * rather than reconfigure the SSL object for each handshake.
+   *
+   * @param[in,out] table The table for whose SNIs to build contexts.
+   *
+   * @return logging and status information via an Errata.
+   */
+  static swoc::Errata build_sni_context_cache(SniHandshakeTable &table);
+
+  /** Look up the cached per-SNI context built via build_sni_context_cache.
+   *
+   * @param[in] ssl The SSL object of the handshake, from which the session's
+   * SNI handshake table is retrieved.
+   *
+   * @param[in] sni The SNI received in the client hello.
+   *
+   * @return The context for the SNI, or nullptr if there is none.
+   */
+  static SSL_CTX *get_context_for_sni(SSL *ssl, std::string_view sni);
+
+  /** Report the server-side handshake counters.
+   *
+   * @return An errata with an informational note describing the number of
+   * full and resumed handshakes accepted by the server.
+   */
+  static swoc::Errata report_handshake_statistics();
+
+  /** Request kernel TLS offload for subsequently created TLS contexts.
+   *
+   * This must be called before init. When enabled, SSL_OP_ENABLE_KTLS is set
+   * on the client and server contexts. Whether a given connection is actually
+   * offloaded depends upon the kernel, the OpenSSL build and the negotiated
+   * cipher; connections that are not offloaded use the usual user space
+   * record processing.
+   *
+   * @param[in] enable Whether kTLS should be requested.
+   *
+   * @return logging and status information via an Errata.
+   */
+  static swoc::Errata configure_ktls(bool enable);
+
+  /** Report how many TLS connections were offloaded to the kernel.
+   *
+   * @return An errata with an informational note with the kTLS counters, if
+   * kTLS was requested.
+   */
+  static swoc::Errata report_ktls_statistics();
+
+  /** Report how many SSL objects were allocated versus reused.
+   *
+   * @return An errata with an informational note with the SSL object counters.
+   */
+  static swoc::Errata report_ssl_allocation_statistics();
+
+  /** Configure the ciphers and groups offered in client handshakes.
+   *
+   * This must be called before init. Empty values leave the OpenSSL defaults
+   * (or, for QUIC, the HTTP/3 defaults) in place.
+   *
+   * @param[in] cipher_list The TLS 1.2 and below cipher list.
+   * @param[in] ciphersuites The TLS 1.3 cipher suites.
+   * @param[in] groups The key exchange groups.
+   *
+   * @return logging and status information via an Errata.
+   */
+  static swoc::Errata configure_client_handshake_options(
+      std::string_view cipher_list,
+      std::string_view ciphersuites,
+      std::string_view groups);
+
+  /** Apply the options from configure_client_handshake_options to a context.
+   *
+   * @param[in] context The client context to configure.
+   *
+   * @return logging and status information via an Errata.
+   */
+  static swoc::Errata apply_client_handshake_options(SSL_CTX *context);
 
   /** Configure the use of a client certificate.
    *
@@ -331,6 +553,33 @@ public:
   /// The CA directory containing one or more CA cert files.
   static swoc::file::path ca_certificate_dir;
 
+protected:
+  /** Record whether the kernel took over record processing for the
+   * connection once the handshake completed.
+   *
+   * @return logging information about the offload via an Errata.
+   */
+  swoc::Errata detect_ktls_offload();
+
+  /** Make _ssl ready for a new handshake using the given context.
+   *
+   * If this session still has the SSL object of a previous connection which
+   * was created from the same context, it is reset via SSL_clear rather than
+   * freed and reallocated.
+   *
+   * @param[in] context The context from which the SSL object should be
+   * created.
+   *
+   * @return logging and status information via an Errata.
+   */
+  swoc::Errata prepare_ssl(SSL_CTX *context);
+
+  /** Set the kTLS option on the context if it was requested via configure_ktls.
+   *
+   * @param[in] context The context upon which to set SSL_OP_ENABLE_KTLS.
+   */
+  static void apply_ktls_option(SSL_CTX *context);
+
 protected:
   static swoc::Errata client_init(SSL_CTX *&client_context);
   static swoc::Errata server_init(SSL_CTX *&server_context);
@@ -338,6 +587,10 @@ protected:
 
 protected:
   SSL *_ssl = nullptr;
+  /// The context _ssl was created from (before any per-SNI context switch).
+  SSL_CTX *_ssl_context = nullptr;
+  /// The SNI handshake table that was current when this session accepted.
+  std::shared_ptr<SniHandshakeTable const> _sni_handshake_table;
   /** The SNI to be sent by the client (as opposed to the one expected by the
    * server from the proxy). This only applies to the client.
    */
@@ -348,13 +601,43 @@ protected:
    */
   int _client_verify_mode = SSL_VERIFY_NONE;
 
+  /// The session offered for resumption in the client handshake, if any.
+  SSL_SESSION *_session_to_resume = nullptr;
+
+  /// Whether sent records are encrypted by the kernel.
+  bool _ktls_send = false;
+  /// Whether received records are decrypted by the kernel.
+  bool _ktls_recv = false;
+
   static SSL_CTX *server_context;
   static SSL_CTX *client_context;
 
-  /** The handshake behavior of the verifier server against the proxy in the TLS
-   * handshake as specified per the SNI received from the proxy.
+  /** The SNI handshake table for newly accepted handshakes. Access this via
+   * std::atomic_load and std::atomic_store since it is replaced on reload
+   * while handshakes are being accepted.
    */
-  static std::unordered_map<std::string, TLSHandshakeBehavior> _handshake_behavior_per_sni;
+  static std::shared_ptr<SniHandshakeTable const> _current_sni_handshake_table;
+
+  /// The number of server-side handshakes that negotiated a new session.
+  static std::atomic<uint64_t> _num_full_handshakes;
+  /// The number of server-side handshakes that resumed a previous session.
+  static std::atomic<uint64_t> _num_resumed_handshakes;
+  /// The number of server-side handshakes served from a per-SNI context.
+  static std::atomic<uint64_t> _num_sni_context_hits;
+
+  /// Whether kTLS was requested via configure_ktls.
+  static bool _ktls_is_enabled;
+  /// The number of connections for which both directions were offloaded.
+  static std::atomic<uint64_t> _num_ktls_offloaded;
+  /// The number of connections for which only one direction was offloaded.
+  static std::atomic<uint64_t> _num_ktls_partially_offloaded;
+  /// The number of connections that fell back to user space TLS.
+  static std::atomic<uint64_t> _num_ktls_not_offloaded;
+
+  /// The number of SSL objects created via SSL_new.
+  static std::atomic<uint64_t> _num_ssl_allocations;
+  /// The number of SSL objects reused via SSL_clear.
+  static std::atomic<uint64_t> _num_ssl_reuses;
 
 private:
   /** Open the file for TLS secrets logging.
@@ -372,4 +655,14 @@ private:
 
   /// The file to which TLS secrets will be logged.
   static swoc::file::path tls_secrets_log_file;
+
+  /// The file containing the session ticket keys, if configured.
+  static swoc::file::path session_ticket_key_file;
+
+  /// The client cipher list set via configure_client_handshake_options.
+  static std::string _client_cipher_list;
+  /// The client TLS 1.3 cipher suites set via configure_client_handshake_options.
+  static std::string _client_ciphersuites;
+  /// The client groups set via configure_client_handshake_options.
+  static std::string _client_groups;
 };
@@ -10,11 +10,18 @@
 #include "core/http2.h"
 #include "core/http3.h"
 #include "core/https.h"
+#include "core/KeyIndexFile.h"
+#include "core/Localizer.h"
 #include "core/ProxyVerifier.h"
 #include "core/YamlParser.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <limits>
 #include <list>
 #include <mutex>
 #include <string>
@@ -22,6 +29,7 @@
 #include <thread>
 #include <unistd.h>
 #include <unordered_set>
+#include <vector>
 
 #include <dirent.h>
 #include <netinet/tcp.h>
@@ -62,58 +70,52 @@ std::unordered_set<std::string> Keys_Whitelist;
 
 TextView specified_interface;
 
-std::mutex LoadMutex;
-
 std::list<std::shared_ptr<Ssn>> Session_List;
 
 struct TargetSelector
 {
-  /** Round robin retrieval of HTTP addresses. */
+  /** Retrieve an HTTP address: round robin, or the one owning partition. */
   swoc::IPEndpoint const *
-  get_http_target()
+  get_http_target(int partition = -1)
   {
-    if (http_targets.empty()) {
-      return nullptr;
-    }
-    auto const *http_target = &http_targets[http_target_index];
-    if (++http_target_index >= http_targets.size()) {
-      http_target_index = 0;
-    }
-    return http_target;
+    return get_target(http_targets, http_target_index, partition);
   }
 
-  /** Round robin retrieval of HTTPS addresses. */
+  /** Retrieve an HTTPS address: round robin, or the one owning partition. */
   swoc::IPEndpoint const *
-  get_https_target()
+  get_https_target(int partition = -1)
   {
-    if (https_targets.empty()) {
-      return nullptr;
-    }
-    auto const *https_target = &https_targets[https_target_index];
-    if (++https_target_index >= https_targets.size()) {
-      https_target_index = 0;
-    }
-    return https_target;
+    return get_target(https_targets, https_target_index, partition);
   }
 
-  /** Round robin retrieval of HTTPS addresses. */
+  /** Retrieve an HTTP/3 address: round robin, or the one owning partition. */
   swoc::IPEndpoint const *
-  get_http3_target()
+  get_http3_target(int partition = -1)
   {
-    if (http3_targets.empty()) {
-      return nullptr;
-    }
-    auto const *http3_target = &http3_targets[http3_target_index];
-    if (++http3_target_index >= http3_targets.size()) {
-      http3_target_index = 0;
-    }
-    return http3_target;
+    return get_target(http3_targets, http3_target_index, partition);
   }
 
   std::deque<swoc::IPEndpoint> http_targets;
   std::deque<swoc::IPEndpoint> https_targets;
   std::deque<swoc::IPEndpoint> http3_targets;
 
+private:
+  static swoc::IPEndpoint const *
+  get_target(std::deque<swoc::IPEndpoint> const &targets, size_t &target_index, int partition)
+  {
+    if (targets.empty()) {
+      return nullptr;
+    }
+    if (partition >= 0) {
+      return &targets[partition % targets.size()];
+    }
+    auto const *target = &targets[target_index];
+    if (++target_index >= targets.size()) {
+      target_index = 0;
+    }
+    return target;
+  }
+
 private:
   size_t http_target_index = 0;
   size_t https_target_index = 0;
@@ -122,6 +124,11 @@ private:
 
 TargetSelector Target_Selector;
 
+/** Whether each transaction is sent to the target owning its key's partition
+ * rather than to targets chosen round robin. See --key-hash-targets.
+ */
+bool Use_Key_Hash_Targets = false;
+
 /** Whether the replay-client constructs traffic according to client-request or
  * proxy-request directives.
  *
@@ -134,26 +141,29 @@ TargetSelector Target_Selector;
  */
 bool Use_Proxy_Request_Directives = false;
 
+/** Parse the value of a YAML_TIME_START_KEY.
+ *
+ * @param[in] start_node The value node.
+ *
+ * @return The start time it specifies.
+ */
 swoc::Rv<TimePoint>
-get_start_time(YAML::Node const &node)
+get_start_time(YAML::Node const &start_node)
 {
   swoc::Rv<TimePoint> zret;
-  if (node[YAML_TIME_START_KEY]) {
-    auto start_node{node[YAML_TIME_START_KEY]};
-    if (start_node.IsScalar()) {
-      auto t = swoc::svtou(start_node.Scalar());
-      if (t != 0) {
-        return TimePoint(nanoseconds(t));
-      } else {
-        zret.note(
-            S_ERROR,
-            R"("{}" node value "{}" that is not a positive integer.)",
-            YAML_TIME_START_KEY,
-            start_node.Scalar());
-      }
+  if (start_node.IsScalar()) {
+    auto t = swoc::svtou(start_node.Scalar());
+    if (t != 0) {
+      return TimePoint(nanoseconds(t));
     } else {
-      zret.note(S_ERROR, R"("{}" key that is not a scalar.)", YAML_TIME_START_KEY);
+      zret.note(
+          S_ERROR,
+          R"("{}" node value "{}" that is not a positive integer.)",
+          YAML_TIME_START_KEY,
+          start_node.Scalar());
     }
+  } else {
+    zret.note(S_ERROR, R"("{}" key that is not a scalar.)", YAML_TIME_START_KEY);
   }
   return zret;
 }
@@ -161,16 +171,18 @@ get_start_time(YAML::Node const &node)
 class ClientReplayFileHandler : public ReplayFileHandler
 {
 public:
-  ClientReplayFileHandler();
+  /// @param[in] sessions The list to which to add the parsed sessions.
+  ClientReplayFileHandler(std::list<std::shared_ptr<Ssn>> &sessions);
   ~ClientReplayFileHandler() = default;
 
-  Errata ssn_open(YAML::Node const &node) override;
-  Errata txn_open(YAML::Node const &node) override;
+  Errata ssn_open(YAML::Node const &node, YamlKeyMap const &keys) override;
+  Errata txn_open(YAML::Node const &node, YamlKeyMap const &keys) override;
+  bool skip_transaction(YAML::Node const &node) override;
   Errata client_request(YAML::Node const &node) override;
   Errata proxy_request(YAML::Node const &node) override;
   Errata server_response(YAML::Node const &node) override;
   Errata proxy_response(YAML::Node const &node) override;
-  Errata apply_to_all_messages(HttpFields const &all_headers) override;
+  Errata apply_to_all_messages(std::shared_ptr<HttpFields const> const &all_headers) override;
   Errata txn_close() override;
   Errata ssn_close() override;
 
@@ -181,6 +193,7 @@ private:
   std::shared_ptr<Ssn> _ssn;
   YAML::Node const *_txn_node = nullptr;
   Txn _txn;
+  std::list<std::shared_ptr<Ssn>> &_sessions;
 };
 
 bool Shutdown_Flag = false;
@@ -188,7 +201,11 @@ bool Shutdown_Flag = false;
 class ClientThreadInfo : public ThreadInfo
 {
 public:
-  Ssn *_ssn = nullptr;
+  /// The session to replay. It is held until replayed, so that a streamed
+  /// session is freed once it is sent.
+  std::shared_ptr<Ssn> _ssn;
+  /// Sessions of this thread's previous connections, kept for reuse.
+  SessionPool _session_pool;
   bool
   data_ready() override
   {
@@ -212,7 +229,11 @@ ClientThreadPool::make_thread(std::thread *t)
   return std::thread(TF_Client, t); // move the temporary into the list element for permanence.
 }
 
-ClientReplayFileHandler::ClientReplayFileHandler() : _txn{Use_Strict_Checking} { }
+ClientReplayFileHandler::ClientReplayFileHandler(std::list<std::shared_ptr<Ssn>> &sessions)
+  : _txn{Use_Strict_Checking}
+  , _sessions{sessions}
+{
+}
 
 void
 ClientReplayFileHandler::ssn_reset()
@@ -229,16 +250,16 @@ ClientReplayFileHandler::txn_reset()
 }
 
 Errata
-ClientReplayFileHandler::ssn_open(YAML::Node const &node)
+ClientReplayFileHandler::ssn_open(YAML::Node const &node, YamlKeyMap const &keys)
 {
   Errata errata;
   _ssn = std::make_shared<Ssn>();
   _ssn->_path = _path;
   _ssn->_line_no = node.Mark().line;
 
-  if (auto protocol_sequence_node{node[YAML_SSN_PROTOCOL_KEY]}; protocol_sequence_node) {
+  if (auto const *protocol_sequence_node = keys.find(YamlKey::PROTOCOL); protocol_sequence_node) {
     auto const tls_node =
-        parse_for_protocol_node(protocol_sequence_node, YAML_SSN_PROTOCOL_TLS_NAME);
+        parse_for_protocol_node(*protocol_sequence_node, YAML_SSN_PROTOCOL_TLS_NAME);
     if (!tls_node.is_ok()) {
       errata.note(std::move(tls_node.errata()));
       return errata;
@@ -264,7 +285,7 @@ ClientReplayFileHandler::ssn_open(YAML::Node const &node)
     }
 
     auto const http_node =
-        parse_for_protocol_node(protocol_sequence_node, YAML_SSN_PROTOCOL_HTTP_NAME);
+        parse_for_protocol_node(*protocol_sequence_node, YAML_SSN_PROTOCOL_HTTP_NAME);
     if (!http_node.is_ok()) {
       errata.note(std::move(http_node.errata()));
       return errata;
@@ -278,8 +299,8 @@ ClientReplayFileHandler::ssn_open(YAML::Node const &node)
     }
   }
 
-  if (node[YAML_TIME_START_KEY]) {
-    auto &&[start_time, start_time_errata] = get_start_time(node);
+  if (auto const *start_node = keys.find(YamlKey::CONNECTION_TIME); start_node) {
+    auto &&[start_time, start_time_errata] = get_start_time(*start_node);
     if (!start_time_errata.is_ok()) {
       errata.note(std::move(start_time_errata));
       errata.note(
@@ -293,7 +314,7 @@ ClientReplayFileHandler::ssn_open(YAML::Node const &node)
     _ssn->_start = start_time;
   }
 
-  if (node[YAML_TIME_DELAY_KEY]) {
+  if (keys.find(YamlKey::DELAY)) {
     auto &&[delay_time, delay_errata] = get_delay_time(node);
     if (!delay_errata.is_ok()) {
       errata.note(std::move(delay_errata));
@@ -311,13 +332,13 @@ ClientReplayFileHandler::ssn_open(YAML::Node const &node)
 }
 
 Errata
-ClientReplayFileHandler::txn_open(YAML::Node const &node)
+ClientReplayFileHandler::txn_open(YAML::Node const &node, YamlKeyMap const &keys)
 {
   Errata errata;
   _txn_node = &node;
   _txn._req.set_is_request();
   _txn._rsp.set_is_response();
-  if (!node[YAML_CLIENT_REQ_KEY]) {
+  if (!keys.find(YamlKey::CLIENT_REQUEST)) {
     errata.note(
         S_ERROR,
         R"(Transaction node at "{}":{} does not have a client request [{}].)",
@@ -328,8 +349,8 @@ ClientReplayFileHandler::txn_open(YAML::Node const &node)
   if (!errata.is_ok()) {
     return errata;
   }
-  if (node[YAML_TIME_START_KEY]) {
-    auto &&[transaction_start_time, start_time_errata] = get_start_time(node);
+  if (auto const *start_node = keys.find(YamlKey::CONNECTION_TIME); start_node) {
+    auto &&[transaction_start_time, start_time_errata] = get_start_time(*start_node);
     if (!start_time_errata.is_ok()) {
       errata.note(std::move(start_time_errata));
       errata.note(
@@ -350,11 +371,23 @@ ClientReplayFileHandler::txn_open(YAML::Node const &node)
     }
     _txn._start = transaction_start_time - _ssn->_start;
   }
-
-  LoadMutex.lock();
   return errata;
 }
 
+bool
+ClientReplayFileHandler::skip_transaction(YAML::Node const &node)
+{
+  if (Keys_Whitelist.empty()) {
+    return false;
+  }
+  // Skip unwanted transactions before their messages are parsed. A
+  // transaction without a key is loaded so that txn_close reports it.
+  auto const key = YamlParser::derive_transaction_key(
+      node,
+      Use_Proxy_Request_Directives ? YAML_PROXY_REQ_KEY : YAML_CLIENT_REQ_KEY);
+  return key != HttpHeader::TRANSACTION_KEY_NOT_SET && Keys_Whitelist.count(key) == 0;
+}
+
 Errata
 ClientReplayFileHandler::client_request(YAML::Node const &node)
 {
@@ -440,7 +473,7 @@ ClientReplayFileHandler::proxy_response(YAML::Node const &node)
     } else if (_ssn->is_h3) {
       _txn._rsp.set_is_http3();
     }
-    _txn._rsp._fields_rules = std::make_shared<HttpFields>(*global_config.txn_rules);
+    _txn._rsp._fields_rules->add_shared_rules(global_config.txn_rules);
     return YamlParser::populate_http_message(node, _txn._rsp);
   }
   return {};
@@ -458,7 +491,7 @@ ClientReplayFileHandler::server_response(YAML::Node const &node)
     } else if (_ssn->is_h3) {
       _txn._rsp.set_is_http3();
     }
-    _txn._rsp._fields_rules = std::make_shared<HttpFields>(*global_config.txn_rules);
+    _txn._rsp._fields_rules->add_shared_rules(global_config.txn_rules);
     errata.note(YamlParser::populate_http_message(node, _txn._rsp));
     if (_txn._rsp._status == 0) {
       errata.note(
@@ -472,10 +505,12 @@ ClientReplayFileHandler::server_response(YAML::Node const &node)
 }
 
 Errata
-ClientReplayFileHandler::apply_to_all_messages(HttpFields const &all_headers)
+ClientReplayFileHandler::apply_to_all_messages(
+    std::shared_ptr<HttpFields const> const &all_headers)
 {
-  _txn._req.merge(all_headers);
-  _txn._rsp.merge(all_headers);
+  _txn._req.merge_fields(*all_headers);
+  _txn._rsp.merge_fields(*all_headers);
+  _txn._rsp._fields_rules->add_shared_rules(all_headers);
   return {};
 }
 
@@ -498,37 +533,246 @@ ClientReplayFileHandler::txn_close()
     // purposes, make sure _txn._rsp is aware of the key.
     _txn._rsp.set_key(key);
     if (Keys_Whitelist.empty() || Keys_Whitelist.count(key) > 0) {
+      _txn.compact();
       _ssn->_transactions.emplace_back(std::move(_txn));
     }
   }
   this->txn_reset();
-  LoadMutex.unlock();
   return errata;
 }
 
+/** Split a session into one session per key partition of its targets.
+ *
+ * Each transaction of ssn is moved, in order, into the session for the
+ * partition owning its key so that it is sent to the verifier-server
+ * instance which loaded it. The targets for the session's protocol are the
+ * partitions: the i'th target is expected to serve partition i of n.
+ *
+ * @param[in,out] ssn The session to split. Its transactions are moved out.
+ *
+ * @return The sessions, one per partition with transactions.
+ */
+static std::vector<std::shared_ptr<Ssn>>
+split_session_by_key_partition(Ssn &ssn)
+{
+  size_t num_partitions = Target_Selector.http_targets.size();
+  if (ssn.is_h3) {
+    num_partitions = Target_Selector.http3_targets.size();
+  } else if (ssn.is_h2 || ssn.is_tls) {
+    num_partitions = Target_Selector.https_targets.size();
+  }
+  num_partitions = std::max<size_t>(num_partitions, 1);
+  std::vector<std::shared_ptr<Ssn>> partition_sessions(num_partitions);
+  for (auto &txn : ssn._transactions) {
+    auto const partition = KeyPartition::get_partition(txn._req.get_key(), num_partitions);
+    auto &partition_ssn = partition_sessions[partition];
+    if (partition_ssn == nullptr) {
+      partition_ssn = std::make_shared<Ssn>();
+      partition_ssn->_path = ssn._path;
+      partition_ssn->_line_no = ssn._line_no;
+      partition_ssn->_start = ssn._start;
+      partition_ssn->_user_specified_delay_duration = ssn._user_specified_delay_duration;
+      partition_ssn->_rate_multiplier = ssn._rate_multiplier;
+      partition_ssn->_client_sni = ssn._client_sni;
+      partition_ssn->_client_verify_mode = ssn._client_verify_mode;
+      partition_ssn->is_tls = ssn.is_tls;
+      partition_ssn->is_h2 = ssn.is_h2;
+      partition_ssn->is_h3 = ssn.is_h3;
+      partition_ssn->_key_partition = static_cast<int>(partition);
+    }
+    partition_ssn->_transactions.emplace_back(std::move(txn));
+  }
+  ssn._transactions.clear();
+  partition_sessions.erase(
+      std::remove(partition_sessions.begin(), partition_sessions.end(), nullptr),
+      partition_sessions.end());
+  for (auto const &partition_ssn : partition_sessions) {
+    partition_ssn->_transactions.shrink_to_fit();
+  }
+  return partition_sessions;
+}
+
 Errata
 ClientReplayFileHandler::ssn_close()
 {
   Errata errata;
-  {
-    std::lock_guard<std::mutex> lock(LoadMutex);
-    if (!_ssn->_transactions.empty()) {
-      auto const &e = _ssn->post_process_transactions();
-      if (!e.is_ok()) {
-        errata.note(e);
-        errata.note(
-            S_ERROR,
-            R"("{}":{} Could not process transactions in session.)",
-            _path,
-            _ssn->_line_no);
+  if (!_ssn->_transactions.empty()) {
+    auto const &e = _ssn->post_process_transactions();
+    if (!e.is_ok()) {
+      errata.note(e);
+      errata.note(
+          S_ERROR,
+          R"("{}":{} Could not process transactions in session.)",
+          _path,
+          _ssn->_line_no);
+    }
+    if (Use_Key_Hash_Targets) {
+      for (auto &partition_ssn : split_session_by_key_partition(*_ssn)) {
+        _sessions.push_back(std::move(partition_ssn));
       }
-      Session_List.push_back(_ssn);
+    } else {
+      _sessions.push_back(_ssn);
     }
   }
   this->ssn_reset();
   return errata;
 }
 
+/** A bounded look-ahead window of parsed sessions between the thread streaming
+ * them from the replay files and the dispatcher. See --stream.
+ *
+ * The window holds at most its capacity of sessions, which bounds the memory
+ * of a streaming replay. Sessions are taken in start time order once the
+ * window is full, so a session recorded fewer than capacity sessions out of
+ * order in the replay files is still dispatched in order. Sessions with the
+ * same start time are taken in the order they were added.
+ */
+class SessionWindow
+{
+public:
+  /// @param[in] capacity The maximum number of sessions to hold.
+  explicit SessionWindow(size_t capacity) : _capacity{capacity} {}
+
+  /// Add a parsed session, waiting while the window is full.
+  void push(std::shared_ptr<Ssn> ssn);
+
+  /// Indicate that no more sessions will be added.
+  void close();
+
+  /** Take the earliest session, waiting until the window is full or closed.
+   *
+   * @return The session, or nullptr once the window is closed and empty.
+   */
+  std::shared_ptr<Ssn> pop();
+
+private:
+  struct Entry
+  {
+    std::shared_ptr<Ssn> ssn;
+    /// The order in which the session was added, which breaks start time ties.
+    uint64_t sequence = 0;
+  };
+
+  /// The heap order of _entries, which puts the earliest entry first.
+  static bool
+  is_later(Entry const &lhs, Entry const &rhs)
+  {
+    if (lhs.ssn->_start != rhs.ssn->_start) {
+      return lhs.ssn->_start > rhs.ssn->_start;
+    }
+    return lhs.sequence > rhs.sequence;
+  }
+
+  size_t const _capacity;
+  std::mutex _mutex;
+  /// Signaled when a session is taken from a full window.
+  std::condition_variable _not_full;
+  /// Signaled when the window fills or is closed.
+  std::condition_variable _ready;
+  std::vector<Entry> _entries;
+  uint64_t _next_sequence = 0;
+  bool _is_closed = false;
+};
+
+void
+SessionWindow::push(std::shared_ptr<Ssn> ssn)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _not_full.wait(lock, [this]() { return _entries.size() < _capacity; });
+  _entries.push_back(Entry{std::move(ssn), _next_sequence++});
+  std::push_heap(_entries.begin(), _entries.end(), &SessionWindow::is_later);
+  if (_entries.size() == _capacity) {
+    _ready.notify_one();
+  }
+}
+
+void
+SessionWindow::close()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _is_closed = true;
+  _ready.notify_one();
+}
+
+std::shared_ptr<Ssn>
+SessionWindow::pop()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _ready.wait(lock, [this]() { return _is_closed || _entries.size() >= _capacity; });
+  if (_entries.empty()) {
+    return nullptr;
+  }
+  std::pop_heap(_entries.begin(), _entries.end(), &SessionWindow::is_later);
+  auto ssn = std::move(_entries.back().ssn);
+  _entries.pop_back();
+  _not_full.notify_one();
+  return ssn;
+}
+
+/** A replay file handler that adds each session to a SessionWindow as soon as
+ * it is parsed, so a streamed file's sessions are not all held at once.
+ */
+class StreamingReplayFileHandler : public ClientReplayFileHandler
+{
+public:
+  /**
+   * @param[in] sessions The list in which the base handler puts each parsed
+   * session before it is moved to the window.
+   * @param[in] window The window to which to add the parsed sessions.
+   * @param[in] arena The arena holding the file's localized strings.
+   * @param[in,out] max_content_length The largest request body seen so far.
+   */
+  StreamingReplayFileHandler(
+      std::list<std::shared_ptr<Ssn>> &sessions,
+      SessionWindow &window,
+      std::shared_ptr<swoc::MemArena> arena,
+      size_t &max_content_length);
+
+  Errata ssn_close() override;
+
+private:
+  std::list<std::shared_ptr<Ssn>> &_parsed_sessions;
+  SessionWindow &_window;
+  std::shared_ptr<swoc::MemArena> _arena;
+  size_t &_max_content_length;
+};
+
+StreamingReplayFileHandler::StreamingReplayFileHandler(
+    std::list<std::shared_ptr<Ssn>> &sessions,
+    SessionWindow &window,
+    std::shared_ptr<swoc::MemArena> arena,
+    size_t &max_content_length)
+  : ClientReplayFileHandler{sessions}
+  , _parsed_sessions{sessions}
+  , _window{window}
+  , _arena{std::move(arena)}
+  , _max_content_length{max_content_length}
+{
+}
+
+Errata
+StreamingReplayFileHandler::ssn_close()
+{
+  Errata errata = ClientReplayFileHandler::ssn_close();
+  if (!errata.is_ok()) {
+    _parsed_sessions.clear();
+    return errata;
+  }
+  // The session may have been split by key partition into several.
+  for (auto &ssn : _parsed_sessions) {
+    ssn->_localized_arena = _arena;
+    for (auto const &txn : ssn->_transactions) {
+      if (txn._req._content_size > _max_content_length) {
+        _max_content_length = txn._req._content_size;
+        HttpHeader::set_max_content_length(_max_content_length);
+      }
+    }
+    _window.push(std::move(ssn));
+  }
+  _parsed_sessions.clear();
+  return errata;
+}
+
 /** Command execution.
  *
  * This handles parsing and acting on the command line arguments.
@@ -540,6 +784,8 @@ public:
   ts::Arguments arguments; ///< Results from argument parsing.
 
   void command_run();
+  void command_handshake_benchmark();
+  void command_compile();
 
   /// The process return code with which to exit.
   static int process_exit_code;
@@ -551,15 +797,45 @@ private:
   /// Parse the YAML replay files.
   bool parse_replay_files();
 
+  /** Look up the replay files of the --keys transactions in the --key-index
+   * file.
+   *
+   * @return The replay files containing the indexed keys, each listed once.
+   */
+  swoc::Rv<std::vector<swoc::file::path>> get_key_index_files();
+
   /// Initialize the client, such as the various HTTP sessions.
   bool initialize_client();
 
   /// Replay the traffic specified in the replay files.
   bool replay_traffic();
 
+  /** Replay the traffic while streaming the replay files, rather than after
+   * loading them. See --stream.
+   *
+   * @param[in] sleep_limit The longest to sleep before sending a session.
+   */
+  bool stream_traffic(microseconds sleep_limit);
+
+  /** Parse the replay files in order, adding their sessions to a window.
+   *
+   * @param[in] path The replay file, directory, or compiled corpus.
+   * @param[in] window The window to add the sessions to. It is closed once
+   * the files are parsed or one fails to parse.
+   *
+   * @return Any errors parsing the replay files.
+   */
+  Errata stream_replay_files(swoc::file::path const &path, SessionWindow &window);
+
   /// Do any client cleanup after the traffic is replayed.
   bool cleanup_client();
 
+  /// Parse the command line arguments of the handshake-benchmark command.
+  bool parse_handshake_benchmark_args();
+
+  /// Perform and report the handshakes for each benchmarked protocol.
+  bool run_handshake_benchmark();
+
 private:
   /// The location (file or directory) of the traffic to replay.
   std::string _replay_location;
@@ -572,12 +848,35 @@ private:
 
   /// The maximum Content-Length value after parse_replay_files() is called.
   size_t _max_content_length = 0;
+
+  /// The number of sessions in the --stream look-ahead window, or zero if the
+  /// replay files are loaded before the traffic is replayed.
+  size_t _stream_window_size = 0;
+
+  /// The --key-index file from which to find the replay files of the --keys
+  /// transactions, if any.
+  std::string _key_index_path;
+
+  /// The protocols ("tls", "h2", or "h3") whose handshakes are benchmarked.
+  std::vector<std::string> _benchmark_protocols;
+
+  /// The number of handshakes to perform per benchmarked protocol.
+  size_t _benchmark_handshake_count = 1000;
+
+  /// The number of handshakes to have in flight at a time.
+  size_t _benchmark_concurrency = 1;
+
+  /// The target handshakes per second. Zero means as fast as possible.
+  double _benchmark_rate = 0.0;
+
+  /// Whether handshakes should resume the session of a previous handshake.
+  bool _benchmark_resumption = false;
 };
 
 int Engine::process_exit_code = 0;
 
 void
-Run_Session(Ssn const &ssn, TargetSelector &target_selector)
+Run_Session(Ssn const &ssn, TargetSelector &target_selector, SessionPool &session_pool)
 {
   std::unique_ptr<Session> session;
   swoc::IPEndpoint const *real_target = nullptr;
@@ -590,7 +889,7 @@ Run_Session(Ssn const &ssn, TargetSelector &target_selector)
       ssn.is_h3 ? "h3" : (ssn.is_h2 ? "h2" : (ssn.is_tls ? "https" : "http")));
 
   if (ssn.is_h3) {
-    real_target = target_selector.get_http3_target();
+    real_target = target_selector.get_http3_target(ssn._key_partition);
     if (real_target == nullptr) {
       errata.note(
           S_ERROR,
@@ -600,31 +899,35 @@ Run_Session(Ssn const &ssn, TargetSelector &target_selector)
       errata.note(S_DIAG, "Connecting via HTTP/3 over QUIC.");
     }
   } else if (ssn.is_h2) {
-    real_target = target_selector.get_https_target();
+    real_target = target_selector.get_https_target(ssn._key_partition);
     if (real_target == nullptr) {
       errata.note(
           S_ERROR,
           "Could not replay an HTTP/2 session because no HTTPS ports are provided.");
     } else {
-      session = std::make_unique<H2Session>(ssn._client_sni, ssn._client_verify_mode);
+      auto h2_session = session_pool.acquire<H2Session>();
+      h2_session->set_client_tls_options(ssn._client_sni, ssn._client_verify_mode);
+      session = std::move(h2_session);
       errata.note(S_DIAG, "Connecting via HTTP/2 over TLS.");
     }
   } else if (ssn.is_tls) {
-    real_target = target_selector.get_https_target();
+    real_target = target_selector.get_https_target(ssn._key_partition);
     if (real_target == nullptr) {
       errata.note(
           S_ERROR,
           "Could not replay an HTTPS session because no HTTPS ports are provided.");
     } else {
-      session = std::make_unique<TLSSession>(ssn._client_sni, ssn._client_verify_mode);
+      auto tls_session = session_pool.acquire<TLSSession>();
+      tls_session->set_client_tls_options(ssn._client_sni, ssn._client_verify_mode);
+      session = std::move(tls_session);
       errata.note(S_DIAG, "Connecting via TLS.");
     }
   } else {
-    real_target = target_selector.get_http_target();
+    real_target = target_selector.get_http_target(ssn._key_partition);
     if (real_target == nullptr) {
       errata.note(S_ERROR, "Could not replay an HTTP session because no HTTP ports are provided.");
     } else {
-      session = std::make_unique<Session>();
+      session = session_pool.acquire<Session>();
       errata.note(S_DIAG, "Connecting via HTTP.");
     }
   }
@@ -637,6 +940,7 @@ Run_Session(Ssn const &ssn, TargetSelector &target_selector)
   errata.note(session->do_connect(specified_interface, real_target));
   if (!errata.is_ok()) {
     Engine::process_exit_code = 1;
+    session_pool.release(std::move(session));
     return;
   }
   errata.sink();
@@ -648,6 +952,7 @@ Run_Session(Ssn const &ssn, TargetSelector &target_selector)
   if (!errata.is_ok()) {
     Engine::process_exit_code = 1;
   }
+  session_pool.release(std::move(session));
   return;
 }
 
@@ -662,11 +967,178 @@ TF_Client(std::thread *t)
     Client_Thread_Pool.wait_for_work(&thread_info);
 
     if (thread_info._ssn != nullptr) {
-      Run_Session(*thread_info._ssn, Target_Selector);
+      Run_Session(*thread_info._ssn, Target_Selector, thread_info._session_pool);
     }
   }
 }
 
+/** The shared pacing state of the threads benchmarking a protocol. */
+struct HandshakeBenchmarkSchedule
+{
+  /// The index of the next handshake to perform.
+  std::atomic<size_t> next_index{0};
+  /// The total number of handshakes to perform.
+  size_t handshake_count = 0;
+  /// The time between handshake starts. Zero means as fast as possible.
+  nanoseconds interval = 0ns;
+  /// The time at which the first handshake is scheduled.
+  TimePoint start_time;
+};
+
+/** The measurements of one benchmark thread. */
+struct HandshakeBenchmarkResult
+{
+  /// The connect and handshake latency of each successful handshake.
+  std::vector<nanoseconds> latencies;
+  /// The number of handshakes that failed.
+  size_t num_failed = 0;
+  /// The number of handshakes that resumed a previous session.
+  size_t num_resumed = 0;
+};
+
+/// How long to wait for a TLS 1.3 session ticket after a handshake.
+constexpr auto Session_Ticket_Timeout = 100ms;
+
+/** Repeatedly connect and handshake until the schedule is exhausted.
+ *
+ * Only the TCP or UDP connect and the TLS or QUIC handshake are timed: the
+ * session is closed without sending any requests.
+ */
+void
+TF_Handshake_Benchmark(
+    TextView protocol,
+    std::deque<swoc::IPEndpoint> const &targets,
+    bool use_resumption,
+    HandshakeBenchmarkSchedule &schedule,
+    HandshakeBenchmarkResult &result)
+{
+  SSL_SESSION *resumable_session = nullptr;
+  while (true) {
+    size_t const index = schedule.next_index++;
+    if (index >= schedule.handshake_count) {
+      break;
+    }
+    if (schedule.interval > 0ns) {
+      auto const scheduled_time =
+          schedule.start_time + static_cast<int64_t>(index) * schedule.interval;
+      auto const now = ClockType::now();
+      if (scheduled_time > now) {
+        sleep_for(scheduled_time - now);
+      }
+    }
+    swoc::IPEndpoint const *target = &targets[index % targets.size()];
+
+    std::unique_ptr<Session> session;
+    TLSSession *tls_session = nullptr;
+    H3Session *h3_session = nullptr;
+    if (protocol == "h3") {
+      auto session_h3 = std::make_unique<H3Session>();
+      session_h3->set_session_to_resume(resumable_session);
+      h3_session = session_h3.get();
+      session = std::move(session_h3);
+    } else {
+      std::unique_ptr<TLSSession> session_tls;
+      if (protocol == "h2") {
+        session_tls = std::make_unique<H2Session>();
+      } else {
+        session_tls = std::make_unique<TLSSession>();
+      }
+      session_tls->set_session_to_resume(resumable_session);
+      tls_session = session_tls.get();
+      session = std::move(session_tls);
+    }
+
+    auto const handshake_start = ClockType::now();
+    Errata errata = session->do_connect(specified_interface, target);
+    auto const latency = duration_cast<nanoseconds>(ClockType::now() - handshake_start);
+    if (!errata.is_ok()) {
+      ++result.num_failed;
+      continue;
+    }
+    result.latencies.push_back(latency);
+    bool const is_resumed =
+        tls_session != nullptr ? tls_session->is_session_reused() : h3_session->is_session_reused();
+    if (is_resumed) {
+      ++result.num_resumed;
+    }
+    if (!use_resumption || (is_resumed && resumable_session != nullptr)) {
+      continue;
+    }
+    // Either no session has been received yet or the server declined to
+    // resume the last one: take the session from this handshake.
+    SSL_SESSION *new_session = nullptr;
+    if (tls_session != nullptr) {
+      auto &&[session_from_ticket, ticket_errata] =
+          tls_session->get1_resumable_session(Session_Ticket_Timeout);
+      new_session = session_from_ticket;
+    } else {
+      new_session = h3_session->get1_resumable_session();
+    }
+    if (new_session != nullptr) {
+      SSL_SESSION_free(resumable_session);
+      resumable_session = new_session;
+    }
+  }
+  SSL_SESSION_free(resumable_session);
+}
+
+/** Report the handshake rate and latency percentiles for a protocol.
+ *
+ * @param[in] protocol The benchmarked protocol.
+ * @param[in] results The measurements of each benchmark thread.
+ * @param[in] duration The wall clock time taken by all the handshakes.
+ *
+ * @return An errata with an informational note describing the results.
+ */
+Errata
+report_handshake_benchmark(
+    TextView protocol,
+    std::vector<HandshakeBenchmarkResult> const &results,
+    nanoseconds duration)
+{
+  Errata errata;
+  std::vector<nanoseconds> latencies;
+  size_t num_failed = 0;
+  size_t num_resumed = 0;
+  for (auto const &result : results) {
+    latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+    num_failed += result.num_failed;
+    num_resumed += result.num_resumed;
+  }
+  if (latencies.empty()) {
+    errata.note(S_ERROR, "{} handshake benchmark: all {} handshakes failed.", protocol, num_failed);
+    return errata;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  // Nearest-rank percentile, in microseconds.
+  auto const percentile = [&latencies](double p) -> double {
+    auto rank = static_cast<size_t>(p * latencies.size() + 0.5);
+    rank = std::clamp<size_t>(rank, 1, latencies.size());
+    return latencies[rank - 1].count() / 1000.0;
+  };
+  auto const num_succeeded = latencies.size();
+  auto const seconds = duration.count() / 1'000'000'000.0;
+  errata.note(
+      S_INFO,
+      "{} handshake benchmark: {} handshake{} ({} resumed, {} failed) in {} ms: {:.1f} "
+      "handshakes/s. Latency (us): p50 {:.1f}, p90 {:.1f}, p99 {:.1f}, max {:.1f}.",
+      protocol,
+      num_succeeded,
+      swoc::bwf::If(num_succeeded != 1, "s"),
+      num_resumed,
+      num_failed,
+      duration_cast<milliseconds>(duration).count(),
+      seconds > 0 ? num_succeeded / seconds : 0.0,
+      percentile(0.50),
+      percentile(0.90),
+      percentile(0.99),
+      latencies.back().count() / 1000.0);
+  if (num_failed > 0) {
+    Engine::process_exit_code = 1;
+  }
+  return errata;
+}
+
 bool
 Engine::parse_args()
 {
@@ -690,6 +1162,10 @@ Engine::parse_args()
     Use_Strict_Checking = true;
   }
 
+  if (arguments.get("key-hash-targets")) {
+    Use_Key_Hash_Targets = true;
+  }
+
   auto server_addr_http_arg{arguments.get("connect-http")};
   auto server_addr_https_arg{arguments.get("connect-https")};
   auto server_addr_http3_arg{arguments.get("connect-http3")};
@@ -727,7 +1203,7 @@ Engine::parse_args()
 
   auto key_format_arg{arguments.get("format")};
   if (key_format_arg) {
-    HttpHeader::_key_format = key_format_arg[0];
+    HttpHeader::set_key_format(key_format_arg[0]);
   }
 
   auto cert_arg{arguments.get("client-cert")};
@@ -757,6 +1233,40 @@ Engine::parse_args()
     }
   }
 
+  auto key_index_arg{arguments.get("key-index")};
+  if (key_index_arg) {
+    if (Keys_Whitelist.empty()) {
+      errata.note(S_ERROR, R"("--key-index" requires "--keys".)");
+      process_exit_code = 1;
+      return false;
+    }
+    if (arguments.get("stream")) {
+      errata.note(S_ERROR, R"("--key-index" cannot be used with "--stream".)");
+      process_exit_code = 1;
+      return false;
+    }
+    _key_index_path = key_index_arg[0];
+  }
+
+  auto parse_cache_arg{arguments.get("parse-cache")};
+  if (parse_cache_arg) {
+    errata.note(YamlParser::set_parse_cache_dir(swoc::file::path{parse_cache_arg[0]}));
+    if (!errata.is_ok()) {
+      process_exit_code = 1;
+      return false;
+    }
+  }
+
+  auto stream_arg{arguments.get("stream")};
+  if (stream_arg) {
+    _stream_window_size = swoc::svtou(stream_arg[0]);
+    if (_stream_window_size == 0) {
+      errata.note(S_ERROR, R"("--stream" requires a positive number of sessions.)");
+      process_exit_code = 1;
+      return false;
+    }
+  }
+
   auto interface_arg{arguments.get("interface")};
   if (interface_arg.size() > 1) {
     errata.note(S_ERROR, R"("interface" command requires exactly one device name as an argument.)");
@@ -782,17 +1292,34 @@ Engine::parse_replay_files()
   Errata errata;
   // Phase 2: Parse the YAML replay files.
   errata.note(S_INFO, R"(Loading replay data from "{}".)", _replay_location);
-  errata.note(YamlParser::load_replay_files(
-      swoc::file::path{_replay_location},
-      [](swoc::file::path const &file) -> Errata {
-        ClientReplayFileHandler handler;
-        return YamlParser::load_replay_file(file, handler);
-      },
-      10));
+  // Each loader thread collects its sessions in a list of its own, so parsing
+  // needs no lock. The lists are spliced together once all files are parsed.
+  auto const n_threads = YamlParser::get_default_thread_count();
+  std::vector<std::list<std::shared_ptr<Ssn>>> thread_sessions(n_threads);
+  auto const loader = [&thread_sessions](swoc::file::path const &file) -> Errata {
+    ClientReplayFileHandler handler{thread_sessions[YamlParser::get_loader_thread_index()]};
+    return YamlParser::load_replay_file(file, handler);
+  };
+  if (_key_index_path.empty()) {
+    errata.note(YamlParser::load_replay_files(
+        swoc::file::path{_replay_location},
+        loader,
+        n_threads,
+        YamlParser::SPLIT_FILES));
+  } else {
+    auto &&[files, files_errata] = get_key_index_files();
+    errata.note(std::move(files_errata));
+    if (errata.is_ok()) {
+      errata.note(YamlParser::load_replay_files(files, loader, n_threads));
+    }
+  }
   if (!errata.is_ok()) {
     process_exit_code = 1;
     return false;
   }
+  for (auto &sessions : thread_sessions) {
+    Session_List.splice(Session_List.end(), sessions);
+  }
   _session_count = Session_List.size();
   for (auto ssn : Session_List) {
     _transaction_count += ssn->_transactions.size();
@@ -807,11 +1334,66 @@ Engine::parse_replay_files()
       swoc::bwf::If(_transaction_count != 1, "s"),
       _session_count,
       swoc::bwf::If(_session_count != 1, "s"));
+  errata.note(Txn::report_memory_statistics());
   HttpHeader::set_max_content_length(_max_content_length);
 
   return true;
 }
 
+swoc::Rv<std::vector<swoc::file::path>>
+Engine::get_key_index_files()
+{
+  swoc::Rv<std::vector<swoc::file::path>> zret;
+  swoc::file::path const index_path{_key_index_path};
+  auto &&[index, index_errata] = KeyIndexFile::open(index_path);
+  zret.note(std::move(index_errata));
+  if (!zret.is_ok()) {
+    return zret;
+  }
+  if (index->get_key_format() != HttpHeader::_key_format) {
+    zret.note(
+        S_ERROR,
+        R"(The key index "{}" was built with key format "{}" rather than "{}".)",
+        index_path,
+        index->get_key_format(),
+        HttpHeader::_key_format);
+    return zret;
+  }
+  swoc::file::path const replay_path{_replay_location};
+  std::error_code ec;
+  bool const replay_path_is_file = swoc::file::is_regular_file(swoc::file::status(replay_path, ec));
+  std::vector<uint32_t> file_ids;
+  for (auto const &key : Keys_Whitelist) {
+    auto const file_id = index->find(key);
+    if (file_id == KeyIndexFile::NO_FILE) {
+      zret.note(S_INFO, R"(Key "{}" is not in the key index "{}".)", key, index_path);
+    } else {
+      file_ids.push_back(file_id);
+    }
+  }
+  // Load the files in index order, each once however many keys it holds.
+  std::sort(file_ids.begin(), file_ids.end());
+  file_ids.erase(std::unique(file_ids.begin(), file_ids.end()), file_ids.end());
+  auto &files = zret.result();
+  files.reserve(file_ids.size());
+  for (auto const file_id : file_ids) {
+    // The index records files relative to the indexed directory, or the
+    // indexed file itself.
+    files.push_back(
+        replay_path_is_file ? replay_path
+                            : replay_path / swoc::file::path{index->get_file_path(file_id)});
+  }
+  zret.note(
+      S_INFO,
+      R"(Loading {} replay file{} for {} key{} from the key index "{}".)",
+      files.size(),
+      swoc::bwf::If(files.size() != 1, "s"),
+      Keys_Whitelist.size(),
+      swoc::bwf::If(Keys_Whitelist.size() != 1, "s"),
+      index_path);
+  return zret;
+}
+
 bool
 Engine::initialize_client()
 {
@@ -822,7 +1404,12 @@ Engine::initialize_client()
     return ssn1->_start < ssn2->_start;
   });
 
-  errata.note(Session::init(_transaction_count));
+  // The transaction count of a streamed corpus is not known in advance. The
+  // window bounds how many of its sessions are held at once, so judge by that
+  // whether failing to raise the file limit matters.
+  auto const load_size = _stream_window_size > 0 ? _stream_window_size : _transaction_count;
+  errata.note(Session::init(
+      static_cast<int>(std::min<size_t>(load_size, std::numeric_limits<int>::max()))));
   if (!errata.is_ok()) {
     process_exit_code = 1;
     return false;
@@ -834,6 +1421,7 @@ Engine::initialize_client()
   if (tls_secrets_log_file_arg) {
     tls_secrets_log_file = tls_secrets_log_file_arg[0];
   }
+  errata.note(TLSSession::configure_ktls(arguments.get("ktls")));
   errata.note(TLSSession::init(tls_secrets_log_file));
   if (!errata.is_ok()) {
     process_exit_code = 1;
@@ -866,6 +1454,56 @@ Engine::initialize_client()
   return true;
 }
 
+/** Hand a session to a worker thread to replay.
+ *
+ * @param[in] ssn The session, which the worker holds until it is replayed.
+ * @param[out] errata Notes whether a worker could be found.
+ */
+static void
+Dispatch_Session(std::shared_ptr<Ssn> ssn, Errata &errata)
+{
+  ClientThreadInfo *thread_info = dynamic_cast<ClientThreadInfo *>(Client_Thread_Pool.get_worker());
+  if (nullptr == thread_info) {
+    errata.note(S_ERROR, "Failed to get worker thread");
+  } else {
+    // Only pointer to worker thread info.
+    {
+      std::unique_lock<std::mutex> lock(thread_info->_mutex);
+      thread_info->_ssn = std::move(ssn);
+      thread_info->_cvar.notify_one();
+    }
+  }
+}
+
+/** Wait for the worker threads to finish and report the replayed traffic.
+ *
+ * @param[out] errata Notes the replay summary.
+ * @param[in] n_txn The number of transactions dispatched.
+ * @param[in] n_ssn The number of sessions dispatched.
+ * @param[in] replay_start_time When the first session was dispatched.
+ */
+static void
+Finish_Replay(Errata &errata, unsigned n_txn, unsigned n_ssn, TimePoint replay_start_time)
+{
+  // Wait until all threads are done
+  Shutdown_Flag = true;
+  Client_Thread_Pool.join_threads();
+
+  auto replay_duration = duration_cast<milliseconds>(ClockType::now() - replay_start_time);
+  errata.note(
+      S_INFO,
+      "{} transaction{} in {} session{} (reuse {:.2f}) in {} millisecond{} ({:.3f} / "
+      "millisecond).",
+      n_txn,
+      swoc::bwf::If(n_txn != 1, "s"),
+      n_ssn,
+      swoc::bwf::If(n_ssn != 1, "s"),
+      n_txn / static_cast<double>(n_ssn),
+      replay_duration.count(),
+      swoc::bwf::If(replay_duration.count() != 1, "s"),
+      n_txn / static_cast<double>(replay_duration.count()));
+}
+
 bool
 Engine::replay_traffic()
 {
@@ -883,6 +1521,10 @@ Engine::replay_traffic()
     Client_Thread_Pool.set_max_threads(thread_limit_int);
   }
 
+  if (_stream_window_size > 0) {
+    return stream_traffic(sleep_limit);
+  }
+
   // A value of zero means to run the transactions as fast as possible.
   double rate_multiplier = 0.0;
   auto rate_arg{arguments.get("rate")};
@@ -991,58 +1633,307 @@ Engine::replay_traffic()
           sleep_for(std::min(sleep_limit, duration_cast<microseconds>(nexttime - curtime)));
         }
       }
-      ClientThreadInfo *thread_info =
-          dynamic_cast<ClientThreadInfo *>(Client_Thread_Pool.get_worker());
-      if (nullptr == thread_info) {
-        errata.note(S_ERROR, "Failed to get worker thread");
-      } else {
-        // Only pointer to worker thread info.
-        {
-          std::unique_lock<std::mutex> lock(thread_info->_mutex);
-          thread_info->_ssn = ssn.get();
-          thread_info->_cvar.notify_one();
-        }
-      }
+      Dispatch_Session(ssn, errata);
       ++n_ssn;
       n_txn += ssn->_transactions.size();
     }
   }
-  // Wait until all threads are done
-  Shutdown_Flag = true;
-  Client_Thread_Pool.join_threads();
+  Finish_Replay(errata, n_txn, n_ssn, replay_start_time);
+  return true;
+}
 
-  auto replay_duration = duration_cast<milliseconds>(ClockType::now() - replay_start_time);
+bool
+Engine::stream_traffic(microseconds sleep_limit)
+{
+  Errata errata;
+
+  // Pacing by the recorded session times, as replay_traffic does, needs the
+  // recording's duration and transaction count before the first session is
+  // sent, which a streamed corpus does not provide. A target rate instead
+  // spaces the sessions by the transactions sent so far.
+  double target_rate = 0.0;
+  auto rate_arg{arguments.get("rate")};
+  if (rate_arg.size() == 1) {
+    target_rate = std::max(0.0, atof(rate_arg[0].c_str()));
+  }
+  int repeat_count = 1;
+  auto repeat_arg{arguments.get("repeat")};
+  if (repeat_arg.size() == 1) {
+    repeat_count = atoi(repeat_arg[0].c_str());
+  }
+
+  // The replay files are parsed again for each repetition.
+  swoc::file::path const replay_path{_replay_location};
   errata.note(
       S_INFO,
-      "{} transaction{} in {} session{} (reuse {:.2f}) in {} millisecond{} ({:.3f} / "
-      "millisecond).",
-      n_txn,
-      swoc::bwf::If(n_txn != 1, "s"),
-      n_ssn,
-      swoc::bwf::If(n_ssn != 1, "s"),
-      n_txn / static_cast<double>(n_ssn),
-      replay_duration.count(),
-      swoc::bwf::If(replay_duration.count() != 1, "s"),
-      n_txn / static_cast<double>(replay_duration.count()));
+      R"(Streaming replay data from "{}" through a window of {} session{}.)",
+      replay_path,
+      _stream_window_size,
+      swoc::bwf::If(_stream_window_size != 1, "s"));
+
+  auto replay_start_time = ClockType::now();
+  unsigned n_ssn = 0;
+  unsigned n_txn = 0;
+  unsigned n_late = 0;
+  for (int i = 0; i < repeat_count; i++) {
+    SessionWindow window{_stream_window_size};
+    Errata stream_errata;
+    std::thread stream_thread{[&]() -> void {
+      stream_errata.note(stream_replay_files(replay_path, window));
+    }};
+    auto const this_iteration_start_time = ClockType::now();
+    unsigned this_iteration_n_txn = 0;
+    TimePoint latest_start;
+    while (auto ssn = window.pop()) {
+      if (ssn->_start < latest_start) {
+        ++n_late;
+      } else {
+        latest_start = ssn->_start;
+      }
+      if (ssn->_user_specified_delay_duration > 0us) {
+        sleep_for(ssn->_user_specified_delay_duration);
+      } else if (target_rate > 0.0) {
+        auto const curtime = ClockType::now();
+        auto const nexttime = this_iteration_start_time +
+                              microseconds(static_cast<int64_t>(
+                                  this_iteration_n_txn * 1'000'000.0 / target_rate));
+        if (nexttime > curtime) {
+          sleep_for(std::min(sleep_limit, duration_cast<microseconds>(nexttime - curtime)));
+        }
+      }
+      ++n_ssn;
+      n_txn += ssn->_transactions.size();
+      this_iteration_n_txn += ssn->_transactions.size();
+      Dispatch_Session(std::move(ssn), errata);
+    }
+    stream_thread.join();
+    if (!stream_errata.is_ok()) {
+      process_exit_code = 1;
+      errata.note(std::move(stream_errata));
+      break;
+    }
+  }
+  if (n_late > 0) {
+    errata.note(
+        S_INFO,
+        "{} session{} started before a session already sent: a larger --stream window would "
+        "send them in time order.",
+        n_late,
+        swoc::bwf::If(n_late != 1, "s"));
+  }
+  Finish_Replay(errata, n_txn, n_ssn, replay_start_time);
   return true;
 }
 
+Errata
+Engine::stream_replay_files(swoc::file::path const &path, SessionWindow &window)
+{
+  Errata errata;
+  bool has_failed = false;
+  size_t max_content_length = 0;
+  // A single loader thread parses the files in order, so their sessions reach
+  // the window in the order the files were recorded.
+  errata.note(YamlParser::load_replay_files(
+      path,
+      [&](swoc::file::path const &file) -> Errata {
+        Errata file_errata;
+        if (has_failed) {
+          return file_errata;
+        }
+        // The file's strings are freed with the last of its sessions. Each
+        // session is added to the window as soon as it is parsed, but the
+        // file's node tree is held until the whole file is parsed.
+        auto arena = std::make_shared<swoc::MemArena>(8000);
+        std::list<std::shared_ptr<Ssn>> sessions;
+        {
+          Localizer::ScopedArena scoped_arena{*arena};
+          StreamingReplayFileHandler handler{sessions, window, arena, max_content_length};
+          file_errata.note(YamlParser::load_replay_file(file, handler));
+        }
+        if (!file_errata.is_ok()) {
+          has_failed = true;
+        }
+        return file_errata;
+      },
+      1));
+  window.close();
+  return errata;
+}
+
 bool
 Engine::cleanup_client()
 {
+  { // Scope the errata so the statistics are logged before terminating TLS.
+    Errata errata = TLSSession::report_ktls_statistics();
+    errata.note(SessionPool::report_allocation_statistics());
+    errata.note(TLSSession::report_ssl_allocation_statistics());
+  }
   TLSSession::terminate();
   H2Session::terminate();
   H3Session::terminate();
   return true;
 }
 
+bool
+Engine::parse_handshake_benchmark_args()
+{
+  Errata errata;
+
+  auto server_addr_https_arg{arguments.get("connect-https")};
+  auto server_addr_http3_arg{arguments.get("connect-http3")};
+  if (server_addr_https_arg) {
+    errata.note(resolve_ips(server_addr_https_arg[0], Target_Selector.https_targets));
+  }
+  if (server_addr_http3_arg) {
+    errata.note(resolve_ips(server_addr_http3_arg[0], Target_Selector.http3_targets));
+  }
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+    return false;
+  }
+
+  auto protocol_arg{arguments.get("protocol")};
+  if (protocol_arg) {
+    for (auto const &protocol : protocol_arg) {
+      _benchmark_protocols.emplace_back(protocol);
+    }
+  } else {
+    if (server_addr_https_arg) {
+      _benchmark_protocols.emplace_back("tls");
+    }
+    if (server_addr_http3_arg) {
+      _benchmark_protocols.emplace_back("h3");
+    }
+  }
+  if (_benchmark_protocols.empty()) {
+    errata.note(
+        S_ERROR,
+        R"(Must provide at least one of "--connect-https" or "--connect-http3" arguments.)");
+    process_exit_code = 1;
+    return false;
+  }
+  for (auto const &protocol : _benchmark_protocols) {
+    if (protocol != "tls" && protocol != "h2" && protocol != "h3") {
+      errata.note(S_ERROR, R"(Unrecognized protocol "{}": expected tls, h2, or h3.)", protocol);
+    } else if (protocol == "h3" && Target_Selector.http3_targets.empty()) {
+      errata.note(S_ERROR, R"(Benchmarking h3 requires "--connect-http3".)");
+    } else if (protocol != "h3" && Target_Selector.https_targets.empty()) {
+      errata.note(S_ERROR, R"(Benchmarking {} requires "--connect-https".)", protocol);
+    }
+  }
+
+  auto handshakes_arg{arguments.get("handshakes")};
+  if (handshakes_arg) {
+    _benchmark_handshake_count = swoc::svtou(handshakes_arg[0]);
+  }
+  auto concurrency_arg{arguments.get("concurrency")};
+  if (concurrency_arg) {
+    _benchmark_concurrency = swoc::svtou(concurrency_arg[0]);
+  }
+  if (_benchmark_handshake_count == 0 || _benchmark_concurrency == 0) {
+    errata.note(S_ERROR, R"("--handshakes" and "--concurrency" must be positive integers.)");
+  }
+  auto rate_arg{arguments.get("rate")};
+  if (rate_arg) {
+    _benchmark_rate = std::max(0.0, atof(rate_arg[0].c_str()));
+  }
+  _benchmark_resumption = arguments.get("resumption");
+
+  auto ciphers_arg{arguments.get("ciphers")};
+  auto ciphersuites_arg{arguments.get("tls13-ciphersuites")};
+  auto groups_arg{arguments.get("groups")};
+  errata.note(TLSSession::configure_client_handshake_options(
+      ciphers_arg ? ciphers_arg[0] : "",
+      ciphersuites_arg ? ciphersuites_arg[0] : "",
+      groups_arg ? groups_arg[0] : ""));
+
+  auto cert_arg{arguments.get("client-cert")};
+  if (cert_arg.size() >= 1) {
+    errata.note(TLSSession::configure_client_cert(cert_arg[0]));
+  }
+  auto ca_certs_arg{arguments.get("ca-certs")};
+  if (ca_certs_arg.size() >= 1) {
+    errata.note(TLSSession::configure_ca_cert(ca_certs_arg[0]));
+  }
+  auto interface_arg{arguments.get("interface")};
+  if (!interface_arg.empty()) {
+    specified_interface = interface_arg[0];
+  }
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+    return false;
+  }
+  return true;
+}
+
+bool
+Engine::run_handshake_benchmark()
+{
+  Errata errata;
+  for (auto const &protocol : _benchmark_protocols) {
+    auto const &targets =
+        protocol == "h3" ? Target_Selector.http3_targets : Target_Selector.https_targets;
+    HandshakeBenchmarkSchedule schedule;
+    schedule.handshake_count = _benchmark_handshake_count;
+    if (_benchmark_rate > 0.0) {
+      schedule.interval = nanoseconds(static_cast<int64_t>(1'000'000'000.0 / _benchmark_rate));
+    }
+    auto const thread_count = std::min(_benchmark_concurrency, _benchmark_handshake_count);
+    errata.note(
+        S_INFO,
+        "Benchmarking {} {} handshake{} with {} concurrent connection{}{}.",
+        _benchmark_handshake_count,
+        protocol,
+        swoc::bwf::If(_benchmark_handshake_count != 1, "s"),
+        thread_count,
+        swoc::bwf::If(thread_count != 1, "s"),
+        swoc::bwf::If(_benchmark_resumption, " using session resumption"));
+
+    std::vector<HandshakeBenchmarkResult> results(thread_count);
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    schedule.start_time = ClockType::now();
+    for (size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back(
+          TF_Handshake_Benchmark,
+          TextView{protocol},
+          std::cref(targets),
+          _benchmark_resumption,
+          std::ref(schedule),
+          std::ref(results[i]));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto const duration = duration_cast<nanoseconds>(ClockType::now() - schedule.start_time);
+    errata.note(report_handshake_benchmark(protocol, results, duration));
+  }
+  return true;
+}
+
+void
+Engine::command_handshake_benchmark()
+{
+  if (!parse_handshake_benchmark_args()) {
+    return;
+  }
+  if (!initialize_client()) {
+    return;
+  }
+  if (!run_handshake_benchmark()) {
+    return;
+  }
+  cleanup_client();
+}
+
 void
 Engine::command_run()
 {
   if (!parse_args()) {
     return;
   }
-  if (!parse_replay_files()) {
+  // A streaming replay parses the replay files as it sends their traffic.
+  if (_stream_window_size == 0 && !parse_replay_files()) {
     return;
   }
   if (!initialize_client()) {
@@ -1056,6 +1947,26 @@ Engine::command_run()
   }
 };
 
+void
+Engine::command_compile()
+{
+  Errata errata;
+  auto args{arguments.get("compile")};
+  if (args.size() < 2) {
+    errata.note(
+        S_ERROR,
+        R"("compile" command requires the replay file path and the corpus file path as )"
+        "arguments.");
+    process_exit_code = 1;
+    return;
+  }
+  errata.note(
+      YamlParser::compile_replay_files(swoc::file::path{args[0]}, swoc::file::path{args[1]}));
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+  }
+}
+
 int
 main(int /* argc */, char const *argv[])
 {
@@ -1122,6 +2033,13 @@ main(int /* argc */, char const *argv[])
           1,
           "")
       .add_option("--no-proxy", "", "Use proxy data instead of client data.")
+      .add_option(
+          "--key-hash-targets",
+          "",
+          "Send each transaction to the target owning its key rather than to "
+          "targets chosen round robin. The i'th target of each --connect "
+          "list is expected to be a verifier-server run with --partition i/n, "
+          "where n is the number of targets in the list.")
       .add_option(
           "--interface",
           "-i",
@@ -1136,6 +2054,26 @@ main(int /* argc */, char const *argv[])
           "",
           1,
           "")
+      .add_option(
+          "--stream",
+          "",
+          "Replay the sessions while parsing the replay files in order, rather "
+          "than after loading them all, holding at most the given number of "
+          "parsed sessions to reorder by start time. Memory is then bounded by "
+          "this window plus the largest replay file rather than by the size of "
+          "all the replay files.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--parse-cache",
+          "",
+          "A directory in which to cache the parsed replay files by their "
+          "content, so that files which have not changed are not parsed again "
+          "on the next run.",
+          "",
+          1,
+          "")
       .add_option(
           "--sleep-limit",
           "",
@@ -1187,14 +2125,137 @@ main(int /* argc */, char const *argv[])
           "",
           1,
           "")
+      .add_option(
+          "--ktls",
+          "",
+          "Request kernel TLS (kTLS) offload of TLS record processing. "
+          "Connections for which the kernel or negotiated cipher does not "
+          "support kTLS fall back to user space TLS.")
       .add_option(
           "--keys",
           "-k",
           "A whitelist of transactions to send.",
           "",
           MORE_THAN_ZERO_ARG_N,
+          "")
+      .add_option(
+          "--key-index",
+          "",
+          "A key index written by the verifier-server index command for the "
+          "replay files. Only the replay files containing the --keys "
+          "transactions are then parsed.",
+          "",
+          1,
           "");
 
+  engine.parser
+      .add_command(
+          "handshake-benchmark",
+          "handshake-benchmark: measure the TLS and QUIC handshake rate and latency "
+          "against the given targets without sending any requests.",
+          "",
+          0,
+          [&]() -> void { engine.command_handshake_benchmark(); })
+      .add_option(
+          "--connect-https",
+          "",
+          "TLS address and port to connect on. Can be a comma separated list.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--connect-http3",
+          "",
+          "HTTP/3 address and port to connect on. Can be a comma separated list.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--protocol",
+          "",
+          "The protocols whose handshakes to benchmark: tls, h2, and/or h3. By "
+          "default tls is benchmarked if --connect-https is provided and h3 if "
+          "--connect-http3 is provided.",
+          "",
+          MORE_THAN_ZERO_ARG_N,
+          "")
+      .add_option(
+          "--handshakes",
+          "",
+          "The number of handshakes to perform per protocol. The default is 1000.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--concurrency",
+          "",
+          "The number of handshakes to perform concurrently. The default is 1.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--rate",
+          "",
+          "The target handshakes per second. 0 means to perform the handshakes "
+          "as fast as possible. The default is 0.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--resumption",
+          "",
+          "Resume the session of a previous handshake rather than performing "
+          "full handshakes.")
+      .add_option("--ciphers", "", "The TLS 1.2 and below cipher list to offer.", "", 1, "")
+      .add_option("--tls13-ciphersuites", "", "The TLS 1.3 cipher suites to offer.", "", 1, "")
+      .add_option("--groups", "", "The key exchange groups to offer.", "", 1, "")
+      .add_option(
+          "--interface",
+          "-i",
+          "Specify the network device the client will establish connections from.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--client-cert",
+          "",
+          "Specify a TLS client certificate file containing both the public and "
+          "private keys. Alternatively a directory containing client.pem and "
+          "client.key files can be provided.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--ca-certs",
+          "",
+          "Specify TLS CA certificate file containing one or more certificates. "
+          "Alternatively, a directory containing separate certificate files can "
+          "be provided.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--tls-secrets-log-file",
+          "",
+          "A filename to which TLS secrets will be logged. These can be used to "
+          "decrypt packet captures. By default no TLS secrets will be logged.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--ktls",
+          "",
+          "Request kernel TLS (kTLS) offload of TLS record processing.");
+
+  engine.parser.add_command(
+      "compile",
+      "compile <path> <corpus-file>: compile the replay file(s) in path into a corpus "
+      "of their pre-tokenized trees, which run accepts in place of them. The transactions "
+      "are still built from the trees at startup.",
+      "",
+      2,
+      [&]() -> void { engine.command_compile(); });
+
   // parse the arguments
   engine.arguments = engine.parser.parse(argv);
 
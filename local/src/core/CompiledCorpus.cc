@@ -0,0 +1,401 @@
+/** @file
+ * Implementation of CompiledCorpus.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/CompiledCorpus.h"
+#include "core/ProxyVerifier.h"
+#include "core/ScalarSource.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "swoc/bwf_ex.h"
+#include "swoc/bwf_std.h"
+
+using swoc::Errata;
+
+namespace
+{
+/// Identifies a compiled corpus file.
+constexpr char COMPILED_CORPUS_MAGIC[8] = {'P', 'V', 'C', 'O', 'R', 'P', 'U', 'S'};
+
+/// The node types of a NodeRecord.
+enum NodeType : uint32_t { NODE_NULL = 0, NODE_SCALAR, NODE_SEQUENCE, NODE_MAP };
+} // namespace
+
+struct CompiledCorpus::Header
+{
+  char magic[sizeof(COMPILED_CORPUS_MAGIC)];
+  uint32_t version = 0;
+  uint32_t file_count = 0;
+  uint64_t node_count = 0;
+};
+
+struct CompiledCorpus::FileRecord
+{
+  uint64_t path_offset = 0;
+  uint64_t path_length = 0;
+  /// The index of the file's root node.
+  uint64_t root = 0;
+};
+
+/** A node of a replay file's tree.
+ *
+ * A scalar's text is the string at @a offset of @a length. A sequence's
+ * @a count elements start at node @a offset. A map's @a count keys and
+ * values alternate starting at node @a offset.
+ */
+struct CompiledCorpus::NodeRecord
+{
+  uint32_t type = NODE_NULL;
+  uint32_t count = 0;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+};
+
+void
+CompiledCorpus::Builder::add_file(std::string_view path, YAML::Node const &root)
+{
+  auto const root_index = _nodes.size();
+  _nodes.emplace_back();
+  _files.emplace_back(path, root_index);
+  add_node(root_index, root);
+}
+
+void
+CompiledCorpus::Builder::add_node(size_t index, YAML::Node const &node)
+{
+  // Children are appended after their parent, so _nodes may be reallocated
+  // while they are added: parents are assigned by index, not by reference.
+  switch (node.Type()) {
+  case YAML::NodeType::Scalar: {
+    auto const &scalar = node.Scalar();
+    _nodes[index] = Node{NODE_SCALAR, 0, add_string(scalar), scalar.size()};
+    break;
+  }
+  case YAML::NodeType::Sequence: {
+    auto const first = _nodes.size();
+    auto const count = node.size();
+    _nodes[index] = Node{NODE_SEQUENCE, static_cast<uint32_t>(count), first, 0};
+    _nodes.resize(first + count);
+    auto child_index = first;
+    for (auto const &child : node) {
+      add_node(child_index++, child);
+    }
+    break;
+  }
+  case YAML::NodeType::Map: {
+    auto const first = _nodes.size();
+    auto const count = node.size();
+    _nodes[index] = Node{NODE_MAP, static_cast<uint32_t>(count), first, 0};
+    _nodes.resize(first + 2 * count);
+    auto child_index = first;
+    for (auto it = node.begin(); it != node.end(); ++it) {
+      add_node(child_index++, it->first);
+      add_node(child_index++, it->second);
+    }
+    break;
+  }
+  default:
+    _nodes[index] = Node{};
+    break;
+  }
+}
+
+uint64_t
+CompiledCorpus::Builder::add_string(std::string_view s)
+{
+  auto const [spot, is_new] = _string_offsets.emplace(s, _strings.size());
+  if (is_new) {
+    _strings.append(s);
+  }
+  return spot->second;
+}
+
+Errata
+CompiledCorpus::Builder::write(swoc::file::path const &path)
+{
+  Errata errata;
+  Header header;
+  std::copy(std::begin(COMPILED_CORPUS_MAGIC), std::end(COMPILED_CORPUS_MAGIC), header.magic);
+  header.version = VERSION;
+  header.file_count = static_cast<uint32_t>(_files.size());
+  header.node_count = _nodes.size();
+
+  std::vector<FileRecord> file_records;
+  file_records.reserve(_files.size());
+  for (auto const &[file_path, root] : _files) {
+    file_records.push_back(FileRecord{add_string(file_path), file_path.size(), root});
+  }
+  static_assert(sizeof(Node) == sizeof(NodeRecord), "Builder nodes are written as NodeRecords.");
+
+  // A process mapping the previous corpus never sees a partially written
+  // one, and parse cache entries of the same content may be written by
+  // several threads at once.
+  errata.note(write_file_atomically(path, "compiled corpus", [&](FILE *out) {
+    return fwrite(&header, sizeof(header), 1, out) == 1 &&
+           fwrite(file_records.data(), sizeof(FileRecord), file_records.size(), out) ==
+               file_records.size() &&
+           fwrite(_nodes.data(), sizeof(Node), _nodes.size(), out) == _nodes.size() &&
+           fwrite(_strings.data(), 1, _strings.size(), out) == _strings.size();
+  }));
+  if (!errata.is_ok()) {
+    return errata;
+  }
+  errata.note(
+      S_INFO,
+      R"(Compiled {} replay file{} of {} nodes and {} bytes of strings into "{}".)",
+      file_records.size(),
+      swoc::bwf::If(file_records.size() != 1, "s"),
+      _nodes.size(),
+      _strings.size(),
+      path);
+  return errata;
+}
+
+CompiledCorpus::CompiledCorpus(void const *data, size_t size)
+  : _data{static_cast<char const *>(data)}
+  , _size{size}
+{
+  auto const &header = get_header();
+  _strings_offset = sizeof(Header) + header.file_count * sizeof(FileRecord) +
+                    header.node_count * sizeof(NodeRecord);
+}
+
+CompiledCorpus::~CompiledCorpus()
+{
+  munmap(const_cast<char *>(_data), _size);
+}
+
+// static
+bool
+CompiledCorpus::is_compiled_corpus(swoc::file::path const &path)
+{
+  char magic[sizeof(COMPILED_CORPUS_MAGIC)];
+  FILE *in = fopen(path.c_str(), "rb");
+  if (in == nullptr) {
+    return false;
+  }
+  bool const is_read = fread(magic, sizeof(magic), 1, in) == 1;
+  fclose(in);
+  return is_read && 0 == memcmp(magic, COMPILED_CORPUS_MAGIC, sizeof(magic));
+}
+
+// static
+swoc::Rv<std::unique_ptr<CompiledCorpus>>
+CompiledCorpus::open(swoc::file::path const &path)
+{
+  swoc::Rv<std::unique_ptr<CompiledCorpus>> zret;
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    zret.note(S_ERROR, R"(Could not open the compiled corpus "{}": {})", path, swoc::bwf::Errno{});
+    return zret;
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0) {
+    zret.note(S_ERROR, R"(Could not stat the compiled corpus "{}": {})", path, swoc::bwf::Errno{});
+    close(fd);
+    return zret;
+  }
+  auto const size = static_cast<size_t>(stat_buf.st_size);
+  if (size < sizeof(Header)) {
+    zret.note(S_ERROR, R"("{}" is too small to be a compiled corpus.)", path);
+    close(fd);
+    return zret;
+  }
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps the file's contents available after the descriptor is
+  // closed.
+  close(fd);
+  if (data == MAP_FAILED) {
+    zret.note(S_ERROR, R"(Could not map the compiled corpus "{}": {})", path, swoc::bwf::Errno{});
+    return zret;
+  }
+  std::unique_ptr<CompiledCorpus> corpus{new CompiledCorpus{data, size}};
+  auto const &header = corpus->get_header();
+  if (memcmp(header.magic, COMPILED_CORPUS_MAGIC, sizeof(COMPILED_CORPUS_MAGIC)) != 0) {
+    zret.note(S_ERROR, R"("{}" is not a compiled corpus.)", path);
+    return zret;
+  }
+  if (header.version != VERSION) {
+    zret.note(
+        S_ERROR,
+        R"(The compiled corpus "{}" has version {} rather than the supported version {}: )"
+        "compile it again.",
+        path,
+        header.version,
+        VERSION);
+    return zret;
+  }
+  if (!corpus->is_valid()) {
+    zret.note(S_ERROR, R"(The compiled corpus "{}" is truncated or corrupt.)", path);
+    return zret;
+  }
+  for (uint32_t file_id = 0; file_id < corpus->get_file_count(); ++file_id) {
+    corpus->_file_ids.emplace(corpus->get_file_path(file_id), file_id);
+  }
+  zret.result() = std::move(corpus);
+  return zret;
+}
+
+bool
+CompiledCorpus::is_valid() const
+{
+  auto const &header = get_header();
+  // Guard against overflow in the record table sizes of a corrupt header.
+  if (header.node_count > _size / sizeof(NodeRecord) || _strings_offset > _size) {
+    return false;
+  }
+  auto const strings_size = _size - _strings_offset;
+  auto const is_string_valid = [strings_size](uint64_t offset, uint64_t length) {
+    return offset <= strings_size && length <= strings_size - offset;
+  };
+  auto const node_count = header.node_count;
+  auto const *const files = get_file_records();
+  for (size_t i = 0; i < header.file_count; ++i) {
+    if (!is_string_valid(files[i].path_offset, files[i].path_length) ||
+        files[i].root >= node_count)
+    {
+      return false;
+    }
+  }
+  auto const *const nodes = get_node_records();
+  for (uint64_t i = 0; i < node_count; ++i) {
+    auto const &node = nodes[i];
+    switch (node.type) {
+    case NODE_NULL:
+      break;
+    case NODE_SCALAR:
+      if (!is_string_valid(node.offset, node.length)) {
+        return false;
+      }
+      break;
+    case NODE_SEQUENCE:
+    case NODE_MAP: {
+      uint64_t const n_children = node.type == NODE_MAP ? 2 * uint64_t{node.count} : node.count;
+      // Requiring children to follow their parent rules out cycles.
+      if (node.offset <= i || node.offset > node_count || n_children > node_count - node.offset) {
+        return false;
+      }
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t
+CompiledCorpus::find_file(std::string_view path) const
+{
+  auto const spot = _file_ids.find(path);
+  return spot == _file_ids.end() ? NO_FILE : spot->second;
+}
+
+std::string_view
+CompiledCorpus::get_file_path(uint32_t file_id) const
+{
+  auto const &record = get_file_records()[file_id];
+  return get_string(record.path_offset, record.path_length);
+}
+
+YAML::Node
+CompiledCorpus::get_root(uint32_t file_id, bool tag_sources) const
+{
+  auto const &record = get_node_records()[get_file_records()[file_id].root];
+  YAML::Node root = make_node(record, tag_sources);
+  add_children(root, record, tag_sources);
+  return root;
+}
+
+size_t
+CompiledCorpus::get_file_count() const
+{
+  return get_header().file_count;
+}
+
+size_t
+CompiledCorpus::get_size() const
+{
+  return _size;
+}
+
+YAML::Node
+CompiledCorpus::make_node(NodeRecord const &record, bool tag_sources) const
+{
+  switch (record.type) {
+  case NODE_SCALAR: {
+    auto const text = get_string(record.offset, record.length);
+    YAML::Node node{std::string{text}};
+    if (tag_sources && !text.empty()) {
+      ScalarSource::set(node, text);
+    }
+    return node;
+  }
+  case NODE_SEQUENCE:
+    return YAML::Node{YAML::NodeType::Sequence};
+  case NODE_MAP:
+    return YAML::Node{YAML::NodeType::Map};
+  default:
+    return YAML::Node{YAML::NodeType::Null};
+  }
+}
+
+void
+CompiledCorpus::add_children(YAML::Node &node, NodeRecord const &record, bool tag_sources) const
+{
+  // Each child is added to its parent before its own children are, so every
+  // node is allocated once in the root's memory.
+  auto const *const children = get_node_records() + record.offset;
+  if (record.type == NODE_SEQUENCE) {
+    for (uint32_t i = 0; i < record.count; ++i) {
+      YAML::Node child = make_node(children[i], tag_sources);
+      node.push_back(child);
+      add_children(child, children[i], tag_sources);
+    }
+  } else if (record.type == NODE_MAP) {
+    for (uint32_t i = 0; i < record.count; ++i) {
+      auto const &key_record = children[2 * i];
+      auto const &value_record = children[2 * i + 1];
+      // Keys are only looked up, never localized, so they need no source.
+      YAML::Node key = make_node(key_record, false);
+      add_children(key, key_record, false);
+      YAML::Node value = make_node(value_record, tag_sources);
+      node.force_insert(key, value);
+      add_children(value, value_record, tag_sources);
+    }
+  }
+}
+
+std::string_view
+CompiledCorpus::get_string(uint64_t offset, uint64_t length) const
+{
+  return {_data + _strings_offset + offset, length};
+}
+
+CompiledCorpus::Header const &
+CompiledCorpus::get_header() const
+{
+  return *reinterpret_cast<Header const *>(_data);
+}
+
+CompiledCorpus::FileRecord const *
+CompiledCorpus::get_file_records() const
+{
+  return reinterpret_cast<FileRecord const *>(_data + sizeof(Header));
+}
+
+CompiledCorpus::NodeRecord const *
+CompiledCorpus::get_node_records() const
+{
+  return reinterpret_cast<NodeRecord const *>(get_file_records() + get_file_count());
+}
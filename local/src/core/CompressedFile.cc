@@ -0,0 +1,289 @@
+/** @file
+ * Implementation of CompressedFile.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/CompressedFile.h"
+#include "core/ProxyVerifier.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "swoc/TextView.h"
+#include "swoc/bwf_ex.h"
+#include "swoc/bwf_std.h"
+
+using swoc::Errata;
+using swoc::TextView;
+
+namespace
+{
+/// Make room in @a content for more output after its first @a used bytes.
+void
+grow_content(std::string &content, size_t used)
+{
+  if (used == content.size()) {
+    content.resize(std::max(content.size() * 2, used + CompressedFile::BLOCK_SIZE));
+  }
+}
+
+/// Decompresses the blocks of a compressed file into its content.
+class Decompressor
+{
+public:
+  explicit Decompressor(swoc::file::path const &path) : _path{path} { }
+  virtual ~Decompressor() = default;
+
+  /** Decompress the next block of the file.
+   *
+   * @param[in] block The compressed bytes.
+   * @param[in,out] content The decompressed content, grown as needed.
+   * @param[in,out] used The number of bytes of content decompressed so far.
+   *
+   * @return Any errors in the compressed data.
+   */
+  virtual Errata decompress(TextView block, std::string &content, size_t &used) = 0;
+
+  /// Whether the blocks so far end with a complete gzip member or zstd frame.
+  virtual bool is_complete() const = 0;
+
+protected:
+  swoc::file::path const &_path;
+};
+
+/// Decompresses gzip members with zlib.
+class GzipDecompressor : public Decompressor
+{
+public:
+  explicit GzipDecompressor(swoc::file::path const &path) : Decompressor{path}
+  {
+    // 16 added to the window bits selects the gzip wrapper rather than zlib's.
+    _is_initialized = inflateInit2(&_stream, 16 + MAX_WBITS) == Z_OK;
+  }
+
+  ~GzipDecompressor() override
+  {
+    if (_is_initialized) {
+      inflateEnd(&_stream);
+    }
+  }
+
+  Errata
+  decompress(TextView block, std::string &content, size_t &used) override
+  {
+    Errata errata;
+    if (!_is_initialized) {
+      errata.note(S_ERROR, R"(Could not initialize gzip decompression of "{}".)", _path);
+      return errata;
+    }
+    if (_is_complete && !block.empty()) {
+      // Another member follows, starting at this block.
+      inflateReset(&_stream);
+      _is_complete = false;
+    }
+    _stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(block.data()));
+    _stream.avail_in = static_cast<uInt>(block.size());
+    // Inflate until the block is consumed and the output is flushed, which
+    // is when inflate leaves room in the output.
+    do {
+      grow_content(content, used);
+      _stream.next_out = reinterpret_cast<Bytef *>(content.data() + used);
+      _stream.avail_out = static_cast<uInt>(
+          std::min<size_t>(content.size() - used, std::numeric_limits<uInt>::max()));
+      auto const avail_out = _stream.avail_out;
+      int const result = inflate(&_stream, Z_NO_FLUSH);
+      used += avail_out - _stream.avail_out;
+      if (result == Z_STREAM_END) {
+        _is_complete = true;
+        if (_stream.avail_in > 0) {
+          // Another member follows, as in concatenated gzip files.
+          inflateReset(&_stream);
+          _is_complete = false;
+        }
+      } else if (result != Z_OK && result != Z_BUF_ERROR) {
+        errata.note(
+            S_ERROR,
+            R"(Could not decompress the gzip file "{}": {})",
+            _path,
+            _stream.msg != nullptr ? _stream.msg : "invalid data");
+        return errata;
+      } else {
+        _is_complete = false;
+      }
+    } while (_stream.avail_in > 0 || _stream.avail_out == 0);
+    return errata;
+  }
+
+  bool
+  is_complete() const override
+  {
+    return _is_complete;
+  }
+
+private:
+  z_stream _stream{};
+  bool _is_initialized = false;
+  bool _is_complete = false;
+};
+
+/// Decompresses zstd frames.
+class ZstdDecompressor : public Decompressor
+{
+public:
+  explicit ZstdDecompressor(swoc::file::path const &path)
+    : Decompressor{path}
+    , _stream{ZSTD_createDStream(), &ZSTD_freeDStream}
+  {
+  }
+
+  Errata
+  decompress(TextView block, std::string &content, size_t &used) override
+  {
+    Errata errata;
+    if (!_stream) {
+      errata.note(S_ERROR, R"(Could not initialize zstd decompression of "{}".)", _path);
+      return errata;
+    }
+    if (used == 0 && content.empty()) {
+      // The first frame usually records its size, so the content can be
+      // allocated once. The size is not trusted beyond a plausible ratio.
+      auto const frame_size = ZSTD_getFrameContentSize(block.data(), block.size());
+      if (frame_size != ZSTD_CONTENTSIZE_UNKNOWN && frame_size != ZSTD_CONTENTSIZE_ERROR &&
+          frame_size <= std::max(content.capacity(), CompressedFile::BLOCK_SIZE) * 64)
+      {
+        content.resize(frame_size);
+      }
+    }
+    ZSTD_inBuffer input{block.data(), block.size(), 0};
+    ZSTD_outBuffer output{};
+    do {
+      grow_content(content, used);
+      output = {content.data() + used, content.size() - used, 0};
+      _remaining = ZSTD_decompressStream(_stream.get(), &output, &input);
+      used += output.pos;
+      if (ZSTD_isError(_remaining)) {
+        errata.note(
+            S_ERROR,
+            R"(Could not decompress the zstd file "{}": {})",
+            _path,
+            ZSTD_getErrorName(_remaining));
+        return errata;
+      }
+    } while (input.pos < input.size || output.pos == output.size);
+    return errata;
+  }
+
+  bool
+  is_complete() const override
+  {
+    // ZSTD_decompressStream returns zero when a frame is complete and
+    // flushed.
+    return _remaining == 0;
+  }
+
+private:
+  std::unique_ptr<ZSTD_DStream, decltype(&ZSTD_freeDStream)> _stream;
+  /// The last return of ZSTD_decompressStream, nonzero before the first block.
+  size_t _remaining = 1;
+};
+} // namespace
+
+CompressedFile::Format
+CompressedFile::get_format(swoc::file::path const &path)
+{
+  auto const extension = TextView{path.string()}.suffix_at('.');
+  if (0 == strcasecmp(extension, "gz")) {
+    return Format::GZIP;
+  } else if (0 == strcasecmp(extension, "zst")) {
+    return Format::ZSTD;
+  }
+  return Format::NONE;
+}
+
+bool
+CompressedFile::is_compressed(swoc::file::path const &path)
+{
+  return get_format(path) != Format::NONE;
+}
+
+swoc::file::path
+CompressedFile::get_content_path(swoc::file::path const &path)
+{
+  if (!is_compressed(path)) {
+    return path;
+  }
+  TextView content_path{path.string()};
+  content_path.split_suffix_at('.');
+  return swoc::file::path{std::string{content_path}};
+}
+
+swoc::Rv<std::string>
+CompressedFile::load(swoc::file::path const &path, size_t &compressed_size)
+{
+  swoc::Rv<std::string> zret;
+  auto &content = zret.result();
+  compressed_size = 0;
+  std::unique_ptr<Decompressor> decompressor;
+  switch (get_format(path)) {
+  case Format::GZIP:
+    decompressor = std::make_unique<GzipDecompressor>(path);
+    break;
+  case Format::ZSTD:
+    decompressor = std::make_unique<ZstdDecompressor>(path);
+    break;
+  case Format::NONE:
+    zret.note(S_ERROR, R"("{}" is not a compressed file.)", path);
+    return zret;
+  }
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    zret.note(S_ERROR, R"(Could not open "{}": {})", path, swoc::bwf::Errno{});
+    return zret;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0) {
+    // Replay files typically compress by a factor of ten or more, so start
+    // with a few times the compressed size and double from there.
+    content.reserve(static_cast<size_t>(file_stat.st_size) * 4);
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  std::vector<char> block(BLOCK_SIZE);
+  size_t used = 0;
+  while (true) {
+    ssize_t const n = ::read(fd, block.data(), block.size());
+    if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0) {
+      zret.note(S_ERROR, R"(Error reading "{}": {})", path, swoc::bwf::Errno{});
+      break;
+    } else if (n == 0) {
+      if (!decompressor->is_complete()) {
+        zret.note(S_ERROR, R"(The compressed file "{}" is truncated.)", path);
+      }
+      break;
+    }
+    compressed_size += static_cast<size_t>(n);
+    TextView const compressed{block.data(), static_cast<size_t>(n)};
+    zret.note(decompressor->decompress(compressed, content, used));
+    if (!zret.is_ok()) {
+      break;
+    }
+  }
+  // The compressed pages are not read again, so release them rather than
+  // let them crowd the page cache.
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+  content.resize(used);
+  return zret;
+}
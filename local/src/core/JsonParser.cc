@@ -0,0 +1,665 @@
+/** @file
+ * Implementation of JsonParser.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/JsonParser.h"
+#include "core/ProxyVerifier.h"
+#include "core/ScalarSource.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <strings.h>
+
+#include "swoc/bwf_ex.h"
+#include "swoc/bwf_std.h"
+
+using swoc::TextView;
+
+namespace
+{
+/// The YAML merge key, which yaml_merge interprets.
+constexpr std::string_view MERGE_KEY{"<<"};
+
+/** A recursive descent JSON parser that adds the values it parses to YAML
+ * nodes.
+ *
+ * Containers are added to their parent before their members are parsed, so
+ * every node of the tree is allocated once in the root's memory rather than
+ * being copied up into each ancestor as it is added.
+ */
+class JsonReader
+{
+public:
+  /** @param[in] tag_sources Whether to tag values that are verbatim in
+   * @a text with their source (see JsonParser::parse).
+   */
+  JsonReader(TextView text, bool tag_sources)
+    : _begin{text.data()}
+    , _cur{text.data()}
+    , _end{text.end()}
+    , _tag_sources{tag_sources}
+  {
+  }
+
+  /** Parse the document.
+   *
+   * @param[out] root The root node of the document.
+   *
+   * @return True if the text is a single valid JSON value, false otherwise
+   * with the reason in get_error().
+   */
+  bool
+  parse(YAML::Node &root)
+  {
+    skip_whitespace();
+    if (_cur == _end) {
+      return fail("the document is empty");
+    }
+    if (*_cur == '{' || *_cur == '[') {
+      root = YAML::Node{*_cur == '{' ? YAML::NodeType::Map : YAML::NodeType::Sequence};
+      if (!parse_container(root, 0)) {
+        return false;
+      }
+    } else {
+      // A document that is a single scalar is added to a sequence and then
+      // unwrapped, so scalars are only parsed in one place.
+      YAML::Node holder{YAML::NodeType::Sequence};
+      if (!parse_value(holder, nullptr, 0)) {
+        return false;
+      }
+      root = holder[0];
+    }
+    skip_whitespace();
+    if (_cur != _end) {
+      return fail("unexpected content after the document");
+    }
+    return true;
+  }
+
+  std::string const &
+  get_error() const
+  {
+    return _error;
+  }
+
+  /// The line and column, counted from 1, at which parsing failed.
+  std::pair<size_t, size_t>
+  get_error_position() const
+  {
+    size_t const line = std::count(_begin, _cur, '\n') + 1;
+    char const *line_start = _cur;
+    while (line_start > _begin && line_start[-1] != '\n') {
+      --line_start;
+    }
+    return {line, static_cast<size_t>(_cur - line_start) + 1};
+  }
+
+  bool
+  has_merge_key() const
+  {
+    return _has_merge_key;
+  }
+
+private:
+  bool
+  fail(char const *reason)
+  {
+    _error = reason;
+    return false;
+  }
+
+  void
+  skip_whitespace()
+  {
+    while (_cur < _end && (*_cur == ' ' || *_cur == '\n' || *_cur == '\r' || *_cur == '\t')) {
+      ++_cur;
+    }
+  }
+
+  /** Add a child to a container: a member if @a key is not null, otherwise
+   * an element.
+   */
+  template <typename T>
+  static void
+  add_child(YAML::Node &container, std::string const *key, T const &child)
+  {
+    if (key != nullptr) {
+      container.force_insert(*key, child);
+    } else {
+      container.push_back(child);
+    }
+  }
+
+  /** Add a scalar of _value to @a container, tagged with its @a source if
+   * _value is the source verbatim.
+   */
+  void
+  add_scalar(YAML::Node &container, std::string const *key, TextView source)
+  {
+    // Every escape decodes to fewer bytes than it is written in, so a value
+    // the size of its source has no escapes.
+    if (_tag_sources && !source.empty() && source.size() == _value.size()) {
+      YAML::Node child{_value};
+      ScalarSource::set(child, source);
+      add_child(container, key, child);
+    } else {
+      add_child(container, key, _value);
+    }
+  }
+
+  /** Parse the members or elements of an object or array.
+   *
+   * @param[in] container A map or sequence node, with _cur at its opening
+   * brace or bracket.
+   */
+  bool
+  parse_container(YAML::Node &container, int depth)
+  {
+    if (depth >= JsonParser::MAX_DEPTH) {
+      return fail("objects and arrays are nested too deeply");
+    }
+    bool const is_object = *_cur == '{';
+    char const close = is_object ? '}' : ']';
+    ++_cur;
+    skip_whitespace();
+    if (_cur < _end && *_cur == close) {
+      ++_cur;
+      return true;
+    }
+    std::string key;
+    while (true) {
+      if (is_object) {
+        if (_cur == _end || *_cur != '"') {
+          return fail("expected a string member name");
+        }
+        if (!parse_string(key)) {
+          return false;
+        }
+        if (key == MERGE_KEY) {
+          _has_merge_key = true;
+        }
+        skip_whitespace();
+        if (_cur == _end || *_cur != ':') {
+          return fail("expected ':' after a member name");
+        }
+        ++_cur;
+        skip_whitespace();
+      }
+      if (!parse_value(container, is_object ? &key : nullptr, depth)) {
+        return false;
+      }
+      skip_whitespace();
+      if (_cur == _end) {
+        return fail(is_object ? "the object is not closed" : "the array is not closed");
+      }
+      if (*_cur == close) {
+        ++_cur;
+        return true;
+      }
+      if (*_cur != ',') {
+        return fail(is_object ? "expected ',' or '}'" : "expected ',' or ']'");
+      }
+      ++_cur;
+      skip_whitespace();
+    }
+  }
+
+  /** Parse a value at _cur and add it to @a container. */
+  bool
+  parse_value(YAML::Node &container, std::string const *key, int depth)
+  {
+    if (_cur == _end) {
+      return fail("expected a value");
+    }
+    switch (*_cur) {
+    case '{':
+    case '[': {
+      YAML::Node child{*_cur == '{' ? YAML::NodeType::Map : YAML::NodeType::Sequence};
+      add_child(container, key, child);
+      return parse_container(child, depth + 1);
+    }
+    case '"': {
+      char const *const start = _cur + 1;
+      if (!parse_string(_value)) {
+        return false;
+      }
+      add_scalar(container, key, TextView{start, _cur - 1});
+      return true;
+    }
+    case 't':
+      return parse_literal(container, key, "true");
+    case 'f':
+      return parse_literal(container, key, "false");
+    case 'n':
+      if (!match("null")) {
+        return fail("expected a value");
+      }
+      add_child(container, key, YAML::Node{YAML::NodeType::Null});
+      return true;
+    default:
+      return parse_number(container, key);
+    }
+  }
+
+  /// Consume @a word if it is at _cur.
+  bool
+  match(std::string_view word)
+  {
+    if (static_cast<size_t>(_end - _cur) < word.size() ||
+        0 != memcmp(_cur, word.data(), word.size()))
+    {
+      return false;
+    }
+    _cur += word.size();
+    return true;
+  }
+
+  bool
+  parse_literal(YAML::Node &container, std::string const *key, std::string_view word)
+  {
+    if (!match(word)) {
+      return fail("expected a value");
+    }
+    _value.assign(word);
+    add_child(container, key, _value);
+    return true;
+  }
+
+  /** Parse a number, which is kept as the scalar of its text. */
+  bool
+  parse_number(YAML::Node &container, std::string const *key)
+  {
+    auto const is_digit = [this]() { return _cur < _end && *_cur >= '0' && *_cur <= '9'; };
+    char const *const start = _cur;
+    if (_cur < _end && *_cur == '-') {
+      ++_cur;
+    }
+    if (!is_digit()) {
+      return fail("expected a value");
+    }
+    if (*_cur == '0') {
+      ++_cur;
+    } else {
+      while (is_digit()) {
+        ++_cur;
+      }
+    }
+    if (_cur < _end && *_cur == '.') {
+      ++_cur;
+      if (!is_digit()) {
+        return fail("expected a digit after the decimal point");
+      }
+      while (is_digit()) {
+        ++_cur;
+      }
+    }
+    if (_cur < _end && (*_cur == 'e' || *_cur == 'E')) {
+      ++_cur;
+      if (_cur < _end && (*_cur == '+' || *_cur == '-')) {
+        ++_cur;
+      }
+      if (!is_digit()) {
+        return fail("expected a digit in the exponent");
+      }
+      while (is_digit()) {
+        ++_cur;
+      }
+    }
+    _value.assign(start, _cur - start);
+    add_scalar(container, key, TextView{start, _cur});
+    return true;
+  }
+
+  /** Parse a string, decoding its escapes, with _cur at its opening quote. */
+  bool
+  parse_string(std::string &value)
+  {
+    ++_cur;
+    value.clear();
+    while (true) {
+      // Copy the run of characters up to the next quote or escape at once.
+      char const *run_end = _cur;
+      while (run_end < _end && *run_end != '"' && *run_end != '\\' &&
+             static_cast<unsigned char>(*run_end) >= 0x20) {
+        ++run_end;
+      }
+      value.append(_cur, run_end - _cur);
+      _cur = run_end;
+      if (_cur == _end) {
+        return fail("the string is not closed");
+      }
+      if (*_cur == '"') {
+        ++_cur;
+        return true;
+      }
+      if (*_cur != '\\') {
+        return fail("control characters must be escaped in strings");
+      }
+      ++_cur;
+      if (_cur == _end) {
+        return fail("the string is not closed");
+      }
+      switch (*_cur++) {
+      case '"':
+        value += '"';
+        break;
+      case '\\':
+        value += '\\';
+        break;
+      case '/':
+        value += '/';
+        break;
+      case 'b':
+        value += '\b';
+        break;
+      case 'f':
+        value += '\f';
+        break;
+      case 'n':
+        value += '\n';
+        break;
+      case 'r':
+        value += '\r';
+        break;
+      case 't':
+        value += '\t';
+        break;
+      case 'u':
+        if (!parse_unicode_escape(value)) {
+          return false;
+        }
+        break;
+      default:
+        --_cur;
+        return fail("invalid escape in a string");
+      }
+    }
+  }
+
+  /// Parse the four hex digits of a \u escape.
+  bool
+  parse_hex4(uint32_t &code)
+  {
+    if (_end - _cur < 4) {
+      return fail("a \\u escape needs four hex digits");
+    }
+    code = 0;
+    for (int i = 0; i < 4; ++i, ++_cur) {
+      char const c = *_cur;
+      code <<= 4;
+      if (c >= '0' && c <= '9') {
+        code |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        code |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        code |= c - 'A' + 10;
+      } else {
+        return fail("a \\u escape needs four hex digits");
+      }
+    }
+    return true;
+  }
+
+  /** Decode a \u escape, and the low surrogate escape that follows a high
+   * surrogate, and append the code point as UTF-8.
+   */
+  bool
+  parse_unicode_escape(std::string &value)
+  {
+    uint32_t code = 0;
+    if (!parse_hex4(code)) {
+      return false;
+    }
+    if (code >= 0xD800 && code <= 0xDBFF) {
+      uint32_t low = 0;
+      if (!match("\\u") || !parse_hex4(low) || low < 0xDC00 || low > 0xDFFF) {
+        return fail("a high surrogate must be followed by a low surrogate");
+      }
+      code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+      return fail("a low surrogate must follow a high surrogate");
+    }
+    if (code < 0x80) {
+      value += static_cast<char>(code);
+    } else if (code < 0x800) {
+      value += static_cast<char>(0xC0 | (code >> 6));
+      value += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      value += static_cast<char>(0xE0 | (code >> 12));
+      value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      value += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+      value += static_cast<char>(0xF0 | (code >> 18));
+      value += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+      value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      value += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    return true;
+  }
+
+private:
+  char const *const _begin;
+  char const *_cur;
+  char const *const _end;
+  /// A buffer for scalar values, reused to avoid an allocation per scalar.
+  std::string _value;
+  std::string _error;
+  bool _has_merge_key = false;
+  bool const _tag_sources = false;
+};
+
+// The following skip over JSON text without building nodes, to find where
+// split_array should split a document. Each returns nullptr if the text ends
+// before what it skips does.
+
+char const *
+skip_json_whitespace(char const *cur, char const *end)
+{
+  while (cur < end && (*cur == ' ' || *cur == '\n' || *cur == '\r' || *cur == '\t')) {
+    ++cur;
+  }
+  return cur;
+}
+
+/// Skip a string, with @a cur at its opening quote.
+char const *
+skip_json_string(char const *cur, char const *end)
+{
+  for (++cur; cur < end; ++cur) {
+    if (*cur == '\\') {
+      ++cur; // Skip the escaped character, which may be a quote.
+    } else if (*cur == '"') {
+      return cur + 1;
+    }
+  }
+  return nullptr;
+}
+
+/// Skip a value, with @a cur at its first character.
+char const *
+skip_json_value(char const *cur, char const *end)
+{
+  if (cur == end) {
+    return nullptr;
+  }
+  if (*cur == '"') {
+    return skip_json_string(cur, end);
+  }
+  if (*cur == '{' || *cur == '[') {
+    // Brackets are only counted, not matched: JsonParser::parse rejects a
+    // chunk with mismatched brackets.
+    int depth = 0;
+    while (cur < end) {
+      if (*cur == '"') {
+        cur = skip_json_string(cur, end);
+        if (cur == nullptr) {
+          return nullptr;
+        }
+        continue;
+      }
+      if (*cur == '{' || *cur == '[') {
+        ++depth;
+      } else if ((*cur == '}' || *cur == ']') && --depth == 0) {
+        return cur + 1;
+      }
+      ++cur;
+    }
+    return nullptr;
+  }
+  char const *const start = cur;
+  while (cur < end && *cur != ',' && *cur != ']' && *cur != '}' && *cur != ' ' && *cur != '\n' &&
+         *cur != '\r' && *cur != '\t')
+  {
+    ++cur;
+  }
+  return cur == start ? nullptr : cur;
+}
+} // namespace
+
+swoc::Rv<YAML::Node>
+JsonParser::parse(TextView text, bool &has_merge_key, bool tag_sources)
+{
+  swoc::Rv<YAML::Node> zret;
+  JsonReader reader{text, tag_sources};
+  YAML::Node root;
+  if (!reader.parse(root)) {
+    auto const [line, column] = reader.get_error_position();
+    zret.note(
+        S_ERROR,
+        "JSON syntax error at line {}, column {}: {}.",
+        line,
+        column,
+        reader.get_error());
+    return zret;
+  }
+  has_merge_key = reader.has_merge_key();
+  zret.result() = root;
+  return zret;
+}
+
+JsonParser::ArraySplit
+JsonParser::split_array(TextView text, std::string_view key, size_t max_chunks)
+{
+  ArraySplit split;
+  if (max_chunks < 2) {
+    return split;
+  }
+  char const *const end = text.end();
+  char const *cur = skip_json_whitespace(text.data(), end);
+  if (cur == end || *cur != '{') {
+    return split;
+  }
+  // The positions of the array's brackets and the extents of its elements.
+  char const *array_open = nullptr;
+  char const *array_close = nullptr;
+  std::vector<std::pair<char const *, char const *>> elements;
+  ++cur;
+  while (true) {
+    cur = skip_json_whitespace(cur, end);
+    if (cur == end) {
+      return split;
+    }
+    if (*cur == '}') {
+      if (array_open == nullptr) {
+        return split;
+      }
+      break;
+    }
+    if (*cur != '"') {
+      return split;
+    }
+    char const *const name = cur + 1;
+    cur = skip_json_string(cur, end);
+    if (cur == nullptr) {
+      return split;
+    }
+    bool const is_key = std::string_view{name, static_cast<size_t>(cur - 1 - name)} == key;
+    cur = skip_json_whitespace(cur, end);
+    if (cur == end || *cur != ':') {
+      return split;
+    }
+    cur = skip_json_whitespace(cur + 1, end);
+    if (is_key) {
+      if (array_open != nullptr || cur == end || *cur != '[') {
+        return split;
+      }
+      array_open = cur;
+      cur = skip_json_whitespace(cur + 1, end);
+      while (cur < end && *cur != ']') {
+        char const *const element = cur;
+        cur = skip_json_value(cur, end);
+        if (cur == nullptr) {
+          return split;
+        }
+        elements.emplace_back(element, cur);
+        cur = skip_json_whitespace(cur, end);
+        if (cur < end && *cur == ',') {
+          cur = skip_json_whitespace(cur + 1, end);
+        } else if (cur == end || *cur != ']') {
+          return split;
+        }
+      }
+      if (cur == end) {
+        return split;
+      }
+      array_close = cur++;
+    } else {
+      cur = skip_json_value(cur, end);
+      if (cur == nullptr) {
+        return split;
+      }
+    }
+    cur = skip_json_whitespace(cur, end);
+    if (cur < end && *cur == ',') {
+      ++cur;
+    } else if (cur == end || *cur != '}') {
+      return split;
+    }
+  }
+  if (elements.size() < 2) {
+    return split;
+  }
+
+  split.remainder.reserve(text.size() - (array_close - array_open) + 1);
+  split.remainder.append(text.data(), array_open + 1 - text.data());
+  split.remainder.append(array_close, end - array_close);
+
+  // Divide the elements into runs of about the same number of bytes.
+  auto const n_chunks = std::min(max_chunks, elements.size());
+  auto const n_bytes = static_cast<size_t>(elements.back().second - elements.front().first);
+  auto const add_chunk = [&](char const *first, char const *last) {
+    auto &chunk = split.chunks.emplace_back();
+    chunk.reserve(key.size() + (last - first) + 8);
+    chunk.append("{\"").append(key).append("\":[");
+    chunk.append(first, last - first);
+    chunk.append("]}");
+  };
+  char const *chunk_start = elements.front().first;
+  for (size_t i = 0; i < elements.size(); ++i) {
+    auto const chunk_end = elements[i].second;
+    auto const n_remaining_chunks = n_chunks - split.chunks.size();
+    bool const is_last_element = i + 1 == elements.size();
+    bool const is_full = static_cast<size_t>(chunk_end - elements.front().first) * n_chunks >=
+                         n_bytes * (split.chunks.size() + 1);
+    // Leave at least one element for each of the remaining chunks.
+    bool const must_end = elements.size() - (i + 1) < n_remaining_chunks;
+    if (is_last_element || (n_remaining_chunks > 1 && (is_full || must_end))) {
+      add_chunk(chunk_start, chunk_end);
+      if (!is_last_element) {
+        chunk_start = elements[i + 1].first;
+      }
+    }
+  }
+  return split;
+}
+
+bool
+JsonParser::is_json_file(swoc::file::path const &path)
+{
+  auto const extension = TextView{path.string()}.suffix_at('.');
+  return extension.size() == 4 && 0 == strncasecmp(extension.data(), "json", 4);
+}
@@ -0,0 +1,326 @@
+/** @file
+ * Implementation of KeyIndexFile.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/KeyIndexFile.h"
+#include "core/ProxyVerifier.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "swoc/bwf_ex.h"
+#include "swoc/bwf_std.h"
+
+using swoc::Errata;
+
+namespace
+{
+/// Identifies a key index file.
+constexpr char KEY_INDEX_MAGIC[8] = {'P', 'V', 'K', 'E', 'Y', 'I', 'D', 'X'};
+} // namespace
+
+/** A reference to a string in the string table. */
+struct KeyIndexFile::StringRef
+{
+  /// The offset of the string from the start of the string table.
+  uint64_t offset = 0;
+  uint64_t length = 0;
+};
+
+struct KeyIndexFile::Header
+{
+  char magic[sizeof(KEY_INDEX_MAGIC)];
+  uint32_t version = 0;
+  uint32_t file_count = 0;
+  uint64_t key_count = 0;
+  uint64_t sni_count = 0;
+  StringRef key_format;
+};
+
+struct KeyIndexFile::FileRecord
+{
+  StringRef path;
+};
+
+struct KeyIndexFile::KeyRecord
+{
+  StringRef key;
+  uint32_t file_id = 0;
+  uint32_t reserved = 0;
+};
+
+struct KeyIndexFile::SniRecord
+{
+  StringRef sni;
+  StringRef alpn_wire_string;
+  int32_t verify_mode = 0;
+  uint32_t reserved = 0;
+};
+
+void
+KeyIndexFile::Builder::set_key_format(std::string_view key_format)
+{
+  _key_format = key_format;
+}
+
+uint32_t
+KeyIndexFile::Builder::add_file(std::string_view path)
+{
+  _files.emplace_back(path);
+  return static_cast<uint32_t>(_files.size() - 1);
+}
+
+void
+KeyIndexFile::Builder::add_key(std::string_view key, uint32_t file_id)
+{
+  _keys.emplace_back(key, file_id);
+}
+
+void
+KeyIndexFile::Builder::add_sni(SniBehavior const &behavior)
+{
+  _snis.emplace_back(
+      behavior.sni,
+      std::make_pair(behavior.verify_mode, std::string{behavior.alpn_wire_string}));
+}
+
+Errata
+KeyIndexFile::Builder::write(swoc::file::path const &path)
+{
+  Errata errata;
+  // The stable sort keeps the first file added for a duplicate key in front
+  // of the others, which unique then drops.
+  std::stable_sort(_keys.begin(), _keys.end(), [](auto const &lhs, auto const &rhs) {
+    return lhs.first < rhs.first;
+  });
+  _keys.erase(
+      std::unique(
+          _keys.begin(),
+          _keys.end(),
+          [](auto const &lhs, auto const &rhs) { return lhs.first == rhs.first; }),
+      _keys.end());
+
+  std::string strings;
+  auto const add_string = [&strings](std::string_view s) -> StringRef {
+    StringRef const ref{strings.size(), s.size()};
+    strings.append(s);
+    return ref;
+  };
+
+  Header header;
+  std::copy(std::begin(KEY_INDEX_MAGIC), std::end(KEY_INDEX_MAGIC), header.magic);
+  header.version = VERSION;
+  header.file_count = static_cast<uint32_t>(_files.size());
+  header.key_count = _keys.size();
+  header.sni_count = _snis.size();
+  header.key_format = add_string(_key_format);
+
+  std::vector<FileRecord> file_records;
+  file_records.reserve(_files.size());
+  for (auto const &file : _files) {
+    file_records.push_back(FileRecord{add_string(file)});
+  }
+  std::vector<KeyRecord> key_records;
+  key_records.reserve(_keys.size());
+  for (auto const &[key, file_id] : _keys) {
+    key_records.push_back(KeyRecord{add_string(key), file_id, 0});
+  }
+  std::vector<SniRecord> sni_records;
+  sni_records.reserve(_snis.size());
+  for (auto const &[sni, behavior] : _snis) {
+    auto const &[verify_mode, alpn_wire_string] = behavior;
+    sni_records.push_back(
+        SniRecord{add_string(sni), add_string(alpn_wire_string), verify_mode, 0});
+  }
+
+  // A server mapping the previous index never sees a partially written one.
+  errata.note(write_file_atomically(path, "key index", [&](FILE *out) {
+    return fwrite(&header, sizeof(header), 1, out) == 1 &&
+           fwrite(file_records.data(), sizeof(FileRecord), file_records.size(), out) ==
+               file_records.size() &&
+           fwrite(key_records.data(), sizeof(KeyRecord), key_records.size(), out) ==
+               key_records.size() &&
+           fwrite(sni_records.data(), sizeof(SniRecord), sni_records.size(), out) ==
+               sni_records.size() &&
+           fwrite(strings.data(), 1, strings.size(), out) == strings.size();
+  }));
+  if (!errata.is_ok()) {
+    return errata;
+  }
+  errata.note(
+      S_INFO,
+      R"(Wrote a key index of {} key{} in {} replay file{} to "{}".)",
+      key_records.size(),
+      swoc::bwf::If(key_records.size() != 1, "s"),
+      file_records.size(),
+      swoc::bwf::If(file_records.size() != 1, "s"),
+      path);
+  return errata;
+}
+
+KeyIndexFile::KeyIndexFile(void const *data, size_t size)
+  : _data{static_cast<char const *>(data)}
+  , _size{size}
+{
+  auto const &header = get_header();
+  _strings_offset = sizeof(Header) + header.file_count * sizeof(FileRecord) +
+                    header.key_count * sizeof(KeyRecord) + header.sni_count * sizeof(SniRecord);
+}
+
+KeyIndexFile::~KeyIndexFile()
+{
+  munmap(const_cast<char *>(_data), _size);
+}
+
+// static
+swoc::Rv<std::unique_ptr<KeyIndexFile>>
+KeyIndexFile::open(swoc::file::path const &path)
+{
+  swoc::Rv<std::unique_ptr<KeyIndexFile>> zret;
+  int const fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    zret.note(S_ERROR, R"(Could not open the key index "{}": {})", path, swoc::bwf::Errno{});
+    return zret;
+  }
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0) {
+    zret.note(S_ERROR, R"(Could not stat the key index "{}": {})", path, swoc::bwf::Errno{});
+    close(fd);
+    return zret;
+  }
+  auto const size = static_cast<size_t>(stat_buf.st_size);
+  if (size < sizeof(Header)) {
+    zret.note(S_ERROR, R"("{}" is too small to be a key index.)", path);
+    close(fd);
+    return zret;
+  }
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps the file's contents available after the descriptor is
+  // closed.
+  close(fd);
+  if (data == MAP_FAILED) {
+    zret.note(S_ERROR, R"(Could not map the key index "{}": {})", path, swoc::bwf::Errno{});
+    return zret;
+  }
+  std::unique_ptr<KeyIndexFile> index{new KeyIndexFile{data, size}};
+  auto const &header = index->get_header();
+  if (memcmp(header.magic, KEY_INDEX_MAGIC, sizeof(KEY_INDEX_MAGIC)) != 0) {
+    zret.note(S_ERROR, R"("{}" is not a key index.)", path);
+    return zret;
+  }
+  if (header.version != VERSION) {
+    zret.note(
+        S_ERROR,
+        R"(The key index "{}" has version {} rather than the supported version {}: rebuild it.)",
+        path,
+        header.version,
+        VERSION);
+    return zret;
+  }
+  // Guard against overflow in the record table sizes of a corrupt header.
+  if (header.key_count > size / sizeof(KeyRecord) || header.sni_count > size / sizeof(SniRecord) ||
+      index->_strings_offset > size)
+  {
+    zret.note(S_ERROR, R"(The key index "{}" is truncated or corrupt.)", path);
+    return zret;
+  }
+  zret.result() = std::move(index);
+  return zret;
+}
+
+uint32_t
+KeyIndexFile::find(std::string_view key) const
+{
+  auto const *const begin = get_key_records();
+  auto const *const end = begin + get_key_count();
+  auto const spot =
+      std::lower_bound(begin, end, key, [this](KeyRecord const &record, std::string_view key) {
+        return get_string(record.key) < key;
+      });
+  if (spot == end || get_string(spot->key) != key) {
+    return NO_FILE;
+  }
+  return spot->file_id;
+}
+
+std::string_view
+KeyIndexFile::get_file_path(uint32_t file_id) const
+{
+  if (file_id >= get_file_count()) {
+    return {};
+  }
+  return get_string(get_file_records()[file_id].path);
+}
+
+KeyIndexFile::SniBehavior
+KeyIndexFile::get_sni_behavior(size_t i) const
+{
+  auto const &record = get_sni_records()[i];
+  return {get_string(record.sni), record.verify_mode, get_string(record.alpn_wire_string)};
+}
+
+std::string_view
+KeyIndexFile::get_key_format() const
+{
+  return get_string(get_header().key_format);
+}
+
+size_t
+KeyIndexFile::get_key_count() const
+{
+  return get_header().key_count;
+}
+
+size_t
+KeyIndexFile::get_file_count() const
+{
+  return get_header().file_count;
+}
+
+size_t
+KeyIndexFile::get_sni_count() const
+{
+  return get_header().sni_count;
+}
+
+std::string_view
+KeyIndexFile::get_string(StringRef const &ref) const
+{
+  auto const strings_size = _size - _strings_offset;
+  if (ref.offset > strings_size || ref.length > strings_size - ref.offset) {
+    return {};
+  }
+  return {_data + _strings_offset + ref.offset, ref.length};
+}
+
+KeyIndexFile::Header const &
+KeyIndexFile::get_header() const
+{
+  return *reinterpret_cast<Header const *>(_data);
+}
+
+KeyIndexFile::FileRecord const *
+KeyIndexFile::get_file_records() const
+{
+  return reinterpret_cast<FileRecord const *>(_data + sizeof(Header));
+}
+
+KeyIndexFile::KeyRecord const *
+KeyIndexFile::get_key_records() const
+{
+  return reinterpret_cast<KeyRecord const *>(get_file_records() + get_file_count());
+}
+
+KeyIndexFile::SniRecord const *
+KeyIndexFile::get_sni_records() const
+{
+  return reinterpret_cast<SniRecord const *>(get_key_records() + get_key_count());
+}
@@ -6,10 +6,15 @@
  */
 
 #include "core/Localizer.h"
+#include "core/ProxyVerifier.h"
 
+#include <algorithm>
 #include <cassert>
 #include <dirent.h>
+#include <limits>
+#include <mutex>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "swoc/bwf_ex.h"
@@ -21,37 +26,121 @@ using swoc::TextView;
 using namespace swoc::literals;
 using namespace std::literals;
 
-Localizer::NameSet Localizer::_names;
-swoc::MemArena Localizer::_arena{8000};
-bool Localizer::_frozen = false;
+std::array<Localizer::NameShard, Localizer::NUM_NAME_SHARDS> Localizer::_name_shards;
+std::deque<swoc::MemArena> Localizer::_arenas;
+std::mutex Localizer::_arenas_mutex;
+std::vector<std::shared_ptr<void const>> Localizer::_retained_sources;
+size_t Localizer::_retained_bytes = 0;
+std::mutex Localizer::_retained_sources_mutex;
+std::atomic<bool> Localizer::_frozen{false};
+
+/// The arena of this thread, an element of Localizer::_arenas.
+static thread_local swoc::MemArena *Thread_Arena = nullptr;
+
+/// The arena of this thread's innermost Localizer::ScopedArena, if any.
+static thread_local swoc::MemArena *Scoped_Arena = nullptr;
+
+Localizer::ScopedArena::ScopedArena(swoc::MemArena &arena) : _previous{Scoped_Arena}
+{
+  Scoped_Arena = &arena;
+}
+
+Localizer::ScopedArena::~ScopedArena()
+{
+  Scoped_Arena = _previous;
+}
+
+swoc::MemArena &
+Localizer::get_thread_arena()
+{
+  if (Thread_Arena == nullptr) {
+    std::lock_guard<std::mutex> lock(_arenas_mutex);
+    Thread_Arena = &_arenas.emplace_back(8000);
+  }
+  return *Thread_Arena;
+}
+
+swoc::MemArena &
+Localizer::get_localization_arena()
+{
+  return Scoped_Arena != nullptr ? *Scoped_Arena : get_thread_arena();
+}
 
 swoc::TextView
-Localizer::localize_helper(TextView text, bool should_lower)
+Localizer::localize_helper(swoc::MemArena &arena, TextView text, bool should_lower)
 {
-  assert(!_frozen);
-  auto span{_arena.alloc(text.size()).rebind<char>()};
+  // A scoped arena's owner frees its strings, so it may be filled after the
+  // permanent localization is frozen.
+  assert(!_frozen || Scoped_Arena != nullptr);
+  auto span{arena.alloc(text.size()).rebind<char>()};
   if (should_lower) {
     std::transform(text.begin(), text.end(), span.begin(), &tolower);
   } else {
     std::copy(text.begin(), text.end(), span.begin());
   }
-  TextView local{span.data(), text.size()};
-  if (should_lower) {
-    _names.insert(local);
-  }
-  return local;
+  return TextView{span.data(), text.size()};
 }
 
-void
+swoc::Errata
 Localizer::freeze_localization()
 {
   _frozen = true;
+
+  uint64_t lookups = 0;
+  uint64_t hits = 0;
+  size_t num_names = 0;
+  size_t name_bytes = 0;
+  for (auto &shard : _name_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    lookups += shard.lookups;
+    hits += shard.hits;
+    num_names += shard.names.size();
+    name_bytes += shard.arena.size();
+  }
+  size_t arena_bytes = 0;
+  size_t num_arenas = 0;
+  {
+    std::lock_guard<std::mutex> lock(_arenas_mutex);
+    for (auto const &arena : _arenas) {
+      arena_bytes += arena.size();
+    }
+    num_arenas = _arenas.size();
+  }
+  swoc::Errata errata;
+  errata.note(
+      S_INFO,
+      "Localized strings: {} of {} case-insensitive lookups ({}%) found one of {} interned "
+      "names of {} bytes; {} bytes in {} thread arena{}.",
+      hits,
+      lookups,
+      lookups == 0 ? 0 : hits * 100 / lookups,
+      num_names,
+      name_bytes,
+      arena_bytes,
+      num_arenas,
+      swoc::bwf::If(num_arenas != 1, "s"));
+  size_t num_sources = 0;
+  size_t retained_bytes = 0;
+  {
+    std::lock_guard<std::mutex> lock(_retained_sources_mutex);
+    num_sources = _retained_sources.size();
+    retained_bytes = _retained_bytes;
+  }
+  if (num_sources > 0) {
+    errata.note(
+        S_INFO,
+        "Strings are referred to in place in {} memory-mapped source{} of {} bytes.",
+        num_sources,
+        swoc::bwf::If(num_sources != 1, "s"),
+        retained_bytes);
+  }
+  return errata;
 }
 
 swoc::TextView
 Localizer::localize(char const *text)
 {
-  return localize_helper(TextView{text, strlen(text) + 1}, !SHOULD_LOWER);
+  return localize_helper(get_localization_arena(), TextView{text, strlen(text) + 1}, !SHOULD_LOWER);
 }
 
 swoc::TextView
@@ -63,28 +152,68 @@ Localizer::localize_lower(char const *text)
 swoc::TextView
 Localizer::localize(TextView text)
 {
-  return localize_helper(text, !SHOULD_LOWER);
+  return localize_helper(get_localization_arena(), text, !SHOULD_LOWER);
 }
 
 swoc::TextView
 Localizer::localize_lower(TextView text)
 {
-  // _names.find() does a case insensitive lookup, so cache lookup via
-  // _names only should be used for case-insensitive localization. It's
+  // The shard's set does a case insensitive lookup, so cache lookup via the
+  // interned names only should be used for case-insensitive localization. It's
   // value applies to well-known, common strings such as HTTP headers.
-  auto spot = _names.find(text);
-  if (spot != _names.end()) {
+  auto const hash = Hash{}(text);
+  using HashType = std::remove_const_t<decltype(hash)>;
+  static_assert(
+      std::numeric_limits<HashType>::digits == 64,
+      "The name shards are selected from a 64-bit hash.");
+  // The set buckets by the low bits of the hash, so select the shard by the
+  // high bits.
+  auto &shard = _name_shards[hash >> (std::numeric_limits<HashType>::digits - NAME_SHARD_BITS)];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  ++shard.lookups;
+  auto spot = shard.names.find(text);
+  if (spot != shard.names.end()) {
+    ++shard.hits;
     return *spot;
   }
-  return localize_helper(text, SHOULD_LOWER);
+  // Interned names outlive any scoped arena, since later files share them.
+  auto const local = localize_helper(shard.arena, text, SHOULD_LOWER);
+  shard.names.insert(local);
+  return local;
+}
+
+bool
+Localizer::can_retain()
+{
+  if (Scoped_Arena != nullptr) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(_retained_sources_mutex);
+  return _retained_sources.size() < MAX_RETAINED_SOURCES;
+}
+
+void
+Localizer::retain(std::shared_ptr<void const> source, size_t size)
+{
+  std::lock_guard<std::mutex> lock(_retained_sources_mutex);
+  _retained_sources.emplace_back(std::move(source));
+  _retained_bytes += size;
 }
 
 swoc::TextView
-Localizer::localize(TextView text, Encoding enc)
+Localizer::localize_retained(TextView text)
 {
   assert(!_frozen);
+  return text;
+}
+
+swoc::TextView
+Localizer::localize(TextView text, Encoding enc)
+{
+  assert(!_frozen || Scoped_Arena != nullptr);
   if (Encoding::URI == enc) {
-    auto span{_arena.require(text.size()).remnant().rebind<char>()};
+    auto &arena = get_localization_arena();
+    auto span{arena.require(text.size()).remnant().rebind<char>()};
     auto spot = text.begin(), limit = text.end();
     char *dst = span.begin();
     while (spot < limit) {
@@ -98,7 +227,7 @@ Localizer::localize(TextView text, Encoding enc)
       }
     }
     TextView text{span.data(), dst};
-    _arena.alloc(text.size());
+    arena.alloc(text.size());
     return text;
   }
   return localize(text);
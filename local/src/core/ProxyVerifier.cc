@@ -20,6 +20,7 @@
 #include <sstream>
 #include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <string>
 #include <thread>
@@ -220,6 +221,110 @@ Resolve_FQDN(swoc::TextView fqdn)
   return zret;
 }
 
+/** The process's file mode creation mask.
+ *
+ * umask can only be read by setting it, so it is read once during static
+ * initialization, before any threads create files.
+ */
+static mode_t const Process_Umask = []() {
+  auto const mask = umask(0);
+  umask(mask);
+  return mask;
+}();
+
+swoc::Errata
+write_file_atomically(
+    swoc::file::path const &path,
+    std::string_view description,
+    std::function<bool(FILE *)> const &write)
+{
+  swoc::Errata errata;
+  std::string tmp_path = path.string() + ".XXXXXX";
+  int const fd = mkstemp(tmp_path.data());
+  if (fd < 0) {
+    errata.note(
+        S_ERROR,
+        R"(Could not create a temporary file for the {} "{}": {})",
+        description,
+        path,
+        swoc::bwf::Errno{});
+    return errata;
+  }
+  // mkstemp creates the file readable only by its owner. Give it the
+  // permissions fopen would under the process's umask.
+  fchmod(fd, 0666 & ~Process_Umask);
+  FILE *out = fdopen(fd, "wb");
+  if (out == nullptr) {
+    errata.note(S_ERROR, R"(Could not open "{}" for writing: {})", tmp_path, swoc::bwf::Errno{});
+    close(fd);
+    unlink(tmp_path.c_str());
+    return errata;
+  }
+  bool const written = write(out);
+  if (fclose(out) != 0 || !written) {
+    errata.note(
+        S_ERROR,
+        R"(Could not write the {} "{}": {})",
+        description,
+        tmp_path,
+        swoc::bwf::Errno{});
+    unlink(tmp_path.c_str());
+    return errata;
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    errata.note(
+        S_ERROR,
+        R"(Could not rename "{}" to "{}": {})",
+        tmp_path,
+        path,
+        swoc::bwf::Errno{});
+    unlink(tmp_path.c_str());
+  }
+  return errata;
+}
+
+// static
+size_t
+KeyPartition::get_partition(std::string_view key, size_t count)
+{
+  // FNV-1a rather than std::hash: the client and every server must agree on
+  // the owner of a key, even if they were built against different standard
+  // libraries.
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char const c : key) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash % count;
+}
+
+// static
+swoc::Rv<KeyPartition>
+KeyPartition::parse(swoc::TextView spec)
+{
+  swoc::Rv<KeyPartition> zret;
+  swoc::TextView count_text{spec};
+  swoc::TextView const index_text{count_text.take_prefix_at('/')};
+  swoc::TextView parsed_index;
+  swoc::TextView parsed_count;
+  auto const index = swoc::svtou(index_text, &parsed_index, 10);
+  auto const count = swoc::svtou(count_text, &parsed_count, 10);
+  if (index_text.empty() || parsed_index.size() != index_text.size() || count_text.empty() ||
+      parsed_count.size() != count_text.size())
+  {
+    zret.note(S_ERROR, R"(Partition "{}" is not of the form "<index>/<count>".)", spec);
+  } else if (count == 0 || index >= count) {
+    zret.note(
+        S_ERROR,
+        R"(Partition "{}" must have a non-zero count and an index less than the count.)",
+        spec);
+  } else {
+    zret.result().index = index;
+    zret.result().count = count;
+  }
+  return zret;
+}
+
 void
 ThreadPool::wait_for_work(ThreadInfo *thread_info)
 {
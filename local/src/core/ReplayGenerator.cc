@@ -0,0 +1,648 @@
+/** @file
+ * Implementation of ReplayGenerator.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "core/ReplayGenerator.h"
+#include "core/CompiledCorpus.h"
+#include "core/JsonParser.h"
+#include "core/ProxyVerifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+
+#include "swoc/bwf_ex.h"
+#include "swoc/bwf_std.h"
+
+using swoc::Errata;
+using swoc::TextView;
+using namespace swoc::literals;
+
+namespace
+{
+/// The connection time of the first session: 2021-01-01 00:00:00 UTC, in
+/// nanoseconds.
+constexpr uint64_t BASE_CONNECTION_TIME = 1'609'459'200'000'000'000;
+/// The interval between the connection times of consecutive sessions.
+constexpr uint64_t SESSION_INTERVAL = 1'000'000;
+/// The number of hosts of synthesized URLs.
+constexpr uint64_t N_SYNTHESIZED_HOSTS = 100;
+
+/// The names of the protocols in a protocol mix, indexed by Protocol.
+constexpr std::array<TextView, ReplayGenerator::N_PROTOCOLS> PROTOCOL_NAMES{
+    "http"_tv,
+    "https"_tv,
+    "h2"_tv,
+};
+
+/** A deterministic random number generator.
+ *
+ * This is splitmix64 rather than a standard library engine and distribution
+ * because the standard distributions are free to differ between library
+ * implementations, and generated corpora must be the same wherever they are
+ * generated.
+ */
+class Random
+{
+public:
+  explicit Random(uint64_t seed) : _state{seed} { }
+
+  uint64_t
+  next()
+  {
+    uint64_t z = (_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  /// A number below @a n, which must not be zero.
+  uint64_t
+  below(uint64_t n)
+  {
+    // The bias of the modulus is negligible for the small ranges drawn here.
+    return next() % n;
+  }
+
+  /// A number in @a range.
+  size_t
+  draw(ReplayGenerator::Range const &range)
+  {
+    return range.min + below(range.max - range.min + 1);
+  }
+
+  /// Whether an event of probability 1 / @a n happens.
+  bool
+  one_in(uint64_t n)
+  {
+    return below(n) == 0;
+  }
+
+private:
+  uint64_t _state;
+};
+
+/// Writes the JSON text of a replay file.
+class FileWriter
+{
+public:
+  FileWriter(ReplayGenerator::Options const &options, uint64_t seed)
+    : _options{options}
+    , _rng{seed}
+  {
+  }
+
+  ReplayGenerator::Options const &_options;
+  Random _rng;
+  std::string _text;
+
+  /// Append literal JSON text.
+  FileWriter &
+  raw(TextView text)
+  {
+    _text.append(text.data(), text.size());
+    return *this;
+  }
+
+  /// Append a JSON number.
+  FileWriter &
+  number(uint64_t n)
+  {
+    char digits[20];
+    char *const end = digits + sizeof(digits);
+    char *p = end;
+    do {
+      *--p = static_cast<char>('0' + n % 10);
+      n /= 10;
+    } while (n > 0);
+    _text.append(p, end - p);
+    return *this;
+  }
+
+  /// Append a JSON string.
+  FileWriter &
+  string(TextView text)
+  {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    _text += '"';
+    for (char const c : text) {
+      if (c == '"' || c == '\\') {
+        _text += '\\';
+        _text += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        _text += "\\u00";
+        _text += HEX_DIGITS[c >> 4];
+        _text += HEX_DIGITS[c & 0xf];
+      } else {
+        _text += c;
+      }
+    }
+    _text += '"';
+    return *this;
+  }
+
+  /// Append a header field, a two element array, with a number for a value.
+  FileWriter &
+  field(TextView name, uint64_t value)
+  {
+    raw(", ["_tv).string(name).raw(", \""_tv).number(value).raw("\"]"_tv);
+    return *this;
+  }
+
+  /// Append a header field, a two element array.
+  FileWriter &
+  field(TextView name, TextView value)
+  {
+    raw(", ["_tv).string(name).raw(", "_tv).string(value).raw("]"_tv);
+    return *this;
+  }
+
+  /// Append the fields added to each message beyond those its protocol
+  /// requires, with random values.
+  void
+  added_fields()
+  {
+    static constexpr char VALUE_CHARS[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    auto const n_fields = _rng.draw(_options.header_count);
+    for (size_t i = 0; i < n_fields; ++i) {
+      raw(", [\"X-Gen-"_tv).number(i).raw("\", \""_tv);
+      auto const size = _rng.draw(_options.header_size);
+      // Each draw supplies ten characters of six bits each.
+      for (size_t j = 0; j < size; j += 10) {
+        uint64_t bits = _rng.next();
+        for (size_t k = j; k < std::min(size, j + 10); ++k, bits >>= 6) {
+          _text += VALUE_CHARS[bits & 0x3f];
+        }
+      }
+      raw("\"]"_tv);
+    }
+  }
+
+  /// Append a random version 4 UUID.
+  FileWriter &
+  uuid()
+  {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    uint64_t const high = (_rng.next() & ~0xf000ULL) | 0x4000ULL;
+    uint64_t const low = (_rng.next() & ~(3ULL << 62)) | (2ULL << 62);
+    _text += '"';
+    for (int i = 0; i < 32; ++i) {
+      if (i == 8 || i == 12 || i == 16 || i == 20) {
+        _text += '-';
+      }
+      uint64_t const half = i < 16 ? high : low;
+      _text += HEX_DIGITS[(half >> (60 - 4 * (i % 16))) & 0xf];
+    }
+    _text += '"';
+    return *this;
+  }
+};
+
+/// The host and path of a URL, without its scheme, query, or fragment.
+struct UrlParts
+{
+  TextView host;
+  TextView path;
+};
+
+UrlParts
+split_url(TextView url)
+{
+  if (auto const scheme_end = url.find("://"); scheme_end != TextView::npos) {
+    url.remove_prefix(scheme_end + 3);
+  }
+  if (auto const fragment = url.find('#'); fragment != TextView::npos) {
+    url.remove_suffix(url.size() - fragment);
+  }
+  auto const path_start = url.find('/');
+  UrlParts parts;
+  parts.host = url.prefix(path_start);
+  parts.path = path_start == TextView::npos ? "/"_tv : url.remove_prefix(path_start);
+  return parts;
+}
+
+/** Seed the random number sequence of a file.
+ *
+ * The sequence depends only on the generation seed and the file's index, so
+ * files can be generated in any order.
+ */
+uint64_t
+get_file_seed(uint64_t seed, size_t index)
+{
+  Random mix{seed ^ (0x9e3779b97f4a7c15ULL * (index + 1))};
+  return mix.next();
+}
+
+/// Draw a protocol by its weight.
+ReplayGenerator::Protocol
+draw_protocol(Random &rng, std::array<unsigned, ReplayGenerator::N_PROTOCOLS> const &weights)
+{
+  uint64_t total_weight = 0;
+  for (auto const weight : weights) {
+    total_weight += weight;
+  }
+  if (total_weight == 0) {
+    return ReplayGenerator::Protocol::HTTP;
+  }
+  auto pick = rng.below(total_weight);
+  size_t index = 0;
+  while (pick >= weights[index]) {
+    pick -= weights[index++];
+  }
+  return static_cast<ReplayGenerator::Protocol>(index);
+}
+
+/// Append the JSON text of a request or response message.
+void
+message(
+    FileWriter &writer,
+    bool is_request,
+    ReplayGenerator::Protocol protocol,
+    TextView scheme,
+    TextView host,
+    TextView path)
+{
+  auto &rng = writer._rng;
+  bool const is_http2 = protocol == ReplayGenerator::Protocol::HTTP2;
+  size_t body_size = 0;
+  if (is_request) {
+    bool const is_post = rng.one_in(2);
+    TextView const method = is_post ? "POST"_tv : "GET"_tv;
+    body_size = is_post ? rng.draw(writer._options.request_body_size) : 0;
+    if (is_http2) {
+      writer.raw(R"({"headers": {"fields": [[":method", ")"_tv).raw(method).raw("\"]"_tv);
+      writer.field(":scheme"_tv, scheme).field(":authority"_tv, host).field(":path"_tv, path);
+    } else {
+      writer.raw(R"({"method": ")"_tv).raw(method).raw(R"(", "scheme": ")"_tv).raw(scheme);
+      writer.raw(R"(", "url": )"_tv).string(path).raw(R"(, "version": "1.1", )"_tv);
+      writer.raw(R"("headers": {"fields": [["Host", )"_tv).string(host).raw("]"_tv);
+    }
+    if (is_post) {
+      writer.field("Content-Type"_tv, "text/html"_tv).field("Content-Length"_tv, body_size);
+    }
+  } else {
+    bool const is_ok = rng.one_in(2);
+    body_size = rng.draw(writer._options.response_body_size);
+    if (is_http2) {
+      writer.raw(R"({"headers": {"fields": [[":status", ")"_tv).number(is_ok ? 200 : 404);
+      writer.raw("\"]"_tv);
+    } else {
+      writer.raw(R"({"status": )"_tv).number(is_ok ? 200 : 404);
+      writer.raw(R"(, "reason": ")"_tv).raw(is_ok ? "OK"_tv : "Not Found"_tv);
+      writer.raw(R"(", "headers": {"fields": [["Connection", ")"_tv);
+      writer.raw(rng.one_in(11) ? "close"_tv : "keep-alive"_tv).raw("\"]"_tv);
+    }
+    writer.field("Content-Type"_tv, "text/html"_tv).field("Content-Length"_tv, body_size);
+  }
+  writer.added_fields();
+  writer.raw(R"(]}, "content": {"encoding": "plain", "size": )"_tv).number(body_size).raw("}}"_tv);
+}
+} // namespace
+
+swoc::Rv<ReplayGenerator::Range>
+ReplayGenerator::Range::parse(TextView text)
+{
+  swoc::Rv<Range> zret;
+  TextView const original{text};
+  TextView max_text{text.trim_if(&isspace)};
+  TextView const min_text{max_text.take_prefix_at('-').trim_if(&isspace)};
+  if (max_text.trim_if(&isspace).empty() && original.find('-') == TextView::npos) {
+    max_text = min_text;
+  }
+  TextView parsed_min;
+  TextView parsed_max;
+  auto &range = zret.result();
+  range.min = swoc::svtou(min_text, &parsed_min, 10);
+  range.max = swoc::svtou(max_text, &parsed_max, 10);
+  if (min_text.empty() || parsed_min.size() != min_text.size() || max_text.empty() ||
+      parsed_max.size() != max_text.size() || range.min > range.max)
+  {
+    zret.note(S_ERROR, R"("{}" is not a number or a range of numbers such as "1-1000".)", original);
+  }
+  return zret;
+}
+
+Errata
+ReplayGenerator::parse_protocol_mix(TextView text, std::array<unsigned, N_PROTOCOLS> &weights)
+{
+  Errata errata;
+  weights.fill(0);
+  while (!text.ltrim_if(&isspace).empty()) {
+    TextView weight_text{text.take_prefix_at(',').trim_if(&isspace)};
+    TextView const name{weight_text.take_prefix_at(':').trim_if(&isspace)};
+    auto const spot =
+        std::find_if(PROTOCOL_NAMES.begin(), PROTOCOL_NAMES.end(), [&name](TextView candidate) {
+          return 0 == strcasecmp(candidate, name);
+        });
+    if (spot == PROTOCOL_NAMES.end()) {
+      errata.note(S_ERROR, R"("{}" is not a protocol: expected "http", "https", or "h2".)", name);
+      continue;
+    }
+    unsigned weight = 1;
+    if (!weight_text.trim_if(&isspace).empty()) {
+      TextView parsed;
+      weight = static_cast<unsigned>(swoc::svtou(weight_text, &parsed, 10));
+      if (parsed.size() != weight_text.size()) {
+        errata.note(S_ERROR, R"("{}" is not a weight for protocol "{}".)", weight_text, name);
+        continue;
+      }
+    }
+    weights[spot - PROTOCOL_NAMES.begin()] = weight;
+  }
+  if (errata.is_ok() &&
+      std::all_of(weights.begin(), weights.end(), [](unsigned weight) { return weight == 0; }))
+  {
+    errata.note(S_ERROR, "The protocol mix must give at least one protocol a weight.");
+  }
+  return errata;
+}
+
+swoc::Rv<std::vector<std::string>>
+ReplayGenerator::load_urls(swoc::file::path const &path)
+{
+  swoc::Rv<std::vector<std::string>> zret;
+  std::error_code ec;
+  std::string const content = swoc::file::load(path, ec);
+  if (ec) {
+    zret.note(S_ERROR, R"(Could not read the URL list "{}": {}.)", path, ec);
+    return zret;
+  }
+  TextView lines{content};
+  while (!lines.empty()) {
+    TextView const line = lines.take_prefix_at('\n').trim_if(&isspace);
+    if (!line.empty() && line.front() != '#') {
+      zret.result().emplace_back(line);
+    }
+  }
+  if (zret.result().empty()) {
+    zret.note(S_ERROR, R"(The URL list "{}" lists no URLs.)", path);
+  }
+  return zret;
+}
+
+std::vector<ReplayGenerator::FilePlan>
+ReplayGenerator::plan(Options const &options)
+{
+  std::vector<FilePlan> files;
+  Random rng{options.seed};
+  size_t remaining = options.transactions;
+  size_t n_sessions = 0;
+  while (remaining > 0) {
+    auto &file = files.emplace_back();
+    file.index = files.size() - 1;
+    file.first_session = n_sessions;
+    auto const n_file_sessions = std::max<size_t>(1, rng.draw(options.file_sessions));
+    for (size_t i = 0; i < n_file_sessions && remaining > 0; ++i) {
+      auto const n_transactions =
+          std::min(remaining, std::max<size_t>(1, rng.draw(options.session_transactions)));
+      file.session_transactions.push_back(n_transactions);
+      remaining -= n_transactions;
+      ++n_sessions;
+    }
+  }
+  return files;
+}
+
+void
+ReplayGenerator::generate_file(
+    Options const &options,
+    FilePlan const &file,
+    std::function<void(std::string_view)> const &write)
+{
+  FileWriter writer{options, get_file_seed(options.seed, file.index)};
+  auto &rng = writer._rng;
+  writer.raw(R"({"meta": {"version": "1.0"}, "sessions": [)"_tv);
+  for (size_t i = 0; i < file.session_transactions.size(); ++i) {
+    size_t const session_index = file.first_session + i;
+    auto const protocol = draw_protocol(rng, options.protocol_weights);
+    // Each session requests one URL from the list, as replay_gen.py does, or
+    // distinct URLs of one synthesized host.
+    UrlParts url;
+    std::string synthesized_host;
+    if (!options.urls.empty()) {
+      url = split_url(options.urls[rng.below(options.urls.size())]);
+    } else {
+      synthesized_host = "host-" + std::to_string(rng.below(N_SYNTHESIZED_HOSTS)) + ".example.com";
+      url.host = synthesized_host;
+    }
+    bool const is_tls = protocol != Protocol::HTTP;
+    TextView const scheme = is_tls ? "https"_tv : "http"_tv;
+
+    writer.raw(i == 0 ? "\n"_tv : ",\n"_tv);
+    writer.raw(R"({"protocol": [{"name": "http", "version": ")"_tv);
+    writer.raw(protocol == Protocol::HTTP2 ? "2\"}"_tv : "1.1\"}"_tv);
+    if (is_tls) {
+      writer.raw(R"(, {"name": "tls", "version": ")"_tv);
+      writer.raw(rng.one_in(2) ? "TLSv1.2"_tv : "TLSv1.3"_tv).raw(R"(", "sni": )"_tv);
+      writer.string(url.host).raw(R"(, "proxy-verify-mode": 0, "proxy-provided-cert": true})"_tv);
+    }
+    writer.raw(R"(, {"name": "tcp"}, {"name": "ip", "version": )"_tv);
+    writer.raw(rng.one_in(2) ? "4}"_tv : "6}"_tv);
+    writer.raw(R"(], "connection-time": )"_tv)
+        .number(BASE_CONNECTION_TIME + session_index * SESSION_INTERVAL);
+    writer.raw(R"(, "transactions": [)"_tv);
+    std::string synthesized_path;
+    for (size_t txn = 0; txn < file.session_transactions[i]; ++txn) {
+      if (options.urls.empty()) {
+        synthesized_path = "/gen/" + std::to_string(session_index) + "/" + std::to_string(txn);
+        url.path = synthesized_path;
+      }
+      writer.raw(txn == 0 ? "\n"_tv : ",\n"_tv);
+      writer.raw(R"({"all": {"headers": {"fields": [["uuid", )"_tv).uuid().raw("]]}}"_tv);
+      // The proxy is expected to pass the messages on unchanged.
+      size_t const request_start = writer._text.size();
+      message(writer, true, protocol, scheme, url.host, url.path);
+      std::string const request = writer._text.substr(request_start);
+      writer._text.resize(request_start);
+      writer.raw(R"(, "client-request": )"_tv).raw(request);
+      writer.raw(R"(, "proxy-request": )"_tv).raw(request);
+      size_t const response_start = writer._text.size();
+      message(writer, false, protocol, scheme, url.host, url.path);
+      std::string const response = writer._text.substr(response_start);
+      writer._text.resize(response_start);
+      writer.raw(R"(, "server-response": )"_tv).raw(response);
+      writer.raw(R"(, "proxy-response": )"_tv).raw(response).raw("}"_tv);
+    }
+    writer.raw("]}"_tv);
+    if (i + 1 < file.session_transactions.size()) {
+      write(writer._text);
+      writer._text.clear();
+    }
+  }
+  writer.raw("\n]}\n"_tv);
+  write(writer._text);
+}
+
+std::string
+ReplayGenerator::generate_file(Options const &options, FilePlan const &file)
+{
+  std::string text;
+  generate_file(options, file, [&text](std::string_view piece) { text.append(piece); });
+  return text;
+}
+
+std::string
+ReplayGenerator::get_file_name(Options const &options, size_t index, size_t n_files)
+{
+  size_t width = 1;
+  for (size_t n = n_files > 0 ? n_files - 1 : 0; n >= 10; n /= 10) {
+    ++width;
+  }
+  auto const digits = std::to_string(index);
+  return options.prefix + std::string(width > digits.size() ? width - digits.size() : 0, '0') +
+         digits + ".json";
+}
+
+Errata
+ReplayGenerator::generate(Options const &options, swoc::file::path const &output)
+{
+  Errata errata;
+  auto const start = std::chrono::steady_clock::now();
+  auto const files = plan(options);
+  if (files.empty()) {
+    errata.note(S_ERROR, "No transactions to generate.");
+    return errata;
+  }
+  if (options.format == Format::JSON) {
+    std::error_code ec;
+    auto const stat = swoc::file::status(output, ec);
+    if (ec && mkdir(output.c_str(), 0755) != 0) {
+      errata.note(S_ERROR, R"(Could not create "{}": {}.)", output, swoc::bwf::Errno{});
+      return errata;
+    } else if (!ec && !swoc::file::is_dir(stat)) {
+      errata.note(S_ERROR, R"("{}" is not a directory.)", output);
+      return errata;
+    }
+  }
+
+  int n_threads = options.n_threads > 0
+                      ? options.n_threads
+                      : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  n_threads = static_cast<int>(std::min<size_t>(n_threads, files.size()));
+
+  // The compiled corpus is built from the files' trees in file order, so that
+  // it does not depend on the order in which the threads finish. The threads
+  // hand the trees to this thread through a window of pending trees, which it
+  // adds to the corpus as they arrive in order. A thread does not start a
+  // file beyond the window, so only a few trees are held at once rather than
+  // those of every file.
+  size_t const n_pending_slots = 2 * static_cast<size_t>(n_threads);
+  std::vector<YAML::Node> pending_roots(options.format == Format::CORPUS ? n_pending_slots : 0);
+  std::vector<bool> is_pending(pending_roots.size(), false);
+  // The next file to add to the corpus.
+  size_t next_root = 0;
+  std::mutex roots_mutex;
+  std::condition_variable roots_cvar;
+  std::atomic<size_t> next_file{0};
+  std::atomic<size_t> n_bytes{0};
+  std::mutex errata_mutex;
+  auto generate_files = [&]() {
+    Errata thread_errata;
+    for (size_t i = next_file++; i < files.size(); i = next_file++) {
+      auto const name = get_file_name(options, i, files.size());
+      if (options.format == Format::CORPUS) {
+        {
+          std::unique_lock<std::mutex> lock(roots_mutex);
+          roots_cvar.wait(lock, [&]() { return i < next_root + n_pending_slots; });
+        }
+        auto const text = generate_file(options, files[i]);
+        n_bytes += text.size();
+        bool has_merge_key = false;
+        auto &&[root, parse_errata] = JsonParser::parse(text, has_merge_key);
+        thread_errata.note(std::move(parse_errata));
+        {
+          std::lock_guard<std::mutex> lock(roots_mutex);
+          // Assigning to a node would write through to the tree it refers to.
+          pending_roots[i % n_pending_slots].reset(root);
+          is_pending[i % n_pending_slots] = true;
+        }
+        roots_cvar.notify_all();
+        continue;
+      }
+      auto const path = output / swoc::file::path{name};
+      FILE *out = fopen(path.c_str(), "w");
+      if (out == nullptr) {
+        thread_errata.note(
+            S_ERROR,
+            R"(Could not open "{}" for writing: {})",
+            path,
+            swoc::bwf::Errno{});
+        break;
+      }
+      bool written = true;
+      generate_file(options, files[i], [&](std::string_view piece) {
+        written = written && fwrite(piece.data(), 1, piece.size(), out) == piece.size();
+        n_bytes += piece.size();
+      });
+      if (fclose(out) != 0 || !written) {
+        thread_errata.note(S_ERROR, R"(Could not write "{}": {})", path, swoc::bwf::Errno{});
+        break;
+      }
+    }
+    std::lock_guard<std::mutex> lock(errata_mutex);
+    errata.note(std::move(thread_errata));
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(n_threads);
+  for (int i = 0; i < n_threads; ++i) {
+    threads.emplace_back(generate_files);
+  }
+  CompiledCorpus::Builder builder;
+  if (options.format == Format::CORPUS) {
+    for (size_t i = 0; i < files.size(); ++i) {
+      YAML::Node root;
+      {
+        std::unique_lock<std::mutex> lock(roots_mutex);
+        auto const slot = i % n_pending_slots;
+        roots_cvar.wait(lock, [&]() { return is_pending[slot]; });
+        root.reset(pending_roots[slot]);
+        pending_roots[slot].reset();
+        is_pending[slot] = false;
+        ++next_root;
+      }
+      roots_cvar.notify_all();
+      builder.add_file(get_file_name(options, i, files.size()), root);
+    }
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (!errata.is_ok()) {
+    return errata;
+  }
+  if (options.format == Format::CORPUS) {
+    errata.note(builder.write(output));
+    if (!errata.is_ok()) {
+      return errata;
+    }
+  }
+
+  auto const duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  size_t const n_sessions = files.back().first_session + files.back().session_transactions.size();
+  errata.note(
+      S_INFO,
+      R"(Generated {} transaction{} in {} session{} and {} file{} ({} bytes of JSON) into "{}" )"
+      "in {} with seed {}: {} transactions per second.",
+      options.transactions,
+      swoc::bwf::If(options.transactions != 1, "s"),
+      n_sessions,
+      swoc::bwf::If(n_sessions != 1, "s"),
+      files.size(),
+      swoc::bwf::If(files.size() != 1, "s"),
+      n_bytes.load(),
+      output,
+      duration,
+      options.seed,
+      options.transactions * 1000 / std::max<int64_t>(1, duration.count()));
+  return errata;
+}
@@ -6,15 +6,27 @@
  */
 
 #include "core/YamlParser.h"
+#include "core/CompiledCorpus.h"
+#include "core/CompressedFile.h"
+#include "core/JsonParser.h"
 #include "core/ProxyVerifier.h"
+#include "core/ScalarSource.h"
 #include "core/verification.h"
 
 #include "core/Localizer.h"
 #include "core/yaml_util.h"
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <openssl/evp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 #include "swoc/bwf_ex.h"
@@ -36,6 +48,111 @@ using ClockType = std::chrono::system_clock;
 using TimePoint = std::chrono::time_point<ClockType, nanoseconds>;
 
 TimePoint YamlParser::_parsing_start_time{};
+std::atomic<size_t> YamlParser::_num_parsed_files{0};
+std::atomic<size_t> YamlParser::_num_parsed_transactions{0};
+std::atomic<size_t> YamlParser::_num_skipped_transactions{0};
+std::atomic<size_t> YamlParser::_num_cached_files{0};
+swoc::file::path YamlParser::_parse_cache_dir;
+std::atomic<size_t> YamlParser::_num_parsed_bytes{0};
+YamlParser::ParseStats YamlParser::_compressed_stats;
+YamlParser::ParseStats YamlParser::_uncompressed_stats;
+int YamlParser::_num_parsing_threads = 1;
+std::shared_ptr<CompiledCorpus const> YamlParser::_compiled_corpus;
+bool YamlParser::_is_compiled_corpus_retained = false;
+
+/// The index of the load_replay_files thread running on this thread.
+static thread_local int Loader_Thread_Index = 0;
+
+/// The smallest replay file load_split_file splits. Smaller files are not
+/// worth the threads.
+static constexpr size_t MIN_SPLIT_FILE_SIZE = 1 << 20;
+
+/// The smallest replay file parse_replay_file maps rather than reads. The
+/// mappings of smaller files would waste most of their last page.
+static constexpr size_t MIN_MAPPED_FILE_SIZE = 1 << 16;
+
+/** A read-only mapping of a replay file, unmapped on destruction.
+ *
+ * A private mapping is not a snapshot: writing the file in place changes
+ * the mapped values, and reading pages past the end of a truncated file
+ * raises SIGBUS. A mapped file should thus only be replaced by renaming a
+ * new file over it, which leaves the mapping with the previous file.
+ * Loading within a Localizer::ScopedArena, as the Verifier Server does,
+ * reads files rather than mapping them.
+ */
+class MappedFile
+{
+public:
+  MappedFile(char const *data, size_t size) : _data{data}, _size{size} { }
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+  ~MappedFile() { munmap(const_cast<char *>(_data), _size); }
+
+  /** Map a replay file.
+   *
+   * @return The mapping, or nullptr if the file is smaller than
+   * MIN_MAPPED_FILE_SIZE or cannot be mapped, in which case it should be
+   * read instead.
+   */
+  static std::shared_ptr<MappedFile>
+  map(swoc::file::path const &path)
+  {
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return nullptr;
+    }
+    struct stat file_stat;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &file_stat) == 0 &&
+        static_cast<size_t>(file_stat.st_size) >= MIN_MAPPED_FILE_SIZE)
+    {
+      data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+      return nullptr;
+    }
+    return std::make_shared<MappedFile>(
+        static_cast<char const *>(data),
+        static_cast<size_t>(file_stat.st_size));
+  }
+
+  TextView
+  get_text() const
+  {
+    return {_data, _size};
+  }
+
+private:
+  char const *const _data;
+  size_t const _size;
+};
+
+/** Localize the value of a scalar node, referring to its source (see
+ * ScalarSource) rather than copying it if it has one.
+ */
+static TextView
+localize_value(YAML::Node const &node)
+{
+  if (auto const source = ScalarSource::get(node); !source.empty()) {
+    return Localizer::localize_retained(source);
+  }
+  return Localizer::localize(node.Scalar());
+}
+
+/** A chunk of the sessions of a replay file split by load_split_file. */
+struct ReplayFileChunk
+{
+  /// The replay file.
+  swoc::file::path path;
+  /// A tree whose sessions node holds the chunk's sessions.
+  YAML::Node root;
+  /// The file's global field rules, shared by all of its chunks.
+  std::shared_ptr<HttpFields> global_fields_rules;
+};
+
+/// The chunk load_replay_file loads on this thread, if any.
+static thread_local ReplayFileChunk const *Loading_Chunk = nullptr;
 
 swoc::Rv<microseconds>
 interpret_delay_string(TextView src)
@@ -92,14 +209,15 @@ Errata
 YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
 {
   Errata errata;
+  YamlKeyMap const keys{node};
 
-  if (node[YAML_HTTP_VERSION_KEY]) {
-    message._http_version = Localizer::localize_lower(node[YAML_HTTP_VERSION_KEY].Scalar());
+  if (auto const *version_node = keys.find(YamlKey::VERSION); version_node) {
+    message._http_version = Localizer::localize_lower(version_node->Scalar());
   } else {
     message._http_version = "1.1";
   }
-  if (node[YAML_HTTP2_KEY]) {
-    auto http2_node{node[YAML_HTTP2_KEY]};
+  if (auto const *http2_node_ptr = keys.find(YamlKey::HTTP2); http2_node_ptr) {
+    auto const &http2_node{*http2_node_ptr};
     if (http2_node.IsMap()) {
       if (http2_node[YAML_HTTP_STREAM_ID_KEY]) {
         auto http_stream_id_node{http2_node[YAML_HTTP_STREAM_ID_KEY]};
@@ -134,9 +252,9 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
     }
   }
 
-  if (node[YAML_HTTP_STATUS_KEY]) {
+  if (auto const *status_node_ptr = keys.find(YamlKey::STATUS); status_node_ptr) {
     message.set_is_response();
-    auto status_node{node[YAML_HTTP_STATUS_KEY]};
+    auto const &status_node{*status_node_ptr};
     if (status_node.IsScalar()) {
       TextView text{status_node.Scalar()};
       TextView parsed;
@@ -161,10 +279,10 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
     }
   }
 
-  if (node[YAML_HTTP_REASON_KEY]) {
-    auto reason_node{node[YAML_HTTP_REASON_KEY]};
+  if (auto const *reason_node_ptr = keys.find(YamlKey::REASON); reason_node_ptr) {
+    auto const &reason_node{*reason_node_ptr};
     if (reason_node.IsScalar()) {
-      message._reason = Localizer::localize(reason_node.Scalar());
+      message._reason = localize_value(reason_node);
     } else {
       errata.note(
           S_ERROR,
@@ -174,10 +292,10 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
     }
   }
 
-  if (node[YAML_HTTP_METHOD_KEY]) {
-    auto method_node{node[YAML_HTTP_METHOD_KEY]};
+  if (auto const *method_node_ptr = keys.find(YamlKey::METHOD); method_node_ptr) {
+    auto const &method_node{*method_node_ptr};
     if (method_node.IsScalar()) {
-      message._method = Localizer::localize(method_node.Scalar());
+      message._method = localize_value(method_node);
       message.set_is_request();
     } else {
       errata.note(
@@ -188,10 +306,10 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
     }
   }
 
-  if (node[YAML_HTTP_URL_KEY]) {
-    auto url_node{node[YAML_HTTP_URL_KEY]};
+  if (auto const *url_node_ptr = keys.find(YamlKey::URL); url_node_ptr) {
+    auto const &url_node{*url_node_ptr};
     if (url_node.IsScalar()) {
-      message._url = Localizer::localize(url_node.Scalar());
+      message._url = localize_value(url_node);
       message.parse_url(message._url);
     } else if (url_node.IsSequence()) {
       errata.note(parse_url_rules(url_node, *message._fields_rules, message._verify_strictly));
@@ -204,10 +322,10 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
     }
   }
 
-  if (node[YAML_HTTP_SCHEME_KEY]) {
-    auto scheme_node{node[YAML_HTTP_SCHEME_KEY]};
+  if (auto const *scheme_node_ptr = keys.find(YamlKey::SCHEME); scheme_node_ptr) {
+    auto const &scheme_node{*scheme_node_ptr};
     if (scheme_node.IsScalar()) {
-      message._scheme = Localizer::localize(scheme_node.Scalar());
+      message._scheme = localize_value(scheme_node);
     } else {
       errata.note(
           S_ERROR,
@@ -217,10 +335,9 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
     }
   }
 
-  if (node[YAML_HDR_KEY]) {
-    auto hdr_node{node[YAML_HDR_KEY]};
-    if (hdr_node[YAML_FIELDS_KEY]) {
-      auto field_list_node{hdr_node[YAML_FIELDS_KEY]};
+  if (auto const *hdr_node = keys.find(YamlKey::HEADERS); hdr_node) {
+    if ((*hdr_node)[YAML_FIELDS_KEY]) {
+      auto field_list_node{(*hdr_node)[YAML_FIELDS_KEY]};
       Errata result =
           parse_fields_and_rules(field_list_node, *message._fields_rules, message._verify_strictly);
       if (result.is_ok()) {
@@ -245,10 +362,12 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
   }
 
   // Do this after parsing fields so it can override transfer encoding.
-  if (auto content_node{node[YAML_CONTENT_KEY]}; content_node) {
+  if (auto const *content_node_ptr = keys.find(YamlKey::CONTENT); content_node_ptr) {
+    auto const &content_node{*content_node_ptr};
     if (content_node.IsMap()) {
-      if (auto xf_node{content_node[YAML_CONTENT_TRANSFER_KEY]}; xf_node) {
-        TextView xf{xf_node.Scalar()};
+      YamlKeyMap const content_keys{content_node};
+      if (auto const *xf_node = content_keys.find(YamlKey::TRANSFER); xf_node) {
+        TextView xf{xf_node->Scalar()};
         if (0 == strcasecmp("chunked"_tv, xf)) {
           message._chunked_p = true;
         } else if (0 == strcasecmp("plain"_tv, xf)) {
@@ -263,24 +382,26 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
               R"(Invalid value "{}" for "{}" key at {} in "{}" node at {})",
               xf,
               YAML_CONTENT_TRANSFER_KEY,
-              xf_node.Mark(),
+              xf_node->Mark(),
               YAML_CONTENT_KEY,
               content_node.Mark());
         }
       }
-      if (auto data_node{content_node[YAML_CONTENT_DATA_KEY]}; data_node) {
+      if (auto const *data_node = content_keys.find(YamlKey::DATA); data_node) {
         Localizer::Encoding enc{Localizer::Encoding::TEXT};
-        if (auto enc_node{content_node[YAML_CONTENT_ENCODING_KEY]}; enc_node) {
-          TextView text{enc_node.Scalar()};
+        if (auto const *enc_node = content_keys.find(YamlKey::ENCODING); enc_node) {
+          TextView text{enc_node->Scalar()};
           if (0 == strcasecmp("uri"_tv, text)) {
             enc = Localizer::Encoding::URI;
           } else if (0 == strcasecmp("plain"_tv, text)) {
             enc = Localizer::Encoding::TEXT;
           } else {
-            errata.note(S_ERROR, R"(Unknown encoding "{}" at {}.)", text, enc_node.Mark());
+            errata.note(S_ERROR, R"(Unknown encoding "{}" at {}.)", text, enc_node->Mark());
           }
         }
-        TextView content{Localizer::localize(data_node.Scalar(), enc)};
+        TextView content{
+            enc == Localizer::Encoding::TEXT ? localize_value(*data_node)
+                                             : Localizer::localize(data_node->Scalar(), enc)};
         message._content_data = content.data();
         const size_t content_size = content.size();
         message._recorded_content_size = content_size;
@@ -298,19 +419,19 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
           message._content_size = content_size;
         }
 
-        if (auto verify_node(content_node[YAML_CONTENT_VERIFY_KEY]); verify_node) {
-          if (verify_node.IsMap()) {
+        if (auto const *verify_node = content_keys.find(YamlKey::VERIFY); verify_node) {
+          if (verify_node->IsMap()) {
             // Verification is specified as a map, such as:
             // verify: {value: test, as: equal, case: ignore }
             errata.note(parse_body_verification(
-                verify_node,
+                *verify_node,
                 message._content_rule,
                 message._verify_strictly,
                 content));
           }
         }
-      } else if (auto size_node{content_node[YAML_CONTENT_SIZE_KEY]}; size_node) {
-        const size_t content_size = swoc::svtou(size_node.Scalar());
+      } else if (auto const *size_node = content_keys.find(YamlKey::SIZE); size_node) {
+        const size_t content_size = swoc::svtou(size_node->Scalar());
         message._recorded_content_size = content_size;
         // Cross check against previously read content-length header, if any.
         if (message._content_length_p) {
@@ -325,22 +446,22 @@ YamlParser::populate_http_message(YAML::Node const &node, HttpHeader &message)
         } else {
           message._content_size = content_size;
         }
-        if (auto verify_node(content_node[YAML_CONTENT_VERIFY_KEY]); verify_node) {
-          if (verify_node.IsMap()) {
+        if (auto const *verify_node = content_keys.find(YamlKey::VERIFY); verify_node) {
+          if (verify_node->IsMap()) {
             // Verification is specified as a map, such as:
             // verify: {value: test, as: equal, case: ignore }
             errata.note(parse_body_verification(
-                verify_node,
+                *verify_node,
                 message._content_rule,
                 message._verify_strictly));
           }
         }
-      } else if (auto verify_node(content_node[YAML_CONTENT_VERIFY_KEY]); verify_node) {
-        if (verify_node.IsMap()) {
+      } else if (auto const *verify_node = content_keys.find(YamlKey::VERIFY); verify_node) {
+        if (verify_node->IsMap()) {
           // Verification is specified as a map, such as:
           // verify: {value: test, as: equal, case: ignore }
           errata.note(parse_body_verification(
-              verify_node,
+              *verify_node,
               message._content_rule,
               message._verify_strictly));
         }
@@ -392,6 +513,81 @@ YamlParser::parse_global_rules(YAML::Node const &node, HttpFields &fields)
   return errata;
 }
 
+/** Add the field values of a fields node to fields, without localizing them.
+ *
+ * Malformed fields are ignored: populate_http_message reports them if the
+ * transaction is loaded.
+ */
+static void
+add_unparsed_fields(YAML::Node const &fields_node, HttpFields &fields)
+{
+  if (!fields_node.IsSequence()) {
+    return;
+  }
+  auto const add_values = [&fields](TextView name, YAML::Node const &value_node) {
+    if (value_node.IsScalar()) {
+      fields.add_field(name, value_node.Scalar());
+    } else if (value_node.IsSequence()) {
+      for (auto const &value : value_node) {
+        if (value.IsScalar()) {
+          fields.add_field(name, value.Scalar());
+        }
+      }
+    }
+  };
+  for (auto const &node : fields_node) {
+    if (!node.IsSequence() || node.size() < 2 || !node[YAML_RULE_KEY_INDEX].IsScalar()) {
+      continue;
+    }
+    TextView const name{node[YAML_RULE_KEY_INDEX].Scalar()};
+    auto const value_node{node[YAML_RULE_VALUE_INDEX]};
+    if (value_node.IsMap()) {
+      if (auto const field_value_node{value_node[YAML_RULE_VALUE_MAP_KEY]}; field_value_node) {
+        add_values(name, field_value_node);
+      }
+    } else {
+      add_values(name, value_node);
+    }
+  }
+}
+
+/// The fields node of a message or "all" node, or an undefined node.
+static YAML::Node
+get_fields_node(YAML::Node const &node)
+{
+  if (node && node.IsMap()) {
+    if (auto const headers_node{node[YAML_HDR_KEY]}; headers_node && headers_node.IsMap()) {
+      return headers_node[YAML_FIELDS_KEY];
+    }
+  }
+  return YAML::Node{YAML::NodeType::Undefined};
+}
+
+std::string
+YamlParser::derive_transaction_key(
+    YAML::Node const &txn_node,
+    std::string const &request_key,
+    bool include_all_messages)
+{
+  HttpHeader message;
+  if (auto const request_node{txn_node[request_key]}; request_node && request_node.IsMap()) {
+    if (auto const url_node{request_node[YAML_HTTP_URL_KEY]}; url_node && url_node.IsScalar()) {
+      message._url = url_node.Scalar();
+    }
+    if (auto const fields_node{get_fields_node(request_node)}; fields_node) {
+      add_unparsed_fields(fields_node, *message._fields_rules);
+    }
+  }
+  message.derive_key();
+  if (include_all_messages && message.get_key() == HttpHeader::TRANSACTION_KEY_NOT_SET) {
+    if (auto const fields_node{get_fields_node(txn_node[YAML_ALL_MESSAGES_KEY])}; fields_node) {
+      add_unparsed_fields(fields_node, *message._fields_rules);
+      message.derive_key();
+    }
+  }
+  return message.get_key();
+}
+
 Errata
 YamlParser::parse_url_rules(
     YAML::Node const &url_rules_node,
@@ -426,10 +622,9 @@ YamlParser::parse_url_rules(
       // Legacy support for non-map nodes, not/nocase unsupported
       // URL part verification rules can't support multiple values,
       // so there's no IsSequence() case
-      TextView value{Localizer::localize(node[YAML_RULE_VALUE_INDEX].Scalar())};
+      TextView value{localize_value(node[YAML_RULE_VALUE_INDEX])};
       if (node_size == 2 && assume_equality_rule) {
-        fields._url_rules[static_cast<size_t>(part_id)].push_back(
-            RuleCheck::make_equality(part_id, value));
+        fields._url_rules.push_back({part_id, RuleCheck::make_equality(part_id, value)});
       } else if (node_size == 3) {
         // Contains a verification rule.
         TextView rule_type{node[YAML_RULE_TYPE_INDEX].Scalar()};
@@ -442,7 +637,7 @@ YamlParser::parse_url_rules(
               rule_type);
           continue;
         } else {
-          fields._url_rules[static_cast<size_t>(part_id)].push_back(tester);
+          fields._url_rules.push_back({part_id, tester});
         }
       }
     } else if (ValueNode.IsMap()) {
@@ -485,7 +680,7 @@ YamlParser::parse_url_rules(
       if (url_value_node) {
         if (url_value_node.IsScalar()) {
           // Single value
-          value = Localizer::localize(url_value_node.Scalar());
+          value = localize_value(url_value_node);
         } else if (url_value_node.IsSequence()) {
           errata.note(
               S_ERROR,
@@ -504,7 +699,7 @@ YamlParser::parse_url_rules(
             node.Mark(),
             rule_type);
       } else {
-        fields._url_rules[static_cast<size_t>(part_id)].push_back(tester);
+        fields._url_rules.push_back({part_id, tester});
       }
     } else if (ValueNode.IsSequence()) {
       errata.note(
@@ -547,7 +742,7 @@ YamlParser::parse_fields_and_rules(
     if (ValueNode.IsScalar()) {
       // Legacy support for non-map nodes, not/nocase unsupported
       // There's only a single value associated with this field name.
-      TextView value{Localizer::localize(node[YAML_RULE_VALUE_INDEX].Scalar())};
+      TextView value{localize_value(node[YAML_RULE_VALUE_INDEX])};
       fields.add_field(name, value);
       if (node_size == 2 && assume_equality_rule) {
         fields._rules.emplace(name, RuleCheck::make_equality(name, value));
@@ -574,7 +769,7 @@ YamlParser::parse_fields_and_rules(
       std::vector<TextView> values;
       values.reserve(ValueNode.size());
       for (auto const &value : ValueNode) {
-        TextView localized_value{Localizer::localize(value.Scalar())};
+        TextView localized_value{localize_value(value)};
         values.emplace_back(localized_value);
         fields.add_field(name, localized_value);
       }
@@ -638,7 +833,7 @@ YamlParser::parse_fields_and_rules(
       if (field_value_node) {
         if (field_value_node.IsScalar()) {
           // Single value
-          value = Localizer::localize(field_value_node.Scalar());
+          value = localize_value(field_value_node);
           fields.add_field(name, value);
           tester = RuleCheck::make_rule_check(name, value, rule_type, is_inverted, is_nocase);
         } else if (field_value_node.IsSequence()) {
@@ -647,7 +842,7 @@ YamlParser::parse_fields_and_rules(
           std::vector<TextView> values;
           values.reserve(ValueNode.size());
           for (auto const &value : field_value_node) {
-            TextView localized_value{Localizer::localize(value.Scalar())};
+            TextView localized_value{localize_value(value)};
             values.emplace_back(localized_value);
             fields.add_field(name, localized_value);
           }
@@ -721,7 +916,7 @@ YamlParser::parse_body_verification(
   if (body_value_node) {
     if (body_value_node.IsScalar()) {
       // Single value
-      TextView value = Localizer::localize(body_value_node.Scalar());
+      TextView value = localize_value(body_value_node);
       tester = RuleCheck::make_rule_check("body", value, rule_type, is_inverted, is_nocase, true);
     } else if (body_value_node.IsSequence()) {
       errata.note(
@@ -750,18 +945,34 @@ Errata
 YamlParser::parsing_is_started()
 {
   _parsing_start_time = ClockType::now();
+  _num_parsed_files = 0;
+  _num_parsed_transactions = 0;
+  _num_skipped_transactions = 0;
+  _num_cached_files = 0;
+  _num_parsed_bytes = 0;
+  _compressed_stats.reset();
+  _uncompressed_stats.reset();
+  _num_parsing_threads = 1;
   return {};
 }
 
+void
+YamlParser::ParseStats::reset()
+{
+  files = 0;
+  file_bytes = 0;
+  content_bytes = 0;
+  parse_ns = 0;
+}
+
 Errata
 YamlParser::parsing_is_done()
 {
   // Localization should only be done during the YAML parsing stages. Any
   // localization done after this point (such as during the parsing of bytes
   // off the wire) would be a logic error.
-  Localizer::freeze_localization();
+  Errata errata = Localizer::freeze_localization();
 
-  Errata errata;
   auto parsing_duration = ClockType::now() - _parsing_start_time;
   if (parsing_duration > 10s) {
     errata.note(
@@ -774,6 +985,64 @@ YamlParser::parsing_is_done()
         "Replay file parsing took: {} milliseconds.",
         duration_cast<milliseconds>(parsing_duration).count());
   }
+  // Rates are computed in microseconds so sub-second loads report sensibly.
+  uint64_t const parsing_us = std::max<uint64_t>(
+      1,
+      static_cast<uint64_t>(duration_cast<microseconds>(parsing_duration).count()));
+  errata.note(
+      S_INFO,
+      "Parsed {} replay file{} ({} bytes) and {} transaction{} with {} thread{}: {} files/s, {} "
+      "transactions/s, {} MB/s.",
+      _num_parsed_files.load(),
+      swoc::bwf::If(_num_parsed_files != 1, "s"),
+      _num_parsed_bytes.load(),
+      _num_parsed_transactions.load(),
+      swoc::bwf::If(_num_parsed_transactions != 1, "s"),
+      _num_parsing_threads,
+      swoc::bwf::If(_num_parsing_threads != 1, "s"),
+      _num_parsed_files * 1'000'000 / parsing_us,
+      _num_parsed_transactions * 1'000'000 / parsing_us,
+      // Bytes per microsecond are megabytes per second.
+      _num_parsed_bytes / parsing_us);
+  if (_compressed_stats.files > 0) {
+    // These rates are per thread, from the time each thread spent on the
+    // files of the kind, so they compare however the files were spread
+    // across the threads.
+    errata.note(
+        S_INFO,
+        "Parsed {} compressed replay file{} ({} bytes, {} bytes decompressed): {} MB/s of "
+        "decompressed content per thread.",
+        _compressed_stats.files.load(),
+        swoc::bwf::If(_compressed_stats.files != 1, "s"),
+        _compressed_stats.file_bytes.load(),
+        _compressed_stats.content_bytes.load(),
+        // Bytes per nanosecond are gigabytes per second.
+        _compressed_stats.content_bytes * 1000 / std::max<uint64_t>(1, _compressed_stats.parse_ns));
+    if (_uncompressed_stats.files > 0) {
+      errata.note(
+          S_INFO,
+          "Parsed {} uncompressed replay file{} ({} bytes): {} MB/s per thread.",
+          _uncompressed_stats.files.load(),
+          swoc::bwf::If(_uncompressed_stats.files != 1, "s"),
+          _uncompressed_stats.content_bytes.load(),
+          _uncompressed_stats.content_bytes * 1000 /
+              std::max<uint64_t>(1, _uncompressed_stats.parse_ns));
+    }
+  }
+  if (_num_cached_files > 0) {
+    errata.note(
+        S_INFO,
+        R"(Loaded {} of the replay files from the parse cache "{}".)",
+        _num_cached_files.load(),
+        _parse_cache_dir);
+  }
+  if (_num_skipped_transactions > 0) {
+    errata.note(
+        S_INFO,
+        "Skipped {} transaction{} without parsing their messages.",
+        _num_skipped_transactions.load(),
+        swoc::bwf::If(_num_skipped_transactions != 1, "s"));
+  }
   return errata;
 }
 
@@ -1010,6 +1279,169 @@ private:
   ReplayFileHandler &_handler;
 };
 
+swoc::Rv<YAML::Node>
+YamlParser::parse_replay_file(swoc::file::path const &path)
+{
+  swoc::Rv<YAML::Node> zret;
+  auto &root = zret.result();
+  if (auto const compiled_corpus = std::atomic_load(&_compiled_corpus); compiled_corpus) {
+    if (auto const file_id = compiled_corpus->find_file(path.string());
+        file_id != CompiledCorpus::NO_FILE)
+    {
+      root = compiled_corpus->get_root(file_id, _is_compiled_corpus_retained);
+      ++_num_parsed_files;
+      return zret;
+    }
+  }
+  auto const load_start = ClockType::now();
+  bool const is_json = JsonParser::is_json_file(CompressedFile::get_content_path(path));
+  // A large JSON file is mapped rather than read, so that its values can
+  // refer to the mapping instead of being copied (see ScalarSource).
+  std::shared_ptr<MappedFile> mapped_file;
+  if (is_json && !CompressedFile::is_compressed(path) && Localizer::can_retain()) {
+    mapped_file = MappedFile::map(path);
+  }
+  size_t file_size = 0;
+  std::string loaded_content;
+  TextView content;
+  if (mapped_file) {
+    content = mapped_file->get_text();
+    file_size = content.size();
+  } else {
+    auto &&[file_content, load_errata] = load_content(path, file_size);
+    if (!load_errata.is_ok()) {
+      zret.note(std::move(load_errata));
+      return zret;
+    }
+    loaded_content = std::move(file_content);
+    content = loaded_content;
+  }
+  _num_parsed_bytes += content.size();
+  swoc::file::path cache_path;
+  if (!_parse_cache_dir.empty()) {
+    cache_path = get_parse_cache_path(content);
+    // A missing or unreadable cache entry is simply parsed again.
+    if (auto &&[cached, cache_errata] = CompiledCorpus::open(cache_path);
+        cached && cached->get_file_count() == 1)
+    {
+      root = cached->get_root(0);
+      ++_num_parsed_files;
+      ++_num_cached_files;
+      count_parsed_file(path, file_size, content.size(), ClockType::now() - load_start);
+      return zret;
+    }
+  }
+  bool is_parsed = false;
+  if (is_json) {
+    bool has_merge_key = false;
+    auto &&[json_root, json_errata] =
+        JsonParser::parse(content, has_merge_key, mapped_file != nullptr);
+    if (json_errata.is_ok()) {
+      root = json_root;
+      if (has_merge_key) {
+        yaml_merge(root);
+      }
+      if (mapped_file) {
+        // The tree's values refer to the mapping.
+        Localizer::retain(mapped_file, content.size());
+      }
+      is_parsed = true;
+    } else {
+      // The file may use YAML syntax beyond JSON, which YAML::Load accepts.
+      zret.note(S_DIAG, R"("{}" is not valid JSON, parsing it as YAML instead.)", path);
+    }
+  }
+  if (!is_parsed) {
+    if (mapped_file) {
+      // YAML::Load takes only strings and streams.
+      loaded_content.assign(content.data(), content.size());
+    }
+    try {
+      root = YAML::Load(loaded_content);
+      yaml_merge(root);
+      is_parsed = true;
+    } catch (std::exception const &ex) {
+      zret.note(S_ERROR, R"(Exception: {} in "{}".)", ex.what(), path);
+    }
+  }
+  if (is_parsed) {
+    ++_num_parsed_files;
+    count_parsed_file(path, file_size, content.size(), ClockType::now() - load_start);
+    if (!cache_path.empty()) {
+      // Threads parsing files of the same content write the same bytes to
+      // the entry, so they need not coordinate.
+      CompiledCorpus::Builder builder;
+      builder.add_file(path.string(), root);
+      if (!builder.write(cache_path).is_ok()) {
+        zret.note(S_DIAG, R"(Could not write the parse cache entry "{}".)", cache_path);
+      }
+    }
+  }
+  return zret;
+}
+
+swoc::Rv<std::string>
+YamlParser::load_content(swoc::file::path const &path, size_t &file_size)
+{
+  if (CompressedFile::is_compressed(path)) {
+    return CompressedFile::load(path, file_size);
+  }
+  swoc::Rv<std::string> zret;
+  std::error_code ec;
+  zret.result() = swoc::file::load(path, ec);
+  if (ec.value()) {
+    zret.note(S_ERROR, R"(Error loading "{}": {})", path, ec);
+  }
+  file_size = zret.result().size();
+  return zret;
+}
+
+void
+YamlParser::count_parsed_file(
+    swoc::file::path const &path,
+    size_t file_size,
+    size_t content_size,
+    std::chrono::nanoseconds parse_time)
+{
+  auto &stats = CompressedFile::is_compressed(path) ? _compressed_stats : _uncompressed_stats;
+  ++stats.files;
+  stats.file_bytes += file_size;
+  stats.content_bytes += content_size;
+  stats.parse_ns += static_cast<uint64_t>(parse_time.count());
+}
+
+Errata
+YamlParser::set_parse_cache_dir(swoc::file::path const &dir)
+{
+  Errata errata;
+  std::error_code ec;
+  if (!dir.empty() && !swoc::file::is_dir(swoc::file::status(dir, ec))) {
+    errata.note(S_ERROR, R"(The parse cache "{}" is not a directory.)", dir);
+    return errata;
+  }
+  _parse_cache_dir = dir;
+  return errata;
+}
+
+swoc::file::path
+YamlParser::get_parse_cache_path(swoc::TextView content)
+{
+  // A hit is not compared with the content, so the entry is named by a
+  // cryptographic digest of it: files of different content never share one.
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_size = 0;
+  if (!EVP_Digest(content.data(), content.size(), digest, &digest_size, EVP_sha256(), nullptr)) {
+    // Without a digest the file is simply parsed rather than cached.
+    return {};
+  }
+  swoc::LocalBufferWriter<2 * EVP_MAX_MD_SIZE + 16> w;
+  for (unsigned int i = 0; i < digest_size; ++i) {
+    w.print("{:02x}", static_cast<unsigned int>(digest[i]));
+  }
+  w.write(".pvcache");
+  return _parse_cache_dir / swoc::file::path{std::string{w.view()}};
+}
+
 Errata
 YamlParser::load_replay_file(swoc::file::path const &path, ReplayFileHandler &handler)
 {
@@ -1018,35 +1450,49 @@ YamlParser::load_replay_file(swoc::file::path const &path, ReplayFileHandler &ha
   if (!errata.is_ok()) {
     return errata;
   }
-  std::error_code ec;
-  std::string content{swoc::file::load(path, ec)};
-  if (ec.value()) {
-    errata.note(S_ERROR, R"(Error loading "{}": {})", path, ec);
+  if (Loading_Chunk != nullptr && Loading_Chunk->path.string() == path.string()) {
+    // load_split_file has parsed the file's meta node and this thread's chunk
+    // of its sessions.
+    handler.global_config = VerificationConfig{Loading_Chunk->global_fields_rules};
+    errata.note(load_sessions(path, Loading_Chunk->root, handler));
     return errata;
   }
-  YAML::Node root;
-  auto global_fields_rules = std::make_shared<HttpFields>();
-  try {
-    root = YAML::Load(content);
-    yaml_merge(root);
-  } catch (std::exception const &ex) {
-    errata.note(S_ERROR, R"(Exception: {} in "{}".)", ex.what(), path);
-  }
+  auto &&[root, parse_errata] = parse_replay_file(path);
+  errata.note(std::move(parse_errata));
   if (!errata.is_ok()) {
     return errata;
   }
+  auto &&[global_fields_rules, meta_errata] = parse_meta(path, root);
+  errata.note(std::move(meta_errata));
+  handler.global_config = VerificationConfig{global_fields_rules};
+  errata.note(load_sessions(path, root, handler));
+  return errata;
+}
+
+swoc::Rv<std::shared_ptr<HttpFields>>
+YamlParser::parse_meta(swoc::file::path const &path, YAML::Node const &root)
+{
+  swoc::Rv<std::shared_ptr<HttpFields>> zret{std::make_shared<HttpFields>()};
   if (root[YAML_META_KEY]) {
     auto meta_node{root[YAML_META_KEY]};
     if (meta_node[YAML_GLOBALS_KEY]) {
       auto globals_node{meta_node[YAML_GLOBALS_KEY]};
       // Path not passed to later calls than Load_Replay_File.
-      errata.note(YamlParser::parse_global_rules(globals_node, *global_fields_rules));
+      zret.note(YamlParser::parse_global_rules(globals_node, *zret.result()));
     }
   } else {
-    errata
-        .note(S_INFO, R"(No meta node ("{}") at "{}":{}.)", YAML_META_KEY, path, root.Mark().line);
+    zret.note(S_INFO, R"(No meta node ("{}") at "{}":{}.)", YAML_META_KEY, path, root.Mark().line);
   }
-  handler.global_config = VerificationConfig{global_fields_rules};
+  return zret;
+}
+
+Errata
+YamlParser::load_sessions(
+    swoc::file::path const &path,
+    YAML::Node const &root,
+    ReplayFileHandler &handler)
+{
+  Errata errata;
   if (!root[YAML_SSN_KEY]) {
     errata.note(
         S_ERROR,
@@ -1076,13 +1522,15 @@ YamlParser::load_replay_file(swoc::file::path const &path, ReplayFileHandler &ha
   }
   for (auto const &ssn_node : ssn_list_node) {
     // HeaderRules ssn_rules = global_rules;
-    auto session_errata{handler.ssn_open(ssn_node)};
+    YamlKeyMap const ssn_keys{ssn_node};
+    auto session_errata{handler.ssn_open(ssn_node, ssn_keys)};
     if (!session_errata.is_ok()) {
       errata.note(std::move(session_errata));
       errata.note(S_ERROR, R"(Failure opening session at "{}":{}.)", path, ssn_node.Mark().line);
       continue;
     }
-    if (!ssn_node[YAML_TXN_KEY]) {
+    auto const *txn_list_node_ptr = ssn_keys.find(YamlKey::TRANSACTIONS);
+    if (txn_list_node_ptr == nullptr) {
       errata.note(
           S_ERROR,
           R"(Session at "{}":{} has no "{}" key.)",
@@ -1091,7 +1539,7 @@ YamlParser::load_replay_file(swoc::file::path const &path, ReplayFileHandler &ha
           YAML_TXN_KEY);
       continue;
     }
-    auto txn_list_node{ssn_node[YAML_TXN_KEY]};
+    auto const &txn_list_node{*txn_list_node_ptr};
     if (!txn_list_node.IsSequence()) {
       session_errata.note(
           S_ERROR,
@@ -1108,33 +1556,40 @@ YamlParser::load_replay_file(swoc::file::path const &path, ReplayFileHandler &ha
           ssn_node.Mark(),
           path);
     }
+    _num_parsed_transactions += txn_list_node.size();
     for (auto const &txn_node : txn_list_node) {
+      if (handler.skip_transaction(txn_node)) {
+        ++_num_skipped_transactions;
+        continue;
+      }
       // HeaderRules txn_rules = ssn_rules;
-      auto txn_errata = handler.txn_open(txn_node);
+      YamlKeyMap const txn_keys{txn_node};
+      auto txn_errata = handler.txn_open(txn_node, txn_keys);
       if (!txn_errata.is_ok()) {
         session_errata
             .note(S_ERROR, R"(Could not open transaction at {} in "{}".)", txn_node.Mark(), path);
       }
-      HttpFields all_fields;
-      if (auto all_node{txn_node[YAML_ALL_MESSAGES_KEY]}; all_node) {
-        if (auto headers_node{all_node[YAML_HDR_KEY]}; headers_node) {
-          txn_errata.note(YamlParser::parse_global_rules(headers_node, all_fields));
+      // The "all" fields and rules are shared by the transaction's messages.
+      std::shared_ptr<HttpFields> all_fields;
+      if (auto const *all_node = txn_keys.find(YamlKey::ALL); all_node) {
+        if (auto headers_node{(*all_node)[YAML_HDR_KEY]}; headers_node) {
+          all_fields = std::make_shared<HttpFields>();
+          txn_errata.note(YamlParser::parse_global_rules(headers_node, *all_fields));
         }
       }
-      if (auto creq_node{txn_node[YAML_CLIENT_REQ_KEY]}; creq_node) {
-        txn_errata.note(handler.client_request(creq_node));
+      if (auto const *creq_node = txn_keys.find(YamlKey::CLIENT_REQUEST); creq_node) {
+        txn_errata.note(handler.client_request(*creq_node));
       }
-      if (auto preq_node{txn_node[YAML_PROXY_REQ_KEY]}; preq_node) { // global_rules appears to be
-                                                                     // being copied
-        txn_errata.note(handler.proxy_request(preq_node));
+      if (auto const *preq_node = txn_keys.find(YamlKey::PROXY_REQUEST); preq_node) {
+        txn_errata.note(handler.proxy_request(*preq_node));
       }
-      if (auto ursp_node{txn_node[YAML_SERVER_RSP_KEY]}; ursp_node) {
-        txn_errata.note(handler.server_response(ursp_node));
+      if (auto const *ursp_node = txn_keys.find(YamlKey::SERVER_RESPONSE); ursp_node) {
+        txn_errata.note(handler.server_response(*ursp_node));
       }
-      if (auto prsp_node{txn_node[YAML_PROXY_RSP_KEY]}; prsp_node) {
-        txn_errata.note(handler.proxy_response(prsp_node));
+      if (auto const *prsp_node = txn_keys.find(YamlKey::PROXY_RESPONSE); prsp_node) {
+        txn_errata.note(handler.proxy_response(*prsp_node));
       }
-      if (!all_fields._fields.empty()) {
+      if (all_fields && !all_fields->_fields.empty()) {
         txn_errata.note(handler.apply_to_all_messages(all_fields));
       }
       txn_errata.note(handler.txn_close());
@@ -1150,15 +1605,196 @@ YamlParser::load_replay_file(swoc::file::path const &path, ReplayFileHandler &ha
   return errata;
 }
 
+int
+YamlParser::get_default_thread_count()
+{
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+int
+YamlParser::get_loader_thread_index()
+{
+  return Loader_Thread_Index;
+}
+
 Errata
-YamlParser::load_replay_files(swoc::file::path const &path, loader_t loader, int n_threads)
+YamlParser::load_files(
+    std::vector<swoc::file::path> const &files,
+    loader_t const &loader,
+    int n_threads)
 {
   Errata errata;
-  errata.note(parsing_is_started());
   std::mutex local_mutex;
-  std::error_code ec;
+  std::atomic<size_t> idx{0};
+  if (n_threads <= 0) {
+    n_threads = get_default_thread_count();
+  }
+  n_threads = std::min(n_threads, static_cast<int>(files.size()));
+  _num_parsing_threads = n_threads;
+
+  // Lambda suitable to spawn in a thread to load files.
+  auto load_wrapper = [&](int thread_index) -> void {
+    Loader_Thread_Index = thread_index;
+    size_t k = 0;
+    while ((k = idx++) < files.size()) {
+      auto result = loader(files[k]);
+      std::lock_guard<std::mutex> lock(local_mutex);
+      errata.note(result);
+    }
+  };
+
+  errata.note(S_INFO, "Loading {} replay files.", files.size());
+  std::vector<std::thread> threads;
+  threads.reserve(n_threads);
+  for (int tidx = 0; tidx < n_threads; ++tidx) {
+    threads.emplace_back(load_wrapper, tidx);
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  return errata;
+}
+
+Errata
+YamlParser::load_compiled_corpus(
+    swoc::file::path const &path,
+    loader_t const &loader,
+    int n_threads)
+{
+  Errata errata;
+  auto &&[corpus, corpus_errata] = CompiledCorpus::open(path);
+  errata.note(std::move(corpus_errata));
+  if (!errata.is_ok()) {
+    return errata;
+  }
+  std::vector<swoc::file::path> files;
+  files.reserve(corpus->get_file_count());
+  for (uint32_t file_id = 0; file_id < corpus->get_file_count(); ++file_id) {
+    files.emplace_back(std::string{corpus->get_file_path(file_id)});
+  }
+  if (files.empty()) {
+    errata.note(S_ERROR, R"(No replay files compiled into "{}".)", path);
+    return errata;
+  }
+  std::shared_ptr<CompiledCorpus const> const shared_corpus{std::move(corpus)};
+  // A retained corpus stays mapped, so the values of its trees can refer to
+  // the mapping.
+  _is_compiled_corpus_retained = Localizer::can_retain();
+  if (_is_compiled_corpus_retained) {
+    Localizer::retain(shared_corpus, shared_corpus->get_size());
+  }
+  // parse_replay_file takes the trees of these files from the corpus.
+  std::atomic_store(&_compiled_corpus, shared_corpus);
+  errata.note(load_files(files, loader, n_threads));
+  std::atomic_store(&_compiled_corpus, std::shared_ptr<CompiledCorpus const>{});
+  _is_compiled_corpus_retained = false;
+  return errata;
+}
 
-  dirent **elements = nullptr;
+Errata
+YamlParser::load_split_file(swoc::file::path const &path, loader_t const &loader, int n_threads)
+{
+  Errata errata;
+  if (n_threads <= 0) {
+    n_threads = get_default_thread_count();
+  }
+  auto const load_start = ClockType::now();
+  size_t file_size = 0;
+  auto &&[content, load_errata] = load_content(path, file_size);
+  if (!load_errata.is_ok()) {
+    errata.note(std::move(load_errata));
+    return errata;
+  }
+  auto const content_size = content.size();
+  auto split = content_size < MIN_SPLIT_FILE_SIZE
+                   ? JsonParser::ArraySplit{}
+                   : JsonParser::split_array(content, YAML_SSN_KEY, n_threads);
+  std::string{}.swap(content);
+  bool has_merge_key = false;
+  YAML::Node meta_root;
+  if (!split.chunks.empty()) {
+    auto &&[remainder_root, remainder_errata] = JsonParser::parse(split.remainder, has_merge_key);
+    if (remainder_errata.is_ok()) {
+      meta_root = remainder_root;
+    } else {
+      split.chunks.clear();
+    }
+  }
+  // Parse all the chunks before loading any, so that the file can still be
+  // loaded whole if a chunk does not parse.
+  std::vector<ReplayFileChunk> chunks(split.chunks.size());
+  std::atomic<bool> is_split{!chunks.empty()};
+  auto const run_threads = [&chunks](auto const &task) -> void {
+    std::vector<std::thread> threads;
+    threads.reserve(chunks.size());
+    for (size_t chunk_index = 0; chunk_index < chunks.size(); ++chunk_index) {
+      threads.emplace_back(task, chunk_index);
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  };
+  run_threads([&](size_t chunk_index) -> void {
+    bool chunk_has_merge_key = false;
+    auto &&[root, chunk_errata] = JsonParser::parse(split.chunks[chunk_index], chunk_has_merge_key);
+    std::string{}.swap(split.chunks[chunk_index]);
+    if (!chunk_errata.is_ok()) {
+      is_split = false;
+      return;
+    }
+    if (chunk_has_merge_key) {
+      yaml_merge(root);
+    }
+    chunks[chunk_index].root = root;
+  });
+  if (!is_split) {
+    // The file may be invalid JSON, or use YAML syntax beyond JSON. Either
+    // way, loading the file whole reports or handles it.
+    return loader(path);
+  }
+
+  if (has_merge_key) {
+    yaml_merge(meta_root);
+  }
+  auto &&[global_fields_rules, meta_errata] = parse_meta(path, meta_root);
+  errata.note(std::move(meta_errata));
+  for (auto &chunk : chunks) {
+    chunk.path = path;
+    chunk.global_fields_rules = global_fields_rules;
+  }
+  ++_num_parsed_files;
+  _num_parsed_bytes += content_size;
+  _num_parsing_threads = static_cast<int>(chunks.size());
+  errata.note(S_INFO, R"(Loading "{}" in {} chunks of its sessions.)", path, chunks.size());
+
+  std::mutex errata_mutex;
+  run_threads([&](size_t chunk_index) -> void {
+    auto &chunk = chunks[chunk_index];
+    Loader_Thread_Index = static_cast<int>(chunk_index);
+    Loading_Chunk = &chunk;
+    auto result = loader(path);
+    Loading_Chunk = nullptr;
+    // Release the chunk's tree on this thread rather than serially below.
+    chunk.root = YAML::Node{};
+    std::lock_guard<std::mutex> lock(errata_mutex);
+    errata.note(result);
+  });
+  // The chunks are parsed concurrently, so this is the wall time of the file
+  // rather than the time of any one thread.
+  count_parsed_file(path, file_size, content_size, ClockType::now() - load_start);
+  return errata;
+}
+
+Errata
+YamlParser::load_replay_files(
+    swoc::file::path const &path,
+    loader_t loader,
+    int n_threads,
+    bool split_files)
+{
+  Errata errata;
+  errata.note(parsing_is_started());
+  std::error_code ec;
 
   auto stat{swoc::file::status(path, ec)};
   if (ec) {
@@ -1166,7 +1802,16 @@ YamlParser::load_replay_files(swoc::file::path const &path, loader_t loader, int
     errata.note(parsing_is_done());
     return errata;
   } else if (swoc::file::is_regular_file(stat)) {
-    errata.note(loader(path));
+    if (CompiledCorpus::is_compiled_corpus(path)) {
+      errata.note(load_compiled_corpus(path, loader, n_threads));
+    } else if (
+        split_files && n_threads != 1 &&
+        JsonParser::is_json_file(CompressedFile::get_content_path(path)))
+    {
+      errata.note(load_split_file(path, loader, n_threads));
+    } else {
+      errata.note(loader(path));
+    }
     errata.note(parsing_is_done());
     return errata;
   } else if (!swoc::file::is_dir(stat)) {
@@ -1175,49 +1820,134 @@ YamlParser::load_replay_files(swoc::file::path const &path, loader_t loader, int
     return errata;
   }
 
-  if (0 == chdir(path.c_str())) {
-    int n_sessions = scandir(
-        ".",
-        &elements,
-        [](dirent const *entry) -> int {
-          auto extension = swoc::TextView{entry->d_name, strlen(entry->d_name)}.suffix_at('.');
-          return 0 == strcasecmp(extension, "json") || 0 == strcasecmp(extension, "yaml");
-        },
-        &alphasort);
-    if (n_sessions > 0) {
-      std::atomic<int> idx{0};
-      swoc::MemSpan<dirent *> entries{elements, static_cast<size_t>(n_sessions)};
-
-      // Lambda suitable to spawn in a thread to load files.
-      auto load_wrapper = [&]() -> void {
-        size_t k = 0;
-        while ((k = idx++) < entries.count()) {
-          auto result = loader(swoc::file::path{entries[k]->d_name});
-          std::lock_guard<std::mutex> lock(local_mutex);
-          errata.note(result);
-        }
-      };
+  std::vector<ReplayFileEntry> entries;
+  errata.note(find_replay_files(path, entries));
+  if (!errata.is_ok()) {
+    errata.note(parsing_is_done());
+    return errata;
+  }
+  if (entries.empty()) {
+    errata.note(S_ERROR, R"(No replay files found in "{}".)", path);
+    errata.note(parsing_is_done());
+    return errata;
+  }
+  if (n_threads == 1) {
+    // A single thread loads the files in path order, which callers such as
+    // --stream rely upon.
+    std::sort(entries.begin(), entries.end(), [](auto const &lhs, auto const &rhs) {
+      return lhs.path.string() < rhs.path.string();
+    });
+  } else {
+    // Start the largest files first so that a large file started last does
+    // not leave the other threads idle while it is parsed.
+    std::sort(entries.begin(), entries.end(), [](auto const &lhs, auto const &rhs) {
+      return lhs.size != rhs.size ? lhs.size > rhs.size : lhs.path.string() < rhs.path.string();
+    });
+  }
+  std::vector<swoc::file::path> files;
+  files.reserve(entries.size());
+  for (auto &entry : entries) {
+    files.emplace_back(std::move(entry.path));
+  }
+  errata.note(load_files(files, loader, n_threads));
+  errata.note(parsing_is_done());
+  return errata;
+}
 
-      errata.note(S_INFO, "Loading {} replay files.", n_sessions);
-      std::vector<std::thread> threads;
-      threads.reserve(n_threads);
-      for (int tidx = 0; tidx < n_threads; ++tidx) {
-        threads.emplace_back(load_wrapper);
-      }
-      for (std::thread &thread : threads) {
-        thread.join();
-      }
-      for (int i = 0; i < n_sessions; i++) {
-        free(elements[i]);
-      }
-      free(elements);
+Errata
+YamlParser::find_replay_files(swoc::file::path const &dir, std::vector<ReplayFileEntry> &entries)
+{
+  Errata errata;
+  DIR *const dirp = opendir(dir.c_str());
+  if (dirp == nullptr) {
+    errata.note(S_ERROR, R"(Failed to access directory "{}": {}.)", dir, swoc::bwf::Errno{});
+    return errata;
+  }
+  while (dirent const *const entry = readdir(dirp)) {
+    TextView const name{entry->d_name, strlen(entry->d_name)};
+    if (name == "." || name == "..") {
+      continue;
+    }
+    auto const child = dir / swoc::file::path{std::string{name}};
+    struct stat child_stat;
+    if (lstat(child.c_str(), &child_stat) != 0) {
+      continue;
+    }
+    if (S_ISDIR(child_stat.st_mode)) {
+      errata.note(find_replay_files(child, entries));
+      continue;
+    }
+    // Symbolic links to files are followed, but not links to directories, so
+    // the traversal cannot loop.
+    if (S_ISLNK(child_stat.st_mode) && stat(child.c_str(), &child_stat) != 0) {
+      continue;
+    }
+    // Compressed files are named for their content, as in "replay.json.gz".
+    TextView content_name = name;
+    if (CompressedFile::is_compressed(child)) {
+      content_name.split_suffix_at('.');
+    }
+    auto const extension = content_name.suffix_at('.');
+    if (S_ISREG(child_stat.st_mode) &&
+        (0 == strcasecmp(extension, "json") || 0 == strcasecmp(extension, "yaml")))
+    {
+      entries.push_back({child, static_cast<size_t>(child_stat.st_size)});
+    }
+  }
+  closedir(dirp);
+  return errata;
+}
 
-    } else {
-      errata.note(S_ERROR, R"(No replay files found in "{}".)", path);
+std::string
+YamlParser::get_relative_path(swoc::file::path const &file, swoc::file::path const &dir)
+{
+  TextView relative{file.string()};
+  TextView const dir_view{dir.string()};
+  if (relative.size() > dir_view.size() && relative.starts_with(dir_view)) {
+    relative.remove_prefix(dir_view.size());
+    if (relative.front() == '/' || dir_view.back() == '/') {
+      return std::string{relative.ltrim('/')};
     }
+  }
+  return file.string();
+}
+
+Errata
+YamlParser::load_replay_files(
+    std::vector<swoc::file::path> const &files,
+    loader_t loader,
+    int n_threads)
+{
+  Errata errata;
+  errata.note(parsing_is_started());
+  if (files.empty()) {
+    errata.note(S_ERROR, "No replay files to load.");
   } else {
-    errata.note(S_ERROR, R"(Failed to access directory "{}": {}.)", path, swoc::bwf::Errno{});
+    errata.note(load_files(files, loader, n_threads));
   }
   errata.note(parsing_is_done());
   return errata;
 }
+
+Errata
+YamlParser::compile_replay_files(swoc::file::path const &path, swoc::file::path const &corpus_path)
+{
+  Errata errata;
+  CompiledCorpus::Builder builder;
+  std::mutex builder_mutex;
+  errata.note(load_replay_files(
+      path,
+      [&path, &builder, &builder_mutex](swoc::file::path const &file) -> Errata {
+        auto &&[root, file_errata] = parse_replay_file(file);
+        if (file_errata.is_ok()) {
+          std::lock_guard<std::mutex> lock(builder_mutex);
+          builder.add_file(get_relative_path(file, path), root);
+        }
+        return std::move(file_errata);
+      }));
+  if (!errata.is_ok()) {
+    return errata;
+  }
+  errata.note(builder.write(corpus_path));
+  return errata;
+}
@@ -9,6 +9,7 @@
 #include "core/verification.h"
 #include "core/ProxyVerifier.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cassert>
 #include <fcntl.h>
@@ -19,6 +20,7 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <mutex>
 #include <thread>
 #include <unistd.h>
 
@@ -41,7 +43,15 @@ using chrono::milliseconds;
 constexpr int MAX_NOFILE = 300000;
 
 std::string HttpHeader::_key_format{"{field.uuid}"};
-swoc::MemSpan<char> HttpHeader::_content;
+HttpHeader::KeyPlan HttpHeader::_key_plan{HttpHeader::compile_key_format(_key_format)};
+std::atomic<char const *> HttpHeader::_content{nullptr};
+std::atomic<uint64_t> HttpHeader::_num_cached_serializations{0};
+std::atomic<uint64_t> HttpHeader::_cached_serialization_build_ns{0};
+std::atomic<uint64_t> HttpHeader::_num_cached_serializations_sent{0};
+std::atomic<uint64_t> HttpFields::_shared_rules_bytes_saved{0};
+std::atomic<uint64_t> Txn::_num_compacted{0};
+std::atomic<uint64_t> Txn::_loaded_bytes{0};
+std::atomic<uint64_t> Txn::_compacted_bytes{0};
 std::bitset<600> HttpHeader::STATUS_NO_CONTENT;
 
 memoized_ip_endpoints_t InterfaceNameToEndpoint::memoized_ip_endpoints;
@@ -95,7 +105,12 @@ swoc::Errata
 Ssn::post_process_transactions()
 {
   swoc::Errata errata;
-  _transactions.sort([](Txn const &txn1, Txn const &txn2) { return txn1._start < txn2._start; });
+  auto const by_start = [](Txn const &txn1, Txn const &txn2) { return txn1._start < txn2._start; };
+  // Replay files almost always list transactions in order already.
+  if (!std::is_sorted(_transactions.begin(), _transactions.end(), by_start)) {
+    std::stable_sort(_transactions.begin(), _transactions.end(), by_start);
+  }
+  _transactions.shrink_to_fit();
   auto const offset_time = _transactions.front()._start;
   for (auto &txn : _transactions) {
     if (txn._start >= offset_time) {
@@ -105,36 +120,108 @@ Ssn::post_process_transactions()
   return errata;
 }
 
-void
-HttpHeader::set_max_content_length(size_t n)
+/// The length of Content_Buffer. Guarded by Content_Mutex.
+static size_t Content_Length = 0;
+/// The buffer HttpHeader::_content points to. Guarded by Content_Mutex.
+static std::shared_ptr<char const> Content_Buffer;
+/// The buffers set_max_content_length replaced, which a send may still be
+/// reading. Guarded by Content_Mutex.
+static std::vector<std::shared_ptr<char const>> Replaced_Content_Buffers;
+static std::mutex Content_Mutex;
+
+/** Replace Content_Buffer with a buffer of at least n bytes unless it is
+ * already that large. Content_Mutex must be held.
+ *
+ * @return The replaced buffer, or nullptr if none was replaced.
+ */
+static std::shared_ptr<char const>
+grow_content(size_t n)
 {
   n = swoc::round_up<16>(n);
-  _content.assign(static_cast<char *>(malloc(n)), n);
+  if (n <= Content_Length && Content_Buffer) {
+    return {};
+  }
+  auto *content = static_cast<char *>(malloc(n));
   for (size_t k = 0; k < n; k += 8) {
-    swoc::FixedBufferWriter w{_content.data() + k, 8};
+    swoc::FixedBufferWriter w{content + k, 8};
     w.print("{:07x} ", k / 8);
   };
+  auto replaced = std::move(Content_Buffer);
+  Content_Buffer.reset(content, [](char const *buffer) { free(const_cast<char *>(buffer)); });
+  Content_Length = n;
+  HttpHeader::_content.store(content);
+  return replaced;
+}
+
+void
+HttpHeader::set_max_content_length(size_t n)
+{
+  std::lock_guard<std::mutex> lock(Content_Mutex);
+  if (auto replaced = grow_content(n); replaced) {
+    Replaced_Content_Buffers.emplace_back(std::move(replaced));
+  }
+}
+
+std::shared_ptr<char const>
+HttpHeader::get_content(size_t n)
+{
+  std::lock_guard<std::mutex> lock(Content_Mutex);
+  grow_content(n);
+  return Content_Buffer;
 }
 
 swoc::Errata
 HttpHeader::update_content_length(swoc::TextView method)
 {
   swoc::Errata errata;
-  size_t cl = std::numeric_limits<size_t>::max();
-  _content_length_p = false;
+  std::tie(_content_size, _content_length_p) = get_content_length_for(method);
+  return errata;
+}
+
+std::pair<size_t, bool>
+HttpHeader::get_content_length_for(swoc::TextView method) const
+{
   // Some methods ignore the Content-Length for the current transaction
   if (strcasecmp(method, "HEAD") == 0) {
     // Don't try chunked encoding later
-    _content_size = 0;
-    _content_length_p = true;
+    return {0, true};
   } else if (auto spot{_fields_rules->_fields.find(FIELD_CONTENT_LENGTH)};
              spot != _fields_rules->_fields.end())
   {
-    cl = swoc::svtou(spot->second);
-    _content_size = cl;
-    _content_length_p = true;
+    return {swoc::svtou(spot->second), true};
   }
-  return errata;
+  return {_content_size, false};
+}
+
+MessageOverlay::MessageOverlay(HttpHeader const &hdr)
+  : protocol{hdr.get_http_protocol()}
+  , http_version{hdr._http_version}
+  , stream_id{hdr._stream_id}
+  , content_size{hdr._content_size}
+  , content_length_p{hdr._content_length_p}
+{
+}
+
+MessageOverlay::MessageOverlay(HttpHeader const &response, HttpHeader const &request)
+  : protocol{request.get_http_protocol()}
+  , http_version{response._http_version}
+  , stream_id{response._stream_id}
+{
+  switch (protocol) {
+  case HTTP_PROTOCOL_TYPE::HTTP_1:
+    // As with set_is_http1, HTTP/1 responses are always sent as HTTP/1.1.
+    http_version = "1.1";
+    break;
+  case HTTP_PROTOCOL_TYPE::HTTP_2:
+    http_version = "2";
+    stream_id = request._stream_id;
+    break;
+  case HTTP_PROTOCOL_TYPE::HTTP_3:
+    http_version = "3";
+    stream_id = request._stream_id;
+    break;
+  }
+  std::tie(content_size, content_length_p) = response.get_content_length_for(request._method);
 }
 
 swoc::Errata
@@ -144,7 +231,7 @@ HttpHeader::update_transfer_encoding()
   if (auto spot{_fields_rules->_fields.find(FIELD_TRANSFER_ENCODING)};
       spot != _fields_rules->_fields.end())
   {
-    if (0 == strcasecmp("chunked", spot->second)) {
+    if (0 == strcasecmp("chunked"_tv, spot->second)) {
       _chunked_p = true;
       _has_transfer_encoding_chunked = true;
     }
@@ -152,15 +239,117 @@ HttpHeader::update_transfer_encoding()
   return {};
 }
 
+swoc::Errata
+HttpHeader::cache_http1_serialization()
+{
+  auto const start = ClockType::now();
+  // HTTP/1 messages are always sent as HTTP/1.1 (see set_is_http1),
+  // regardless of the version recorded in the replay file.
+  swoc::LocalBufferWriter<MAX_HDR_SIZE> w;
+  swoc::Errata errata = serialize(w, "1.1");
+  if (!errata.is_ok() || w.error()) {
+    errata.note(S_ERROR, "Could not cache the HTTP/1 serialization for key: {}", get_key());
+    return errata;
+  }
+  _http1_serialization.assign(w.data(), w.size());
+  record_cached_serialization(duration_cast<std::chrono::nanoseconds>(ClockType::now() - start));
+  return errata;
+}
+
+// static
+void
+HttpHeader::record_cached_serialization(std::chrono::nanoseconds build_time)
+{
+  ++_num_cached_serializations;
+  _cached_serialization_build_ns += build_time.count();
+}
+
+// static
+void
+HttpHeader::record_cached_serialization_sent()
+{
+  ++_num_cached_serializations_sent;
+}
+
+// static
+swoc::Errata
+HttpHeader::report_serialization_cache_statistics()
+{
+  swoc::Errata errata;
+  uint64_t const num_cached = _num_cached_serializations;
+  if (num_cached == 0) {
+    return errata;
+  }
+  uint64_t const num_sent = _num_cached_serializations_sent;
+  uint64_t const average_build_ns = _cached_serialization_build_ns / num_cached;
+  errata.note(
+      S_INFO,
+      "Response serialization cache: {} header{} cached at load time ({} ns each on "
+      "average), {} sent from the cache, saving an estimated {} us of serialization.",
+      num_cached,
+      swoc::bwf::If(num_cached != 1, "s"),
+      average_build_ns,
+      num_sent,
+      num_sent * average_build_ns / 1000);
+  return errata;
+}
+
+void
+Txn::compact()
+{
+  auto const loaded_bytes = get_memory_footprint();
+  _req._fields_rules->shrink_to_fit();
+  _rsp._fields_rules->shrink_to_fit();
+  ++_num_compacted;
+  _loaded_bytes += loaded_bytes;
+  _compacted_bytes += get_memory_footprint();
+}
+
+size_t
+Txn::get_memory_footprint() const
+{
+  return sizeof(*this) + _req.get_heap_footprint() + _rsp.get_heap_footprint();
+}
+
+swoc::Errata
+Txn::report_memory_statistics()
+{
+  swoc::Errata errata;
+  uint64_t const num_compacted = _num_compacted;
+  if (num_compacted == 0) {
+    return errata;
+  }
+  errata.note(
+      S_INFO,
+      "Loaded transactions use an estimated {} bytes each for their messages, fields and "
+      "rules: {} bytes as parsed.",
+      _compacted_bytes / num_compacted,
+      _loaded_bytes / num_compacted);
+  if (uint64_t const shared_bytes = HttpFields::get_shared_rules_bytes_saved(); shared_bytes > 0) {
+    errata.note(
+        S_INFO,
+        R"(Sharing the global and "all" field rules rather than copying them into each )"
+        "message saved an estimated {} bytes.",
+        shared_bytes);
+  }
+  return errata;
+}
+
 swoc::Errata
 HttpHeader::serialize(swoc::BufferWriter &w) const
+{
+  return serialize(w, _http_version);
+}
+
+swoc::Errata
+HttpHeader::serialize(swoc::BufferWriter &w, TextView http_version) const
 {
   swoc::Errata errata;
 
   if (is_response()) {
-    w.print("HTTP/{} {} {}{}", _http_version, _status, _reason, HTTP_EOL);
+    w.print("HTTP/{} {} {}{}", http_version, _status, _reason, HTTP_EOL);
   } else if (is_request()) {
-    w.print("{} {} HTTP/{}{}", _method, _url, _http_version, HTTP_EOL);
+    w.print("{} {} HTTP/{}{}", _method, _url, http_version, HTTP_EOL);
   } else {
     errata.note(S_ERROR, R"(Unable to write header: could not determine request/response state.)");
   }
@@ -173,11 +362,6 @@ HttpHeader::serialize(swoc::BufferWriter &w) const
   return errata;
 }
 
-HttpFields::HttpFields()
-{
-  _fields_sequence.reserve(num_fields_to_reserve);
-}
-
 void
 HttpFields::add_field(swoc::TextView name, swoc::TextView value)
 {
@@ -186,7 +370,7 @@ HttpFields::add_field(swoc::TextView name, swoc::TextView value)
 }
 
 void
-HttpFields::merge(HttpFields const &other)
+HttpFields::merge_fields(HttpFields const &other)
 {
   for (auto const &field : other._fields) {
     _fields.emplace(field.first, field.second);
@@ -194,9 +378,49 @@ HttpFields::merge(HttpFields const &other)
   for (auto const &field : other._fields_sequence) {
     _fields_sequence.push_back({field.name, field.value});
   }
-  for (auto const &rule : other._rules) {
-    _rules.emplace(rule.first, rule.second);
+}
+
+void
+HttpFields::add_shared_rules(std::shared_ptr<HttpFields const> rules)
+{
+  if (rules == nullptr || (rules->_rules.empty() && rules->_url_rules.empty())) {
+    return;
   }
+  _shared_rules_bytes_saved += rules->get_rules_footprint();
+  _shared_rules.push_back(std::move(rules));
+}
+
+uint64_t
+HttpFields::get_shared_rules_bytes_saved()
+{
+  return _shared_rules_bytes_saved;
+}
+
+void
+HttpFields::shrink_to_fit()
+{
+  _fields_sequence.shrink_to_fit();
+  _url_rules.shrink_to_fit();
+  _shared_rules.shrink_to_fit();
+}
+
+/// The memory of a map node besides its value: three links and a color.
+static constexpr size_t MAP_NODE_OVERHEAD = 4 * sizeof(void *);
+
+size_t
+HttpFields::get_memory_footprint() const
+{
+  return sizeof(*this) + _fields_sequence.capacity() * sizeof(Field) +
+         _fields.size() * (sizeof(Fields::value_type) + MAP_NODE_OVERHEAD) +
+         get_rules_footprint();
+}
+
+size_t
+HttpFields::get_rules_footprint() const
+{
+  return _rules.size() * (sizeof(Rules::value_type) + MAP_NODE_OVERHEAD) +
+         _url_rules.capacity() * sizeof(UrlRule) +
+         _shared_rules.capacity() * sizeof(decltype(_shared_rules)::value_type);
 }
 
 void
@@ -357,12 +581,77 @@ HttpHeader::set_key(TextView new_key)
   _key = new_key;
 }
 
-std::string
+std::string const &
 HttpHeader::get_key() const
 {
   return _key;
 }
 
+/// The prefix of key format names which refer to a field.
+static constexpr TextView KEY_FIELD_PREFIX{"field."};
+
+HttpHeader::KeyPlan
+HttpHeader::compile_key_format(TextView format)
+{
+  KeyPlan plan;
+  plan.format = format;
+  auto const add_literal = [&plan](TextView text) {
+    if (!plan.parts.empty() && plan.parts.back().type == KeyPlan::PartType::LITERAL) {
+      plan.parts.back().text.append(text.data(), text.size());
+    } else {
+      plan.parts.push_back({KeyPlan::PartType::LITERAL, std::string{text}});
+    }
+  };
+  while (format) {
+    auto const brace = format.find_first_of("{}");
+    if (brace == TextView::npos) {
+      add_literal(format);
+      break;
+    }
+    if (brace > 0) {
+      add_literal(format.prefix(brace));
+    }
+    format.remove_prefix(brace);
+    if (format.size() > 1 && format[1] == format[0]) {
+      // "{{" and "}}" are escaped braces.
+      add_literal(format.prefix(1));
+      format.remove_prefix(2);
+      continue;
+    }
+    if (format[0] == '}') {
+      // An unbalanced closing brace: leave it to bwprint.
+      return plan;
+    }
+    format.remove_prefix(1);
+    auto const close = format.find('}');
+    TextView name{format.prefix(close)};
+    if (close == TextView::npos || name.find_first_of(":{") != TextView::npos) {
+      // Unbalanced braces or a specifier with format options: leave these to
+      // bwprint.
+      return plan;
+    }
+    format.remove_prefix(close + 1);
+    if (name.starts_with_nocase(KEY_FIELD_PREFIX)) {
+      name.remove_prefix(KEY_FIELD_PREFIX.size());
+      plan.parts.push_back({KeyPlan::PartType::FIELD, std::string{name}});
+    } else if (0 == strcasecmp("url"_tv, name)) {
+      plan.parts.push_back({KeyPlan::PartType::URL, {}});
+    } else {
+      // Other names, such as argument indices, are left to bwprint.
+      return plan;
+    }
+  }
+  plan.is_compiled = true;
+  return plan;
+}
+
+void
+HttpHeader::set_key_format(TextView format)
+{
+  _key_format = format;
+  _key_plan = compile_key_format(format);
+}
+
 void
 HttpHeader::derive_key()
 {
@@ -370,6 +659,33 @@ HttpHeader::derive_key()
     // Key has already been derived or has been explicitly set by the user.
     return;
   }
+  if (_key_plan.is_compiled && _key_plan.format == _key_format) {
+    _key.clear();
+    for (auto const &part : _key_plan.parts) {
+      switch (part.type) {
+      case KeyPlan::PartType::LITERAL:
+        _key.append(part.text);
+        break;
+      case KeyPlan::PartType::FIELD:
+        if (auto spot{_fields_rules->_fields.find(part.text)};
+            spot != _fields_rules->_fields.end()) {
+          _key.append(spot->second.data(), spot->second.size());
+        } else {
+          _key.append(TRANSACTION_KEY_NOT_SET);
+        }
+        break;
+      case KeyPlan::PartType::URL:
+        if (_url.empty()) {
+          _key.append(TRANSACTION_KEY_NOT_SET);
+        } else {
+          _key.append(_url.data(), _url.size());
+        }
+        break;
+      }
+    }
+    return;
+  }
+  // The format was not compiled: format it field by field.
   swoc::FixedBufferWriter w{nullptr};
   Binding binding(*this);
   w.print_n(binding, _key_format);
@@ -384,16 +700,14 @@ HttpHeader::verify_headers(swoc::TextView transaction_key, HttpFields const &rul
   // Remains false if no issue is observed
   // Setting true does not break loop because test() calls errata.note(S_DIAG, )
   bool issue_exists = false;
-  auto const &rules = rules_._rules;
-  auto const *url_rules = rules_._url_rules;
   auto const &fields = _fields_rules->_fields;
   auto const *url_parts = _fields_rules->_url_parts;
-  for (auto const &[name, rule_check] : rules) {
+  auto const check_field_rule = [&](swoc::TextView name, RuleCheck const &rule_check) {
     auto name_range = fields.equal_range(name);
     auto field_iter = name_range.first;
-    if (rule_check->expects_duplicate_fields()) {
+    if (rule_check.expects_duplicate_fields()) {
       if (field_iter == name_range.second) {
-        if (!rule_check->test(transaction_key, swoc::TextView(), std::vector<TextView>{})) {
+        if (!rule_check.test(transaction_key, swoc::TextView(), std::vector<TextView>{})) {
           // We supply the empty name and value for the absence check which
           // expects this to indicate an absent field.
           issue_exists = true;
@@ -404,33 +718,69 @@ HttpHeader::verify_headers(swoc::TextView transaction_key, HttpFields const &rul
           values.emplace_back(field_iter->second);
           ++field_iter;
         }
-        if (!rule_check->test(transaction_key, name, values)) {
+        if (!rule_check.test(transaction_key, name, values)) {
           issue_exists = true;
         }
       }
     } else {
       if (field_iter == name_range.second) {
-        if (!rule_check->test(transaction_key, swoc::TextView(), swoc::TextView())) {
+        if (!rule_check.test(transaction_key, swoc::TextView(), swoc::TextView())) {
           // We supply the empty name and value for the absence check which
           // expects this to indicate an absent field.
           issue_exists = true;
         }
       } else {
-        if (!rule_check
-                 ->test(transaction_key, field_iter->first, swoc::TextView(field_iter->second))) {
+        if (!rule_check.test(transaction_key, field_iter->first, field_iter->second)) {
           issue_exists = true;
         }
       }
     }
+  };
+  if (rules_._shared_rules.empty()) {
+    for (auto const &[name, rule_check] : rules_._rules) {
+      check_field_rule(name, *rule_check);
+    }
+  } else {
+    // Check the rules in the order they would have if the shared rules had
+    // been copied in: by name, with the shared rules first for each name. The
+    // rule sets are each ordered by name, so this walks their names in order
+    // rather than collecting and sorting the rules of every message.
+    auto const for_each_rule_set = [&rules_](auto const &f) {
+      for (auto const &shared_rules : rules_._shared_rules) {
+        f(shared_rules->_rules);
+      }
+      f(rules_._rules);
+    };
+    swoc::TextView const *name = nullptr;
+    while (true) {
+      swoc::TextView const *next_name = nullptr;
+      for_each_rule_set([&name, &next_name](auto const &rules) {
+        auto const spot = name == nullptr ? rules.begin() : rules.upper_bound(*name);
+        if (spot != rules.end() &&
+            (next_name == nullptr || CaseInsensitiveCompare{}(spot->first, *next_name)))
+        {
+          next_name = &spot->first;
+        }
+      });
+      if (next_name == nullptr) {
+        break;
+      }
+      name = next_name;
+      for_each_rule_set([&name, &check_field_rule](auto const &rules) {
+        auto const [first, last] = rules.equal_range(*name);
+        for (auto spot = first; spot != last; ++spot) {
+          check_field_rule(spot->first, *spot->second);
+        }
+      });
+    }
   }
-  for (std::size_t i = 0; i < URL_PART_NAMES.count(); ++i) {
-    const std::vector<std::shared_ptr<RuleCheck>> &v = url_rules[i];
-    for (size_t j = 0; j < v.size(); ++j) {
-      const std::shared_ptr<RuleCheck> rule_check = v[j];
-      swoc::TextView value = url_parts[i];
-      if (rule_check == nullptr) {
+
+  auto const check_url_rules = [&](size_t part_index, auto const &url_rules) {
+    for (auto const &[part, rule_check] : url_rules) {
+      if (static_cast<size_t>(part) != part_index || rule_check == nullptr) {
         continue;
       }
+      swoc::TextView value = url_parts[part_index];
       if (value.empty()) {
         if (!rule_check->test(transaction_key, swoc::TextView(), swoc::TextView())) {
           // We supply the empty name and value for the absence check which
@@ -438,22 +788,39 @@ HttpHeader::verify_headers(swoc::TextView transaction_key, HttpFields const &rul
           issue_exists = true;
         }
       } else {
-        if (!rule_check->test(transaction_key, URL_PART_NAMES[static_cast<UrlPart>(i)], value)) {
+        if (!rule_check->test(
+                transaction_key,
+                URL_PART_NAMES[static_cast<UrlPart>(part_index)],
+                value))
+        {
           issue_exists = true;
         }
       }
     }
+  };
+  // Check the rules by URL part, as they are reported in that order.
+  for (std::size_t i = 0; i < URL_PART_NAMES.count(); ++i) {
+    for (auto const &shared_rules : rules_._shared_rules) {
+      check_url_rules(i, shared_rules->_url_rules);
+    }
+    check_url_rules(i, rules_._url_rules);
   }
   return issue_exists;
 }
 
 void
-HttpHeader::merge(HttpFields const &other)
+HttpHeader::merge_fields(HttpFields const &other)
 {
-  _fields_rules->merge(other);
+  _fields_rules->merge_fields(other);
   derive_key();
 }
 
+size_t
+HttpHeader::get_heap_footprint() const
+{
+  return _fields_rules->get_memory_footprint() + _http1_serialization.capacity();
+}
+
 HttpHeader::HttpHeader(bool verify_strictly)
   : _fields_rules{std::make_shared<HttpFields>()}
   , _verify_strictly{verify_strictly}
@@ -584,6 +951,7 @@ HttpHeader::parse_request(swoc::TextView data)
       _http_version = first_line.take_suffix_at('/');
       parse_url(_url);
       set_is_request();
+      _fields_rules->_fields_sequence.reserve(HttpFields::num_fields_to_reserve);
 
       while (data) {
         auto field{data.take_prefix_at('\n').rtrim_if(&isspace)};
@@ -636,6 +1004,7 @@ HttpHeader::parse_response(swoc::TextView data)
       auto reason{status_start.ltrim_if(&isspace).take_prefix_if(&isspace)};
       _reason = reason;
       set_is_response();
+      _fields_rules->_fields_sequence.reserve(HttpFields::num_fields_to_reserve);
 
       if ((_status < 1 || _status > 599) && (_status != 999)) {
         zret.note(
@@ -679,10 +1048,9 @@ HttpHeader::parse_response(swoc::TextView data)
 swoc::BufferWriter &
 HttpHeader::Binding::operator()(BufferWriter &w, const swoc::bwf::Spec &spec) const
 {
-  static constexpr TextView FIELD_PREFIX{"field."};
   TextView name{spec._name};
-  if (name.starts_with_nocase(FIELD_PREFIX)) {
-    name.remove_prefix(FIELD_PREFIX.size());
+  if (name.starts_with_nocase(KEY_FIELD_PREFIX)) {
+    name.remove_prefix(KEY_FIELD_PREFIX.size());
     if (auto spot{_hdr._fields_rules->_fields.find(name)};
         spot != _hdr._fields_rules->_fields.end()) {
       bwformat(w, spec, spot->second);
@@ -771,7 +1139,7 @@ Session::read_and_parse_request(swoc::FixedBufferWriter &buffer)
     zret.note(S_ERROR, R"(The received request was malformed.)");
     zret.note(S_DIAG, R"(Received data: {}.)", received_data);
   }
-  auto const key = hdr->get_key();
+  auto const &key = hdr->get_key();
   zret.note(S_DIAG, "Received an HTTP/1 request with key {}:\n{}", key, *hdr);
   return zret;
 }
@@ -820,20 +1188,35 @@ Session::write(TextView view)
 
 swoc::Rv<ssize_t>
 Session::write(HttpHeader const &hdr)
+{
+  return write(hdr, MessageOverlay{hdr});
+}
+
+swoc::Rv<ssize_t>
+Session::write(HttpHeader const &hdr, MessageOverlay const &overlay)
 {
   // 1. header.serialize, write it out
   // 2. transmit the body
   swoc::LocalBufferWriter<MAX_HDR_SIZE> w;
   swoc::Rv<ssize_t> zret{-1};
+  TextView header_bytes;
 
-  zret.errata() = hdr.serialize(w);
+  if (overlay.protocol == HTTP_PROTOCOL_TYPE::HTTP_1 && overlay.http_version == "1.1" &&
+      !hdr._http1_serialization.empty())
+  {
+    header_bytes = hdr._http1_serialization;
+    HttpHeader::record_cached_serialization_sent();
+  } else {
+    zret.errata() = hdr.serialize(w, overlay.http_version);
 
-  if (!zret.is_ok()) {
-    zret.note(S_ERROR, "Header serialization failed for key: {}", hdr.get_key());
-    return zret;
+    if (!zret.is_ok()) {
+      zret.note(S_ERROR, "Header serialization failed for key: {}", hdr.get_key());
+      return zret;
+    }
+    header_bytes = w.view();
   }
 
-  auto &&[header_bytes_written, header_write_errata] = write(w.view());
+  auto &&[header_bytes_written, header_write_errata] = write(header_bytes);
   zret.note(std::move(header_write_errata));
   if (zret.is_ok()) {
     zret.note(
@@ -845,9 +1228,9 @@ Session::write(HttpHeader const &hdr)
         hdr);
   }
 
-  if (header_bytes_written == static_cast<ssize_t>(w.size())) {
+  if (header_bytes_written == static_cast<ssize_t>(header_bytes.size())) {
     zret.result() = header_bytes_written;
-    auto &&[body_bytes_written, body_write_errata] = write_body(hdr);
+    auto &&[body_bytes_written, body_write_errata] = write_body(hdr, overlay);
     zret.note(std::move(body_write_errata));
     zret.result() += body_bytes_written;
   } else {
@@ -856,7 +1239,7 @@ Session::write(HttpHeader const &hdr)
         R"(Header write for key {} failed with {} of {} bytes written: {}.)",
         hdr.get_key(),
         zret.result(),
-        w.size(),
+        header_bytes.size(),
         swoc::bwf::Errno{});
   }
   return zret;
@@ -1189,32 +1572,32 @@ Session::drain_body(
 }
 
 swoc::Rv<ssize_t>
-Session::write_body(HttpHeader const &hdr)
+Session::write_body(HttpHeader const &hdr, MessageOverlay const &overlay)
 {
   swoc::Rv<ssize_t> bytes_written{0};
   std::error_code ec;
-  auto const key = hdr.get_key();
+  auto const &key = hdr.get_key();
 
-  /* Observe that by this point, hdr._content_size will have been adjusted to 0
-   * for HEAD requests via update_content_length. */
+  /* Observe that overlay.content_size is 0 for responses to HEAD requests. See
+   * MessageOverlay. */
   auto const message_type_permits_body =
       (hdr.is_request() || (hdr._status && !HttpHeader::STATUS_NO_CONTENT[hdr._status]));
   // Note that zero-length chunked bodies must send a zero-length encoded chunk.
-  if (message_type_permits_body && (hdr._content_size > 0 || hdr._chunked_p)) {
+  if (message_type_permits_body && (overlay.content_size > 0 || hdr._chunked_p)) {
     TextView content;
     if (hdr._content_data) {
-      content = TextView{hdr._content_data, hdr._content_size};
+      content = TextView{hdr._content_data, overlay.content_size};
     } else {
       // If hdr._content_data is null, then there was no explicit description
       // of the body data via the data node. Instead we'll use our generated
       // HttpHeader::_content.
-      content = TextView{HttpHeader::_content.data(), hdr._content_size};
+      content = TextView{HttpHeader::_content.load(), overlay.content_size};
     }
     bytes_written.note(
         S_DIAG,
         "Sent {} byte body {}{} for key {}:\n{}",
-        hdr._content_size,
-        swoc::bwf::If(hdr._content_length_p, "[CL]"),
+        overlay.content_size,
+        swoc::bwf::If(overlay.content_length_p, "[CL]"),
         swoc::bwf::If(hdr._chunked_p, "[chunked]"),
         key,
         content);
@@ -1228,7 +1611,7 @@ Session::write_body(HttpHeader const &hdr)
       bytes_written.result() += n;
       ec = std::error_code(errno, std::system_category());
 
-      if (!hdr._content_length_p && !hdr._has_transfer_encoding_chunked) {
+      if (!overlay.content_length_p && !hdr._has_transfer_encoding_chunked) {
         // Since there is no content-length, close the connection to signal the
         // end of body.
         bytes_written.note(
@@ -1240,7 +1623,7 @@ Session::write_body(HttpHeader const &hdr)
       }
     }
 
-    if (bytes_written != static_cast<ssize_t>(hdr._content_size) &&
+    if (bytes_written != static_cast<ssize_t>(overlay.content_size) &&
         bytes_written != static_cast<ssize_t>(hdr._recorded_content_size))
     {
       bytes_written.note(
@@ -1249,19 +1632,19 @@ Session::write_body(HttpHeader const &hdr)
           swoc::bwf::If(hdr._chunked_p, " [chunked]"),
           key,
           bytes_written.result(),
-          hdr._content_size,
+          overlay.content_size,
           ec);
     }
   } else if (
       hdr._status && !HttpHeader::STATUS_NO_CONTENT[hdr._status] && !hdr._chunked_p &&
-      !hdr._content_length_p)
+      !overlay.content_length_p)
   {
     // Note the conditions:
     //
     //   1. This is a response since there is a hdr._status. Only responses
     //   have a status.
     //
-    //   2. There's no body since hdr._content_size must be zero in this code
+    //   2. There's no body since overlay.content_size must be zero in this code
     //   block (see the if condition matching this else).
     //
     //   3. The response headers give no indication that there is no more body
@@ -1391,7 +1774,7 @@ Session::run_transaction(Txn const &json_txn)
 
 Errata
 Session::run_transactions(
-    std::list<Txn> const &txn_list,
+    std::vector<Txn> const &txn_list,
     swoc::TextView interface,
     swoc::IPEndpoint const *real_target,
     double rate_multiplier)
@@ -1628,6 +2011,54 @@ Session::close()
   }
 }
 
+void
+Session::reset()
+{
+  this->close();
+  _body_offset = 0;
+}
+
+std::atomic<uint64_t> SessionPool::_num_acquired{0};
+std::atomic<uint64_t> SessionPool::_num_allocated{0};
+
+void
+SessionPool::release(std::unique_ptr<Session> session)
+{
+  if (session == nullptr) {
+    return;
+  }
+  if (!session->is_reusable()) {
+    return;
+  }
+  auto &free_list = _free_lists[std::type_index(typeid(*session))];
+  if (free_list.size() >= MAX_IDLE_SESSIONS_PER_TYPE) {
+    return;
+  }
+  session->reset();
+  free_list.push_back(std::move(session));
+}
+
+// static
+Errata
+SessionPool::report_allocation_statistics()
+{
+  Errata errata;
+  uint64_t const num_acquired = _num_acquired;
+  if (num_acquired == 0) {
+    return errata;
+  }
+  uint64_t const num_allocated = _num_allocated;
+  errata.note(
+      S_INFO,
+      "Session allocation: {} connection{}, {} Session object{} allocated, {} reused.",
+      num_acquired,
+      swoc::bwf::If(num_acquired != 1, "s"),
+      num_allocated,
+      swoc::bwf::If(num_allocated != 1, "s"),
+      num_acquired - num_allocated);
+  return errata;
+}
+
 Errata
 Session::init(int num_transactions)
 {
@@ -59,6 +59,7 @@ static ssize_t receive_nghttp2_request(
     milliseconds timeout);
 
 int *H2Session::process_exit_code = nullptr;
+nghttp2_session_callbacks *H2Session::_session_callbacks = nullptr;
 
 swoc::Rv<int>
 H2Session::poll_for_headers(chrono::milliseconds timeout)
@@ -257,7 +258,7 @@ H2Session::connect()
 
 Errata
 H2Session::run_transactions(
-    std::list<Txn> const &txn_list,
+    std::vector<Txn> const &txn_list,
     swoc::TextView interface,
     swoc::IPEndpoint const *real_target,
     double rate_multiplier)
@@ -938,13 +939,11 @@ H2StreamState::register_rcbuf(nghttp2_rcbuf *rcbuf)
   return TextView(reinterpret_cast<char *>(buf.base), buf.len);
 }
 
-H2Session::H2Session() : _session{nullptr}, _callbacks{nullptr}, _options{nullptr} { }
+H2Session::H2Session() : _session{nullptr} { }
 
 H2Session::H2Session(TextView const &client_sni, int client_verify_mode)
   : TLSSession(client_sni, client_verify_mode)
   , _session{nullptr}
-  , _callbacks{nullptr}
-  , _options{nullptr}
 {
 }
 
@@ -952,9 +951,20 @@ H2Session::~H2Session()
 {
   // This is safe to call upon a nullptr. Thus this is appropriate to be called
   // even if client_session_init or server_session_init has not been called.
-  nghttp2_session_callbacks_del(_callbacks);
   nghttp2_session_del(_session);
-  nghttp2_option_del(_options);
+}
+
+void
+H2Session::reset()
+{
+  super_type::reset();
+  nghttp2_session_del(_session);
+  _session = nullptr;
+  _h2_is_negotiated = false;
+  _is_server = false;
+  _stream_map.clear();
+  _ended_streams.clear();
+  _last_added_stream.reset();
 }
 
 swoc::Rv<ssize_t>
@@ -1022,10 +1032,10 @@ data_read_callback(
 }
 
 swoc::Rv<ssize_t>
-H2Session::write(HttpHeader const &hdr)
+H2Session::write(HttpHeader const &hdr, MessageOverlay const &overlay)
 {
   if (!_h2_is_negotiated) {
-    return Session::write(hdr);
+    return Session::write(hdr, overlay);
   }
   swoc::Rv<ssize_t> zret{0};
   int32_t stream_id = 0;
@@ -1033,7 +1043,7 @@ H2Session::write(HttpHeader const &hdr)
   H2StreamState *stream_state = nullptr;
   std::shared_ptr<H2StreamState> new_stream_state{nullptr};
   if (hdr.is_response()) {
-    stream_id = hdr._stream_id;
+    stream_id = overlay.stream_id;
     auto stream_map_iter = _stream_map.find(stream_id);
     if (stream_map_iter == _stream_map.end()) {
       zret.note(S_ERROR, "Could not find registered stream for stream id: {}", stream_id);
@@ -1046,26 +1056,36 @@ H2Session::write(HttpHeader const &hdr)
   }
 
   // grab header, send to session
-  // pack_headers will convert all the fields in hdr into nghttp2_nv structs
   int hdr_count = 0;
-  nghttp2_nv *hdrs = nullptr;
-  pack_headers(hdr, hdrs, hdr_count);
-  if (hdr.is_response()) {
-    stream_state->store_nv_response_headers_to_free(hdrs);
+  nghttp2_nv const *hdrs = nullptr;
+  if (hdr._h2_packed_headers) {
+    hdrs = hdr._h2_packed_headers->nva.data();
+    hdr_count = static_cast<int>(hdr._h2_packed_headers->nva.size());
+    HttpHeader::record_cached_serialization_sent();
   } else {
-    stream_state->store_nv_request_headers_to_free(hdrs);
+    // pack_headers will convert all the fields in hdr into nghttp2_nv structs
+    nghttp2_nv *packed_hdrs = nullptr;
+    pack_headers(hdr, packed_hdrs, hdr_count);
+    if (hdr.is_response()) {
+      stream_state->store_nv_response_headers_to_free(packed_hdrs);
+    } else {
+      stream_state->store_nv_request_headers_to_free(packed_hdrs);
+    }
+    hdrs = packed_hdrs;
   }
 
   stream_state->_key = hdr.get_key();
-  if (hdr._content_size > 0 && (hdr.is_request() || !HttpHeader::STATUS_NO_CONTENT[hdr._status])) {
+  if (overlay.content_size > 0 &&
+      (hdr.is_request() || !HttpHeader::STATUS_NO_CONTENT[hdr._status]))
+  {
     TextView content;
     if (hdr._content_data) {
-      content = TextView{hdr._content_data, hdr._content_size};
+      content = TextView{hdr._content_data, overlay.content_size};
     } else {
       // If hdr._content_data is null, then there was no explicit description
       // of the body data via the data node. Instead we'll use our generated
       // HttpHeader::_content.
-      content = TextView{HttpHeader::_content.data(), hdr._content_size};
+      content = TextView{HttpHeader::_content.load(), overlay.content_size};
     }
     nghttp2_data_provider data_prd;
     data_prd.source.fd = 0;
@@ -1136,14 +1156,11 @@ H2Session::write(HttpHeader const &hdr)
   return zret;
 }
 
+// static
 Errata
 H2Session::pack_headers(HttpHeader const &hdr, nghttp2_nv *&nv_hdr, int &hdr_count)
 {
   Errata errata;
-  if (!_h2_is_negotiated) {
-    errata.note(S_ERROR, "Should not be packing headers if h2 is not negotiated.");
-    return errata;
-  }
   hdr_count = hdr._fields_rules->_fields.size();
 
   if (!hdr._contains_pseudo_headers_in_fields_array) {
@@ -1182,6 +1199,36 @@ H2Session::pack_headers(HttpHeader const &hdr, nghttp2_nv *&nv_hdr, int &hdr_cou
   return errata;
 }
 
+// static
+Errata
+H2Session::cache_packed_headers(HttpHeader &hdr)
+{
+  auto const start = ClockType::now();
+  nghttp2_nv *nva = nullptr;
+  int hdr_count = 0;
+  Errata errata = pack_headers(hdr, nva, hdr_count);
+  if (!errata.is_ok()) {
+    errata.note(S_ERROR, "Could not cache the HTTP/2 headers for key: {}", hdr.get_key());
+    free(nva);
+    return errata;
+  }
+  auto packed = std::make_shared<H2PackedHeaders>();
+  packed->fields = hdr._fields_rules;
+  packed->status = hdr._status_string;
+  packed->nva.assign(nva, nva + hdr_count);
+  free(nva);
+  if (hdr.is_response()) {
+    // Reference the cache's copy of the status rather than hdr's so the array
+    // remains valid however hdr is copied.
+    packed->nva[0].value = reinterpret_cast<uint8_t *>(packed->status.data());
+  }
+  hdr._h2_packed_headers = std::move(packed);
+  HttpHeader::record_cached_serialization(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(ClockType::now() - start));
+  return errata;
+}
+
+// static
 nghttp2_nv
 H2Session::tv_to_nv(char const *name, TextView v)
 {
@@ -1223,6 +1270,7 @@ H2Session::init(int *process_exit_code)
   H2Session::process_exit_code = process_exit_code;
   Errata errata = H2Session::client_init(h2_client_context);
   errata.note(H2Session::server_init(server_context));
+  errata.note(H2Session::callbacks_init());
   errata.note(S_DIAG, "Finished H2Session::init");
   return errata;
 }
@@ -1231,6 +1279,8 @@ H2Session::init(int *process_exit_code)
 void
 H2Session::terminate()
 {
+  nghttp2_session_callbacks_del(_session_callbacks);
+  _session_callbacks = nullptr;
   // H2Session uses the same context as TLSSession::server_context, which is
   // cleaned up via TLSSession::init().
   return H2Session::terminate(h2_client_context);
@@ -1299,39 +1349,12 @@ Errata
 H2Session::client_session_init()
 {
   Errata errata;
-
-  // Set up the H2 callback methods
-  int ret = nghttp2_session_callbacks_new(&this->_callbacks);
-
-  if (ret != 0) {
-    errata.note(S_ERROR, "nghttp2_session_callbacks_new {}", ret);
-  }
-
-  if (0 != nghttp2_option_new(&_options)) {
-    errata.note(S_ERROR, "nghttp2_option_new could not allocate memory.");
+  // A reconnect replaces the session of the previous connection.
+  nghttp2_session_del(_session);
+  _session = nullptr;
+  if (0 != nghttp2_session_client_new(&this->_session, _session_callbacks, this)) {
+    errata.note(S_ERROR, "nghttp2_session_client_new could not initialize a new session.");
   }
-  nghttp2_option_set_no_closed_streams(_options, 1);
-  nghttp2_option_set_max_deflate_dynamic_table_size(_options, 0);
-
-  nghttp2_session_callbacks_set_on_begin_headers_callback(
-      this->_callbacks,
-      on_begin_headers_callback);
-  nghttp2_session_callbacks_set_on_header_callback2(this->_callbacks, on_header_callback);
-
-  // Note that instead of using the nghttp2_session_callbacks_set_send_callback
-  // and nghttp2_session_callbacks_set_recv_callback, we manually drive things
-  // along via our use of nghttp2_session_mem_recv and
-  // nghttp2_session_mem_send.
-
-  nghttp2_session_callbacks_set_on_frame_send_callback(this->_callbacks, on_frame_send_cb);
-  nghttp2_session_callbacks_set_on_frame_recv_callback(this->_callbacks, on_frame_recv_cb);
-  nghttp2_session_callbacks_set_on_stream_close_callback(this->_callbacks, on_stream_close_cb);
-  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
-      this->_callbacks,
-      on_data_chunk_recv_cb);
-
-  nghttp2_session_client_new(&this->_session, this->_callbacks, this);
-
   return errata;
 }
 
@@ -1345,42 +1368,44 @@ H2Session::server_session_init()
 
   _is_server = true;
 
-  // Set up the H2 callback methods
-  auto ret = nghttp2_session_callbacks_new(&this->_callbacks);
-  if (0 != ret) {
-    errata.note(S_ERROR, "nghttp2_session_callbacks_new {}", ret);
+  nghttp2_session_del(_session);
+  _session = nullptr;
+  if (0 != nghttp2_session_server_new(&this->_session, _session_callbacks, this)) {
+    errata.note(S_ERROR, "nghttp2_session_server_new could not initialize a new session.");
     return errata;
   }
 
-  if (0 != nghttp2_option_new(&_options)) {
-    errata.note(S_ERROR, "nghttp2_option_new could not allocate memory.");
+  return errata;
+}
+
+// static
+Errata
+H2Session::callbacks_init()
+{
+  Errata errata;
+  if (_session_callbacks != nullptr) {
+    return errata;
+  }
+  auto const ret = nghttp2_session_callbacks_new(&_session_callbacks);
+  if (0 != ret) {
+    errata.note(S_ERROR, "nghttp2_session_callbacks_new {}", ret);
     return errata;
   }
-  nghttp2_option_set_no_closed_streams(_options, 1);
-  nghttp2_option_set_max_deflate_dynamic_table_size(_options, 0);
-
-  nghttp2_session_callbacks_set_on_header_callback2(this->_callbacks, on_header_callback);
   nghttp2_session_callbacks_set_on_begin_headers_callback(
-      this->_callbacks,
+      _session_callbacks,
       on_begin_headers_callback);
+  nghttp2_session_callbacks_set_on_header_callback2(_session_callbacks, on_header_callback);
 
   // Note that instead of using the nghttp2_session_callbacks_set_send_callback
   // and nghttp2_session_callbacks_set_recv_callback, we manually drive things
   // along via our use of nghttp2_session_mem_recv and
   // nghttp2_session_mem_send.
 
-  nghttp2_session_callbacks_set_on_frame_send_callback(this->_callbacks, on_frame_send_cb);
-  nghttp2_session_callbacks_set_on_frame_recv_callback(this->_callbacks, on_frame_recv_cb);
-  nghttp2_session_callbacks_set_on_stream_close_callback(this->_callbacks, on_stream_close_cb);
+  nghttp2_session_callbacks_set_on_frame_send_callback(_session_callbacks, on_frame_send_cb);
+  nghttp2_session_callbacks_set_on_frame_recv_callback(_session_callbacks, on_frame_recv_cb);
+  nghttp2_session_callbacks_set_on_stream_close_callback(_session_callbacks, on_stream_close_cb);
   nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
-      this->_callbacks,
+      _session_callbacks,
       on_data_chunk_recv_cb);
-
-  ret = nghttp2_session_server_new(&this->_session, this->_callbacks, this);
-  if (0 != ret) {
-    errata.note(S_ERROR, "nghttp2_session_server_new could not initialize a new session.");
-    return errata;
-  }
-
   return errata;
 }
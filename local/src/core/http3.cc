@@ -1656,7 +1656,7 @@ H3Session::connect()
 
 Errata
 H3Session::run_transactions(
-    std::list<Txn> const &transactions,
+    std::vector<Txn> const &transactions,
     swoc::TextView interface,
     swoc::IPEndpoint const *target,
     double rate_multiplier)
@@ -1776,6 +1776,10 @@ H3Session::H3Session(TextView const &client_sni, int client_verify_mode)
 H3Session::~H3Session()
 {
   _last_added_stream.reset();
+  if (_session_to_resume != nullptr) {
+    SSL_SESSION_free(_session_to_resume);
+    _session_to_resume = nullptr;
+  }
   char buffer[NGTCP2_MAX_UDP_PAYLOAD_SIZE] = {0};
   ngtcp2_tstamp ts = 0;
   ngtcp2_ssize rc = 0;
@@ -1800,6 +1804,38 @@ H3Session::~H3Session()
   }
 }
 
+void
+H3Session::set_session_to_resume(SSL_SESSION *session)
+{
+  if (session != nullptr) {
+    SSL_SESSION_up_ref(session);
+  }
+  if (_session_to_resume != nullptr) {
+    SSL_SESSION_free(_session_to_resume);
+  }
+  _session_to_resume = session;
+}
+
+SSL_SESSION *
+H3Session::get1_resumable_session() const
+{
+  if (quic_socket.ssl == nullptr) {
+    return nullptr;
+  }
+  SSL_SESSION *session = SSL_get1_session(quic_socket.ssl);
+  if (session != nullptr && !SSL_SESSION_is_resumable(session)) {
+    SSL_SESSION_free(session);
+    session = nullptr;
+  }
+  return session;
+}
+
+bool
+H3Session::is_session_reused() const
+{
+  return quic_socket.ssl != nullptr && SSL_session_reused(quic_socket.ssl) == 1;
+}
+
 swoc::Rv<ssize_t> H3Session::read(swoc::MemSpan<char> /* span */)
 {
   swoc::Rv<ssize_t> zret{0};
@@ -1814,6 +1850,7 @@ swoc::Rv<ssize_t> H3Session::write(TextView /* data */)
   return zret;
 }
 
+// static
 nghttp3_nv
 H3Session::tv_to_nv(char const *name, TextView v)
 {
@@ -1828,6 +1865,7 @@ H3Session::tv_to_nv(char const *name, TextView v)
   return res;
 }
 
+// static
 Errata
 H3Session::pack_headers(HttpHeader const &hdr, nghttp3_nv *&nv_hdr, int &hdr_count)
 {
@@ -1852,17 +1890,46 @@ H3Session::pack_headers(HttpHeader const &hdr, nghttp3_nv *&nv_hdr, int &hdr_cou
   return errata;
 }
 
+// static
+Errata
+H3Session::cache_packed_headers(HttpHeader &hdr)
+{
+  auto const start = ClockType::now();
+  nghttp3_nv *nva = nullptr;
+  int hdr_count = 0;
+  Errata errata = pack_headers(hdr, nva, hdr_count);
+  if (!errata.is_ok()) {
+    errata.note(S_ERROR, "Could not cache the HTTP/3 headers for key: {}", hdr.get_key());
+    free(nva);
+    return errata;
+  }
+  auto packed = std::make_shared<H3PackedHeaders>();
+  packed->fields = hdr._fields_rules;
+  packed->status = hdr._status_string;
+  packed->nva.assign(nva, nva + hdr_count);
+  free(nva);
+  if (hdr.is_response()) {
+    // Reference the cache's copy of the status rather than hdr's so the array
+    // remains valid however hdr is copied.
+    packed->nva[0].value = reinterpret_cast<uint8_t *>(packed->status.data());
+  }
+  hdr._h3_packed_headers = std::move(packed);
+  HttpHeader::record_cached_serialization(
+      chrono::duration_cast<chrono::nanoseconds>(ClockType::now() - start));
+  return errata;
+}
+
 swoc::Rv<ssize_t>
-H3Session::write(HttpHeader const &hdr)
+H3Session::write(HttpHeader const &hdr, MessageOverlay const &overlay)
 {
   swoc::Rv<ssize_t> zret{0};
 
-  auto const key = hdr.get_key();
+  auto const &key = hdr.get_key();
   H3StreamState *stream_state = nullptr;
   std::shared_ptr<H3StreamState> new_stream_state{nullptr};
   int64_t stream_id = 0;
   if (hdr.is_response()) {
-    stream_id = hdr._stream_id;
+    stream_id = overlay.stream_id;
     auto stream_map_iter = stream_map.find(stream_id);
     if (stream_map_iter == stream_map.end()) {
       zret.note(S_ERROR, "Could not find registered stream for stream id: {}", stream_id);
@@ -1889,24 +1956,35 @@ H3Session::write(HttpHeader const &hdr)
   }
   stream_state->key = key;
 
-  int num_headers;
-  nghttp3_nv *nva = nullptr;
-  zret.note(pack_headers(hdr, nva, num_headers));
-  if (!zret.is_ok()) {
-    zret.note(S_ERROR, "Failed to pack headers for key: {}", key);
-    return zret;
+  int num_headers = 0;
+  nghttp3_nv *packed_nva = nullptr;
+  nghttp3_nv const *nva = nullptr;
+  if (hdr._h3_packed_headers) {
+    nva = hdr._h3_packed_headers->nva.data();
+    num_headers = static_cast<int>(hdr._h3_packed_headers->nva.size());
+    HttpHeader::record_cached_serialization_sent();
+  } else {
+    zret.note(pack_headers(hdr, packed_nva, num_headers));
+    if (!zret.is_ok()) {
+      zret.note(S_ERROR, "Failed to pack headers for key: {}", key);
+      free(packed_nva);
+      return zret;
+    }
+    nva = packed_nva;
   }
 
   int submit_result = 0;
-  if (hdr._content_size > 0 && (hdr.is_request() || !HttpHeader::STATUS_NO_CONTENT[hdr._status])) {
+  if (overlay.content_size > 0 &&
+      (hdr.is_request() || !HttpHeader::STATUS_NO_CONTENT[hdr._status]))
+  {
     TextView content;
     if (hdr._content_data) {
-      content = TextView{hdr._content_data, hdr._content_size};
+      content = TextView{hdr._content_data, overlay.content_size};
     } else {
       // If hdr._content_data is null, then there was no explicit description
       // of the body data via the data node. Instead we'll use our generated
       // HttpHeader::_content.
-      content = TextView{HttpHeader::_content.data(), hdr._content_size};
+      content = TextView{HttpHeader::_content.load(), overlay.content_size};
     }
     nghttp3_data_reader data_reader;
     data_reader.read_data = cb_h3_readfunction;
@@ -1969,7 +2047,7 @@ H3Session::write(HttpHeader const &hdr)
   if (ngtcp2_flush_egress(*this) < 0) {
     zret.note(S_ERROR, "Failure calling ngtcp2_flush_egress while writing headers.");
   }
-  free(nva);
+  free(packed_nva);
   return zret;
 }
 
@@ -2027,6 +2105,12 @@ H3Session::client_ssl_ctx_init(SSL_CTX *&client_context)
     return errata;
   }
 
+  // Let any user-specified cipher suites and groups override the defaults.
+  errata.note(TLSSession::apply_client_handshake_options(client_context));
+  if (!errata.is_ok()) {
+    return errata;
+  }
+
   if (SSL_CTX_set_quic_method(client_context, &ssl_quic_method) == 0) {
     errata.note(S_ERROR, "SSL_CTX_set_quic_method failed: {}", swoc::bwf::SSLError{});
     return errata;
@@ -2069,6 +2153,9 @@ H3Session::client_ssl_session_init(SSL_CTX *client_context)
   }
   SSL_set_connect_state(quic_socket.ssl);
   SSL_set_quic_use_legacy_codepoint(quic_socket.ssl, 0);
+  if (_session_to_resume != nullptr) {
+    SSL_set_session(quic_socket.ssl, _session_to_resume);
+  }
 
   alpn = reinterpret_cast<uint8_t const *>(H3_ALPN_H3_29_H3.data());
   alpnlen = H3_ALPN_H3_29_H3.size();
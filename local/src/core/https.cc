@@ -28,11 +28,33 @@ using namespace std::literals;
 namespace chrono = std::chrono;
 using chrono::milliseconds;
 
-std::unordered_map<std::string, TLSHandshakeBehavior> TLSSession::_handshake_behavior_per_sni;
+std::shared_ptr<SniHandshakeTable const> TLSSession::_current_sni_handshake_table;
+std::atomic<uint64_t> TLSSession::_num_full_handshakes{0};
+std::atomic<uint64_t> TLSSession::_num_resumed_handshakes{0};
+std::atomic<uint64_t> TLSSession::_num_sni_context_hits{0};
+bool TLSSession::_ktls_is_enabled = false;
+std::atomic<uint64_t> TLSSession::_num_ktls_offloaded{0};
+std::atomic<uint64_t> TLSSession::_num_ktls_partially_offloaded{0};
+std::atomic<uint64_t> TLSSession::_num_ktls_not_offloaded{0};
+std::atomic<uint64_t> TLSSession::_num_ssl_allocations{0};
+std::atomic<uint64_t> TLSSession::_num_ssl_reuses{0};
 
 std::mutex TLSSession::tls_secrets_log_file_fd_mutex;
 int TLSSession::tls_secrets_log_file_fd = -1;
 swoc::file::path TLSSession::tls_secrets_log_file;
+swoc::file::path TLSSession::session_ticket_key_file;
+std::string TLSSession::_client_cipher_list;
+std::string TLSSession::_client_ciphersuites;
+std::string TLSSession::_client_groups;
+
+/// The session ID context shared by all server contexts so that sessions
+/// established on one per-SNI context can be resumed on another.
+static constexpr unsigned char SERVER_SESSION_ID_CONTEXT[] = "proxy-verifier";
+
+/// The number of bytes of key material OpenSSL expects for
+/// SSL_CTX_set_tlsext_ticket_keys: a 16 byte key name, a 32 byte HMAC secret,
+/// and a 32 byte AES key.
+static constexpr size_t TICKET_KEYS_LENGTH = 80;
 
 namespace swoc
 {
@@ -88,7 +110,7 @@ alpn_select_next_proto_cb(
     unsigned char *outlen,
     unsigned char const *in,
     unsigned int inlen,
-    void * /* arg */)
+    void *arg)
 {
   /* It's easier to get the SNI here than in the client_hello_callback because
    * we can use SSL_get_servername here. Per the OpenSSL documentation of
@@ -103,8 +125,18 @@ alpn_select_next_proto_cb(
   unsigned char const *alpn = protocol_negotiation_string;
   int alpn_len = protocol_negotiation_len;
 
-  if (sni != nullptr) {
-    std::string_view alpn_protocol_string = TLSSession::get_alpn_protocol_string_for_sni(sni);
+  if (arg != nullptr) {
+    // This is a per-SNI context: the behavior was resolved when the context
+    // was built.
+    auto const *behavior = static_cast<TLSHandshakeBehavior const *>(arg);
+    std::string_view alpn_protocol_string = behavior->get_alpn_wire_string();
+    if (!alpn_protocol_string.empty()) {
+      alpn = reinterpret_cast<unsigned char const *>(alpn_protocol_string.data());
+      alpn_len = alpn_protocol_string.size();
+    }
+  } else if (sni != nullptr) {
+    std::string_view alpn_protocol_string =
+        TLSSession::get_alpn_protocol_string_for_sni(ssl, sni);
     if (!alpn_protocol_string.empty()) {
       alpn = reinterpret_cast<unsigned char const *>(alpn_protocol_string.data());
       alpn_len = alpn_protocol_string.size();
@@ -216,6 +248,41 @@ TLSHandshakeBehavior::get_alpn_wire_string() const
   return _alpn_wire_string;
 }
 
+SniHandshakeTable::~SniHandshakeTable()
+{
+  for (auto &[sni, context] : _server_context_per_sni) {
+    SSL_CTX_free(context);
+  }
+}
+
+void
+SniHandshakeTable::register_tls_handshake_behavior(
+    std::string_view sni,
+    TLSHandshakeBehavior &&handshake_behavior)
+{
+  _handshake_behavior_per_sni.emplace(sni, std::move(handshake_behavior));
+}
+
+size_t
+SniHandshakeTable::size() const
+{
+  return _handshake_behavior_per_sni.size();
+}
+
+void
+SniHandshakeTable::merge(SniHandshakeTable &&other)
+{
+  for (auto &[sni, handshake_behavior] : other._handshake_behavior_per_sni) {
+    _handshake_behavior_per_sni.emplace(sni, std::move(handshake_behavior));
+  }
+}
+
+std::unordered_map<std::string, TLSHandshakeBehavior> const &
+SniHandshakeTable::get_handshake_behaviors() const
+{
+  return _handshake_behavior_per_sni;
+}
+
 TLSSession::TLSSession(TextView const &client_sni, int client_verify_mode)
   : _client_sni{client_sni}
   , _client_verify_mode{client_verify_mode}
@@ -228,6 +295,102 @@ TLSSession::~TLSSession()
     SSL_free(_ssl);
     _ssl = nullptr;
   }
+  if (_session_to_resume != nullptr) {
+    SSL_SESSION_free(_session_to_resume);
+    _session_to_resume = nullptr;
+  }
+}
+
+void
+TLSSession::set_client_tls_options(TextView client_sni, int client_verify_mode)
+{
+  _client_sni = client_sni;
+  _client_verify_mode = client_verify_mode;
+}
+
+void
+TLSSession::set_session_to_resume(SSL_SESSION *session)
+{
+  if (session != nullptr) {
+    SSL_SESSION_up_ref(session);
+  }
+  if (_session_to_resume != nullptr) {
+    SSL_SESSION_free(_session_to_resume);
+  }
+  _session_to_resume = session;
+}
+
+swoc::Rv<SSL_SESSION *>
+TLSSession::get1_resumable_session(chrono::milliseconds timeout)
+{
+  swoc::Rv<SSL_SESSION *> zret{nullptr};
+  if (_ssl == nullptr) {
+    return zret;
+  }
+  SSL_SESSION *session = SSL_get1_session(_ssl);
+  if (session != nullptr && SSL_SESSION_is_resumable(session)) {
+    zret = session;
+    return zret;
+  }
+  SSL_SESSION_free(session);
+  if (SSL_version(_ssl) < TLS1_3_VERSION) {
+    return zret;
+  }
+  // TLS 1.3 tickets arrive after the handshake. Peek so that OpenSSL
+  // processes the post-handshake messages without consuming any application
+  // data.
+  char buf[1];
+  int retval = SSL_peek(_ssl, buf, sizeof(buf));
+  if (retval <= 0 && SSL_get_error(_ssl, retval) == SSL_ERROR_WANT_READ) {
+    auto &&[poll_return, poll_errata] = poll_for_data_on_socket(timeout, POLLIN);
+    zret.note(std::move(poll_errata));
+    if (poll_return > 0) {
+      SSL_peek(_ssl, buf, sizeof(buf));
+    }
+  }
+  session = SSL_get1_session(_ssl);
+  if (session != nullptr && SSL_SESSION_is_resumable(session)) {
+    zret = session;
+  } else {
+    SSL_SESSION_free(session);
+    zret.note(S_DIAG, "No resumable session was received within {}.", timeout);
+  }
+  return zret;
+}
+
+Errata
+TLSSession::prepare_ssl(SSL_CTX *context)
+{
+  Errata errata;
+  if (_ssl != nullptr && _ssl_context == context && SSL_clear(_ssl) == 1) {
+    if (SSL_get_SSL_CTX(_ssl) != context) {
+      // A per-SNI context was swapped in for the previous connection.
+      SSL_set_SSL_CTX(_ssl, context);
+    }
+    // The client hello callback or connect may have changed these for the
+    // previous connection.
+    SSL_set_verify(_ssl, SSL_CTX_get_verify_mode(context), nullptr);
+    // A new SSL object would not attempt to resume the previous session.
+    SSL_set_session(_ssl, nullptr);
+    ++_num_ssl_reuses;
+    return errata;
+  }
+  if (_ssl != nullptr) {
+    SSL_free(_ssl);
+  }
+  _ssl = SSL_new(context);
+  _ssl_context = context;
+  if (_ssl == nullptr) {
+    errata.note(
+        S_ERROR,
+        R"(Failed to create SSL object fd={} context={} err={}.)",
+        get_fd(),
+        context,
+        swoc::bwf::SSLError{});
+    return errata;
+  }
+  ++_num_ssl_allocations;
+  return errata;
 }
 
 swoc::Rv<ssize_t>
@@ -236,6 +399,11 @@ TLSSession::read(swoc::MemSpan<char> span)
   if (this->is_closed()) {
     return swoc::Rv<ssize_t>{0};
   }
+  // Reads continue to go through SSL_read even if the receive side is
+  // offloaded to the kernel: a plain read() fails with EIO on non-application
+  // records (such as post-handshake session tickets or alerts), which OpenSSL
+  // handles for us via recvmsg. With kTLS, OpenSSL performs no decryption
+  // itself.
   swoc::Rv<ssize_t> zret{SSL_read(this->_ssl, span.data(), span.size())};
 
   if (zret <= 0) {
@@ -264,6 +432,10 @@ TLSSession::read(swoc::MemSpan<char> span)
 swoc::Rv<ssize_t>
 TLSSession::write(TextView view)
 {
+  if (_ktls_send) {
+    // The kernel encrypts the records, so this is a plain socket write.
+    return Session::write(view);
+  }
   TextView remaining = view;
   swoc::Rv<ssize_t> num_written = 0;
   static int write_count = 0;
@@ -340,17 +512,15 @@ TLSSession::poll_for_data_on_ssl_socket(chrono::milliseconds timeout, int ssl_er
 Errata
 TLSSession::accept()
 {
-  Errata errata;
-  _ssl = SSL_new(server_context);
-  if (_ssl == nullptr) {
-    errata.note(
-        S_ERROR,
-        R"(Failed to create SSL server object fd={} server_context={} err={}.)",
-        get_fd(),
-        server_context,
-        swoc::bwf::SSLError{});
+  Errata errata = prepare_ssl(server_context);
+  if (!errata.is_ok()) {
+    errata.note(S_ERROR, R"(Failed to create SSL server object.)");
     return errata;
   }
+  // Hold the current table for the handshake so that the handshake callbacks,
+  // which find it via the SSL object, are not affected by a reload.
+  _sni_handshake_table = std::atomic_load(&_current_sni_handshake_table);
+  SSL_set_app_data(_ssl, const_cast<SniHandshakeTable *>(_sni_handshake_table.get()));
   if (SSL_set_fd(_ssl, get_fd()) == 0) {
     errata.note(S_ERROR, R"(Failed SSL_set_fd: {}.)", swoc::bwf::SSLError{});
     return errata;
@@ -388,6 +558,15 @@ TLSSession::accept()
     // Poll succeeded.
     retval = SSL_accept(_ssl);
   }
+  if (retval == 1) {
+    if (SSL_session_reused(_ssl)) {
+      ++_num_resumed_handshakes;
+      errata.note(S_DIAG, "Resumed a previous TLS session.");
+    } else {
+      ++_num_full_handshakes;
+    }
+    errata.note(detect_ktls_offload());
+  }
   errata.note(S_DIAG, "Finished accept using TLSSession");
   return errata;
 }
@@ -401,20 +580,20 @@ TLSSession::connect()
 Errata
 TLSSession::connect(SSL_CTX *client_context)
 {
-  Errata errata;
-  _ssl = SSL_new(client_context);
-  if (_ssl == nullptr) {
-    errata.note(
-        S_ERROR,
-        R"(Failed to create SSL client object fd={} client_context={} err={}.)",
-        get_fd(),
-        client_context,
-        swoc::bwf::SSLError{});
+  Errata errata = prepare_ssl(client_context);
+  if (!errata.is_ok()) {
+    errata.note(S_ERROR, R"(Failed to create SSL client object.)");
     return errata;
   }
   SSL_set_fd(_ssl, get_fd());
+  if (_session_to_resume != nullptr) {
+    SSL_set_session(_ssl, _session_to_resume);
+  }
   if (!_client_sni.empty()) {
     SSL_set_tlsext_host_name(_ssl, _client_sni.c_str());
+  } else {
+    // Clear any SNI left on a reused SSL object by a previous connection.
+    SSL_set_tlsext_host_name(_ssl, nullptr);
   }
   if (_client_verify_mode != SSL_VERIFY_NONE) {
     errata.note(
@@ -459,6 +638,10 @@ TLSSession::connect(SSL_CTX *client_context)
     retval = SSL_connect(_ssl);
   }
 
+  if (retval == 1) {
+    errata.note(detect_ktls_offload());
+  }
+
   auto const verify_result = SSL_get_verify_result(_ssl);
   errata.note(
       S_DIAG,
@@ -472,14 +655,50 @@ void
 TLSSession::close()
 {
   if (!this->is_closed()) {
-    if (_ssl != nullptr) {
-      SSL_free(_ssl);
-      _ssl = nullptr;
-    }
+    _ktls_send = false;
+    _ktls_recv = false;
     super_type::close();
   }
 }
 
+void
+TLSSession::reset()
+{
+  super_type::reset();
+  _client_sni.clear();
+  _client_verify_mode = SSL_VERIFY_NONE;
+  set_session_to_resume(nullptr);
+  _sni_handshake_table.reset();
+}
+
+Errata
+TLSSession::detect_ktls_offload()
+{
+  Errata errata;
+  if (!_ktls_is_enabled) {
+    return errata;
+  }
+#ifdef SSL_OP_ENABLE_KTLS
+  _ktls_send = BIO_get_ktls_send(SSL_get_wbio(_ssl)) == 1;
+  _ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(_ssl)) == 1;
+#endif
+  if (_ktls_send && _ktls_recv) {
+    ++_num_ktls_offloaded;
+  } else if (_ktls_send || _ktls_recv) {
+    ++_num_ktls_partially_offloaded;
+  } else {
+    ++_num_ktls_not_offloaded;
+  }
+  errata.note(
+      S_DIAG,
+      "kTLS offload for fd {} with cipher {}: send: {}, receive: {}.",
+      get_fd(),
+      SSL_get_cipher_name(_ssl),
+      _ktls_send ? "kernel" : "user space",
+      _ktls_recv ? "kernel" : "user space");
+  return errata;
+}
+
 swoc::file::path TLSSession::certificate_file;
 swoc::file::path TLSSession::privatekey_file;
 swoc::file::path TLSSession::ca_certificate_file;
@@ -508,6 +727,7 @@ TLSSession::terminate()
 {
   TLSSession::terminate(client_context);
   TLSSession::terminate(server_context);
+  set_sni_handshake_table(nullptr);
 }
 
 // static
@@ -599,13 +819,23 @@ client_hello_callback(SSL *ssl, int * /* al */, void * /* arg */)
   if (client_sni == nullptr) {
     return ret;
   }
-  errata.note(S_DIAG, R"(Accepted a TLS connection with an SNI of: {}.)", client_sni);
+  std::string_view const sni{client_sni, len};
+  errata.note(S_DIAG, R"(Accepted a TLS connection with an SNI of: {}.)", sni);
+
+  if (auto *sni_context = TLSSession::get_context_for_sni(ssl, sni); sni_context != nullptr) {
+    // The per-SNI context already carries the certificates, verify mode and
+    // ALPN selection for this SNI. SSL_set_SSL_CTX does not transfer the
+    // verify mode to an existing SSL object, so that is applied explicitly.
+    SSL_set_SSL_CTX(ssl, sni_context);
+    SSL_set_verify(ssl, SSL_CTX_get_verify_mode(sni_context), nullptr);
+    return ret;
+  }
 
-  auto const verify_mode = TLSSession::get_verify_mode_for_sni(client_sni);
+  auto const verify_mode = TLSSession::get_verify_mode_for_sni(ssl, sni);
   if (verify_mode == SSL_VERIFY_NONE) {
     return ret;
   }
-  errata.note(S_DIAG, R"(Sending a certificate request to client with SNI: {}.)", client_sni);
+  errata.note(S_DIAG, R"(Sending a certificate request to client with SNI: {}.)", sni);
 
   SSL_set_verify(ssl, verify_mode, nullptr /* no callback specified */);
 
@@ -613,7 +843,7 @@ client_hello_callback(SSL *ssl, int * /* al */, void * /* arg */)
   errata.note(
       S_DIAG,
       R"(Client TLS verification result for client with SNI {}: {}.)",
-      client_sni,
+      sni,
       (verify_result == X509_V_OK ? "passed" : "failed"));
   return ret;
 }
@@ -801,10 +1031,12 @@ TLSSession::client_init(SSL_CTX *&client_context)
     return errata;
   }
   errata.note(configure_certificates(client_context));
+  errata.note(apply_client_handshake_options(client_context));
 
   if (tls_secrets_are_being_logged()) {
     SSL_CTX_set_keylog_callback(client_context, keylog_callback);
   }
+  apply_ktls_option(client_context);
   return errata;
 }
 
@@ -826,6 +1058,46 @@ TLSSession::server_init(SSL_CTX *&server_context)
   if (tls_secrets_are_being_logged()) {
     SSL_CTX_set_keylog_callback(server_context, keylog_callback);
   }
+  apply_ktls_option(server_context);
+
+  // Session resumption. Tickets are encrypted with the keys of the context
+  // the SSL object was created from, which is always this one, so the keys
+  // only need to be installed here even when a per-SNI context is swapped in.
+  SSL_CTX_set_session_cache_mode(server_context, SSL_SESS_CACHE_SERVER);
+  SSL_CTX_set_session_id_context(
+      server_context,
+      SERVER_SESSION_ID_CONTEXT,
+      sizeof(SERVER_SESSION_ID_CONTEXT) - 1);
+  if (!session_ticket_key_file.empty()) {
+    std::error_code ec;
+    std::string const keys = swoc::file::load(session_ticket_key_file, ec);
+    if (ec.value() != 0) {
+      errata.note(
+          S_ERROR,
+          R"(Failed to load the session ticket key file "{}": {}.)",
+          session_ticket_key_file,
+          ec);
+    } else if (keys.size() < TICKET_KEYS_LENGTH) {
+      errata.note(
+          S_ERROR,
+          R"(The session ticket key file "{}" must contain at least {} bytes, found {}.)",
+          session_ticket_key_file,
+          TICKET_KEYS_LENGTH,
+          keys.size());
+    } else if (!SSL_CTX_set_tlsext_ticket_keys(
+                   server_context,
+                   const_cast<char *>(keys.data()),
+                   TICKET_KEYS_LENGTH))
+    {
+      errata.note(
+          S_ERROR,
+          R"(Failed to set the session ticket keys from "{}": {}.)",
+          session_ticket_key_file,
+          swoc::bwf::SSLError{});
+    } else {
+      errata.note(S_DIAG, "Using session ticket keys from: {}", session_ticket_key_file);
+    }
+  }
 
   return errata;
 }
@@ -840,19 +1112,21 @@ TLSSession::terminate(SSL_CTX *&context)
 
 // static
 void
-TLSSession::register_tls_handshake_behavior(
-    std::string_view sni,
-    TLSHandshakeBehavior &&handshake_behavior)
+TLSSession::set_sni_handshake_table(std::shared_ptr<SniHandshakeTable const> table)
 {
-  _handshake_behavior_per_sni.emplace(sni, std::move(handshake_behavior));
+  std::atomic_store(&_current_sni_handshake_table, std::move(table));
 }
 
 // static
 int
-TLSSession::get_verify_mode_for_sni(std::string_view sni)
+TLSSession::get_verify_mode_for_sni(SSL *ssl, std::string_view sni)
 {
-  auto const it = _handshake_behavior_per_sni.find(std::string(sni));
-  if (it == _handshake_behavior_per_sni.end()) {
+  auto const *table = static_cast<SniHandshakeTable const *>(SSL_get_app_data(ssl));
+  if (table == nullptr) {
+    return SSL_VERIFY_NONE;
+  }
+  auto const it = table->_handshake_behavior_per_sni.find(std::string(sni));
+  if (it == table->_handshake_behavior_per_sni.end()) {
     return SSL_VERIFY_NONE;
   }
   return it->second.get_verify_mode();
@@ -860,11 +1134,264 @@ TLSSession::get_verify_mode_for_sni(std::string_view sni)
 
 // static
 std::string_view
-TLSSession::get_alpn_protocol_string_for_sni(std::string_view sni)
+TLSSession::get_alpn_protocol_string_for_sni(SSL *ssl, std::string_view sni)
 {
-  auto const it = _handshake_behavior_per_sni.find(std::string(sni));
-  if (it == _handshake_behavior_per_sni.end()) {
+  auto const *table = static_cast<SniHandshakeTable const *>(SSL_get_app_data(ssl));
+  if (table == nullptr) {
+    return "";
+  }
+  auto const it = table->_handshake_behavior_per_sni.find(std::string(sni));
+  if (it == table->_handshake_behavior_per_sni.end()) {
     return "";
   }
   return it->second.get_alpn_wire_string();
 }
+
+// static
+Errata
+TLSSession::configure_session_tickets(std::string_view ticket_key_file)
+{
+  Errata errata;
+  if (ticket_key_file.empty()) {
+    return errata;
+  }
+  std::error_code ec;
+  swoc::file::path key_path = swoc::file::absolute(swoc::file::path{ticket_key_file}, ec);
+  if (ec.value() != 0) {
+    errata.note(
+        S_ERROR,
+        R"(Could not get absolute path for the session ticket key file "{}": {}.)",
+        ticket_key_file,
+        ec);
+    return errata;
+  }
+  session_ticket_key_file = key_path;
+  return errata;
+}
+
+// static
+Errata
+TLSSession::build_sni_context_cache(SniHandshakeTable &table)
+{
+  Errata errata;
+  X509 *certificate = SSL_CTX_get0_certificate(server_context);
+  EVP_PKEY *private_key = SSL_CTX_get0_privatekey(server_context);
+  X509_STORE *ca_store = SSL_CTX_get_cert_store(server_context);
+  for (auto const &[sni, behavior] : table._handshake_behavior_per_sni) {
+    if (table._server_context_per_sni.find(sni) != table._server_context_per_sni.end()) {
+      continue;
+    }
+    SSL_CTX *context = SSL_CTX_new(TLS_server_method());
+    if (context == nullptr) {
+      errata.note(
+          S_ERROR,
+          R"(Failed to create a server context for SNI "{}": {}.)",
+          sni,
+          swoc::bwf::SSLError{});
+      return errata;
+    }
+    // Share the already loaded certificates rather than reloading them from
+    // disk for each SNI.
+    if (certificate != nullptr && private_key != nullptr) {
+      if (!SSL_CTX_use_certificate(context, certificate) ||
+          !SSL_CTX_use_PrivateKey(context, private_key) || !SSL_CTX_check_private_key(context))
+      {
+        // Without its certificate every handshake for the SNI would fail.
+        errata.note(
+            S_ERROR,
+            R"(Failed to set the server certificate and private key for SNI "{}": {}.)",
+            sni,
+            swoc::bwf::SSLError{});
+        SSL_CTX_free(context);
+        return errata;
+      }
+    }
+    if (ca_store != nullptr) {
+      X509_STORE_up_ref(ca_store);
+      SSL_CTX_set_cert_store(context, ca_store);
+    }
+    SSL_CTX_set_verify(context, behavior.get_verify_mode(), nullptr);
+    SSL_CTX_set_session_id_context(
+        context,
+        SERVER_SESSION_ID_CONTEXT,
+        sizeof(SERVER_SESSION_ID_CONTEXT) - 1);
+#ifndef OPENSSL_NO_NEXTPROTONEG
+    SSL_CTX_set_next_protos_advertised_cb(context, advertise_next_protocol_cb, nullptr);
+#endif /* !OPENSSL_NO_NEXTPROTONEG */
+    SSL_CTX_set_alpn_select_cb(
+        context,
+        alpn_select_next_proto_cb,
+        const_cast<TLSHandshakeBehavior *>(&behavior));
+    if (tls_secrets_are_being_logged()) {
+      SSL_CTX_set_keylog_callback(context, keylog_callback);
+    }
+    apply_ktls_option(context);
+    table._server_context_per_sni.emplace(sni, context);
+  }
+  errata.note(
+      S_DIAG,
+      "Built {} per-SNI server TLS context{}.",
+      table._server_context_per_sni.size(),
+      swoc::bwf::If(table._server_context_per_sni.size() != 1, "s"));
+  return errata;
+}
+
+// static
+SSL_CTX *
+TLSSession::get_context_for_sni(SSL *ssl, std::string_view sni)
+{
+  auto const *table = static_cast<SniHandshakeTable const *>(SSL_get_app_data(ssl));
+  if (table == nullptr) {
+    return nullptr;
+  }
+  auto const it = table->_server_context_per_sni.find(sni);
+  if (it == table->_server_context_per_sni.end()) {
+    return nullptr;
+  }
+  ++_num_sni_context_hits;
+  return it->second;
+}
+
+// static
+Errata
+TLSSession::report_handshake_statistics()
+{
+  Errata errata;
+  uint64_t const num_full = _num_full_handshakes;
+  uint64_t const num_resumed = _num_resumed_handshakes;
+  uint64_t const total = num_full + num_resumed;
+  if (total == 0) {
+    return errata;
+  }
+  errata.note(
+      S_INFO,
+      "TLS handshakes: {} total, {} full, {} resumed ({}% resumption rate), {} served from a "
+      "per-SNI context.",
+      total,
+      num_full,
+      num_resumed,
+      num_resumed * 100 / total,
+      _num_sni_context_hits.load());
+  return errata;
+}
+
+// static
+Errata
+TLSSession::configure_ktls(bool enable)
+{
+  Errata errata;
+  _ktls_is_enabled = false;
+  if (!enable) {
+    return errata;
+  }
+#ifdef SSL_OP_ENABLE_KTLS
+  _ktls_is_enabled = true;
+  errata.note(S_DIAG, "Requesting kernel TLS offload for TLS connections.");
+#else
+  errata.note(
+      S_WARN,
+      "kTLS was requested but this OpenSSL build does not support it. Continuing with user "
+      "space TLS.");
+#endif
+  return errata;
+}
+
+// static
+void
+TLSSession::apply_ktls_option(SSL_CTX *context)
+{
+#ifdef SSL_OP_ENABLE_KTLS
+  if (_ktls_is_enabled && context != nullptr) {
+    SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+  }
+#else
+  (void)context;
+#endif
+}
+
+// static
+Errata
+TLSSession::report_ktls_statistics()
+{
+  Errata errata;
+  if (!_ktls_is_enabled) {
+    return errata;
+  }
+  errata.note(
+      S_INFO,
+      "kTLS offload: {} connections fully offloaded, {} partially offloaded, {} using user space "
+      "TLS.",
+      _num_ktls_offloaded.load(),
+      _num_ktls_partially_offloaded.load(),
+      _num_ktls_not_offloaded.load());
+  return errata;
+}
+
+// static
+Errata
+TLSSession::report_ssl_allocation_statistics()
+{
+  Errata errata;
+  uint64_t const num_allocations = _num_ssl_allocations;
+  uint64_t const num_reuses = _num_ssl_reuses;
+  if (num_allocations + num_reuses == 0) {
+    return errata;
+  }
+  errata.note(
+      S_INFO,
+      "SSL object allocation: {} TLS connection{}, {} SSL object{} allocated, {} reused via "
+      "SSL_clear.",
+      num_allocations + num_reuses,
+      swoc::bwf::If(num_allocations + num_reuses != 1, "s"),
+      num_allocations,
+      swoc::bwf::If(num_allocations != 1, "s"),
+      num_reuses);
+  return errata;
+}
+
+// static
+Errata
+TLSSession::configure_client_handshake_options(
+    std::string_view cipher_list,
+    std::string_view ciphersuites,
+    std::string_view groups)
+{
+  Errata errata;
+  _client_cipher_list = cipher_list;
+  _client_ciphersuites = ciphersuites;
+  _client_groups = groups;
+  return errata;
+}
+
+// static
+Errata
+TLSSession::apply_client_handshake_options(SSL_CTX *context)
+{
+  Errata errata;
+  if (!_client_cipher_list.empty() &&
+      SSL_CTX_set_cipher_list(context, _client_cipher_list.c_str()) != 1)
+  {
+    errata.note(
+        S_ERROR,
+        R"(Failed to set the client cipher list to "{}": {})",
+        _client_cipher_list,
+        swoc::bwf::SSLError{});
+  }
+  if (!_client_ciphersuites.empty() &&
+      SSL_CTX_set_ciphersuites(context, _client_ciphersuites.c_str()) != 1)
+  {
+    errata.note(
+        S_ERROR,
+        R"(Failed to set the client TLS 1.3 cipher suites to "{}": {})",
+        _client_ciphersuites,
+        swoc::bwf::SSLError{});
+  }
+  if (!_client_groups.empty() && SSL_CTX_set1_groups_list(context, _client_groups.c_str()) != 1) {
+    errata.note(
+        S_ERROR,
+        R"(Failed to set the client groups to "{}": {})",
+        _client_groups,
+        swoc::bwf::SSLError{});
+  }
+  return errata;
+}
@@ -0,0 +1,256 @@
+/** @file
+ * Implement the Proxy Verifier replay file generator.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "core/ArgParser.h"
+#include "core/ProxyVerifier.h"
+#include "core/ReplayGenerator.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "swoc/Errata.h"
+#include "swoc/TextView.h"
+#include "swoc/bwf_base.h"
+#include "swoc/bwf_std.h"
+#include "swoc/swoc_file.h"
+
+using swoc::Errata;
+
+struct Engine
+{
+  ts::ArgParser parser;    ///< Command line argument parser.
+  ts::Arguments arguments; ///< Results from argument parsing.
+
+  void command_generate();
+
+  /** Set a range option from its argument, if it was given.
+   *
+   * @param[in] name The name of the option.
+   * @param[out] range The range to set.
+   *
+   * @return Any errors parsing the argument.
+   */
+  Errata parse_range_option(char const *name, ReplayGenerator::Range &range);
+
+  /// The process return code with which to exit.
+  static int process_exit_code;
+};
+
+int Engine::process_exit_code = 0;
+
+Errata
+Engine::parse_range_option(char const *name, ReplayGenerator::Range &range)
+{
+  Errata errata;
+  if (auto const arg{arguments.get(name)}; arg) {
+    auto &&[parsed_range, range_errata] = ReplayGenerator::Range::parse(arg.value());
+    if (!range_errata.is_ok()) {
+      errata.note(std::move(range_errata));
+      errata.note(S_ERROR, R"(Invalid --{} argument.)", name);
+      return errata;
+    }
+    range = parsed_range;
+  }
+  return errata;
+}
+
+void
+Engine::command_generate()
+{
+  Errata errata;
+  auto args{arguments.get("generate")};
+  if (args.size() < 1) {
+    errata.note(S_ERROR, R"("generate" command requires an output path as an argument.)");
+    process_exit_code = 1;
+    return;
+  }
+
+  ReplayGenerator::Options options;
+  if (auto const transactions_arg{arguments.get("transactions")}; transactions_arg) {
+    options.transactions = std::strtoull(transactions_arg.value().c_str(), nullptr, 10);
+  }
+  if (options.transactions == 0) {
+    errata.note(S_ERROR, R"(--transactions must be given a positive number of transactions.)");
+    process_exit_code = 1;
+    return;
+  }
+  if (auto const seed_arg{arguments.get("seed")}; seed_arg) {
+    options.seed = std::strtoull(seed_arg.value().c_str(), nullptr, 10);
+  }
+  errata.note(parse_range_option("sessions-per-file", options.file_sessions));
+  errata.note(parse_range_option("transactions-per-session", options.session_transactions));
+  errata.note(parse_range_option("header-count", options.header_count));
+  errata.note(parse_range_option("header-size", options.header_size));
+  errata.note(parse_range_option("request-body-size", options.request_body_size));
+  errata.note(parse_range_option("response-body-size", options.response_body_size));
+  if (auto const protocol_arg{arguments.get("protocols")}; protocol_arg) {
+    errata.note(
+        ReplayGenerator::parse_protocol_mix(protocol_arg.value(), options.protocol_weights));
+  }
+  if (auto const url_file_arg{arguments.get("url-file")}; url_file_arg) {
+    auto &&[urls, url_errata] = ReplayGenerator::load_urls(swoc::file::path{url_file_arg.value()});
+    errata.note(std::move(url_errata));
+    options.urls = std::move(urls);
+  }
+  if (auto const prefix_arg{arguments.get("prefix")}; prefix_arg) {
+    options.prefix = prefix_arg.value();
+  }
+  if (auto const format_arg{arguments.get("format")}; format_arg) {
+    swoc::TextView const format{format_arg.value()};
+    if (0 == strcasecmp(format, "corpus")) {
+      options.format = ReplayGenerator::Format::CORPUS;
+    } else if (0 != strcasecmp(format, "json")) {
+      errata.note(S_ERROR, R"("{}" is not a format: expected "json" or "corpus".)", format);
+    }
+  }
+  if (auto const threads_arg{arguments.get("threads")}; threads_arg) {
+    options.n_threads = std::atoi(threads_arg.value().c_str());
+  }
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+    return;
+  }
+
+  errata.note(ReplayGenerator::generate(options, swoc::file::path{args[0]}));
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+  }
+}
+
+int
+main(int /* argc */, char const *argv[])
+{
+  Engine engine;
+
+  engine.parser
+      .add_option(
+          "--verbose",
+          "",
+          "Enable verbose output:"
+          "\n\terror: Only print errors."
+          "\n\twarn: Print warnings and errors."
+          "\n\tinfo: Print info messages in addition to warnings and "
+          "errors. This is the default verbosity level."
+          "\n\tdiag: Print debug messages in addition to info, "
+          "warnings, and errors,",
+          "",
+          1,
+          "info")
+      .add_option("--version", "-V", "Print version string")
+      .add_option("--help", "-h", "Print usage information");
+
+  engine.parser
+      .add_command(
+          "generate",
+          "generate <path>: generate replay files into the directory path, or "
+          "compile them into the corpus file path with --format corpus.",
+          "",
+          1,
+          [&]() -> void { engine.command_generate(); })
+      .add_option("--transactions", "-n", "The total number of transactions.", "", 1, "")
+      .add_option(
+          "--seed",
+          "",
+          "The seed from which the replay files are generated. The same seed "
+          "and options always generate the same files. Default: 1",
+          "",
+          1,
+          "")
+      .add_option(
+          "--sessions-per-file",
+          "",
+          "The number of sessions in each file, a number or a range such as "
+          "5-20. Default: 10",
+          "",
+          1,
+          "")
+      .add_option(
+          "--transactions-per-session",
+          "",
+          "The number of transactions in each session, a number or a range "
+          "such as 1-100. Default: 10",
+          "",
+          1,
+          "")
+      .add_option(
+          "--header-count",
+          "",
+          "The number of headers added to each message beyond those its "
+          "protocol requires, a number or a range. Default: 0",
+          "",
+          1,
+          "")
+      .add_option(
+          "--header-size",
+          "",
+          "The size of the values of the added headers, a number or a range. "
+          "Default: 16",
+          "",
+          1,
+          "")
+      .add_option(
+          "--request-body-size",
+          "",
+          "The body size of POST requests, a number or a range. Default: 1-1000",
+          "",
+          1,
+          "")
+      .add_option(
+          "--response-body-size",
+          "",
+          "The body size of responses, a number or a range. Default: 1-1000",
+          "",
+          1,
+          "")
+      .add_option(
+          "--protocols",
+          "",
+          "The protocol mix of the sessions: a comma separated list of http, "
+          "https, and h2, each optionally weighted, such as http:3,h2:1. "
+          "Default: http,https,h2",
+          "",
+          1,
+          "")
+      .add_option(
+          "--url-file",
+          "",
+          "A file of the URLs to request, one per line. By default URLs are "
+          "synthesized.",
+          "",
+          1,
+          "")
+      .add_option("--prefix", "", "A prefix for the replay file names.", "", 1, "")
+      .add_option(
+          "--format",
+          "",
+          "The output format: json for a directory of JSON replay files, or "
+          "corpus for a compiled corpus file. Default: json",
+          "",
+          1,
+          "")
+      .add_option(
+          "--threads",
+          "",
+          "The number of threads generating files. Default: one per core.",
+          "",
+          1,
+          "");
+
+  // parse the arguments
+  engine.arguments = engine.parser.parse(argv);
+  std::string verbosity = "info";
+  if (auto const verbose_argument{engine.arguments.get("verbose")}; verbose_argument) {
+    verbosity = verbose_argument.value();
+  }
+  if (!configure_logging(verbosity)) {
+    std::cerr << "Unrecognized verbosity option: " << verbosity << std::endl;
+    return 1;
+  }
+
+  engine.arguments.invoke();
+  return engine.process_exit_code;
+}
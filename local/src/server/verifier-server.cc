@@ -9,19 +9,28 @@
 #include "core/http2.h"
 #include "core/http3.h"
 #include "core/https.h"
+#include "core/KeyIndex.h"
+#include "core/KeyIndexFile.h"
+#include "core/Localizer.h"
 #include "core/ProxyVerifier.h"
 #include "core/YamlParser.h"
 
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <climits>
 #include <condition_variable>
 #include <csignal>
+#include <cstdio>
 #include <cstring>
 #include <deque>
 #include <libgen.h>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <dirent.h>
 #include <fcntl.h>
@@ -56,6 +65,9 @@ void TF_Serve_Connection(std::thread *t);
  */
 bool Use_Strict_Checking = false;
 
+/** The partition of the key space this server serves. See --partition. */
+KeyPartition Server_Partition;
+
 /// This must be a list so that iterators / pointers to elements do not go stale.
 std::list<std::unique_ptr<std::thread>> Accept_Threads;
 
@@ -66,6 +78,8 @@ class ServerThreadInfo : public ThreadInfo
 {
 public:
   Session *_session = nullptr;
+  /// Sessions of this thread's previous connections, kept for reuse.
+  SessionPool _session_pool;
   bool
   data_ready() override
   {
@@ -131,6 +145,8 @@ ServerThreadPool::make_thread(std::thread *t)
       t); // move the temporary into the list element for permanence.
 }
 
+struct ReplayCorpus;
+
 /** Command execution.
  *
  * This handles parsing and acting on the command line arguments.
@@ -141,6 +157,36 @@ struct Engine
   ts::Arguments arguments; ///< Results from argument parsing.
 
   void command_run();
+  void command_index();
+  void command_compile();
+
+  /** Load the replay files into a new corpus and prepare it to be served.
+   *
+   * @param[in] path The replay file or directory of replay files to load.
+   *
+   * @return The loaded corpus and logging and status information.
+   */
+  swoc::Rv<std::shared_ptr<ReplayCorpus>> load_corpus(swoc::file::path const &path);
+
+  /** Map a key index and prepare a corpus that decodes its replay files on
+   * demand.
+   *
+   * @param[in] index_path The key index written by the index command.
+   * @param[in] path The replay file or directory of replay files indexed.
+   *
+   * @return The lazily loaded corpus and logging and status information.
+   */
+  swoc::Rv<std::shared_ptr<ReplayCorpus>>
+  load_lazy_corpus(swoc::file::path const &index_path, swoc::file::path const &path);
+
+  /** Reload the replay files and swap the new corpus in for new requests.
+   *
+   * The current corpus is kept if the replay files fail to load.
+   */
+  void reload_corpus();
+
+  /// The replay file or directory of replay files passed to the run command.
+  swoc::file::path replay_path;
 
   /// The process return code with which to exit.
   static int process_exit_code;
@@ -176,7 +222,22 @@ sigint_handler(int /* signal */)
   Shutdown_Flag = true;
 }
 
-std::mutex LoadMutex;
+/** Set when a SIGHUP requests that the replay files be reloaded. */
+std::atomic<bool> Reload_Requested{false};
+
+/** Handle SIGHUP by requesting a reload of the replay files.
+ *
+ * The reload is done by the main thread (see Engine::reload_corpus) while
+ * the connection threads continue to serve from the current corpus.
+ *
+ * @param[in] signal The signal number of the signal being handled. This will
+ * always be SIGHUP since that is all that is registered with this handler.
+ */
+void
+sighup_handler(int /* signal */)
+{
+  Reload_Requested = true;
+}
 
 /** Parse the "tls" node for whether the proxy provided a certificate.
  *
@@ -235,19 +296,90 @@ parse_request_certificate(YAML::Node const &tls_node)
   return should_request_certificate;
 }
 
-std::unordered_map<std::string, Txn, std::hash<std::string_view>> Transactions;
+class LazyTransactions;
+
+/** The transactions and per-SNI TLS handshake behaviors of one load of the
+ * replay files.
+ *
+ * Each loader thread populates a partial corpus of its own while loading the
+ * replay files, and the partial corpora are then merged into one which is
+ * only read afterwards. A reload builds a new corpus and swaps it in as
+ * Current_Corpus.
+ *
+ * A corpus owns the memory its transactions refer to, so that the memory of
+ * a corpus replaced by a reload is freed with it.
+ */
+struct ReplayCorpus
+{
+  ReplayCorpus();
+
+  /** Look up the transaction to serve for a key.
+   *
+   * @param[in] key The key of the request.
+   *
+   * @return The transaction for key, or nullptr if there is none, along with
+   * any errors decoding its replay file.
+   */
+  swoc::Rv<Txn const *> find(std::string_view key) const;
+
+  /// The number of transactions that can be served.
+  size_t get_transaction_count() const;
+
+  /** Move the transactions and handshake behaviors of another corpus into
+   * this one.
+   *
+   * As when loading, a key or SNI already in this corpus is not replaced.
+   *
+   * @param[in] other The corpus to merge. Its contents are moved from.
+   */
+  void merge(ReplayCorpus &&other);
+
+  /// The arena into which the corpus's strings are localized while loading
+  /// it (see Localizer::ScopedArena).
+  swoc::MemArena &
+  get_arena()
+  {
+    return *arenas.front();
+  }
+
+  /// The transactions to serve, indexed by key.
+  KeyIndex<Txn> transactions;
+  /** When serving from a key index (see --key-index), the transactions are
+   * decoded on demand by this rather than held in transactions.
+   */
+  std::shared_ptr<LazyTransactions> lazy_transactions;
+  /// The TLS handshake behaviors the replay files specify per SNI.
+  std::shared_ptr<SniHandshakeTable> sni_handshake_table = std::make_shared<SniHandshakeTable>();
+  /// The number of transactions skipped because another partition owns them.
+  size_t num_unowned_transactions = 0;
+  /// The arenas of the localized strings of this corpus and of the corpora
+  /// merged into it.
+  std::vector<std::unique_ptr<swoc::MemArena>> arenas;
+  /// The generated body of the responses which have no literal content.
+  std::shared_ptr<char const> content;
+};
+
+/** The corpus from which new requests are served.
+ *
+ * Access this via std::atomic_load and std::atomic_store. Connections hold a
+ * reference to each corpus they serve from, so a reload does not free a
+ * corpus that in-flight requests still use.
+ */
+std::shared_ptr<ReplayCorpus const> Current_Corpus;
 
 class ServerReplayFileHandler : public ReplayFileHandler
 {
 public:
-  ServerReplayFileHandler();
+  /// @param[in] corpus The corpus to populate from the replay file.
+  ServerReplayFileHandler(ReplayCorpus &corpus);
 
-  swoc::Errata ssn_open(YAML::Node const &node) override;
-  swoc::Errata txn_open(YAML::Node const &node) override;
+  swoc::Errata ssn_open(YAML::Node const &node, YamlKeyMap const &keys) override;
+  swoc::Errata txn_open(YAML::Node const &node, YamlKeyMap const &keys) override;
+  bool skip_transaction(YAML::Node const &node) override;
   swoc::Errata client_request(YAML::Node const &node) override;
   swoc::Errata proxy_request(YAML::Node const &node) override;
   swoc::Errata server_response(YAML::Node const &node) override;
-  swoc::Errata apply_to_all_messages(HttpFields const &all_headers) override;
+  swoc::Errata apply_to_all_messages(std::shared_ptr<HttpFields const> const &all_headers) override;
   swoc::Errata txn_close() override;
   swoc::Errata ssn_close() override;
 
@@ -272,9 +404,14 @@ private:
    */
   std::string _key;
   Txn _txn;
+  ReplayCorpus &_corpus;
 };
 
-ServerReplayFileHandler::ServerReplayFileHandler() : _txn{Use_Strict_Checking} { }
+ServerReplayFileHandler::ServerReplayFileHandler(ReplayCorpus &corpus)
+  : _txn{Use_Strict_Checking}
+  , _corpus{corpus}
+{
+}
 
 void
 ServerReplayFileHandler::txn_reset()
@@ -292,20 +429,19 @@ ServerReplayFileHandler::ssn_reset()
 }
 
 swoc::Errata
-ServerReplayFileHandler::ssn_open(YAML::Node const &node)
+ServerReplayFileHandler::ssn_open(YAML::Node const &node, YamlKeyMap const & /* keys */)
 {
   _ssn_node = &node;
   return {};
 }
 
 swoc::Errata
-ServerReplayFileHandler::txn_open(YAML::Node const &node)
+ServerReplayFileHandler::txn_open(YAML::Node const &node, YamlKeyMap const &keys)
 {
-  LoadMutex.lock();
   _txn._req.set_is_request();
   _txn._rsp.set_is_response();
   Errata errata;
-  if (!node[YAML_SERVER_RSP_KEY]) {
+  if (!keys.find(YamlKey::SERVER_RESPONSE)) {
     errata.note(
         S_ERROR,
         R"(Transaction node at "{}":{} does not have a server response [{}].)",
@@ -320,6 +456,28 @@ ServerReplayFileHandler::txn_open(YAML::Node const &node)
   return {};
 }
 
+bool
+ServerReplayFileHandler::skip_transaction(YAML::Node const &node)
+{
+  if (Server_Partition.count <= 1) {
+    return false;
+  }
+  // The key is derived as client_request, proxy_request, and
+  // apply_to_all_messages would: the proxy request's key, with the "all"
+  // fields, takes precedence over the client request's.
+  auto key = YamlParser::derive_transaction_key(node, YAML_PROXY_REQ_KEY);
+  if (key == HttpHeader::TRANSACTION_KEY_NOT_SET) {
+    key = YamlParser::derive_transaction_key(node, YAML_CLIENT_REQ_KEY, false);
+  }
+  if (key == HttpHeader::TRANSACTION_KEY_NOT_SET || Server_Partition.owns(key)) {
+    // A transaction without a key is loaded so that txn_close reports it.
+    return false;
+  }
+  // Another server instance serves this key.
+  ++_corpus.num_unowned_transactions;
+  return true;
+}
+
 swoc::Errata
 ServerReplayFileHandler::handle_tls_node_directives(
     YAML::Node const &tls_node,
@@ -392,7 +550,9 @@ ServerReplayFileHandler::handle_tls_node_directives(
     errata.note(S_DIAG, R"(Using ALPN protocol string "{}" for SNI "{}")", printable_alpn, sni);
   }
 
-  TLSSession::register_tls_handshake_behavior(sni, std::move(handshake_behavior));
+  _corpus.sni_handshake_table->register_tls_handshake_behavior(
+      sni,
+      std::move(handshake_behavior));
   return errata;
 }
 
@@ -401,7 +561,7 @@ ServerReplayFileHandler::client_request(YAML::Node const &node)
 {
   HttpHeader client_request;
   Errata errata = YamlParser::populate_http_message(node, client_request);
-  auto const key = client_request.get_key();
+  auto const &key = client_request.get_key();
   if (key != HttpHeader::TRANSACTION_KEY_NOT_SET) {
     _key = key;
   }
@@ -479,12 +639,12 @@ ServerReplayFileHandler::proxy_request(YAML::Node const &node)
     return errata;
   }
 
-  _txn._req._fields_rules = std::make_shared<HttpFields>(*global_config.txn_rules);
+  _txn._req._fields_rules->add_shared_rules(global_config.txn_rules);
   errata.note(YamlParser::populate_http_message(node, _txn._req));
   if (!errata.is_ok()) {
     return errata;
   }
-  auto const key = _txn._req.get_key();
+  auto const &key = _txn._req.get_key();
   if (key != HttpHeader::TRANSACTION_KEY_NOT_SET) {
     _key = key;
   }
@@ -495,6 +655,11 @@ swoc::Errata
 ServerReplayFileHandler::server_response(YAML::Node const &node)
 {
   swoc::Errata errata;
+  if (!_key.empty() && !Server_Partition.owns(_key)) {
+    // This transaction will be skipped in txn_close, so don't spend time
+    // parsing its response.
+    return errata;
+  }
   errata.note(YamlParser::populate_http_message(node, _txn._rsp));
   if (_txn._rsp._status == 0) {
     errata
@@ -518,11 +683,13 @@ ServerReplayFileHandler::server_response(YAML::Node const &node)
 }
 
 swoc::Errata
-ServerReplayFileHandler::apply_to_all_messages(HttpFields const &all_headers)
+ServerReplayFileHandler::apply_to_all_messages(
+    std::shared_ptr<HttpFields const> const &all_headers)
 {
-  _txn._req.merge(all_headers);
-  _txn._rsp.merge(all_headers);
-  auto const key = _txn._req.get_key();
+  _txn._req.merge_fields(*all_headers);
+  _txn._req._fields_rules->add_shared_rules(all_headers);
+  _txn._rsp.merge_fields(*all_headers);
+  auto const &key = _txn._req.get_key();
   if (key != HttpHeader::TRANSACTION_KEY_NOT_SET) {
     _key = key;
   }
@@ -540,6 +707,9 @@ ServerReplayFileHandler::txn_close()
         HttpHeader::_key_format,
         _path,
         _txn_node->Mark().line);
+  } else if (!Server_Partition.owns(_key)) {
+    // Another server instance serves this key.
+    ++_corpus.num_unowned_transactions;
   } else {
     // For convenience, we do not require the user to set the key in
     // server-response nodes. Proxy Verifier functions fine in every way for
@@ -547,10 +717,10 @@ ServerReplayFileHandler::txn_close()
     // in some places. For this reason make sure the response is aware of the
     // key.
     _txn._rsp.set_key(_key);
-    Transactions.emplace(_key, std::move(_txn));
+    _txn.compact();
+    _corpus.transactions.emplace(_key, std::move(_txn));
   }
   this->txn_reset();
-  LoadMutex.unlock();
   return errata;
 }
 
@@ -561,6 +731,244 @@ ServerReplayFileHandler::ssn_close()
   return {};
 }
 
+/** The protocols the server listens on, which determine the serializations
+ * of each response to cache.
+ */
+struct ListenProtocols
+{
+  bool http = false;
+  bool https = false;
+  bool http3 = false;
+};
+
+/** Fill in the bodies of loaded responses and cache their serializations.
+ *
+ * @param[in] corpus The newly loaded corpus. It holds the generated body its
+ * responses refer to.
+ * @param[in] protocols The protocols for which to cache serializations.
+ *
+ * @return Any errors caching the serializations.
+ */
+static swoc::Errata
+prepare_transactions(ReplayCorpus &corpus, ListenProtocols const &protocols)
+{
+  swoc::Errata errata;
+  auto &transactions = corpus.transactions;
+  size_t max_content_length = 0;
+  for (auto const &[key, txn] : transactions) {
+    if (txn._rsp._content_data == nullptr) { // don't check responses with literal content.
+      max_content_length = std::max<size_t>(max_content_length, txn._rsp._content_size);
+    }
+  }
+  // The generated content is shared with any other corpus whose bodies fit in
+  // it. Replay files decoded on demand may be prepared by several connection
+  // threads, so it may have grown past this request.
+  corpus.content = HttpHeader::get_content(max_content_length);
+  char const *const content = corpus.content.get();
+  for (auto &[key, txn] : transactions) {
+    if (txn._rsp._content_data == nullptr) { // fill in from static content.
+      txn._rsp._content_data = content;
+    }
+  }
+  // Responses are static per key, so serialize them once here rather than
+  // for every request.
+  for (auto &[key, txn] : transactions) {
+    if (protocols.http || protocols.https) {
+      errata.note(txn._rsp.cache_http1_serialization());
+    }
+    if (protocols.https) {
+      errata.note(H2Session::cache_packed_headers(txn._rsp));
+    }
+    if (protocols.http3) {
+      errata.note(H3Session::cache_packed_headers(txn._rsp));
+    }
+  }
+  return errata;
+}
+
+/** The transactions of the replay files in a key index, each file decoded
+ * when one of its keys is first requested.
+ *
+ * Only the mapped KeyIndexFile is read at startup. The first request for a
+ * key parses the replay file containing it into a ReplayCorpus of its own,
+ * which then serves all of that file's keys. Resident memory thus follows the
+ * set of requested files rather than the size of the corpus.
+ */
+class LazyTransactions
+{
+public:
+  /**
+   * @param[in] index The mapped key index.
+   * @param[in] replay_path The replay file or directory of replay files that
+   * was indexed.
+   * @param[in] protocols The protocols for which to prepare responses.
+   */
+  LazyTransactions(
+      std::unique_ptr<KeyIndexFile> index,
+      swoc::file::path const &replay_path,
+      ListenProtocols const &protocols);
+
+  /// @see ReplayCorpus::find
+  swoc::Rv<Txn const *> find(std::string_view key);
+
+  KeyIndexFile const &
+  get_index() const
+  {
+    return *_index;
+  }
+
+  /// The number of replay files decoded so far.
+  size_t
+  get_decoded_file_count() const
+  {
+    return _num_decoded_files;
+  }
+
+private:
+  /** Decode a replay file into its element of _decoded_files.
+   *
+   * This is called once per file, via its element of _decode_once. If the
+   * file could not be decoded, its element is set to an empty corpus, so the
+   * file is not parsed again for every request.
+   *
+   * @param[in] file_id The index's identifier for the replay file.
+   *
+   * @return Any errors decoding the file.
+   */
+  swoc::Errata decode_file(uint32_t file_id);
+
+private:
+  std::unique_ptr<KeyIndexFile> _index;
+  swoc::file::path _replay_path;
+  /// Whether _replay_path is a single replay file rather than a directory.
+  bool _replay_path_is_file = false;
+  ListenProtocols _protocols;
+  /** The decoded replay files, indexed by file identifier.
+   *
+   * Access the elements via std::atomic_load and std::atomic_store. An
+   * element is set once and never replaced, so the transactions it holds live
+   * as long as this object.
+   */
+  std::vector<std::shared_ptr<ReplayCorpus const>> _decoded_files;
+  /** Ensures each file is decoded once, indexed by file identifier.
+   *
+   * Each file has its own flag, so requests only wait for the decoding of the
+   * file they need rather than that of any other.
+   */
+  std::unique_ptr<std::once_flag[]> _decode_once;
+  std::atomic<size_t> _num_decoded_files{0};
+};
+
+LazyTransactions::LazyTransactions(
+    std::unique_ptr<KeyIndexFile> index,
+    swoc::file::path const &replay_path,
+    ListenProtocols const &protocols)
+  : _index{std::move(index)}
+  , _replay_path{replay_path}
+  , _protocols{protocols}
+  , _decoded_files(_index->get_file_count())
+  , _decode_once{std::make_unique<std::once_flag[]>(_index->get_file_count())}
+{
+  std::error_code ec;
+  _replay_path_is_file = swoc::file::is_regular_file(swoc::file::status(_replay_path, ec));
+}
+
+swoc::Rv<Txn const *>
+LazyTransactions::find(std::string_view key)
+{
+  swoc::Rv<Txn const *> zret{nullptr};
+  auto const file_id = _index->find(key);
+  if (file_id == KeyIndexFile::NO_FILE) {
+    return zret;
+  }
+  auto decoded_file = std::atomic_load(&_decoded_files[file_id]);
+  if (!decoded_file) {
+    // Only the request which decodes the file reports its errors.
+    std::call_once(_decode_once[file_id], [this, file_id, &zret]() {
+      zret.note(decode_file(file_id));
+    });
+    decoded_file = std::atomic_load(&_decoded_files[file_id]);
+  }
+  zret.result() = decoded_file->transactions.find(key);
+  return zret;
+}
+
+swoc::Errata
+LazyTransactions::decode_file(uint32_t file_id)
+{
+  swoc::Errata zret;
+  // The index records files relative to the indexed directory, or the
+  // indexed file itself.
+  auto const file_path = _replay_path_is_file
+                             ? _replay_path
+                             : _replay_path / swoc::file::path{_index->get_file_path(file_id)};
+  auto const start = std::chrono::steady_clock::now();
+  auto corpus = std::make_shared<ReplayCorpus>();
+  {
+    Localizer::ScopedArena scoped_arena{corpus->get_arena()};
+    ServerReplayFileHandler handler{*corpus};
+    zret.note(YamlParser::load_replay_file(file_path, handler));
+  }
+  if (zret.is_ok()) {
+    zret.note(prepare_transactions(*corpus, _protocols));
+  }
+  if (zret.is_ok()) {
+    zret.note(
+        S_DIAG,
+        R"(Decoded {} transaction{} from "{}" on first request in {}.)",
+        corpus->transactions.size(),
+        swoc::bwf::If(corpus->transactions.size() != 1, "s"),
+        file_path,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start));
+  } else {
+    zret.note(S_ERROR, R"(Failed to decode "{}": none of its keys will be served.)", file_path);
+    Engine::process_exit_code = 1;
+    corpus = std::make_shared<ReplayCorpus>();
+  }
+  std::atomic_store(&_decoded_files[file_id], std::shared_ptr<ReplayCorpus const>{corpus});
+  ++_num_decoded_files;
+  return zret;
+}
+
+ReplayCorpus::ReplayCorpus()
+{
+  arenas.emplace_back(std::make_unique<swoc::MemArena>(8000));
+}
+
+swoc::Rv<Txn const *>
+ReplayCorpus::find(std::string_view key) const
+{
+  if (lazy_transactions) {
+    return lazy_transactions->find(key);
+  }
+  return transactions.find(key);
+}
+
+void
+ReplayCorpus::merge(ReplayCorpus &&other)
+{
+  transactions.reserve(transactions.size() + other.transactions.size());
+  for (auto &[key, txn] : other.transactions) {
+    transactions.emplace(key, std::move(txn));
+  }
+  sni_handshake_table->merge(std::move(*other.sni_handshake_table));
+  num_unowned_transactions += other.num_unowned_transactions;
+  for (auto &arena : other.arenas) {
+    arenas.emplace_back(std::move(arena));
+  }
+  other.arenas.clear();
+}
+
+size_t
+ReplayCorpus::get_transaction_count() const
+{
+  if (lazy_transactions) {
+    return lazy_transactions->get_index().get_key_count();
+  }
+  return transactions.size();
+}
+
 void
 delete_thread_info_session(ServerThreadInfo &thread_info)
 {
@@ -568,7 +976,7 @@ delete_thread_info_session(ServerThreadInfo &thread_info)
     return;
   }
   std::unique_lock<std::mutex> lock(thread_info._mutex);
-  delete thread_info._session;
+  thread_info._session_pool.release(std::unique_ptr<Session>{thread_info._session});
   thread_info._session = nullptr;
 }
 
@@ -588,6 +996,11 @@ TF_Serve_Connection(std::thread *t)
     }
 
     errata = thread_info._session->accept();
+    // Each request is served from the corpus that is current when it arrives.
+    // HTTP/2 and HTTP/3 stream states point into that corpus after the
+    // request's iteration of the loop below, so every corpus this connection
+    // served from is kept until the connection is done.
+    std::vector<std::shared_ptr<ReplayCorpus const>> corpora_in_use;
     while (!Shutdown_Flag && !thread_info._session->is_closed() && errata.is_ok()) {
       swoc::Errata thread_errata;
 
@@ -623,10 +1036,17 @@ TF_Serve_Connection(std::thread *t)
       auto const stream_id = req_hdr->_stream_id;
       auto const is_http2 = req_hdr->is_http2();
       auto const is_http3 = req_hdr->is_http3();
-      auto key{req_hdr->get_key()};
-      auto specified_transaction_it{Transactions.find(key)};
+      auto const &key{req_hdr->get_key()};
+      auto corpus = std::atomic_load(&Current_Corpus);
+      if (corpora_in_use.empty() || corpora_in_use.back() != corpus) {
+        corpora_in_use.push_back(corpus);
+      }
+      // The corpus is read-only: every connection shares its entries, so
+      // nothing per-request is written to them.
+      auto &&[specified_transaction_p, find_errata] = corpus->find(key);
+      thread_errata.note(std::move(find_errata));
 
-      if (specified_transaction_it == Transactions.end()) {
+      if (specified_transaction_p == nullptr) {
         thread_errata.note(
             S_ERROR,
             R"(Proxy request with key "{}" not found, sending a 404.)",
@@ -640,7 +1060,7 @@ TF_Serve_Connection(std::thread *t)
         break;
       }
 
-      [[maybe_unused]] auto &[unused_key, specified_transaction] = *specified_transaction_it;
+      Txn const &specified_transaction = *specified_transaction_p;
 
       thread_errata.note(req_hdr->update_content_length(req_hdr->_method));
       thread_errata.note(req_hdr->update_transfer_encoding());
@@ -697,25 +1117,15 @@ TF_Serve_Connection(std::thread *t)
       } else {
         thread_errata.note(S_DIAG, R"(Request with key {} passed validation.)", key);
       }
-      // Responses to HEAD requests may have a non-zero Content-Length
-      // but will never have a body. update_content_length adjusts
-      // expectations so the body is not written for responses to such
-      // requests.
-      specified_transaction._rsp.update_content_length(req_hdr->_method);
-      if (is_http3) {
-        specified_transaction._rsp.set_is_http3();
-        specified_transaction._rsp._stream_id = stream_id;
-      } else if (is_http2) {
-        specified_transaction._rsp.set_is_http2();
-        specified_transaction._rsp._stream_id = stream_id;
-      } else {
-        specified_transaction._rsp.set_is_http1();
-      }
+      // The protocol, stream, and (for HEAD requests) body length of the
+      // response depend upon this request, so they are described by an
+      // overlay rather than set on the shared response.
+      MessageOverlay const response_overlay{specified_transaction._rsp, *req_hdr};
       if (specified_transaction._user_specified_delay_duration > 0us) {
         sleep_for(specified_transaction._user_specified_delay_duration);
       }
       auto &&[bytes_written, write_errata] =
-          thread_info._session->write(specified_transaction._rsp);
+          thread_info._session->write(specified_transaction._rsp, response_overlay);
       thread_errata.note(std::move(write_errata));
     }
 
@@ -727,7 +1137,6 @@ TF_Serve_Connection(std::thread *t)
 void
 TF_Accept(int socket_fd, bool do_https, bool do_http3)
 {
-  std::unique_ptr<Session> session;
   struct pollfd pfd = {.fd = socket_fd, .events = POLLIN, .revents = 0};
 
   while (!Shutdown_Flag) {
@@ -754,28 +1163,33 @@ TF_Accept(int socket_fd, bool do_https, bool do_http3)
     if (0 != ::fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK)) {
       errata.note(S_ERROR, "Failed to make the server socket non-blocking: {}", swoc::bwf::Errno{});
     }
+    ServerThreadInfo *thread_info =
+        dynamic_cast<ServerThreadInfo *>(Server_Thread_Pool.get_worker());
+    if (nullptr == thread_info) {
+      errata.note(S_ERROR, "Failed to get worker thread");
+      ::close(fd);
+      continue;
+    }
+    // The worker is idle, so its session pool can be used under its lock.
+    std::unique_lock<std::mutex> lock(thread_info->_mutex);
+    std::unique_ptr<Session> session;
     if (do_http3) {
       session = std::make_unique<H3Session>();
     } else if (do_https) {
       // H2Session will figure out the HTTP protocol during the TLS handshake
       // and handle HTTP/1.x or HTTP/2 accordingly.
-      session = std::make_unique<H2Session>();
+      session = thread_info->_session_pool.acquire<H2Session>();
     } else {
-      session = std::make_unique<Session>();
+      session = thread_info->_session_pool.acquire<Session>();
     }
     errata = session->set_fd(fd);
     if (!errata.is_ok()) {
-      continue;
-    }
-    ServerThreadInfo *thread_info =
-        dynamic_cast<ServerThreadInfo *>(Server_Thread_Pool.get_worker());
-    if (nullptr == thread_info) {
-      errata.note(S_ERROR, "Failed to get worker thread");
-    } else {
-      std::unique_lock<std::mutex> lock(thread_info->_mutex);
-      thread_info->_session = session.release();
-      thread_info->_cvar.notify_one();
+      // The worker is still handed the session: its accept will fail and it
+      // will return itself and the session to their pools.
+      errata.note(S_ERROR, "Failed to set the socket for an accepted connection.");
     }
+    thread_info->_session = session.release();
+    thread_info->_cvar.notify_one();
   }
 }
 
@@ -875,7 +1289,27 @@ Engine::command_run()
 
     auto key_format_arg{arguments.get("format")};
     if (key_format_arg) {
-      HttpHeader::_key_format = key_format_arg[0];
+      HttpHeader::set_key_format(key_format_arg[0]);
+    }
+
+    auto parse_cache_arg{arguments.get("parse-cache")};
+    if (parse_cache_arg) {
+      errata.note(YamlParser::set_parse_cache_dir(swoc::file::path{parse_cache_arg[0]}));
+      if (!errata.is_ok()) {
+        process_exit_code = 1;
+        return;
+      }
+    }
+
+    auto partition_arg{arguments.get("partition")};
+    if (partition_arg) {
+      auto &&[partition, partition_errata] = KeyPartition::parse(partition_arg[0]);
+      errata.note(std::move(partition_errata));
+      if (!errata.is_ok()) {
+        process_exit_code = 1;
+        return;
+      }
+      Server_Partition = partition;
     }
 
     if (server_addr_http_arg) {
@@ -950,43 +1384,41 @@ Engine::command_run()
         if (tls_secrets_log_file_arg) {
           tls_secrets_log_file = tls_secrets_log_file_arg[0];
         }
+        auto ticket_key_file_arg{arguments.get("tls-ticket-key-file")};
+        if (ticket_key_file_arg) {
+          errata.note(TLSSession::configure_session_tickets(ticket_key_file_arg[0]));
+        }
+        errata.note(TLSSession::configure_ktls(arguments.get("ktls")));
         errata.note(TLSSession::init(tls_secrets_log_file));
         errata.note(H2Session::init(&process_exit_code));
       }
     }
 
-    errata.note(YamlParser::load_replay_files(
-        swoc::file::path{args[0]},
-        [](swoc::file::path const &file) -> swoc::Errata {
-          ServerReplayFileHandler handler;
-          return YamlParser::load_replay_file(file, handler);
-        },
-        10));
-
+    replay_path = swoc::file::path{args[0]};
+    auto &&[corpus, load_errata] = load_corpus(replay_path);
+    errata.note(std::move(load_errata));
     if (!errata.is_ok()) {
       process_exit_code = 1;
       return;
     }
-    Session::init(Transactions.size());
-
-    size_t max_content_length = 0;
-    for (auto const &[key, txn] : Transactions) {
-      if (txn._rsp._content_data == nullptr) { // don't check responses with literal content.
-        max_content_length = std::max<size_t>(max_content_length, txn._rsp._content_size);
-      }
-    }
-    HttpHeader::set_max_content_length(max_content_length);
-    for (auto &[key, txn] : Transactions) {
-      if (txn._rsp._content_data == nullptr) { // fill in from static content.
-        txn._rsp._content_data = txn._rsp._content.data();
-      }
-    }
+    Session::init(corpus->get_transaction_count());
+    TLSSession::set_sni_handshake_table(corpus->sni_handshake_table);
+    std::atomic_store(&Current_Corpus, std::shared_ptr<ReplayCorpus const>{corpus});
 
     errata.note(
         S_INFO,
         "Ready with {} transaction{}.",
-        Transactions.size(),
-        swoc::bwf::If(Transactions.size() != 1, "s"));
+        corpus->get_transaction_count(),
+        swoc::bwf::If(corpus->get_transaction_count() != 1, "s"));
+    if (Server_Partition.count > 1 && !corpus->lazy_transactions) {
+      errata.note(
+          S_INFO,
+          "Serving partition {} of {}: skipped {} transaction{} owned by other partitions.",
+          Server_Partition.index,
+          Server_Partition.count,
+          corpus->num_unowned_transactions,
+          swoc::bwf::If(corpus->num_unowned_transactions != 1, "s"));
+    }
 
     for (auto &server_addr : server_addrs) {
       // Set up listen port.
@@ -1010,9 +1442,13 @@ Engine::command_run()
     }
   } // End of scope for errata so it gets logged.
 
-  // Wait for the listening threads to start up.
+  // Serve until shut down, reloading the replay files when a SIGHUP asks for
+  // it. The connection threads keep serving while a reload is parsed.
   while (!Shutdown_Flag) {
     sleep_for(Thread_Sleep_Interval);
+    if (Reload_Requested.exchange(false)) {
+      reload_corpus();
+    }
   }
   for_each(
       Accept_Threads.begin(),
@@ -1021,12 +1457,263 @@ Engine::command_run()
   Accept_Threads.clear();
   Server_Thread_Pool.join_threads();
 
+  { // Scope the errata so the statistics are logged before exiting.
+    Errata errata = TLSSession::report_handshake_statistics();
+    errata.note(TLSSession::report_ktls_statistics());
+    errata.note(SessionPool::report_allocation_statistics());
+    errata.note(TLSSession::report_ssl_allocation_statistics());
+    errata.note(HttpHeader::report_serialization_cache_statistics());
+    if (auto corpus = std::atomic_load(&Current_Corpus); corpus && corpus->lazy_transactions) {
+      auto const &lazy_transactions = *corpus->lazy_transactions;
+      errata.note(
+          S_INFO,
+          "Decoded {} of {} indexed replay files on demand.",
+          lazy_transactions.get_decoded_file_count(),
+          lazy_transactions.get_index().get_file_count());
+    }
+  }
   TLSSession::terminate();
   H2Session::terminate();
   H3Session::terminate();
   exit(Engine::process_exit_code);
 }
 
+void
+Engine::command_index()
+{
+  Errata errata;
+  auto args{arguments.get("index")};
+  if (args.size() < 2) {
+    errata.note(
+        S_ERROR,
+        R"("index" command requires the replay file path and the index file path as arguments.)");
+    process_exit_code = 1;
+    return;
+  }
+  auto key_format_arg{arguments.get("format")};
+  if (key_format_arg) {
+    HttpHeader::set_key_format(key_format_arg[0]);
+  }
+  swoc::file::path const replay_path{args[0]};
+  swoc::file::path const index_path{args[1]};
+
+  KeyIndexFile::Builder builder;
+  builder.set_key_format(HttpHeader::_key_format);
+  std::mutex builder_mutex;
+  // Each file is parsed into a corpus of its own which is released once its
+  // keys are recorded, so indexing does not hold the whole corpus in memory.
+  errata.note(YamlParser::load_replay_files(
+      replay_path,
+      [&replay_path, &builder, &builder_mutex](swoc::file::path const &file) -> swoc::Errata {
+        ReplayCorpus file_corpus;
+        Localizer::ScopedArena scoped_arena{file_corpus.get_arena()};
+        ServerReplayFileHandler handler{file_corpus};
+        auto file_errata = YamlParser::load_replay_file(file, handler);
+        std::lock_guard<std::mutex> lock(builder_mutex);
+        auto const file_id = builder.add_file(YamlParser::get_relative_path(file, replay_path));
+        for (auto const &[key, txn] : file_corpus.transactions) {
+          builder.add_key(key, file_id);
+        }
+        for (auto const &[sni, behavior] :
+             file_corpus.sni_handshake_table->get_handshake_behaviors())
+        {
+          builder.add_sni({sni, behavior.get_verify_mode(), behavior.get_alpn_wire_string()});
+        }
+        return file_errata;
+      }));
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+    return;
+  }
+  errata.note(builder.write(index_path));
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+  }
+}
+
+void
+Engine::command_compile()
+{
+  Errata errata;
+  auto args{arguments.get("compile")};
+  if (args.size() < 2) {
+    errata.note(
+        S_ERROR,
+        R"("compile" command requires the replay file path and the corpus file path as )"
+        "arguments.");
+    process_exit_code = 1;
+    return;
+  }
+  errata.note(
+      YamlParser::compile_replay_files(swoc::file::path{args[0]}, swoc::file::path{args[1]}));
+  if (!errata.is_ok()) {
+    process_exit_code = 1;
+  }
+}
+
+swoc::Rv<std::shared_ptr<ReplayCorpus>>
+Engine::load_corpus(swoc::file::path const &path)
+{
+  if (auto key_index_arg{arguments.get("key-index")}; key_index_arg) {
+    return load_lazy_corpus(swoc::file::path{key_index_arg[0]}, path);
+  }
+  swoc::Rv<std::shared_ptr<ReplayCorpus>> zret{std::make_shared<ReplayCorpus>()};
+  auto &corpus = *zret.result();
+  // Strings are localized into the corpus's arenas rather than the threads'
+  // permanent ones, so that they are freed with the corpus. Since this also
+  // keeps the loader from referring to the replay files in place, a replay
+  // file rewritten before a reload does not change the corpus being served.
+  // This thread localizes the replay files' metadata.
+  Localizer::ScopedArena scoped_arena{corpus.get_arena()};
+  // Each loader thread fills its own partial corpus, so parsing needs no
+  // lock. The partial corpora are merged once all files are parsed.
+  auto const n_threads = YamlParser::get_default_thread_count();
+  std::vector<ReplayCorpus> partial_corpora(n_threads);
+  zret.note(YamlParser::load_replay_files(
+      path,
+      [&partial_corpora](swoc::file::path const &file) -> swoc::Errata {
+        auto &partial_corpus = partial_corpora[YamlParser::get_loader_thread_index()];
+        Localizer::ScopedArena scoped_arena{partial_corpus.get_arena()};
+        ServerReplayFileHandler handler{partial_corpus};
+        return YamlParser::load_replay_file(file, handler);
+      },
+      n_threads,
+      YamlParser::SPLIT_FILES));
+  if (!zret.is_ok()) {
+    return zret;
+  }
+  for (auto &partial_corpus : partial_corpora) {
+    corpus.merge(std::move(partial_corpus));
+  }
+  zret.note(Txn::report_memory_statistics());
+
+  ListenProtocols const protocols{
+      static_cast<bool>(arguments.get("listen-http")),
+      static_cast<bool>(arguments.get("listen-https")),
+      static_cast<bool>(arguments.get("listen-http3"))};
+  if (protocols.https) {
+    // All SNI handshake behaviors are registered while loading the replay
+    // files, so the per-SNI contexts can be built now.
+    zret.note(TLSSession::build_sni_context_cache(*corpus.sni_handshake_table));
+    if (!zret.is_ok()) {
+      return zret;
+    }
+  }
+
+  zret.note(prepare_transactions(corpus, protocols));
+  return zret;
+}
+
+swoc::Rv<std::shared_ptr<ReplayCorpus>>
+Engine::load_lazy_corpus(swoc::file::path const &index_path, swoc::file::path const &path)
+{
+  swoc::Rv<std::shared_ptr<ReplayCorpus>> zret{std::make_shared<ReplayCorpus>()};
+  auto &corpus = *zret.result();
+  auto &&[index, index_errata] = KeyIndexFile::open(index_path);
+  zret.note(std::move(index_errata));
+  if (!zret.is_ok()) {
+    return zret;
+  }
+  if (index->get_key_format() != HttpHeader::_key_format) {
+    zret.note(
+        S_ERROR,
+        R"(The key index "{}" was built with key format "{}" rather than "{}".)",
+        index_path,
+        index->get_key_format(),
+        HttpHeader::_key_format);
+    return zret;
+  }
+
+  ListenProtocols const protocols{
+      static_cast<bool>(arguments.get("listen-http")),
+      static_cast<bool>(arguments.get("listen-https")),
+      static_cast<bool>(arguments.get("listen-http3"))};
+  // The handshake directives must be known before any replay file is
+  // decoded, so the index carries them.
+  for (size_t i = 0; i < index->get_sni_count(); ++i) {
+    auto const sni_behavior = index->get_sni_behavior(i);
+    TLSHandshakeBehavior handshake_behavior;
+    handshake_behavior.set_verify_mode(sni_behavior.verify_mode);
+    if (!sni_behavior.alpn_wire_string.empty()) {
+      handshake_behavior.set_alpn_protocols_string(sni_behavior.alpn_wire_string);
+    }
+    corpus.sni_handshake_table->register_tls_handshake_behavior(
+        sni_behavior.sni,
+        std::move(handshake_behavior));
+  }
+  if (protocols.https) {
+    zret.note(TLSSession::build_sni_context_cache(*corpus.sni_handshake_table));
+    if (!zret.is_ok()) {
+      return zret;
+    }
+  }
+  zret.note(
+      S_INFO,
+      R"(Mapped the key index "{}": {} key{} in {} replay file{} will be decoded on first request.)",
+      index_path,
+      index->get_key_count(),
+      swoc::bwf::If(index->get_key_count() != 1, "s"),
+      index->get_file_count(),
+      swoc::bwf::If(index->get_file_count() != 1, "s"));
+  corpus.lazy_transactions = std::make_shared<LazyTransactions>(std::move(index), path, protocols);
+  return zret;
+}
+
+/** Return the resident set size of this process in bytes, or 0 if unknown. */
+static size_t
+get_resident_memory()
+{
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm == nullptr) {
+    return 0;
+  }
+  if (fscanf(statm, "%zu %zu", &total_pages, &resident_pages) != 2) {
+    resident_pages = 0;
+  }
+  fclose(statm);
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void
+Engine::reload_corpus()
+{
+  Errata errata;
+  errata.note(S_INFO, R"(Reloading the replay files from "{}".)", replay_path);
+  auto const resident_memory_before = get_resident_memory();
+  auto const start = std::chrono::steady_clock::now();
+  auto &&[corpus, load_errata] = load_corpus(replay_path);
+  errata.note(std::move(load_errata));
+  if (!errata.is_ok()) {
+    errata.note(S_ERROR, "Failed to reload the replay files: still serving the previous ones.");
+    process_exit_code = 1;
+    return;
+  }
+  // Swap in the new corpus. Requests already being served keep the corpus
+  // they started with, which is freed once the last of them finishes.
+  TLSSession::set_sni_handshake_table(corpus->sni_handshake_table);
+  auto previous_corpus =
+      std::atomic_exchange(&Current_Corpus, std::shared_ptr<ReplayCorpus const>{corpus});
+  auto const reload_duration =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  auto const resident_memory_loaded = get_resident_memory();
+  auto const previous_size = previous_corpus ? previous_corpus->get_transaction_count() : 0;
+  previous_corpus.reset();
+  errata.note(
+      S_INFO,
+      "Reloaded {} transaction{} (previously {}) in {}. Resident memory: {} KiB before the "
+      "reload, {} KiB with both corpora loaded, {} KiB after releasing the previous corpus "
+      "(if no connection still uses it).",
+      corpus->get_transaction_count(),
+      swoc::bwf::If(corpus->get_transaction_count() != 1, "s"),
+      previous_size,
+      reload_duration,
+      resident_memory_before / 1024,
+      resident_memory_loaded / 1024,
+      get_resident_memory() / 1024);
+}
+
 int
 main(int /* argc */, char const *argv[])
 {
@@ -1046,6 +1733,12 @@ main(int /* argc */, char const *argv[])
   sigIntHandler.sa_flags = 0;
   sigaction(SIGINT, &sigIntHandler, nullptr);
 
+  struct sigaction sigHupHandler;
+  sigHupHandler.sa_handler = sighup_handler;
+  sigemptyset(&sigHupHandler.sa_mask);
+  sigHupHandler.sa_flags = 0;
+  sigaction(SIGHUP, &sigHupHandler, nullptr);
+
   Engine engine;
 
   engine.parser
@@ -1077,6 +1770,24 @@ main(int /* argc */, char const *argv[])
           1,
           [&]() -> void { engine.command_run(); })
       .add_option("--thread-limit", "", thread_limit_description.c_str(), "", 1, "")
+      .add_option(
+          "--key-index",
+          "",
+          "Serve from a key index written by the index command. Replay files "
+          "are then parsed when one of their keys is first requested rather "
+          "than at startup.",
+          "",
+          1,
+          "")
+      .add_option(
+          "--parse-cache",
+          "",
+          "A directory in which to cache the parsed replay files by their "
+          "content, so that files which have not changed are not parsed again "
+          "on the next run.",
+          "",
+          1,
+          "")
       .add_option(
           "--listen-http",
           "",
@@ -1104,6 +1815,15 @@ main(int /* argc */, char const *argv[])
           "")
 #endif
       .add_option("--format", "-f", "Transaction key format", "", 1, "")
+      .add_option(
+          "--partition",
+          "",
+          "Serve only the transactions whose keys hash to this partition of "
+          "the key space, given as <index>/<count> (for example, 0/4). Use "
+          "with the client's --key-hash-targets option.",
+          "",
+          1,
+          "")
       .add_option(
           "--server-cert",
           "",
@@ -1130,6 +1850,22 @@ main(int /* argc */, char const *argv[])
           "",
           1,
           "")
+      .add_option(
+          "--ktls",
+          "",
+          "Request kernel TLS (kTLS) offload of TLS record processing. "
+          "Connections for which the kernel or negotiated cipher does not "
+          "support kTLS fall back to user space TLS.")
+      .add_option(
+          "--tls-ticket-key-file",
+          "",
+          "A file containing at least 80 bytes of TLS session ticket key "
+          "material. This allows tickets issued by one verifier-server to be "
+          "resumed by another or after a restart. By default random keys are "
+          "generated at startup.",
+          "",
+          1,
+          "")
       .add_option(
           "--strict",
           "-s",
@@ -1138,6 +1874,25 @@ main(int /* argc */, char const *argv[])
           "verification "
           "rule is provided.");
 
+  engine.parser
+      .add_command(
+          "index",
+          "index <path> <index-file>: write a key index of the replay file(s) "
+          "in path for use with run --key-index.",
+          "",
+          2,
+          [&]() -> void { engine.command_index(); })
+      .add_option("--format", "-f", "Transaction key format", "", 1, "");
+
+  engine.parser.add_command(
+      "compile",
+      "compile <path> <corpus-file>: compile the replay file(s) in path into a corpus "
+      "of their pre-tokenized trees, which run accepts in place of them. The transactions "
+      "are still built from the trees at startup.",
+      "",
+      2,
+      [&]() -> void { engine.command_compile(); });
+
   // parse the arguments
   engine.arguments = engine.parser.parse(argv);
   std::string verbosity = "info";
@@ -0,0 +1,65 @@
+'''
+Verify the user can stream the replay files with --stream.
+'''
+# @file
+#
+# Copyright 2022, Verizon Media
+# SPDX-License-Identifier: Apache-2.0
+#
+
+
+Test.Summary = '''
+Verify the user can stream the replay files with --stream.
+'''
+
+replay_dir = "../repeat_argument/replay_files/two_files"
+
+#
+# Test 1: Verify that with a window smaller than the replay files each
+# transaction is executed once.
+#
+r = Test.AddTestRun("Verify transactions are executed once with --stream 2.")
+client = r.AddClientProcess("client1", replay_dir, other_args="--stream 2")
+server = r.AddServerProcess("server1", replay_dir)
+proxy = r.AddProxyProcess("proxy1", listen_port=client.Variables.http_port,
+                          server_port=server.Variables.http_port)
+
+client.Streams.stdout += Testers.ContainsExpression(
+    'Streaming replay data from .* through a window of 2 sessions',
+    'Verify the replay files are streamed.')
+client.Streams.stdout += Testers.ExcludesExpression(
+    'Parsed 8 transactions',
+    'Verify the replay files are not loaded before the replay.')
+client.Streams.stdout += Testers.ContainsExpression(
+    '8 transactions in 5 sessions',
+    'Verify each transaction is executed once.')
+
+#
+# Test 2: Verify that the replay files are streamed again for each
+# repetition.
+#
+r = Test.AddTestRun("Verify transactions are executed twice with --stream 1 --repeat 2.")
+client = r.AddClientProcess("client2", replay_dir, other_args="--stream 1 --repeat 2")
+server = r.AddServerProcess("server2", replay_dir)
+proxy = r.AddProxyProcess("proxy2", listen_port=client.Variables.http_port,
+                          server_port=server.Variables.http_port)
+
+client.Streams.stdout += Testers.ContainsExpression(
+    '16 transactions in 10 sessions',
+    'Verify each transaction is executed twice.')
+
+if Condition.IsPlatform("darwin"):
+    # See the comment in repeat_argument.test.py about the test proxy closing
+    # sessions prematurely on the Mac.
+    client.ReturnCode = Any(0, 1)
+
+#
+# Test 3: Verify that a window of zero sessions is rejected.
+#
+r = Test.AddTestRun("Verify --stream 0 is rejected.")
+client = r.AddClientProcess("client3", replay_dir, other_args="--stream 0")
+
+client.Streams.stdout += Testers.ContainsExpression(
+    '"--stream" requires a positive number of sessions',
+    'Verify the window size is validated.')
+client.ReturnCode = 1
@@ -0,0 +1,117 @@
+'''
+Verify that the verifier-server reloads its replay files on SIGHUP.
+'''
+# @file
+#
+# Copyright 2022, Verizon Media
+# SPDX-License-Identifier: Apache-2.0
+#
+
+import os
+
+Test.Summary = '''
+Verify that the verifier-server reloads its replay files on SIGHUP.
+'''
+
+# The server runs across all the test runs below.
+server = Test.MakeServerProcess("server", "replay")
+server_replay_dir = os.path.join(Test.RunDirectory, "server", "replay")
+
+#
+# Test 1: Serve a transaction from the replay files the server starts with.
+#
+r = Test.AddTestRun("Serve a transaction from the initial replay files.")
+client = r.AddClientProcess("client_first", "client_replay/first.yaml",
+                            http_ports=[server.Variables.http_port],
+                            configure_https=False, configure_http3=False,
+                            other_args="--no-proxy")
+client.StartBefore(server)
+
+client.Streams.stdout = Testers.ContainsExpression(
+    "Received an HTTP/1 200 response for key first",
+    "The server should have served the initial key.")
+
+client.Streams.stdout += Testers.ContainsExpression(
+    "(?i)x-replay-version: 1",
+    "The response should come from the initial replay file.")
+
+client.Streams.stdout += Testers.ExcludesExpression(
+    "Violation:",
+    "There should be no verification errors because there are none added.")
+
+#
+# Test 2: Rewrite the replay files and send the server a SIGHUP while a
+# connection waits between two of its transactions.
+#
+r = Test.AddTestRun("Reload the replay files while a connection is open.")
+client = r.AddClientProcess("client_connection", "client_replay/connection.yaml",
+                            http_ports=[server.Variables.http_port],
+                            configure_https=False, configure_http3=False,
+                            other_args="--no-proxy")
+
+reloader_script = "reload_replay_files.py"
+reloader = r.Processes.Process("reloader")
+reloader.Setup.Copy(reloader_script)
+reloader.Setup.Copy("reloaded_replay")
+reloader.Command = f"python3 {reloader_script} {server_replay_dir} reloaded_replay --delay 1"
+reloader.ReturnCode = 0
+reloader.Streams.stdout = Testers.ContainsExpression(
+    "Sent SIGHUP to the verifier-server.",
+    "The reloader should have signaled the server.")
+
+# The client's second transaction waits for 3 seconds, by which time the
+# server has reloaded the replay files.
+client.StartBefore(reloader)
+
+client.Streams.stdout = Testers.ContainsExpression(
+    "Received an HTTP/1 200 response for key first",
+    "The transaction before the reload should be served from the initial files.")
+
+client.Streams.stdout += Testers.ContainsExpression(
+    "Received an HTTP/1 200 response for key second",
+    "The connection should be served a key only the reloaded files have.")
+
+client.Streams.stdout += Testers.ContainsExpression(
+    "(?i)x-replay-version: 2",
+    "The transaction after the reload should be served from the reloaded files.")
+
+client.Streams.stdout += Testers.ExcludesExpression(
+    "Violation:",
+    "There should be no verification errors because there are none added.")
+
+#
+# Test 3: New connections are served the reloaded replay files.
+#
+r = Test.AddTestRun("Serve new connections from the reloaded replay files.")
+client = r.AddClientProcess("client_reloaded", "client_replay/reloaded.yaml",
+                            http_ports=[server.Variables.http_port],
+                            configure_https=False, configure_http3=False,
+                            other_args="--no-proxy")
+
+client.Streams.stdout = Testers.ContainsExpression(
+    "Received an HTTP/1 200 response for key third",
+    "The server should have served the keys of the reloaded files.")
+
+client.Streams.stdout += Testers.ExcludesExpression(
+    "(?i)x-replay-version: 1",
+    "The changed key should be served from the reloaded files.")
+
+client.Streams.stdout += Testers.ExcludesExpression(
+    "Violation:",
+    "There should be no verification errors because there are none added.")
+
+server.Streams.stdout = Testers.ContainsExpression(
+    "Ready with 1 transaction",
+    "The server should have parsed the initial transaction.")
+
+server.Streams.stdout += Testers.ContainsExpression(
+    r"Reloaded 3 transactions \(previously 1\)",
+    "The server should have reloaded the rewritten replay files.")
+
+server.Streams.stdout += Testers.ExcludesExpression(
+    "not found, sending a 404",
+    "Every key should have been found in the current replay files.")
+
+server.Streams.stdout += Testers.ExcludesExpression(
+    "Violation:",
+    "There should be no verification errors because there are none added.")
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+'''
+Rewrite a Verifier Server's replay files and signal it to reload them.
+'''
+# @file
+#
+# Copyright 2022, Verizon Media
+# SPDX-License-Identifier: Apache-2.0
+#
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+
+def rewrite_replay_files(server_replay_dir, new_replay_dir):
+    """
+    Rewrite the server's replay files with those of new_replay_dir.
+
+    The test framework links the server's replay files to those of the test
+    directory, so each link is removed before its file is written rather than
+    being written through.
+    """
+    for name in os.listdir(new_replay_dir):
+        server_file = os.path.join(server_replay_dir, name)
+        if os.path.lexists(server_file):
+            os.remove(server_file)
+        shutil.copyfile(os.path.join(new_replay_dir, name), server_file)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('server_replay_dir',
+                        help='The replay directory the verifier-server was started with.')
+    parser.add_argument('new_replay_dir',
+                        help='The directory of the replay files to rewrite them with.')
+    parser.add_argument('--delay', type=float, default=1.0,
+                        help='The seconds to wait before rewriting the replay files.')
+    args = parser.parse_args()
+
+    time.sleep(args.delay)
+    rewrite_replay_files(args.server_replay_dir, args.new_replay_dir)
+    # Only the server's command line names its replay directory after the
+    # verifier-server command.
+    pattern = f'verifier-server run .*{args.server_replay_dir}'
+    if subprocess.run(['pkill', '-HUP', '-f', pattern]).returncode != 0:
+        print(f'Found no verifier-server process matching "{pattern}".')
+        return 1
+    print('Sent SIGHUP to the verifier-server.')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
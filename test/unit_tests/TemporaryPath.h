@@ -0,0 +1,96 @@
+/** @file
+ * A temporary file or directory for the unit tests.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "catch.hpp"
+
+#include "swoc/swoc_file.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+
+/** A uniquely named temporary file or directory, removed with all its
+ * contents when this goes out of scope.
+ */
+class TemporaryPath
+{
+public:
+  enum class Type {
+    FILE,     ///< An empty file.
+    DIRECTORY ///< An empty directory.
+  };
+
+  /**
+   * @param[in] name The start of the name of the file or directory, usually
+   * that of the test, to which a unique suffix is added.
+   * @param[in] type Whether to create a file or a directory.
+   */
+  explicit TemporaryPath(std::string_view name, Type type = Type::FILE)
+  {
+    std::string pattern{(std::filesystem::temp_directory_path() / name).string()};
+    pattern += ".XXXXXX";
+    if (type == Type::FILE) {
+      int const fd = mkstemp(pattern.data());
+      REQUIRE(fd >= 0);
+      close(fd);
+    } else {
+      REQUIRE(mkdtemp(pattern.data()) != nullptr);
+    }
+    _path = swoc::file::path{pattern};
+  }
+
+  TemporaryPath(TemporaryPath &&that) : _path{std::move(that._path)}
+  {
+    that._path = swoc::file::path{};
+  }
+
+  TemporaryPath(TemporaryPath const &) = delete;
+  TemporaryPath &operator=(TemporaryPath const &) = delete;
+  TemporaryPath &operator=(TemporaryPath &&) = delete;
+
+  ~TemporaryPath()
+  {
+    if (!_path.empty()) {
+      std::error_code ec;
+      std::filesystem::remove_all(_path.string(), ec);
+    }
+  }
+
+  /// The path of the temporary file or directory.
+  swoc::file::path const &
+  path() const
+  {
+    return _path;
+  }
+
+  /// The path of an entry within the temporary directory.
+  swoc::file::path
+  operator/(std::string_view name) const
+  {
+    return _path / swoc::file::path{name};
+  }
+
+  char const *
+  c_str() const
+  {
+    return _path.c_str();
+  }
+
+  std::string
+  string() const
+  {
+    return _path.string();
+  }
+
+private:
+  swoc::file::path _path;
+};
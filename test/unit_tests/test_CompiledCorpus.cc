@@ -0,0 +1,116 @@
+/** @file
+ * Unit tests for CompiledCorpus.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "TemporaryPath.h"
+#include "core/CompiledCorpus.h"
+#include "core/ScalarSource.h"
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+TEST_CASE("Test compiling and mapping a corpus", "[CompiledCorpus]")
+{
+  TemporaryPath const corpus_path{"test_CompiledCorpus"};
+
+  auto const first_root = YAML::Load(R"(
+meta:
+  version: '1.0'
+sessions:
+- protocol: [ { name: http, version: 1 } ]
+  transactions:
+  - client-request:
+      method: GET
+      url: /a
+      headers:
+        fields:
+        - [ Host, example.com ]
+        - [ uuid, 1, { as: present } ]
+    server-response:
+      status: 200
+      reason: ~
+      headers:
+        fields: []
+      content: {}
+)");
+  auto const second_root = YAML::Load("[ 1, [ 2, 3 ], { a: b } ]");
+
+  CompiledCorpus::Builder builder;
+  builder.add_file("first.yaml", first_root);
+  builder.add_file("second.json", second_root);
+  REQUIRE(builder.write(corpus_path.path()).is_ok());
+  CHECK(CompiledCorpus::is_compiled_corpus(corpus_path.path()));
+
+  auto &&[corpus, errata] = CompiledCorpus::open(corpus_path.path());
+  REQUIRE(errata.is_ok());
+  REQUIRE(corpus);
+  REQUIRE(corpus->get_file_count() == 2);
+  CHECK(corpus->get_file_path(0) == "first.yaml");
+  CHECK(corpus->find_file("first.yaml") == 0);
+  CHECK(corpus->find_file("second.json") == 1);
+  CHECK(corpus->find_file("third.yaml") == CompiledCorpus::NO_FILE);
+
+  auto const first = corpus->get_root(0);
+  CHECK(first["meta"]["version"].Scalar() == "1.0");
+  CHECK(first["sessions"][0]["protocol"][0]["version"].Scalar() == "1");
+  auto const txn = first["sessions"][0]["transactions"][0];
+  CHECK(txn["client-request"]["url"].Scalar() == "/a");
+  CHECK(txn["client-request"]["headers"]["fields"][1][2]["as"].Scalar() == "present");
+  CHECK(txn["server-response"]["reason"].IsNull());
+  CHECK(txn["server-response"]["headers"]["fields"].IsSequence());
+  CHECK(txn["server-response"]["headers"]["fields"].size() == 0);
+  CHECK(txn["server-response"]["content"].IsMap());
+
+  auto const second = corpus->get_root(1);
+  REQUIRE(second.IsSequence());
+  REQUIRE(second.size() == 3);
+  CHECK(second[1][1].Scalar() == "3");
+  CHECK(second[2]["a"].Scalar() == "b");
+  CHECK(ScalarSource::get(second[2]["a"]).empty());
+
+  // Tagged scalars refer to their text in the mapping.
+  auto const tagged = corpus->get_root(1, true);
+  auto const source = ScalarSource::get(tagged[2]["a"]);
+  CHECK(source == "b");
+  CHECK(source.data() != tagged[2]["a"].Scalar().data());
+}
+
+TEST_CASE("Test rejecting files that are not compiled corpora", "[CompiledCorpus]")
+{
+  TemporaryPath const corpus_path{"test_CompiledCorpus"};
+
+  SECTION("An empty file")
+  {
+    CHECK_FALSE(CompiledCorpus::is_compiled_corpus(corpus_path.path()));
+    CHECK_FALSE(CompiledCorpus::open(corpus_path.path()).is_ok());
+  }
+  SECTION("A replay file")
+  {
+    FILE *f = fopen(corpus_path.c_str(), "w");
+    REQUIRE(f != nullptr);
+    fputs("meta:\n  version: '1.0'\n\nsessions:\n- protocol: []\n  transactions: []\n", f);
+    fclose(f);
+    CHECK_FALSE(CompiledCorpus::is_compiled_corpus(corpus_path.path()));
+    CHECK_FALSE(CompiledCorpus::open(corpus_path.path()).is_ok());
+  }
+  SECTION("A truncated corpus")
+  {
+    CompiledCorpus::Builder builder;
+    builder.add_file("first.yaml", YAML::Load("{ a: [ b, c ] }"));
+    REQUIRE(builder.write(corpus_path.path()).is_ok());
+    REQUIRE(truncate(corpus_path.c_str(), 40) == 0);
+    CHECK(CompiledCorpus::is_compiled_corpus(corpus_path.path()));
+    CHECK_FALSE(CompiledCorpus::open(corpus_path.path()).is_ok());
+  }
+  SECTION("A missing file")
+  {
+    swoc::file::path const missing_path{corpus_path.string() + ".missing"};
+    CHECK_FALSE(CompiledCorpus::is_compiled_corpus(missing_path));
+    CHECK_FALSE(CompiledCorpus::open(missing_path).is_ok());
+  }
+}
@@ -0,0 +1,145 @@
+/** @file
+ * Unit tests for CompressedFile.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "TemporaryPath.h"
+#include "core/CompressedFile.h"
+#include "core/YamlParser.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <zlib.h>
+#include <zstd.h>
+
+using namespace std::literals;
+
+/** Compress data as a single gzip member. */
+static std::string
+gzip_compress(std::string const &data)
+{
+  z_stream stream{};
+  REQUIRE(deflateInit2(&stream, 6, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+  std::string compressed(deflateBound(&stream, data.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+  stream.avail_out = static_cast<uInt>(compressed.size());
+  REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  return compressed;
+}
+
+/** Compress data as a single zstd frame. */
+static std::string
+zstd_compress(std::string const &data)
+{
+  std::string compressed(ZSTD_compressBound(data.size()), '\0');
+  auto const size =
+      ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), 3);
+  REQUIRE_FALSE(ZSTD_isError(size));
+  compressed.resize(size);
+  return compressed;
+}
+
+/** Write a file of the given content in a temporary directory. */
+static swoc::file::path
+write_temporary_file(TemporaryPath const &dir, std::string const &name, std::string const &content)
+{
+  auto const path = dir / name;
+  FILE *out = fopen(path.c_str(), "w");
+  REQUIRE(out != nullptr);
+  fwrite(content.data(), 1, content.size(), out);
+  fclose(out);
+  return path;
+}
+
+/** Generate content of the given size that compresses well but not
+ * trivially.
+ */
+static std::string
+generate_content(size_t size)
+{
+  std::string content;
+  content.reserve(size);
+  for (size_t line = 0; content.size() < size; ++line) {
+    content += "- uuid: " + std::to_string(line) + "\n";
+  }
+  content.resize(size);
+  return content;
+}
+
+TEST_CASE("Compressed files are recognized by extension", "[CompressedFile]")
+{
+  using Format = CompressedFile::Format;
+  CHECK(CompressedFile::get_format(swoc::file::path{"replay/file.json.gz"}) == Format::GZIP);
+  CHECK(CompressedFile::get_format(swoc::file::path{"replay/file.yaml.ZST"}) == Format::ZSTD);
+  CHECK(CompressedFile::get_format(swoc::file::path{"replay/file.json"}) == Format::NONE);
+  CHECK(CompressedFile::get_format(swoc::file::path{"replay.gz/file"}) == Format::NONE);
+
+  CHECK(
+      CompressedFile::get_content_path(swoc::file::path{"replay/file.json.zst"}).string() ==
+      "replay/file.json");
+  CHECK(
+      CompressedFile::get_content_path(swoc::file::path{"replay/file.yaml"}).string() ==
+      "replay/file.yaml");
+}
+
+TEST_CASE("Compressed files are decompressed whole", "[CompressedFile]")
+{
+  // Larger than a block, so the file is decompressed across blocks.
+  auto const first = generate_content(CompressedFile::BLOCK_SIZE * 3 + 17);
+  auto const second = "sessions: []\n"s;
+  auto const &[name, compress] = GENERATE(
+      std::make_pair("replay.yaml.gz"s, &gzip_compress),
+      std::make_pair("replay.yaml.zst"s, &zstd_compress));
+  TemporaryPath const dir{"test_CompressedFile", TemporaryPath::Type::DIRECTORY};
+
+  SECTION("A single member or frame")
+  {
+    auto const path = write_temporary_file(dir, name, compress(first));
+    size_t compressed_size = 0;
+    auto &&[content, errata] = CompressedFile::load(path, compressed_size);
+    REQUIRE(errata.is_ok());
+    CHECK(content == first);
+    CHECK(compressed_size < first.size());
+  }
+  SECTION("Concatenated members or frames")
+  {
+    auto const path = write_temporary_file(dir, name, compress(first) + compress(second));
+    size_t compressed_size = 0;
+    auto &&[content, errata] = CompressedFile::load(path, compressed_size);
+    REQUIRE(errata.is_ok());
+    CHECK(content == first + second);
+  }
+  SECTION("A truncated file")
+  {
+    auto compressed = compress(first);
+    compressed.resize(compressed.size() / 2);
+    auto const path = write_temporary_file(dir, name, compressed);
+    size_t compressed_size = 0;
+    CHECK_FALSE(CompressedFile::load(path, compressed_size).is_ok());
+  }
+  SECTION("A file that is not compressed")
+  {
+    auto const path = write_temporary_file(dir, name, first);
+    size_t compressed_size = 0;
+    CHECK_FALSE(CompressedFile::load(path, compressed_size).is_ok());
+  }
+}
+
+TEST_CASE("Compressed replay files parse as their content would", "[CompressedFile]")
+{
+  auto const json = R"({"sessions": [{"transactions": ["a", "b"]}]})"s;
+  TemporaryPath const dir{"test_CompressedFile", TemporaryPath::Type::DIRECTORY};
+  auto const path = write_temporary_file(dir, "replay.json.zst", zstd_compress(json));
+  auto &&[root, errata] = YamlParser::parse_replay_file(path);
+  REQUIRE(errata.is_ok());
+  CHECK(root["sessions"][0]["transactions"][1].Scalar() == "b");
+}
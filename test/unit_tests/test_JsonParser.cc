@@ -0,0 +1,250 @@
+/** @file
+ * Unit tests for JsonParser.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "core/JsonParser.h"
+#include "core/ScalarSource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+using namespace std::literals;
+
+/** Whether two trees have the same structure and scalars. */
+static bool
+is_same_tree(YAML::Node const &lhs, YAML::Node const &rhs)
+{
+  if (lhs.Type() != rhs.Type()) {
+    return false;
+  }
+  switch (lhs.Type()) {
+  case YAML::NodeType::Scalar:
+    return lhs.Scalar() == rhs.Scalar();
+  case YAML::NodeType::Sequence:
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      if (!is_same_tree(lhs[i], rhs[i])) {
+        return false;
+      }
+    }
+    return true;
+  case YAML::NodeType::Map: {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+    for (auto lhs_it = lhs.begin(), rhs_it = rhs.begin(); lhs_it != lhs.end();
+         ++lhs_it, ++rhs_it)
+    {
+      if (!is_same_tree(lhs_it->first, rhs_it->first) ||
+          !is_same_tree(lhs_it->second, rhs_it->second))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+  default:
+    return true;
+  }
+}
+
+/** Generate a JSON replay file with the given number of sessions. */
+static std::string
+generate_replay_file(int n_sessions)
+{
+  std::string json = R"({"meta": {"version": "1.0"}, "sessions": [)";
+  for (int session = 0; session < n_sessions; ++session) {
+    if (session > 0) {
+      json += ", ";
+    }
+    json += R"({"protocol": [{"name": "http", "version": "1.1"}, {"name": "tcp"}], )";
+    json += R"("connection-time": 1611181433002395000, "transactions": [)";
+    for (int txn = 0; txn < 3; ++txn) {
+      auto const uuid = std::to_string(session * 3 + txn);
+      if (txn > 0) {
+        json += ", ";
+      }
+      json += R"({"client-request": {"method": "GET", "url": "/path/)" + uuid;
+      json += R"(?q=café", "version": "1.1", "headers": {"fields": [)";
+      json += R"(["Host", "example.com"], ["uuid", ")" + uuid + R"("], )";
+      json += R"(["X-Quoted", "a \"quoted\" value"]]}, "content": {"size": 0}}, )";
+      json += R"("proxy-request": {"headers": {"fields": [["uuid", {"value": ")" + uuid;
+      json += R"(", "as": "equal"}]]}}, )";
+      json += R"("server-response": {"status": 200, "reason": "OK", "headers": {"fields": [)";
+      json += R"(["Content-Length", "16"], ["X-Null", null], ["X-Bool", true]]}, )";
+      json += R"("content": {"size": 16}}, "proxy-response": {"status": 200}})";
+    }
+    json += "]}";
+  }
+  json += "]}";
+  return json;
+}
+
+TEST_CASE("JSON documents parse to the trees YAML::Load builds", "[JsonParser]")
+{
+  auto const json = GENERATE(
+      "{}"s,
+      "[]"s,
+      R"("scalar")"s,
+      "-1.5e3"s,
+      R"({"a": null, "b": true, "c": false, "d": 0, "e": [1, [2, {}], ""]})"s,
+      "\n  {\"a\":\t[ \"x\" ,\"y\" ]\r\n}\n"s,
+      R"({"escapes": "\"\\\/\b\f\n\r\t", "unicode": "\u0041\u00e9\u20ac"})"s,
+      R"({"duplicate": 1, "duplicate": 2})"s,
+      generate_replay_file(2));
+
+  bool has_merge_key = true;
+  auto &&[root, errata] = JsonParser::parse(json, has_merge_key);
+  INFO(json);
+  REQUIRE(errata.is_ok());
+  CHECK_FALSE(has_merge_key);
+  CHECK(is_same_tree(root, YAML::Load(json)));
+}
+
+TEST_CASE("JSON surrogate pairs are decoded to UTF-8", "[JsonParser]")
+{
+  bool has_merge_key = false;
+  auto &&[root, errata] = JsonParser::parse(R"(["\ud83d\ude00"])", has_merge_key);
+  REQUIRE(errata.is_ok());
+  CHECK(root[0].Scalar() == "\xF0\x9F\x98\x80");
+}
+
+TEST_CASE("JSON values without escapes are tagged with their source", "[JsonParser]")
+{
+  std::string_view const json =
+      R"({"plain": "text", "escaped": "a\nb", "number": -1.5, "empty": ""})";
+  bool has_merge_key = false;
+
+  auto &&[root, errata] = JsonParser::parse(json, has_merge_key, true);
+  REQUIRE(errata.is_ok());
+  auto const plain = ScalarSource::get(root["plain"]);
+  CHECK(plain == "text");
+  CHECK(plain.data() == json.data() + json.find("text"));
+  CHECK(ScalarSource::get(root["number"]) == "-1.5");
+  CHECK(ScalarSource::get(root["escaped"]).empty());
+  CHECK(root["escaped"].Scalar() == "a\nb");
+  CHECK(ScalarSource::get(root["empty"]).empty());
+
+  auto &&[untagged_root, untagged_errata] = JsonParser::parse(json, has_merge_key);
+  REQUIRE(untagged_errata.is_ok());
+  CHECK(ScalarSource::get(untagged_root["plain"]).empty());
+}
+
+TEST_CASE("JSON merge keys are reported", "[JsonParser]")
+{
+  bool has_merge_key = false;
+  auto &&[root, errata] = JsonParser::parse(R"({"a": {"<<": {"b": 1}}})", has_merge_key);
+  REQUIRE(errata.is_ok());
+  CHECK(has_merge_key);
+}
+
+TEST_CASE("Invalid JSON is rejected", "[JsonParser]")
+{
+  auto const json = GENERATE(
+      ""s,
+      "{"s,
+      "[1, 2,]"s,
+      R"({"a" 1})"s,
+      R"({a: 1})"s,
+      "[tru]"s,
+      "01"s,
+      "[1.]"s,
+      R"(["unterminated)"s,
+      R"(["\x"])"s,
+      R"(["\ud800"])"s,
+      "[\"tab\there\"]"s,
+      "{} {}"s,
+      std::string(JsonParser::MAX_DEPTH + 1, '[') + std::string(JsonParser::MAX_DEPTH + 1, ']'));
+
+  bool has_merge_key = false;
+  INFO(json);
+  CHECK_FALSE(JsonParser::parse(json, has_merge_key).is_ok());
+}
+
+TEST_CASE("JSON replay files are recognized by extension", "[JsonParser]")
+{
+  CHECK(JsonParser::is_json_file(swoc::file::path{"replay/file.json"}));
+  CHECK(JsonParser::is_json_file(swoc::file::path{"replay/FILE.JSON"}));
+  CHECK_FALSE(JsonParser::is_json_file(swoc::file::path{"replay/file.yaml"}));
+  CHECK_FALSE(JsonParser::is_json_file(swoc::file::path{"replay.json/file"}));
+  CHECK_FALSE(JsonParser::is_json_file(swoc::file::path{"replay/json"}));
+}
+
+TEST_CASE("JSON arrays are split into chunks that parse to the same elements", "[JsonParser]")
+{
+  auto const json = GENERATE(
+      generate_replay_file(10),
+      R"( {"meta": {"a": [1, "]"]}, "sessions": ["x]", "y\"]", {"z": "}"}, [[]], null] } )"s);
+  size_t const max_chunks = GENERATE(2, 3, 4, 100);
+
+  bool has_merge_key = false;
+  auto const whole = JsonParser::parse(json, has_merge_key).result();
+  auto const split = JsonParser::split_array(json, "sessions", max_chunks);
+  INFO(json);
+  REQUIRE(split.chunks.size() == std::min<size_t>(max_chunks, whole["sessions"].size()));
+
+  auto const remainder = JsonParser::parse(split.remainder, has_merge_key).result();
+  CHECK(is_same_tree(remainder["meta"], whole["meta"]));
+  CHECK(remainder["sessions"].IsSequence());
+  CHECK(remainder["sessions"].size() == 0);
+
+  size_t element_index = 0;
+  for (auto const &chunk : split.chunks) {
+    auto &&[chunk_root, errata] = JsonParser::parse(chunk, has_merge_key);
+    REQUIRE(errata.is_ok());
+    REQUIRE(chunk_root["sessions"].size() > 0);
+    for (auto const &element : chunk_root["sessions"]) {
+      CHECK(is_same_tree(element, whole["sessions"][element_index++]));
+    }
+  }
+  CHECK(element_index == whole["sessions"].size());
+}
+
+TEST_CASE("JSON documents without a splittable array are not split", "[JsonParser]")
+{
+  auto const json = GENERATE(
+      "[]"s,
+      R"({"meta": {}})"s,
+      R"({"sessions": [1]})"s,
+      R"({"sessions": {"a": 1, "b": 2}})"s,
+      R"({"sessions": [1, 2], "sessions": [3, 4]})"s,
+      R"({"meta": {"sessions": [1, 2]}})"s,
+      R"({"sessions": [1, 2)"s,
+      R"({"sessions": ["1, 2]})"s);
+
+  INFO(json);
+  CHECK(JsonParser::split_array(json, "sessions", 4).chunks.empty());
+  CHECK(JsonParser::split_array(R"({"sessions": [1, 2]})", "sessions", 1).chunks.empty());
+}
+
+// Run with: tests "[benchmark]"
+TEST_CASE("Benchmark JSON parsing against YAML::Load", "[.][benchmark]")
+{
+  using std::chrono::duration;
+  using std::chrono::steady_clock;
+
+  auto const json = generate_replay_file(20'000);
+  double const megabytes = json.size() / 1e6;
+
+  auto const yaml_start = steady_clock::now();
+  auto const yaml_root = YAML::Load(json);
+  duration<double> const yaml_time = steady_clock::now() - yaml_start;
+
+  bool has_merge_key = false;
+  auto const json_start = steady_clock::now();
+  auto &&[json_root, errata] = JsonParser::parse(json, has_merge_key);
+  duration<double> const json_time = steady_clock::now() - json_start;
+
+  REQUIRE(errata.is_ok());
+  CHECK(is_same_tree(json_root, yaml_root));
+  WARN(
+      "Parsed " << megabytes << " MB: YAML::Load " << megabytes / yaml_time.count()
+                << " MB/s, JsonParser " << megabytes / json_time.count() << " MB/s.");
+}
@@ -0,0 +1,126 @@
+/** @file
+ * Unit tests for KeyIndex.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "core/KeyIndex.h"
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+/** Generate n distinct keys resembling the uuid keys of replay files. */
+std::vector<std::string>
+generate_keys(size_t n)
+{
+  std::vector<std::string> keys;
+  keys.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys.emplace_back("2d1a7f3c-52e4-4b6e-9f0a-" + std::to_string(1'000'000'000'000 + i));
+  }
+  return keys;
+}
+} // namespace
+
+TEST_CASE("KeyIndex lookup", "[KeyIndex]")
+{
+  KeyIndex<int> index;
+  CHECK(index.find("missing") == nullptr);
+
+  auto const keys = generate_keys(1000);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto const [value, is_new] = index.emplace(keys[i], static_cast<int>(i));
+    REQUIRE(is_new);
+    REQUIRE(*value == static_cast<int>(i));
+  }
+  CHECK(index.size() == keys.size());
+
+  SECTION("Every key is found")
+  {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto const *value = index.find(keys[i]);
+      REQUIRE(value != nullptr);
+      CHECK(*value == static_cast<int>(i));
+    }
+  }
+
+  SECTION("Keys are interned")
+  {
+    std::string key = keys.front();
+    auto const *value = index.find(key);
+    key[0] = 'x';
+    CHECK(index.find(keys.front()) == value);
+    CHECK(index.find(key) == nullptr);
+  }
+
+  SECTION("The first value for a key is kept")
+  {
+    auto const [value, is_new] = index.emplace(keys.front(), -1);
+    CHECK_FALSE(is_new);
+    CHECK(*value == 0);
+    CHECK(index.size() == keys.size());
+  }
+
+  SECTION("Iteration visits every entry")
+  {
+    size_t count = 0;
+    for (auto const &[key, value] : index) {
+      CHECK(keys[value] == key);
+      ++count;
+    }
+    CHECK(count == keys.size());
+  }
+}
+
+// This is hidden by default. Run it via: tests "[benchmark]"
+TEST_CASE("KeyIndex lookup rate", "[.][benchmark][KeyIndex]")
+{
+  using Clock = std::chrono::steady_clock;
+  constexpr size_t num_keys = 2'000'000;
+  auto const keys = generate_keys(num_keys);
+
+  KeyIndex<size_t> index;
+  index.reserve(num_keys);
+  std::unordered_map<std::string, size_t, std::hash<std::string_view>> map;
+  map.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; ++i) {
+    index.emplace(keys[i], i);
+    map.emplace(keys[i], i);
+  }
+
+  // Look the keys up in a different order than they were inserted.
+  std::vector<std::string_view> lookups;
+  lookups.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; ++i) {
+    lookups.emplace_back(keys[(i * 7919) % num_keys]);
+  }
+
+  size_t found = 0;
+  auto start = Clock::now();
+  for (auto const key : lookups) {
+    found += index.find(key) != nullptr;
+  }
+  std::chrono::duration<double> const index_duration = Clock::now() - start;
+  CHECK(found == num_keys);
+
+  found = 0;
+  start = Clock::now();
+  for (auto const key : lookups) {
+    // This is how lookups were done before: via an allocated std::string.
+    found += map.find(std::string{key}) != map.end();
+  }
+  std::chrono::duration<double> const map_duration = Clock::now() - start;
+  CHECK(found == num_keys);
+
+  WARN(
+      "KeyIndex: " << static_cast<uint64_t>(num_keys / index_duration.count())
+                   << " lookups/s, std::unordered_map: "
+                   << static_cast<uint64_t>(num_keys / map_duration.count()) << " lookups/s over "
+                   << num_keys << " keys.");
+}
@@ -0,0 +1,88 @@
+/** @file
+ * Unit tests for KeyIndexFile.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "TemporaryPath.h"
+#include "core/KeyIndexFile.h"
+
+#include <cstdio>
+#include <string>
+
+TEST_CASE("Test writing and mapping a key index", "[KeyIndexFile]")
+{
+  TemporaryPath const index_path{"test_KeyIndexFile"};
+
+  KeyIndexFile::Builder builder;
+  builder.set_key_format("{url}");
+  auto const first_file = builder.add_file("first.yaml");
+  auto const second_file = builder.add_file("second.json");
+  builder.add_key("/b", first_file);
+  builder.add_key("/a", second_file);
+  builder.add_key("/c", second_file);
+  // The first file added for a duplicate key is kept.
+  builder.add_key("/b", second_file);
+  builder.add_sni({"example.com", 1, "\x02h2"});
+  REQUIRE(builder.write(index_path.path()).is_ok());
+
+  auto &&[index, errata] = KeyIndexFile::open(index_path.path());
+  REQUIRE(errata.is_ok());
+  REQUIRE(index);
+  CHECK(index->get_key_format() == "{url}");
+  CHECK(index->get_key_count() == 3);
+  CHECK(index->get_file_count() == 2);
+
+  CHECK(index->find("/a") == second_file);
+  CHECK(index->find("/b") == first_file);
+  CHECK(index->find("/c") == second_file);
+  CHECK(index->find("/d") == KeyIndexFile::NO_FILE);
+  CHECK(index->find("") == KeyIndexFile::NO_FILE);
+
+  CHECK(index->get_file_path(first_file) == "first.yaml");
+  CHECK(index->get_file_path(second_file) == "second.json");
+  CHECK(index->get_file_path(KeyIndexFile::NO_FILE).empty());
+
+  REQUIRE(index->get_sni_count() == 1);
+  auto const sni_behavior = index->get_sni_behavior(0);
+  CHECK(sni_behavior.sni == "example.com");
+  CHECK(sni_behavior.verify_mode == 1);
+  CHECK(sni_behavior.alpn_wire_string == "\x02h2");
+}
+
+TEST_CASE("Test mapping an empty key index", "[KeyIndexFile]")
+{
+  TemporaryPath const index_path{"test_KeyIndexFile"};
+
+  KeyIndexFile::Builder builder;
+  REQUIRE(builder.write(index_path.path()).is_ok());
+
+  auto &&[index, errata] = KeyIndexFile::open(index_path.path());
+  REQUIRE(errata.is_ok());
+  CHECK(index->get_key_count() == 0);
+  CHECK(index->find("/a") == KeyIndexFile::NO_FILE);
+}
+
+TEST_CASE("Test rejecting files that are not key indexes", "[KeyIndexFile]")
+{
+  TemporaryPath const index_path{"test_KeyIndexFile"};
+
+  SECTION("An empty file")
+  {
+    CHECK_FALSE(KeyIndexFile::open(index_path.path()).is_ok());
+  }
+  SECTION("A replay file")
+  {
+    FILE *f = fopen(index_path.c_str(), "w");
+    REQUIRE(f != nullptr);
+    fputs("meta:\n  version: '1.0'\n\nsessions:\n- protocol: []\n  transactions: []\n", f);
+    fclose(f);
+    CHECK_FALSE(KeyIndexFile::open(index_path.path()).is_ok());
+  }
+  SECTION("A missing file")
+  {
+    CHECK_FALSE(KeyIndexFile::open(swoc::file::path{index_path.string() + ".missing"}).is_ok());
+  }
+}
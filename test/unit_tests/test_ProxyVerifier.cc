@@ -0,0 +1,102 @@
+/** @file
+ * Unit tests for ProxyVerifier.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "TemporaryPath.h"
+#include "core/ProxyVerifier.h"
+
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <sys/stat.h>
+
+TEST_CASE("Test parsing a key partition", "[KeyPartition]")
+{
+  SECTION("Valid partitions")
+  {
+    auto &&[partition, errata] = KeyPartition::parse("2/4");
+    REQUIRE(errata.is_ok());
+    CHECK(partition.index == 2);
+    CHECK(partition.count == 4);
+
+    auto &&[only_partition, only_errata] = KeyPartition::parse("0/1");
+    REQUIRE(only_errata.is_ok());
+    CHECK(only_partition.index == 0);
+    CHECK(only_partition.count == 1);
+  }
+  SECTION("Invalid partitions")
+  {
+    CHECK_FALSE(KeyPartition::parse("").is_ok());
+    CHECK_FALSE(KeyPartition::parse("2").is_ok());
+    CHECK_FALSE(KeyPartition::parse("2/").is_ok());
+    CHECK_FALSE(KeyPartition::parse("/4").is_ok());
+    CHECK_FALSE(KeyPartition::parse("4/4").is_ok());
+    CHECK_FALSE(KeyPartition::parse("0/0").is_ok());
+    CHECK_FALSE(KeyPartition::parse("a/4").is_ok());
+    CHECK_FALSE(KeyPartition::parse("1/4x").is_ok());
+  }
+}
+
+TEST_CASE("Test that each key is owned by exactly one partition", "[KeyPartition]")
+{
+  constexpr size_t num_partitions = 4;
+  std::array<size_t, num_partitions> num_owned{};
+  for (size_t i = 0; i < 1000; ++i) {
+    auto const key = std::to_string(i);
+    size_t num_owners = 0;
+    for (size_t index = 0; index < num_partitions; ++index) {
+      KeyPartition const partition{index, num_partitions};
+      if (partition.owns(key)) {
+        ++num_owners;
+        ++num_owned[index];
+        CHECK(KeyPartition::get_partition(key, num_partitions) == index);
+      }
+    }
+    CHECK(num_owners == 1);
+    // An unpartitioned key space owns every key.
+    CHECK(KeyPartition{}.owns(key));
+  }
+  // The keys are spread across the partitions.
+  for (auto const owned : num_owned) {
+    CHECK(owned > 150);
+  }
+  // The partition of a key must not change between builds since the client
+  // and the servers compute it independently.
+  CHECK(KeyPartition::get_partition("", 7) == 14695981039346656037ULL % 7);
+}
+
+TEST_CASE("Test writing a file atomically", "[write_file_atomically]")
+{
+  TemporaryPath const directory{"test_write_file_atomically", TemporaryPath::Type::DIRECTORY};
+  auto const path = directory / "written";
+
+  SECTION("A successful write")
+  {
+    auto const errata = write_file_atomically(path, "test file", [](FILE *out) -> bool {
+      return fputs("contents", out) >= 0;
+    });
+    REQUIRE(errata.is_ok());
+    std::error_code ec;
+    CHECK(swoc::file::load(path, ec) == "contents");
+
+    // The file gets the permissions open(O_CREAT, 0666) would give it.
+    auto const mask = umask(0);
+    umask(mask);
+    struct stat file_stat;
+    REQUIRE(stat(path.c_str(), &file_stat) == 0);
+    CHECK((file_stat.st_mode & 0777) == (0666 & ~mask));
+  }
+  SECTION("A failed write")
+  {
+    auto const errata =
+        write_file_atomically(path, "test file", [](FILE *) -> bool { return false; });
+    CHECK_FALSE(errata.is_ok());
+    // Neither the file nor its temporary file are left behind.
+    CHECK(std::filesystem::is_empty(directory.string()));
+  }
+}
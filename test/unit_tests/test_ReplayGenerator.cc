@@ -0,0 +1,138 @@
+/** @file
+ * Unit tests for ReplayGenerator.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "TemporaryPath.h"
+#include "core/CompiledCorpus.h"
+#include "core/JsonParser.h"
+#include "core/ReplayGenerator.h"
+
+#include <numeric>
+#include <string>
+
+using namespace std::literals;
+
+/** The concatenated content of the generated replay files. */
+static std::string
+load_generated_files(swoc::file::path const &dir, ReplayGenerator::Options const &options)
+{
+  auto const n_files = ReplayGenerator::plan(options).size();
+  std::string content;
+  for (size_t i = 0; i < n_files; ++i) {
+    std::error_code ec;
+    auto const name = ReplayGenerator::get_file_name(options, i, n_files);
+    content += swoc::file::load(dir / swoc::file::path{name}, ec);
+    REQUIRE_FALSE(ec);
+  }
+  return content;
+}
+
+TEST_CASE("Generator ranges and protocol mixes are parsed", "[ReplayGenerator]")
+{
+  auto const range = ReplayGenerator::Range::parse("5-10").result();
+  CHECK(range.min == 5);
+  CHECK(range.max == 10);
+  CHECK(ReplayGenerator::Range::parse("7").result().max == 7);
+  CHECK_FALSE(ReplayGenerator::Range::parse("").is_ok());
+  CHECK_FALSE(ReplayGenerator::Range::parse("10-5").is_ok());
+  CHECK_FALSE(ReplayGenerator::Range::parse("1-x").is_ok());
+
+  std::array<unsigned, ReplayGenerator::N_PROTOCOLS> weights;
+  REQUIRE(ReplayGenerator::parse_protocol_mix("http:3, H2", weights).is_ok());
+  CHECK(weights == std::array<unsigned, ReplayGenerator::N_PROTOCOLS>{3, 0, 1});
+  CHECK_FALSE(ReplayGenerator::parse_protocol_mix("spdy", weights).is_ok());
+  CHECK_FALSE(ReplayGenerator::parse_protocol_mix("http:0", weights).is_ok());
+}
+
+TEST_CASE("Generated files hold the planned sessions", "[ReplayGenerator]")
+{
+  ReplayGenerator::Options options;
+  options.transactions = 1000;
+  options.file_sessions = {3, 7};
+  options.session_transactions = {1, 20};
+  options.header_count = {0, 4};
+  options.urls = {"https://example.com/a/b?q=\"x\"", "http://example.org"};
+
+  auto const files = ReplayGenerator::plan(options);
+  size_t n_transactions = 0;
+  for (auto const &file : files) {
+    bool has_merge_key = false;
+    auto const text = ReplayGenerator::generate_file(options, file);
+    auto &&[root, errata] = JsonParser::parse(text, has_merge_key);
+    REQUIRE(errata.is_ok());
+    auto const sessions = root["sessions"];
+    REQUIRE(sessions.size() == file.session_transactions.size());
+    for (size_t i = 0; i < sessions.size(); ++i) {
+      CHECK(sessions[i]["transactions"].size() == file.session_transactions[i]);
+      n_transactions += sessions[i]["transactions"].size();
+    }
+  }
+  CHECK(n_transactions == options.transactions);
+  CHECK(std::accumulate(
+            files.begin(),
+            files.end(),
+            size_t{0},
+            [](size_t n, auto const &file) { return n + file.session_transactions.size(); }) ==
+        files.back().first_session + files.back().session_transactions.size());
+}
+
+TEST_CASE("Generated files depend only on the seed and options", "[ReplayGenerator]")
+{
+  ReplayGenerator::Options options;
+  options.transactions = 500;
+  auto const file = ReplayGenerator::plan(options).back();
+  auto const text = ReplayGenerator::generate_file(options, file);
+  CHECK(ReplayGenerator::generate_file(options, file) == text);
+
+  options.seed = 2;
+  CHECK(ReplayGenerator::generate_file(options, ReplayGenerator::plan(options).back()) != text);
+
+  options.protocol_weights = {0, 0, 1};
+  bool has_merge_key = false;
+  auto const root = JsonParser::parse(
+                        ReplayGenerator::generate_file(options, ReplayGenerator::plan(options)[0]),
+                        has_merge_key)
+                        .result();
+  for (auto const &session : root["sessions"]) {
+    CHECK(session["protocol"][0]["version"].Scalar() == "2");
+  }
+}
+
+TEST_CASE("Generated files do not depend on the number of threads", "[ReplayGenerator]")
+{
+  ReplayGenerator::Options options;
+  options.transactions = 2000;
+  options.prefix = "gen-";
+
+  options.n_threads = 1;
+  TemporaryPath const single_dir{"test_ReplayGenerator", TemporaryPath::Type::DIRECTORY};
+  REQUIRE(ReplayGenerator::generate(options, single_dir.path()).is_ok());
+  options.n_threads = 4;
+  TemporaryPath const multiple_dir{"test_ReplayGenerator", TemporaryPath::Type::DIRECTORY};
+  REQUIRE(ReplayGenerator::generate(options, multiple_dir.path()).is_ok());
+  CHECK(ReplayGenerator::get_file_name(options, 3, 20) == "gen-03.json");
+  CHECK(
+      load_generated_files(single_dir.path(), options) ==
+      load_generated_files(multiple_dir.path(), options));
+
+  options.format = ReplayGenerator::Format::CORPUS;
+  TemporaryPath const corpus_dir{"test_ReplayGenerator", TemporaryPath::Type::DIRECTORY};
+  auto const corpus_path = corpus_dir / "corpus.pvc";
+  REQUIRE(ReplayGenerator::generate(options, corpus_path).is_ok());
+  auto &&[corpus, errata] = CompiledCorpus::open(corpus_path);
+  REQUIRE(errata.is_ok());
+  CHECK(corpus->get_file_count() == ReplayGenerator::plan(options).size());
+
+  // The threads' trees are added to the corpus in file order.
+  options.n_threads = 1;
+  auto const single_corpus_path = corpus_dir / "single.pvc";
+  REQUIRE(ReplayGenerator::generate(options, single_corpus_path).is_ok());
+  std::error_code ec;
+  auto const single_corpus = swoc::file::load(single_corpus_path, ec);
+  REQUIRE_FALSE(ec);
+  CHECK(swoc::file::load(corpus_path, ec) == single_corpus);
+}
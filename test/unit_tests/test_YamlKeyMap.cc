@@ -0,0 +1,204 @@
+/** @file
+ * Unit tests for YamlKeyMap.h.
+ *
+ * Copyright 2022, Verizon Media
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "TemporaryPath.h"
+#include "core/ReplayGenerator.h"
+#include "core/YamlKeyMap.h"
+#include "core/YamlParser.h"
+#include "core/http.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+/// The key strings of YamlParser.h and the keys they identify.
+static std::vector<std::pair<std::string, YamlKey>> const Key_Strings{
+    {YAML_TIME_START_KEY, YamlKey::CONNECTION_TIME},
+    {YAML_TIME_DELAY_KEY, YamlKey::DELAY},
+    {YAML_SSN_PROTOCOL_KEY, YamlKey::PROTOCOL},
+    {YAML_TXN_KEY, YamlKey::TRANSACTIONS},
+    {YAML_ALL_MESSAGES_KEY, YamlKey::ALL},
+    {YAML_CLIENT_REQ_KEY, YamlKey::CLIENT_REQUEST},
+    {YAML_PROXY_REQ_KEY, YamlKey::PROXY_REQUEST},
+    {YAML_SERVER_RSP_KEY, YamlKey::SERVER_RESPONSE},
+    {YAML_PROXY_RSP_KEY, YamlKey::PROXY_RESPONSE},
+    {YAML_HTTP_VERSION_KEY, YamlKey::VERSION},
+    {YAML_HTTP2_KEY, YamlKey::HTTP2},
+    {YAML_HTTP_STATUS_KEY, YamlKey::STATUS},
+    {YAML_HTTP_REASON_KEY, YamlKey::REASON},
+    {YAML_HTTP_METHOD_KEY, YamlKey::METHOD},
+    {YAML_HTTP_URL_KEY, YamlKey::URL},
+    {YAML_HTTP_SCHEME_KEY, YamlKey::SCHEME},
+    {YAML_HDR_KEY, YamlKey::HEADERS},
+    {YAML_CONTENT_KEY, YamlKey::CONTENT},
+    {YAML_CONTENT_SIZE_KEY, YamlKey::SIZE},
+    {YAML_CONTENT_DATA_KEY, YamlKey::DATA},
+    {YAML_CONTENT_VERIFY_KEY, YamlKey::VERIFY},
+    {YAML_CONTENT_ENCODING_KEY, YamlKey::ENCODING},
+    {YAML_CONTENT_TRANSFER_KEY, YamlKey::TRANSFER},
+};
+
+static_assert(YamlKeyMap::get_key("server-response") == YamlKey::SERVER_RESPONSE);
+static_assert(YamlKeyMap::get_key("server-responses") == YamlKey::UNKNOWN);
+
+/** Generate a temporary replay file. */
+static TemporaryPath
+generate_replay_file(size_t n_transactions)
+{
+  ReplayGenerator::Options options;
+  options.transactions = n_transactions;
+  options.file_sessions = {n_transactions, n_transactions};
+  options.header_count = {5, 10};
+  TemporaryPath path{"test_YamlKeyMap"};
+  FILE *out = fopen(path.c_str(), "w");
+  REQUIRE(out != nullptr);
+  ReplayGenerator::generate_file(
+      options,
+      ReplayGenerator::plan(options).front(),
+      [out](std::string_view piece) { fwrite(piece.data(), 1, piece.size(), out); });
+  fclose(out);
+  return path;
+}
+
+TEST_CASE("YAML keys are identified by their strings", "[YamlKeyMap]")
+{
+  for (auto const &[name, key] : Key_Strings) {
+    INFO(name);
+    CHECK(YamlKeyMap::get_key(name) == key);
+  }
+  CHECK(Key_Strings.size() == static_cast<size_t>(YamlKey::UNKNOWN));
+  for (auto const name : {""sv, "x"sv, "Status"sv, "statuses"sv, "content-length"sv}) {
+    INFO(name);
+    CHECK(YamlKeyMap::get_key(name) == YamlKey::UNKNOWN);
+  }
+}
+
+TEST_CASE("YamlKeyMap finds the values node lookups find", "[YamlKeyMap]")
+{
+  auto const node = YAML::Load(R"(
+    status: 200
+    [status]: 1
+    unknown: 2
+    content: { size: 3 }
+    status: 404
+  )");
+  YamlKeyMap const keys{node};
+  REQUIRE(keys.find(YamlKey::STATUS) != nullptr);
+  CHECK(keys.find(YamlKey::STATUS)->is(node[YAML_HTTP_STATUS_KEY]));
+  CHECK(keys.find(YamlKey::STATUS)->Scalar() == "200");
+  CHECK(keys.find(YamlKey::CONTENT)->is(node[YAML_CONTENT_KEY]));
+  CHECK(keys.find(YamlKey::SIZE) == nullptr);
+  CHECK(keys.find(YamlKey::METHOD) == nullptr);
+
+  YamlKeyMap const sequence_keys{YAML::Load("[status, 200]")};
+  CHECK(sequence_keys.find(YamlKey::STATUS) == nullptr);
+
+  // The messages of a generated replay file have the same values either way.
+  auto const replay_file = generate_replay_file(50);
+  auto const &path = replay_file.path();
+  auto const root = YAML::LoadFile(path.string());
+  for (auto const &session : root[YAML_SSN_KEY]) {
+    for (auto const &txn : session[YAML_TXN_KEY]) {
+      for (auto const &message : txn) {
+        YamlKeyMap const message_keys{message.second};
+        for (auto const &[name, key] : Key_Strings) {
+          auto const value = message.second[name];
+          auto const *found = message_keys.find(key);
+          CHECK(static_cast<bool>(value) == (found != nullptr));
+          CHECK((found == nullptr || found->is(value)));
+        }
+      }
+    }
+  }
+}
+
+/// Populates the messages of each transaction, as the client and server do.
+class MessageHandler : public ReplayFileHandler
+{
+public:
+  swoc::Errata
+  client_request(YAML::Node const &node) override
+  {
+    HttpHeader request;
+    ++n_messages;
+    return YamlParser::populate_http_message(node, request);
+  }
+
+  swoc::Errata
+  server_response(YAML::Node const &node) override
+  {
+    HttpHeader response;
+    ++n_messages;
+    return YamlParser::populate_http_message(node, response);
+  }
+
+  size_t n_messages = 0;
+};
+
+// Run with: tests "[benchmark]"
+TEST_CASE("Benchmark YAML key dispatch and replay file loading", "[.][benchmark]")
+{
+  using std::chrono::duration;
+  using std::chrono::steady_clock;
+
+  HttpHeader::global_init();
+  auto const replay_file = generate_replay_file(20'000);
+  auto const &path = replay_file.path();
+  auto const root = YAML::LoadFile(path.string());
+  std::vector<YAML::Node> messages;
+  for (auto const &session : root[YAML_SSN_KEY]) {
+    for (auto const &txn : session[YAML_TXN_KEY]) {
+      for (auto const &message : txn) {
+        messages.push_back(message.second);
+      }
+    }
+  }
+
+  // The message keys populate_http_message looks up, one lookup at a time as
+  // it did before YamlKeyMap.
+  std::vector<std::pair<std::string, YamlKey>> const message_keys(
+      Key_Strings.begin() + static_cast<size_t>(YamlKey::VERSION),
+      Key_Strings.begin() + static_cast<size_t>(YamlKey::SIZE));
+  size_t lookup_count = 0;
+  auto const lookup_start = steady_clock::now();
+  for (auto const &message : messages) {
+    for (auto const &[name, key] : message_keys) {
+      lookup_count += static_cast<bool>(message[name]);
+    }
+  }
+  duration<double> const lookup_time = steady_clock::now() - lookup_start;
+
+  size_t map_count = 0;
+  auto const map_start = steady_clock::now();
+  for (auto const &message : messages) {
+    YamlKeyMap const keys{message};
+    for (auto const &[name, key] : message_keys) {
+      map_count += keys.find(key) != nullptr;
+    }
+  }
+  duration<double> const map_time = steady_clock::now() - map_start;
+  CHECK(map_count == lookup_count);
+
+  MessageHandler handler;
+  auto const load_start = steady_clock::now();
+  auto const errata = YamlParser::load_replay_file(path, handler);
+  duration<double> const load_time = steady_clock::now() - load_start;
+  REQUIRE(errata.is_ok());
+  CHECK(handler.n_messages == 40'000);
+
+  WARN(
+      "Dispatched the keys of " << messages.size() << " messages: lookups "
+                                << lookup_time.count() * 1000 << " ms, YamlKeyMap "
+                                << map_time.count() * 1000 << " ms. Loaded the 20000 "
+                                << "transaction replay file in " << load_time.count() * 1000
+                                << " ms.");
+}
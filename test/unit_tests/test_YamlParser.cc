@@ -6,10 +6,22 @@
  */
 
 #include "catch.hpp"
+#include "TemporaryPath.h"
+#include "core/Localizer.h"
+#include "core/ScalarSource.h"
 #include "core/YamlParser.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
 #include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 using namespace std::literals;
 using std::chrono::microseconds;
@@ -116,3 +128,182 @@ TEST_CASE("Verify interpretation of delay specification strings", "[delay_specif
     CHECK_FALSE(delay_errata.is_ok());
   }
 }
+
+TEST_CASE("Verify the replay file loader thread defaults", "[load_replay_files]")
+{
+  CHECK(YamlParser::get_default_thread_count() >= 1);
+  // Outside of a loader thread the index is 0, so per-thread containers can
+  // always be indexed with it.
+  CHECK(YamlParser::get_loader_thread_index() == 0);
+}
+
+TEST_CASE("Verify concurrent localization", "[load_replay_files]")
+{
+  // Loader threads localize field names concurrently.
+  constexpr int num_threads = 8;
+  std::vector<swoc::TextView> localized(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&localized, i]() {
+      for (int k = 0; k < 1000; ++k) {
+        Localizer::localize(std::to_string(k));
+        localized[i] = Localizer::localize_lower(swoc::TextView{"X-Concurrent-Field"sv});
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto const &name : localized) {
+    CHECK(name == "x-concurrent-field");
+    // Every thread is given the same interned copy of the name.
+    CHECK(name.data() == localized[0].data());
+  }
+}
+
+TEST_CASE("Verify transaction keys are derived from the unparsed nodes", "[derive_transaction_key]")
+{
+  auto const txn_node = YAML::Load(R"(
+    all: { headers: { fields: [[ uuid, all-key ]] } }
+    client-request:
+      method: GET
+      url: /path/to/object
+      headers: { fields: [[ Host, example.com ], [ UUID, client-key ]] }
+    proxy-request:
+      headers: { fields: [[ uuid, { value: proxy-key, as: equal } ]] }
+    server-response: { status: 200 }
+  )");
+  CHECK(YamlParser::derive_transaction_key(txn_node, YAML_CLIENT_REQ_KEY) == "client-key");
+  CHECK(YamlParser::derive_transaction_key(txn_node, YAML_PROXY_REQ_KEY) == "proxy-key");
+  // The "all" fields are used only if the request's own fields yield no key.
+  CHECK(YamlParser::derive_transaction_key(txn_node, YAML_SERVER_RSP_KEY) == "all-key");
+  CHECK(
+      YamlParser::derive_transaction_key(txn_node, YAML_SERVER_RSP_KEY, false) ==
+      HttpHeader::TRANSACTION_KEY_NOT_SET);
+
+  auto const original_key_format = HttpHeader::_key_format;
+  HttpHeader::set_key_format("{field.host}{url}");
+  CHECK(
+      YamlParser::derive_transaction_key(txn_node, YAML_CLIENT_REQ_KEY) ==
+      "example.com/path/to/object");
+  HttpHeader::set_key_format(original_key_format);
+}
+
+/** Write a file of the given content. */
+static void
+write_file(std::string const &path, std::string const &content)
+{
+  FILE *out = fopen(path.c_str(), "w");
+  REQUIRE(out != nullptr);
+  fwrite(content.data(), 1, content.size(), out);
+  fclose(out);
+}
+
+TEST_CASE("Verify replay directories are loaded recursively", "[load_replay_files]")
+{
+  TemporaryPath const temporary_dir{"test_YamlParser", TemporaryPath::Type::DIRECTORY};
+  auto const dir = temporary_dir.string();
+  REQUIRE(mkdir((dir + "/nested").c_str(), 0700) == 0);
+  write_file(dir + "/b.yaml", "small: 1\n");
+  write_file(dir + "/nested/a.json", R"({"large": ")" + std::string(1000, 'x') + R"("})");
+  write_file(dir + "/nested/notes.txt", "not a replay file");
+  write_file(dir + "/c.YAML", "medium: " + std::string(100, 'x') + "\n");
+
+  auto const n_threads = GENERATE(1, 2);
+  std::mutex files_mutex;
+  std::vector<std::string> files;
+  auto const errata = YamlParser::load_replay_files(
+      swoc::file::path{dir},
+      [&](swoc::file::path const &file) -> swoc::Errata {
+        std::lock_guard<std::mutex> lock(files_mutex);
+        files.push_back(YamlParser::get_relative_path(file, swoc::file::path{dir}));
+        return {};
+      },
+      n_threads);
+  REQUIRE(errata.is_ok());
+  if (n_threads == 1) {
+    // A single thread loads the files in path order.
+    CHECK(files == std::vector<std::string>{"b.yaml", "c.YAML", "nested/a.json"});
+  } else {
+    std::sort(files.begin(), files.end());
+    CHECK(files == std::vector<std::string>{"b.yaml", "c.YAML", "nested/a.json"});
+  }
+
+  CHECK(
+      YamlParser::get_relative_path(swoc::file::path{"/a/b.yaml"}, swoc::file::path{"/c"}) ==
+      "/a/b.yaml");
+}
+
+TEST_CASE("Verify parsed replay files are cached by content", "[parse_cache]")
+{
+  TemporaryPath const temporary_replay_dir{"test_YamlParser", TemporaryPath::Type::DIRECTORY};
+  TemporaryPath const temporary_cache_dir{"test_YamlParser", TemporaryPath::Type::DIRECTORY};
+  auto const replay_dir = temporary_replay_dir.string();
+  auto const cache_dir = temporary_cache_dir.string();
+  auto const replay_path = swoc::file::path{replay_dir + "/replay.yaml"};
+  write_file(replay_path.string(), "sessions: [ { transactions: [ a, b ] } ]\n");
+
+  CHECK_FALSE(YamlParser::set_parse_cache_dir(swoc::file::path{replay_path}).is_ok());
+  REQUIRE(YamlParser::set_parse_cache_dir(swoc::file::path{cache_dir}).is_ok());
+  auto &&[parsed_root, parsed_errata] = YamlParser::parse_replay_file(replay_path);
+  REQUIRE(parsed_errata.is_ok());
+  // The second parse is served from the entry written by the first.
+  auto &&[cached_root, cached_errata] = YamlParser::parse_replay_file(replay_path);
+  REQUIRE(cached_errata.is_ok());
+  CHECK(cached_root["sessions"][0]["transactions"][1].Scalar() == "b");
+
+  // A changed file is parsed again rather than taken from the cache.
+  write_file(replay_path.string(), "sessions: [ { transactions: [ c ] } ]\n");
+  auto &&[changed_root, changed_errata] = YamlParser::parse_replay_file(replay_path);
+  REQUIRE(changed_errata.is_ok());
+  CHECK(changed_root["sessions"][0]["transactions"][0].Scalar() == "c");
+
+  // Entries are named by the SHA-256 digest of the content, and the
+  // temporary files they are written through are renamed into place.
+  CHECK(
+      YamlParser::get_parse_cache_path("abc").string() ==
+      cache_dir + "/ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad.pvcache");
+  std::vector<std::string> entries;
+  for (auto const &entry : std::filesystem::directory_iterator{cache_dir}) {
+    entries.push_back(entry.path().extension().string());
+  }
+  CHECK(entries == std::vector<std::string>{".pvcache", ".pvcache"});
+  REQUIRE(YamlParser::set_parse_cache_dir(swoc::file::path{}).is_ok());
+}
+
+TEST_CASE("Verify rewriting a loaded replay file does not change its values", "[mapped_file]")
+{
+  TemporaryPath const temporary_dir{"test_YamlParser", TemporaryPath::Type::DIRECTORY};
+  auto const dir = temporary_dir.string();
+  auto const replay_path = swoc::file::path{dir + "/replay.json"};
+  // Large enough to be mapped rather than read.
+  auto const make_replay = [](std::string const &url) {
+    return R"({"sessions": [], "url": ")" + url + R"(", "padding": ")" +
+           std::string(100'000, 'x') + R"("})";
+  };
+  write_file(replay_path.string(), make_replay("/first"));
+
+  SECTION("A mapped file replaced by a rename")
+  {
+    REQUIRE(Localizer::can_retain());
+    auto &&[root, errata] = YamlParser::parse_replay_file(replay_path);
+    REQUIRE(errata.is_ok());
+    // The value refers to the mapping, which keeps the replaced file.
+    auto const url = ScalarSource::get(root["url"]);
+    REQUIRE(url == "/first");
+    write_file(dir + "/replay.json.new", make_replay("/other"));
+    REQUIRE(rename((dir + "/replay.json.new").c_str(), replay_path.c_str()) == 0);
+    CHECK(url == "/first");
+  }
+  SECTION("A file loaded into a scoped arena and rewritten in place")
+  {
+    swoc::MemArena arena;
+    Localizer::ScopedArena scoped_arena{arena};
+    auto &&[root, errata] = YamlParser::parse_replay_file(replay_path);
+    REQUIRE(errata.is_ok());
+    // Loading into a scoped arena reads the file rather than mapping it.
+    CHECK(ScalarSource::get(root["url"]).empty());
+    write_file(replay_path.string(), make_replay("/other"));
+    CHECK(root["url"].Scalar() == "/first");
+  }
+}
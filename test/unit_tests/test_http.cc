@@ -7,6 +7,17 @@
 
 #include "catch.hpp"
 #include "core/http.h"
+#include "core/KeyIndex.h"
+#include "core/verification.h"
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "swoc/bwf_base.h"
+
+using namespace std::literals;
 
 struct ParseUrlTestCase
 {
@@ -255,3 +266,221 @@ TEST_CASE("Test path parsing", "[ParseUrl]")
   CHECK(header.uri_query == test_case.expected_uri_query);
   CHECK(header.uri_fragment == test_case.expected_uri_fragment);
 }
+
+TEST_CASE("Test the cached HTTP/1 serialization", "[HttpHeader]")
+{
+  HttpHeader header;
+  header.set_is_http2();
+  header.set_is_response();
+  header._status = 200;
+  header._status_string = "200";
+  header._reason = "OK";
+  header._fields_rules->add_field("content-type", "text/html");
+  header._fields_rules->add_field("content-length", "10");
+
+  REQUIRE(header.cache_http1_serialization().is_ok());
+  CHECK(
+      header._http1_serialization ==
+      "HTTP/1.1 200 OK\r\ncontent-type: text/html\r\ncontent-length: 10\r\n\r\n");
+
+  // Caching does not change the protocol of the header itself.
+  CHECK(header.is_http2());
+  CHECK(header._http_version == "2");
+}
+
+TEST_CASE("Test the response overlay for a request", "[HttpHeader]")
+{
+  HttpHeader response;
+  response.set_is_http2();
+  response.set_is_response();
+  response._status = 200;
+  response._content_size = 10;
+  response._fields_rules->add_field("content-length", "10");
+
+  HttpHeader request;
+  request.set_is_request(HTTP_PROTOCOL_TYPE::HTTP_3);
+  request._stream_id = 4;
+
+  SECTION("GET")
+  {
+    request._method = "GET";
+    MessageOverlay const overlay{response, request};
+    CHECK(overlay.protocol == HTTP_PROTOCOL_TYPE::HTTP_3);
+    CHECK(overlay.http_version == "3");
+    CHECK(overlay.stream_id == 4);
+    CHECK(overlay.content_size == 10);
+    CHECK(overlay.content_length_p);
+  }
+  SECTION("HEAD")
+  {
+    request._method = "HEAD";
+    MessageOverlay const overlay{response, request};
+    CHECK(overlay.content_size == 0);
+    CHECK(overlay.content_length_p);
+  }
+
+  // The overlay does not modify the shared response.
+  CHECK(response.is_http2());
+  CHECK(response._stream_id == -1);
+  CHECK(response._content_size == 10);
+  CHECK_FALSE(response._content_length_p);
+}
+
+TEST_CASE("Test transaction compaction", "[Txn]")
+{
+  Txn txn{false};
+  txn._req.set_is_request();
+  txn._req._fields_rules->add_field("host", "example.com");
+  txn._req._fields_rules->add_field("uuid", "1");
+  txn._req._fields_rules->add_field("x-request", "first");
+  txn._rsp._fields_rules->add_field("content-length", "10");
+
+  auto const loaded_bytes = txn.get_memory_footprint();
+  txn.compact();
+  CHECK(txn.get_memory_footprint() <= loaded_bytes);
+  CHECK(txn._req._fields_rules->_fields_sequence.capacity() == 3);
+  CHECK(txn._rsp._fields_rules->_fields_sequence.capacity() == 1);
+
+  // Compaction does not change the fields.
+  auto const spot = txn._req._fields_rules->_fields.find("Host");
+  REQUIRE(spot != txn._req._fields_rules->_fields.end());
+  CHECK(spot->second == "example.com");
+  CHECK(txn._req._fields_rules->_fields_sequence[2].value == "first");
+}
+
+TEST_CASE("Test verification against shared rules", "[HttpHeader]")
+{
+  RuleCheck::options_init();
+  auto global_rules = std::make_shared<HttpFields>();
+  global_rules->_rules.emplace("x-global", RuleCheck::make_rule_check("x-global", "", "present"));
+
+  HttpFields expected;
+  expected._rules.emplace("uuid", RuleCheck::make_equality("uuid", "1"));
+  expected.add_shared_rules(global_rules);
+  // A set without rules is not referred to.
+  expected.add_shared_rules(std::make_shared<HttpFields>());
+  CHECK(expected._shared_rules.size() == 1);
+
+  HttpHeader received;
+  received.set_is_request();
+  received._fields_rules->add_field("uuid", "1");
+
+  SECTION("shared rule violated")
+  {
+    CHECK(received.verify_headers("1", expected));
+  }
+  SECTION("shared rule satisfied")
+  {
+    received._fields_rules->add_field("x-global", "yes");
+    CHECK_FALSE(received.verify_headers("1", expected));
+  }
+
+  // The shared set is not modified.
+  CHECK(global_rules->_rules.size() == 1);
+}
+
+TEST_CASE("Test key derivation from compiled key formats", "[HttpHeader]")
+{
+  auto const &[key_format, expected_key] = GENERATE(
+      std::make_pair("{field.uuid}"s, "42"s),
+      std::make_pair("{field.HOST}/{url}"s, "example.com//a/b?c"s),
+      std::make_pair("{URL}"s, "/a/b?c"s),
+      std::make_pair("key-{field.missing}-"s, "key-*N/A*-"s),
+      std::make_pair(""s, ""s),
+      // Doubled braces are literal braces.
+      std::make_pair("{{{field.uuid}}}"s, "{42}"s),
+      std::make_pair("{{url}}-{url}"s, "{url}-/a/b?c"s),
+      // Specifiers with format options are formatted rather than compiled.
+      std::make_pair("{field.uuid:>4}"s, "  42"s));
+
+  auto const original_key_format = HttpHeader::_key_format;
+  HttpHeader::set_key_format(key_format);
+  HttpHeader request;
+  auto &&[result, errata] =
+      request.parse_request("GET /a/b?c HTTP/1.1\r\nHost: example.com\r\nuuid: 42\r\n\r\n");
+  HttpHeader::set_key_format(original_key_format);
+
+  INFO(key_format);
+  REQUIRE(result == HttpHeader::PARSE_OK);
+  CHECK(request.get_key() == expected_key);
+}
+
+namespace
+{
+/// Formats a key field by field, as derive_key did before formats were
+/// compiled.
+class FormattedKeyBinding : public swoc::bwf::NameBinding
+{
+public:
+  FormattedKeyBinding(HttpHeader const &hdr) : _hdr(hdr) { }
+
+  swoc::BufferWriter &
+  operator()(swoc::BufferWriter &w, swoc::bwf::Spec const &spec) const override
+  {
+    swoc::TextView name{spec._name};
+    name.remove_prefix(swoc::TextView{"field."}.size());
+    auto const spot = _hdr._fields_rules->_fields.find(name);
+    return bwformat(w, spec, spot->second);
+  }
+
+private:
+  HttpHeader const &_hdr;
+};
+} // namespace
+
+// This is hidden by default. Run it via: tests "[benchmark]"
+TEST_CASE("Key derivation rate on the server request path", "[.][benchmark][HttpHeader]")
+{
+  using Clock = std::chrono::steady_clock;
+  constexpr size_t num_requests = 1'000'000;
+  constexpr size_t num_keys = 1000;
+
+  KeyIndex<size_t> index;
+  std::vector<std::string> requests;
+  requests.reserve(num_keys);
+  for (size_t i = 0; i < num_keys; ++i) {
+    auto const key = "6f4c2b0e-" + std::to_string(1'000'000 + i);
+    index.emplace(key, i);
+    requests.push_back(
+        "GET /path/" + key + " HTTP/1.1\r\nHost: example.com\r\nAccept: */*\r\n" +
+        "User-Agent: benchmark\r\nuuid: " + key + "\r\nX-Request: 1\r\n\r\n");
+  }
+
+  // As the server does per request: parse the request, which derives its
+  // key, and look up the transaction for the key.
+  size_t found = 0;
+  auto start = Clock::now();
+  for (size_t i = 0; i < num_requests; ++i) {
+    HttpHeader request;
+    request.parse_request(requests[i % num_keys]);
+    found += index.find(request.get_key()) != nullptr;
+  }
+  std::chrono::duration<double> const compiled_duration = Clock::now() - start;
+  CHECK(found == num_requests);
+
+  found = 0;
+  start = Clock::now();
+  for (size_t i = 0; i < num_requests; ++i) {
+    HttpHeader request;
+    // A set key is not derived by parse_request.
+    request.set_key("formatted");
+    request.parse_request(requests[i % num_keys]);
+    // This is how keys were derived before: formatted twice, once to size
+    // the key and once to write it.
+    std::string key;
+    FormattedKeyBinding binding{request};
+    swoc::FixedBufferWriter w{nullptr};
+    w.print_n(binding, HttpHeader::_key_format);
+    key.resize(w.extent());
+    swoc::FixedBufferWriter{key.data(), key.size()}.print_n(binding, HttpHeader::_key_format);
+    found += index.find(key) != nullptr;
+  }
+  std::chrono::duration<double> const formatted_duration = Clock::now() - start;
+  CHECK(found == num_requests);
+
+  WARN(
+      "Compiled key format: " << static_cast<uint64_t>(num_requests / compiled_duration.count())
+                              << " requests/s, formatted key: "
+                              << static_cast<uint64_t>(num_requests / formatted_duration.count())
+                              << " requests/s.");
+}